@@ -114,13 +114,20 @@ class Circuit : public IOperation<Time> {
     state.Reset();
     if (!sim) return;
 
+    LayerGrouper layers(sim);
     for (const auto& op : operations) {
+      layers.Add(op);
       op->Execute(sim, state);
       if (curMaxBondDim) {
         const auto bondDim = sim->GetCurrentMaxBondDimension();
         if (bondDim > *curMaxBondDim) *curMaxBondDim = bondDim;
       }
     }
+    layers.End();
+    if (curMaxBondDim) {
+      const auto bondDim = sim->GetCurrentMaxBondDimension();
+      if (bondDim > *curMaxBondDim) *curMaxBondDim = bondDim;
+    }
     // sim->Flush();
   }
 
@@ -1709,6 +1716,7 @@ class Circuit : public IOperation<Time> {
 
     bool executionStopped = false;
 
+    LayerGrouper layers(sim);
     for (size_t i = 0; i < operations.size(); ++i) {
       auto &op = operations[i];
       const auto qubits = op->AffectedQubits();
@@ -1732,6 +1740,7 @@ class Circuit : public IOperation<Time> {
 
         if (executed) {
           if (sim) {
+            layers.Add(op);
             op->Execute(sim, state);
             if (curMaxBondDim) {
               const auto bondDim = sim->GetCurrentMaxBondDimension();
@@ -1770,6 +1779,7 @@ class Circuit : public IOperation<Time> {
 
         if (canExecute) {
           if (sim) {
+            layers.Add(op);
             op->Execute(sim, state);
             if (curMaxBondDim) {
               const auto bondDim = sim->GetCurrentMaxBondDimension();
@@ -1798,6 +1808,12 @@ class Circuit : public IOperation<Time> {
       if (executionStopped) executedOps.emplace_back(executed);
     }
 
+    layers.End();
+    if (sim && curMaxBondDim) {
+      const auto bondDim = sim->GetCurrentMaxBondDimension();
+      if (bondDim > *curMaxBondDim) *curMaxBondDim = bondDim;
+    }
+
     // if (sim) sim->Flush();
 
     return executedOps;
@@ -1827,14 +1843,21 @@ class Circuit : public IOperation<Time> {
 
     const size_t dif = operations.size() - executedOps.size();
 
+    LayerGrouper layers(sim);
     for (size_t i = dif; i < operations.size(); ++i)
       if (!executedOps[i - dif]) {
+        layers.Add(operations[i]);
         operations[i]->Execute(sim, state);
         if (curMaxBondDim) {
           const auto bondDim = sim->GetCurrentMaxBondDimension();
           if (bondDim > *curMaxBondDim) *curMaxBondDim = bondDim;
         }
       }
+    layers.End();
+    if (curMaxBondDim) {
+      const auto bondDim = sim->GetCurrentMaxBondDimension();
+      if (bondDim > *curMaxBondDim) *curMaxBondDim = bondDim;
+    }
 
     // sim->Flush();
   }
@@ -2595,6 +2618,60 @@ class Circuit : public IOperation<Time> {
   }
 
  private:
+  /**
+   * @brief Groups the consecutive gates on disjoint qubits in layers.
+   *
+   * The mps simulator can apply the two qubits gates of a layer that act on
+   * disjoint bonds in parallel, for the other simulators nothing is grouped.
+   * Any other operation ends the layer.
+   * @sa Simulators::IState::BeginLayer
+   */
+  class LayerGrouper {
+   public:
+    explicit LayerGrouper(
+        const std::shared_ptr<Simulators::ISimulator> &simulator)
+        : sim(simulator && simulator->GetSimulationType() ==
+                               Simulators::SimulationType::kMatrixProductState
+                  ? simulator
+                  : nullptr) {}
+
+    // to be called before the operation is executed
+    void Add(const OperationPtr &op) {
+      if (!sim) return;
+
+      if (op->GetType() != OperationType::kGate) {
+        End();
+        return;
+      }
+
+      const auto qubits = op->AffectedQubits();
+      for (const auto qubit : qubits)
+        if (layerQubits.find(qubit) != layerQubits.end()) {
+          End();
+          break;
+        }
+
+      if (!open) {
+        sim->BeginLayer();
+        open = true;
+      }
+      layerQubits.insert(qubits.begin(), qubits.end());
+    }
+
+    void End() {
+      if (!open) return;
+
+      sim->EndLayer();
+      open = false;
+      layerQubits.clear();
+    }
+
+   private:
+    std::shared_ptr<Simulators::ISimulator> sim;
+    std::unordered_set<Types::qubit_t> layerQubits;
+    bool open = false;
+  };
+
   /**
    * @brief Replaces the swap gate and three qubit gates with other operations
    *
@@ -213,6 +213,9 @@ class ExecutionCost {
           cost += opOrder * affectedQubits.size();
       }
       return cost;
+    } else if (method == Simulators::SimulationType::kExtendedStabilizer) {
+      double nrTerms = 1;
+      return ExtendedStabilizerCost(nrQubits, circuit, nrTerms);
     } else if (method == Simulators::SimulationType::kPathIntegral) {
       double cost = 0;
       double doublingCost = 1;
@@ -452,6 +455,14 @@ class ExecutionCost {
       // the overhead for saving / restoring is not here (it's of the same order
       // as measuring), but measurements are not all O(n^2) anyways
       return cost + samples * measOrder * nrQubitsSampled;
+    } else if (method == Simulators::SimulationType::kExtendedStabilizer) {
+      // sampling is done with saving state, measuring and restoring state, a
+      // measurement collapses the tableau and goes over all the terms
+      double nrTerms = 1;
+      const double cost = ExtendedStabilizerCost(nrQubits, circuit, nrTerms);
+
+      return cost + samples * nrQubitsSampled *
+                        (pow(nrQubits, 2) + 2. * nrTerms * nrQubits);
     } else if (method == Simulators::SimulationType::kPathIntegral) {
       double cost = 0;
       double doublingCost = 1;
@@ -552,6 +563,12 @@ class ExecutionCost {
     } else if (method == Simulators::SimulationType::kStabilizer) {
       cost += nrQubits * nrQubits;
       return cost;
+    } else if (method == Simulators::SimulationType::kExtendedStabilizer) {
+      // the decomposition on the tableau, then a lookup for each term
+      double nrTerms = 1;
+      ExtendedStabilizerCost(nrQubits, circuit, nrTerms);
+      cost += nrQubits * nrQubits + nrTerms * log2(nrTerms + 1.) * nrQubits;
+      return cost;
     } else if (method == Simulators::SimulationType::kPathIntegral) {
       double doublingCost = 1;
       for (const auto& op : *circuit) {
@@ -1135,6 +1152,111 @@ class ExecutionCost {
     log.Log(ss.str());
   }
 
+  /**
+   * @brief The number of times an operation can double the extended stabilizer
+   * terms.
+   *
+   * Follows the decomposition used by the extended stabilizer simulator, where
+   * each non-Clifford phase rotation can double the terms: the phase gates and
+   * the rotations are a single rotation, a generic single qubit gate is
+   * decomposed in three, a controlled gate in five on the target and one on the
+   * control, and the three qubit gates in seven T gates.
+   *
+   * @param op The operation.
+   * @return The (upper bound of the) number of doublings.
+   */
+  template <typename Time = Types::time_type>
+  static size_t ExtendedStabilizerDoublings(
+      const std::shared_ptr<Circuits::IOperation<Time>>& op) {
+    if (op->GetType() == Circuits::OperationType::kConditionalGate)
+      return ExtendedStabilizerDoublings(
+          std::static_pointer_cast<Circuits::ConditionalGate<Time>>(op)
+              ->GetOperation());
+
+    if (op->GetType() != Circuits::OperationType::kGate || op->IsClifford())
+      return 0;
+
+    switch (std::static_pointer_cast<Circuits::IQuantumGate<Time>>(op)
+                ->GetGateType()) {
+      case Circuits::QuantumGateType::kPhaseGateType:
+      case Circuits::QuantumGateType::kTGateType:
+      case Circuits::QuantumGateType::kTdgGateType:
+      case Circuits::QuantumGateType::kRxGateType:
+      case Circuits::QuantumGateType::kRyGateType:
+      case Circuits::QuantumGateType::kRzGateType:
+        return 1;
+      case Circuits::QuantumGateType::kCSwapGateType:
+      case Circuits::QuantumGateType::kCCXGateType:
+        return 7;
+      default:
+        break;
+    }
+
+    const size_t nrQubits = op->AffectedQubits().size();
+
+    return nrQubits == 1 ? 3 : nrQubits == 2 ? 6 : 7;
+  }
+
+  /**
+   * @brief The number of times a circuit can double the extended stabilizer
+   * terms.
+   *
+   * @param circuit The circuit.
+   * @return The (upper bound of the) number of doublings.
+   */
+  template <typename Time = Types::time_type>
+  static size_t ExtendedStabilizerDoublings(
+      const std::shared_ptr<Circuits::Circuit<Time>>& circuit) {
+    size_t doublings = 0;
+    for (const auto& op : circuit->GetOperations())
+      doublings += ExtendedStabilizerDoublings(op);
+
+    return doublings;
+  }
+
+  /**
+   * @brief The execution cost for the extended stabilizer simulator.
+   *
+   * The Clifford gates are applied on the tableau only, each non-Clifford
+   * phase rotation can double the number of terms (see
+   * ExtendedStabilizerDoublings) and costs a pass over the terms and their
+   * sorting.
+   *
+   * @param nrQubits The number of qubits.
+   * @param circuit The circuit.
+   * @param nrTerms Receives the (upper bound of the) number of terms at the
+   * end of the circuit.
+   * @return The cost.
+   */
+  static double ExtendedStabilizerCost(
+      size_t nrQubits, const std::shared_ptr<Circuits::Circuit<>>& circuit,
+      double& nrTerms) {
+    const double measOrder = pow(nrQubits, 2);
+    const double opOrder = static_cast<double>(nrQubits);
+
+    double cost = 0;
+    nrTerms = 1;
+    for (const auto& op : *circuit) {
+      const auto affectedQubits = op->AffectedQubits();
+      if (op->GetType() == Circuits::OperationType::kMeasurement ||
+          op->GetType() == Circuits::OperationType::kConditionalMeasurement ||
+          op->GetType() == Circuits::OperationType::kReset)
+        cost += (measOrder + 2. * nrTerms * opOrder) * affectedQubits.size();
+      else if (op->GetType() == Circuits::OperationType::kGate ||
+               op->GetType() == Circuits::OperationType::kConditionalGate) {
+        cost += opOrder * affectedQubits.size();
+
+        const size_t doublings = ExtendedStabilizerDoublings(op);
+        for (size_t i = 0; i < doublings; ++i) {
+          nrTerms *= 2;
+          cost += measOrder + nrTerms * (opOrder + log2(nrTerms));
+        }
+      }
+    }
+
+    return cost;
+  }
+
   static std::shared_ptr<Utils::MultipleLinearRegression> GetRegressor(
       const std::string& logFilePath,
       const std::vector<size_t>& featureIndices) {
@@ -18,6 +18,7 @@
 #include <boost/container_hash/hash.hpp>
 #include <complex>
 #include <memory>
+#include <optional>
 #include <unordered_set>
 #include <vector>
 
@@ -169,6 +170,25 @@ class INetwork : public std::enable_shared_from_this<INetwork<Time>> {
       const std::shared_ptr<Circuits::Circuit<Time>> &circuit,
       size_t hostId) = 0;
 
+  /**
+   * @brief Execute circuit on host and return the amplitudes of the specified
+   * basis states.
+   *
+   * Execute the circuit on the specified host and return the complex
+   * amplitudes of the specified basis states of the resulting quantum state,
+   * without computing the whole statevector. The circuit must fit on the host,
+   * otherwise an exception is thrown.
+   *
+   * @param circuit The circuit to execute.
+   * @param hostId The id of the host to execute the circuit on.
+   * @param outcomes The basis states to obtain the amplitudes for.
+   * @return A vector of complex amplitudes, in the order of the outcomes.
+   * @sa Circuits::Circuit
+   */
+  virtual std::vector<std::complex<double>> ExecuteOnHostAmplitudes(
+      const std::shared_ptr<Circuits::Circuit<Time>> &circuit, size_t hostId,
+      const std::vector<Types::qubit_t> &outcomes) = 0;
+
   /**
    * @brief Execute circuit on host and return the projection onto the zero
    * state.
@@ -1010,6 +1030,27 @@ class INetwork : public std::enable_shared_from_this<INetwork<Time>> {
    * (mps simulator, either qcsim or gpu).
    */
   virtual size_t GetCurrentMaxBondDimension() const { return 0; }
+
+  /**
+   * @brief Returns the truncation error bounds of the last expectation values.
+   *
+   * Returns, for each Pauli string of the last expectation values execution, a
+   * bound of the error the truncation introduced in its expectation value, if
+   * applicable (qcsim pauli propagator). Empty if not available.
+   */
+  virtual std::vector<double> GetTruncationErrors() const { return {}; }
+
+  /**
+   * @brief Returns the lower bound of the fidelity of the last execution.
+   *
+   * Returns the lower bound of the fidelity of the last execution, if a target
+   * fidelity was set for the mps simulator. The bound is derived from the
+   * fixed singular values cutoff and the max bond dimension reached. None if
+   * not available, for example if the max bond dimension was reached.
+   */
+  virtual std::optional<double> GetMPSFidelityLowerBound() const {
+    return std::nullopt;
+  }
 };
 
 }  // namespace Network
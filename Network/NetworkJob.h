@@ -13,10 +13,15 @@
 #ifndef _NETWORK_JOB_H
 #define _NETWORK_JOB_H
 
+#include <limits>
+#include <random>
+
 #include "../Types.h"
 #include "../Utils/ThreadsPool.h"
 
-#include "../Simulators/MPSDummySimulator.h"
+#include "../Simulators/MPSFidelityBudget.h"
+#include "../Simulators/MPSLayoutCache.h"
+#include "../Simulators/PauliFrameSampler.h"
 
 #include "Network.h"
 
@@ -48,6 +53,15 @@ class ExecuteJob {
   void DoWork() {
     if (curCnt == 0) return;
 
+    {
+      ExecuteResults frameRes;
+      if (SampleWithPauliFrames(frameRes)) {
+        const std::lock_guard lock(resultsMutex);
+        for (const auto &r : frameRes) res[r.first] += r.second;
+        return;
+      }
+    }
+
     Circuits::OperationState state;
     state.AllocateBits(nrCbits);
 
@@ -187,6 +201,8 @@ class ExecuteJob {
   void DoWorkNoLock() {
     if (curCnt == 0) return;
 
+    if (SampleWithPauliFrames(res)) return;
+
     Circuits::OperationState state;
     state.AllocateBits(nrCbits);
 
@@ -373,9 +389,49 @@ class ExecuteJob {
   size_t GetJobCount() const { return curCnt; }
 
 private:
+  // Stabilizer circuits without classical control are sampled with Pauli
+  // frames: the circuit is simulated once on the tableau to get a reference
+  // sample and all the shots are derived from it by propagating bit-packed
+  // frames, instead of measuring (and restoring) the tableau for each shot.
+  bool SampleWithPauliFrames(ExecuteResults &results) {
+    if (!optimiseMultipleShotsExecution || curCnt < 2 ||
+        method != Simulators::SimulationType::kStabilizer ||
+        !Simulators::PauliFrameSampler<Time>::CanSample(dcirc))
+      return false;
+
+    if (!optSim) {
+      optSim = Simulators::SimulatorsFactory::CreateSimulator(simType, method);
+      if (!optSim) return false;
+
+      config.ApplyConfigurationToSimulator(optSim);
+      optSim->AllocateQubits(nrQubits);
+      optSim->Initialize();
+    } else if (optSim->GetNumberOfQubits() != nrQubits) {
+      optSim->Clear();
+      config.ApplyConfigurationToSimulator(optSim);
+      optSim->AllocateQubits(nrQubits);
+      optSim->Initialize();
+    } else
+      optSim->Reset();  // some gates might have been already executed on it
+    optSim->SetGatesCounter(0);
+
+    Simulators::PauliFrameSampler<Time> sampler(dcirc, nrQubits, nrCbits);
+    sampler.ComputeReference(optSim);
+
+    std::random_device rd;
+    const uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+
+    for (const auto &r : sampler.Sample(curCnt, nrResultCbits, seed))
+      results[r.first] += r.second;
+
+    return true;
+  }
+
   void OptimizeMPSInitialQubitsMap(
       std::shared_ptr<Simulators::ISimulator> &sim,
       std::shared_ptr<Circuits::Circuit<Time>> &dcirc, size_t nrQubits) const {
+    mpsFidelityBudget.Apply(sim);
+
     if (sim->GetSimulationType() ==
             Simulators::SimulationType::kMatrixProductState &&
         (network->GetInitialQubitsMapOptimization() ||
@@ -400,49 +456,34 @@ private:
             dummySim.SetMaxBondDimension(maxBondDimValue);
           
           if (network->GetInitialQubitsMapOptimization()) {
-            const auto optimalMap = dummySim.ComputeOptimalQubitsMap(layers);
+            const auto optimalMap =
+                Simulators::MPSLayoutCache::GetInstance().GetOptimalQubitsMap(
+                    dummySim, layers);
             sim->SetInitialQubitsMap(optimalMap);
           }
 
           dcirc = Circuits::Circuit<Time>::LayersToCircuit(layers);
 
           if (network->GetMPSOptimizeSwaps()) {
-            // TODO: come up with something better!
+            // with the default (automatic) depth, the estimate from the
+            // circuit shape is only the upper limit, the simulator tunes the
+            // depth at runtime from the measured cost of the decisions
             int lookaheadDepthLocal = network->GetLookaheadDepth();
+            const bool autoTuneLookahead =
+                lookaheadDepthLocal == std::numeric_limits<int>::max();
 
-            if (lookaheadDepthLocal == std::numeric_limits<int>::max()) {
-              double avgTwoQubitGatesPerLayer = 0.0;
-              for (const auto &layer : layers) {
-                int twoQubitGates = 0;
-                for (const auto &op : layer->GetOperations()) {
-                  if (op->AffectedQubits().size() >= 2) {
-                    ++twoQubitGates;
-                  }
-                }
-                avgTwoQubitGatesPerLayer += twoQubitGates;
-              }
-              avgTwoQubitGatesPerLayer /= layers.size();
-
-              int lookaheadVal =
-                  static_cast<int>(4. * avgTwoQubitGatesPerLayer);
-              if (lookaheadVal > 15) lookaheadVal = 15;
-
+            if (autoTuneLookahead)
               lookaheadDepthLocal =
-                  layers.size() < 8 || nrQubits <= 10 ? 0
-                  : layers.size() < 15 ? static_cast<int>(lookaheadVal)
-                  : layers.size() < 25 ? static_cast<int>(1.5 * lookaheadVal)
-                                       : 2 * lookaheadVal;
-            }
+                  Simulators::MPSDummySimulator::EstimateLookaheadDepth(
+                      layers, nrQubits);
 
             int lookaheadHeuristicDepthLocal =
                 network->GetLookaheadDepthWithHeuristic();
 
             if (lookaheadHeuristicDepthLocal == std::numeric_limits<int>::max())
-              lookaheadHeuristicDepthLocal =
-                  layers.size() < 10 || nrQubits <= 10 ? 0
-                                             : layers.size() < 20
-                                                 ? lookaheadDepthLocal - 1
-                                                 : lookaheadDepthLocal - 2;
+              lookaheadHeuristicDepthLocal = Simulators::MPSDummySimulator::
+                  EstimateLookaheadDepthWithHeuristic(
+                      layers.size(), nrQubits, lookaheadDepthLocal);
 
             if (lookaheadHeuristicDepthLocal < 0)
               lookaheadHeuristicDepthLocal = 0;
@@ -450,6 +491,7 @@ private:
             sim->SetUseOptimalMeetingPosition(true);
             sim->SetLookaheadDepth(lookaheadDepthLocal);
             sim->SetLookaheadDepthWithHeuristic(lookaheadHeuristicDepthLocal);
+            sim->SetLookaheadAutoTune(autoTuneLookahead);
             sim->setGrowthFactorGate(network->getGrowthFactorGate());
             sim->setGrowthFactorSwap(network->getGrowthFactorSwap());
             sim->SetUpcomingGates(dcirc->GetOperations());
@@ -478,6 +520,9 @@ public:
   // relevant only if the simulator is not passed or the simulator doesn't have the proper number of qubits,
   // otherwise the simulator is already configured
   Configuration<Time> config;
+  // the truncation derived from the target fidelity, computed by the network
+  // for the whole circuit
+  Simulators::MPSFidelityBudget mpsFidelityBudget;
 
   std::shared_ptr<Network::INetwork<Time>> network;
   size_t* curMaxBondDim = nullptr;
@@ -18,10 +18,12 @@
 #include "QubitRegister.h"
 #include "SimpleController.h"
 #include "SimpleHost.h"
+#include "../Estimators/ExecutionCost.h"
 #include "../Estimators/SimulatorsEstimatorInterface.h"
 #include "NetworkJob.h"
 
-#include "../Simulators/MPSDummySimulator.h"
+#include "../Simulators/MPSFidelityBudget.h"
+#include "../Simulators/MPSLayoutCache.h"
 
 #include "Configuration.h"
 
@@ -218,6 +220,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
     recreateIfNeeded = false;
 
     pauliStrings = &paulis;
+    truncationErrors.clear();
     const auto res = RepeatedExecute(circuit, 1);
     pauliStrings = nullptr;
 
@@ -239,6 +242,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
         // convert the classical state results back to the expected order
         const auto &qubitsMap = optimiser->GetQubitsMap();
 
+        std::vector<std::string> translatedPaulis(paulis.size());
         for (size_t i = 0; i < paulis.size(); ++i) {
           std::string translated(numOps, 'I');
 
@@ -250,12 +254,14 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
               translated[j] = paulis[i][j];
           }
 
-          expectations[i] = simulator->ExpectationValue(translated);
+          translatedPaulis[i] = std::move(translated);
         }
-      } else {
-        for (size_t i = 0; i < paulis.size(); ++i)
-          expectations[i] = simulator->ExpectationValue(paulis[i]);
-      }
+
+        expectations = simulator->ExpectationValues(translatedPaulis);
+      } else
+        expectations = simulator->ExpectationValues(paulis);
+
+      truncationErrors = simulator->GetTruncationErrors();
     }
 
     if (recreate && (!simulator || simType != simulator->GetType() ||
@@ -310,6 +316,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
     } restoreGuard(recreateIfNeeded, &pauliStrings);
 
     pauliStrings = &paulis;
+    truncationErrors.clear();
     const auto res = RepeatedExecuteOnHost(circuit, hostId, 1);
 
     // put the results in the state
@@ -330,6 +337,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
       const size_t numOps = simulator->GetNumberOfQubits();
 
       // convert the pauli strings to the actual qubits order
+      std::vector<std::string> translatedPaulis(paulis.size());
       for (size_t i = 0; i < paulis.size(); ++i) {
         std::string translated(std::max(numOps, paulis[i].size()), 'I');
 
@@ -347,8 +355,11 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
 
         // std::cout << "Translated pauli string: " << translated << std::endl;
 
-        expectations[i] = simulator->ExpectationValue(translated);
+        translatedPaulis[i] = std::move(translated);
       }
+
+      expectations = simulator->ExpectationValues(translatedPaulis);
+      truncationErrors = simulator->GetTruncationErrors();
     } else {
       throw std::runtime_error(
           "ExecuteOnHostExpectations: no simulator available after execution.");
@@ -376,79 +387,67 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
   std::vector<std::complex<double>> ExecuteOnHostAmplitudes(
       const std::shared_ptr<Circuits::Circuit<Time>> &circuit,
       size_t hostId) override {
-    const auto recreate = recreateIfNeeded;
-
-    auto simType = Simulators::SimulatorType::kQCSim;
-    auto method = Simulators::SimulationType::kMatrixProductState;
-    size_t numQubits = 2;
-    if (simulator) {
-      simType = simulator->GetType();
-      method = simulator->GetSimulationType();
-      numQubits = simulator->GetNumberOfQubits();
-    }
-
-    // RAII: restore recreateIfNeeded on any exit path (including exceptions).
-    struct ScopedRestoreFlag {
-      bool &flag, saved;
-      ScopedRestoreFlag(bool &f) : flag(f), saved(f) { flag = false; }
-      ~ScopedRestoreFlag() { flag = saved; }
-    } restoreGuard(recreateIfNeeded);
-
-    const auto res = RepeatedExecuteOnHost(circuit, hostId, 1);
-
-    if (!res.empty()) {
-      const auto &first = *res.begin();
-      GetState().SetResultsInOrder(first.first);
-    }
-
-    if (!simulator)
-      throw std::runtime_error(
-          "ExecuteOnHostAmplitudes: no simulator available after execution.");
-
-    std::vector<std::complex<double>> amplitudes;
-    const size_t n = simulator->GetNumberOfQubits();
-    const size_t dim = 1ULL << n;
-    amplitudes.resize(dim);
-    for (size_t state = 0; state < dim; ++state)
-      amplitudes[state] = simulator->Amplitude(state);
-
-    // Remap amplitudes back to the original qubit ordering if qubits were
-    // remapped during execution on the host.
-    if (!qubitsMapOnHost.empty()) {
-      const size_t offsetBase = qubitsMapOnHost.size();
-
-      // Build reverse mapping: simulator qubit position -> original qubit
-      // position.
-      std::vector<size_t> simToOrig(n);
-      size_t offset = offsetBase;
-
-      for (size_t qbit = 0; qbit < n; ++qbit) {
-        auto pos = qubitsMapOnHost.find(qbit);
-        if (pos != qubitsMapOnHost.end())
-          simToOrig[pos->second] = pos->first;
-        else
-          simToOrig[qbit] = offset++;
+    return ExecuteOnHostForAmplitudes(circuit, hostId, [this]() {
+      const size_t n = simulator->GetNumberOfQubits();
+      const size_t dim = 1ULL << n;
+      std::vector<Types::qubit_t> states(dim);
+      for (size_t state = 0; state < dim; ++state) states[state] = state;
+      auto amplitudes = simulator->Amplitudes(states);
+
+      // Remap amplitudes back to the original qubit ordering if qubits were
+      // remapped during execution on the host.
+      if (!qubitsMapOnHost.empty()) {
+        const auto simToOrig = GetSimulatorToOriginalQubits(n);
+
+        std::vector<std::complex<double>> remapped(dim);
+
+        for (size_t sim_state = 0; sim_state < dim; ++sim_state) {
+          size_t orig_state = 0;
+          for (size_t qbit = 0; qbit < n; ++qbit) {
+            if (sim_state & (1ULL << qbit))
+              orig_state |= (1ULL << simToOrig[qbit]);
+          }
+          if (orig_state < dim) remapped[orig_state] = amplitudes[sim_state];
+        }
+        amplitudes.swap(remapped);
       }
 
-      std::vector<std::complex<double>> remapped(dim);
+      return amplitudes;
+    });
+  }
 
-      for (size_t sim_state = 0; sim_state < dim; ++sim_state) {
-        size_t orig_state = 0;
-        for (size_t qbit = 0; qbit < n; ++qbit) {
-          if (sim_state & (1ULL << qbit))
-            orig_state |= (1ULL << simToOrig[qbit]);
-        }
-        if (orig_state < dim) remapped[orig_state] = amplitudes[sim_state];
-      }
-      amplitudes.swap(remapped);
-    }
+  /**
+   * @brief Execute circuit on host and return the amplitudes of the specified
+   * basis states.
+   *
+   * Execute the circuit on the specified host and return the complex
+   * amplitudes of the specified basis states of the resulting quantum state.
+   * The amplitudes are obtained all at once from the simulator, so the ones
+   * that can share work between them (the tensor network one, for example)
+   * can do so.
+   *
+   * @param circuit The circuit to execute.
+   * @param hostId The id of the host to execute the circuit on.
+   * @param outcomes The basis states, in the original qubits ordering.
+   * @return A vector of complex amplitudes, in the order of the outcomes.
+   */
+  std::vector<std::complex<double>> ExecuteOnHostAmplitudes(
+      const std::shared_ptr<Circuits::Circuit<Time>> &circuit, size_t hostId,
+      const std::vector<Types::qubit_t> &outcomes) override {
+    return ExecuteOnHostForAmplitudes(circuit, hostId, [this, &outcomes]() {
+      if (qubitsMapOnHost.empty()) return simulator->Amplitudes(outcomes);
 
-    if (recreate && (!simulator || simType != simulator->GetType() ||
-                     method != simulator->GetSimulationType() ||
-                     simulator->GetNumberOfQubits() != numQubits))
-      CreateSimulator(simType, method);
+      const size_t n = simulator->GetNumberOfQubits();
+      const auto simToOrig = GetSimulatorToOriginalQubits(n);
 
-    return amplitudes;
+      std::vector<Types::qubit_t> simOutcomes(outcomes.size(), 0);
+      for (size_t i = 0; i < outcomes.size(); ++i)
+        for (size_t qbit = 0; qbit < n; ++qbit)
+          if ((outcomes[i] >> simToOrig[qbit]) & 1)
+            simOutcomes[i] |= 1ULL << qbit;
+
+      return simulator->Amplitudes(simOutcomes);
+    });
   }
 
   /**
@@ -587,6 +586,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
     }
 
     curMaxBondDim = 0;
+    mpsFidelityBudget = ComputeMPSFidelityBudget(distCirc, nrQubits);
 
     std::vector<bool> executed;
     auto optSim =
@@ -647,6 +647,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
         job->curMaxBondDim = &curMaxBondDim;
 
         job->config = configuration;
+        job->mpsFidelityBudget = mpsFidelityBudget;
 
         if (optSim) {
           job->optSim = optSim->Clone();
@@ -670,6 +671,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
       job->curMaxBondDim = &curMaxBondDim;
 
       job->config = configuration;
+      job->mpsFidelityBudget = mpsFidelityBudget;
 
       if (optSim) {
         optSim->SetMultithreading(true);
@@ -777,6 +779,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
     GetState().Clear();
 
     curMaxBondDim = 0;
+    mpsFidelityBudget = ComputeMPSFidelityBudget(distCirc, nrQubits);
 
     std::vector<bool> executed;
     auto optSim = ChooseBestSimulator(distCirc, shots, nrQubits, nrCbits,
@@ -829,6 +832,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
         job->curMaxBondDim = &curMaxBondDim;
 
         job->config = configuration;
+        job->mpsFidelityBudget = mpsFidelityBudget;
 
         if (optSim) {
           job->optSim = optSim->Clone();
@@ -852,6 +856,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
       job->curMaxBondDim = &curMaxBondDim;
 
       job->config = configuration;
+      job->mpsFidelityBudget = mpsFidelityBudget;
 
       if (optSim) {
         optSim->SetMultithreading(true);
@@ -981,6 +986,9 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
 
     configuration.SetConfiguration(key, value);
 
+    if (std::string("matrix_product_state_truncation_threshold") == key)
+      userTruncationThreshold = configuration.GetConfigurationAsDouble(key);
+
     if (simulator) simulator->Configure(key, value);
   }
 
@@ -1869,6 +1877,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
                                                                       cbits);
     
     cloned->configuration = configuration;
+    cloned->userTruncationThreshold = userTruncationThreshold;
 
     cloned->maxSimulators = maxSimulators;
 
@@ -1977,6 +1986,18 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
       simulatorTypes.emplace_back(Simulators::SimulatorType::kQCSim,
                                   Simulators::SimulationType::kPathIntegral);
 
+    // mostly Clifford circuits can be simulated as a sum of stabilizer states,
+    // the number of terms doubles with each non-Clifford gate, so keep it to
+    // circuits with only a few of them
+    if (method != Simulators::SimulationType::kStabilizer &&
+        IsExtendedStabilizerCandidate(dcirc) &&
+        OptimizationSimulatorExists(
+            Simulators::SimulatorType::kQCSim,
+            Simulators::SimulationType::kExtendedStabilizer))
+      simulatorTypes.emplace_back(
+          Simulators::SimulatorType::kQCSim,
+          Simulators::SimulationType::kExtendedStabilizer);
+
 #ifndef NO_QISKIT_AER
     // tensor networks are out of the picture for now for qiskit aer, since they
     // are available with cuda library, and work only on linux (obviously when
@@ -2073,8 +2094,10 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
     }
 
     const double singularValueThreshold =
-        configuration.GetConfigurationAsDouble(
-            "matrix_product_state_truncation_threshold");
+        mpsFidelityBudget.IsEnabled()
+            ? mpsFidelityBudget.GetCutoff()
+            : configuration.GetConfigurationAsDouble(
+                  "matrix_product_state_truncation_threshold");
 
     const std::string mpsSample = configuration.GetConfiguration(
         "mps_sample_measure_algorithm");
@@ -2205,10 +2228,70 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
    */
   size_t GetCurrentMaxBondDimension() const override { return curMaxBondDim; }
 
+  std::vector<double> GetTruncationErrors() const override {
+    return truncationErrors;
+  }
+
+  /**
+   * @brief Returns the lower bound of the fidelity of the last execution.
+   *
+   * Available if a target fidelity was set and the last execution used a mps
+   * simulator that did not hit the max bond dimension.
+   */
+  std::optional<double> GetMPSFidelityLowerBound() const override {
+    if (lastMethod != Simulators::SimulationType::kMatrixProductState)
+      return std::nullopt;
+
+    return mpsFidelityBudget.GetFidelityLowerBound(curMaxBondDim);
+  }
+
  protected:
+  // The extended stabilizer is worth a try only if the circuit is mostly
+  // Clifford and the stabilizer terms stay few, their number can double with
+  // each non-Clifford phase rotation of the decomposition of the gates.
+  static bool IsExtendedStabilizerCandidate(
+      const std::shared_ptr<Circuits::Circuit<Time>> &dcirc) {
+    if (!dcirc || dcirc->size() == 0) return false;
+
+    size_t doublings = 0;
+    for (const auto &op : dcirc->GetOperations()) {
+      doublings += Estimators::ExecutionCost::ExtendedStabilizerDoublings(op);
+      if (doublings > kExtendedStabilizerMaxDoublings) return false;
+    }
+
+    if (doublings == 0) return false;
+
+    return dcirc->CliffordPercentage() >=
+           kExtendedStabilizerMinCliffordPercentage;
+  }
+
+  static constexpr double kExtendedStabilizerMinCliffordPercentage =
+      0.9; /**< The minimum Clifford percentage for the extended stabilizer. */
+  static constexpr size_t kExtendedStabilizerMaxDoublings =
+      20; /**< The maximum number of doublings of the stabilizer terms for the
+             extended stabilizer, about a million terms. */
+
+  // The truncation derived from the target fidelity, if set, for the circuit
+  // about to be executed. The threshold in the configuration can be the one
+  // set on the simulator by a previous budget, so the one set by the user is
+  // used instead.
+  Simulators::MPSFidelityBudget ComputeMPSFidelityBudget(
+      const std::shared_ptr<Circuits::Circuit<Time>> &dcirc,
+      size_t nrQubits) const {
+    return Simulators::MPSFidelityBudget::Compute(
+        configuration.GetConfigurationAsDouble(
+            "matrix_product_state_target_fidelity"),
+        dcirc->GetOperations(), nrQubits,
+        configuration.GetConfigurationAsInt(
+            "matrix_product_state_max_bond_dimension"),
+        userTruncationThreshold);
+  }
+
   void OptimizeMPSInitialQubitsMap(
       std::shared_ptr<Simulators::ISimulator> &sim,
       std::shared_ptr<Circuits::Circuit<Time>> &dcirc, size_t nrQubits) const {
+    mpsFidelityBudget.Apply(sim);
+
     if (sim->GetSimulationType() ==
             Simulators::SimulationType::kMatrixProductState &&
         (optimizeInitialQubitsMap || mpsOptimizeSwaps) &&
@@ -2231,7 +2314,9 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
             dummySim.SetMaxBondDimension(maxBondDimValue);
 
           if (optimizeInitialQubitsMap) {
-            const auto optimalMap = dummySim.ComputeOptimalQubitsMap(layers);
+            const auto optimalMap =
+                Simulators::MPSLayoutCache::GetInstance().GetOptimalQubitsMap(
+                    dummySim, layers);
             sim->SetInitialQubitsMap(optimalMap);
           }
 
@@ -2239,40 +2324,25 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
           dcirc->SetOperations(optCirc->GetOperations());
 
           if (mpsOptimizeSwaps) {
-            // TODO: come up with something better!
+            // with the default (automatic) depth, the estimate from the
+            // circuit shape is only the upper limit, the simulator tunes the
+            // depth at runtime from the measured cost of the decisions
             int lookaheadDepthLocal = lookaheadDepth;
+            const bool autoTuneLookahead =
+                lookaheadDepthLocal == std::numeric_limits<int>::max();
 
-            if (lookaheadDepthLocal == std::numeric_limits<int>::max()) {
-              double avgTwoQubitGatesPerLayer = 0.0;
-              for (const auto &layer : layers) {
-                int twoQubitGates = 0;
-                for (const auto &op : layer->GetOperations()) {
-                  if (op->AffectedQubits().size() >= 2) {
-                    ++twoQubitGates;
-                  }
-                }
-                avgTwoQubitGatesPerLayer += twoQubitGates;
-              }
-              avgTwoQubitGatesPerLayer /= layers.size();
-
-              int lookaheadVal = static_cast<int>(4. * avgTwoQubitGatesPerLayer);
-              if (lookaheadVal > 15) lookaheadVal = 15;
-
+            if (autoTuneLookahead)
               lookaheadDepthLocal =
-                  layers.size() < 8 || nrQubits <= 10 ? 0
-                  : layers.size() < 15 ? static_cast<int>(lookaheadVal)
-                  : layers.size() < 25 ? static_cast<int>(1.5 * lookaheadVal)
-                                       : 2 * lookaheadVal;
-            }
+                  Simulators::MPSDummySimulator::EstimateLookaheadDepth(
+                      layers, nrQubits);
 
             int lookaheadHeuristicDepthLocal = lookaheadDepthWithHeuristic;
 
             if (lookaheadHeuristicDepthLocal == std::numeric_limits<int>::max())
-              lookaheadHeuristicDepthLocal =
-                  layers.size() < 10 || nrQubits <= 10 ? 0
-                  : layers.size() < 20 ? lookaheadDepthLocal - 1
-                                       : lookaheadDepthLocal - 2;
-            
+              lookaheadHeuristicDepthLocal = Simulators::MPSDummySimulator::
+                  EstimateLookaheadDepthWithHeuristic(
+                      layers.size(), nrQubits, lookaheadDepthLocal);
+
             if (lookaheadHeuristicDepthLocal < 0)
               lookaheadHeuristicDepthLocal = 0;
 
@@ -2281,6 +2351,7 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
             sim->SetUseOptimalMeetingPosition(true);
             sim->SetLookaheadDepth(lookaheadDepthLocal);
             sim->SetLookaheadDepthWithHeuristic(lookaheadHeuristicDepthLocal);
+            sim->SetLookaheadAutoTune(autoTuneLookahead);
             sim->SetUpcomingGates(dcirc->GetOperations());
           }
         }
@@ -2504,6 +2575,68 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
       simulatorsEstimator; /**< The simulators estimator. */
 
  private:
+  // executes the circuit on the host, keeping the simulator, and obtains the
+  // amplitudes from it with the passed function
+  template <class GetAmplitudes>
+  std::vector<std::complex<double>> ExecuteOnHostForAmplitudes(
+      const std::shared_ptr<Circuits::Circuit<Time>> &circuit, size_t hostId,
+      GetAmplitudes &&getAmplitudes) {
+    const auto recreate = recreateIfNeeded;
+
+    auto simType = Simulators::SimulatorType::kQCSim;
+    auto method = Simulators::SimulationType::kMatrixProductState;
+    size_t numQubits = 2;
+    if (simulator) {
+      simType = simulator->GetType();
+      method = simulator->GetSimulationType();
+      numQubits = simulator->GetNumberOfQubits();
+    }
+
+    // RAII: restore recreateIfNeeded on any exit path (including exceptions).
+    struct ScopedRestoreFlag {
+      bool &flag, saved;
+      ScopedRestoreFlag(bool &f) : flag(f), saved(f) { flag = false; }
+      ~ScopedRestoreFlag() { flag = saved; }
+    } restoreGuard(recreateIfNeeded);
+
+    const auto res = RepeatedExecuteOnHost(circuit, hostId, 1);
+
+    if (!res.empty()) {
+      const auto &first = *res.begin();
+      GetState().SetResultsInOrder(first.first);
+    }
+
+    if (!simulator)
+      throw std::runtime_error(
+          "ExecuteOnHostAmplitudes: no simulator available after execution.");
+
+    auto amplitudes = getAmplitudes();
+
+    if (recreate && (!simulator || simType != simulator->GetType() ||
+                     method != simulator->GetSimulationType() ||
+                     simulator->GetNumberOfQubits() != numQubits))
+      CreateSimulator(simType, method);
+
+    return amplitudes;
+  }
+
+  // the reverse of the qubits mapping done when executing on the host:
+  // simulator qubit position -> original qubit position
+  std::vector<size_t> GetSimulatorToOriginalQubits(size_t n) const {
+    std::vector<size_t> simToOrig(n);
+    size_t offset = qubitsMapOnHost.size();
+
+    for (size_t qbit = 0; qbit < n; ++qbit) {
+      auto pos = qubitsMapOnHost.find(qbit);
+      if (pos != qubitsMapOnHost.end())
+        simToOrig[pos->second] = pos->first;
+      else
+        simToOrig[qbit] = offset++;
+    }
+
+    return simToOrig;
+  }
+
   Utils::ThreadsPool<ExecuteJob<Time>>
       threadsPool; /**< The threads pool for the execution of the circuits. */
   bool recreateIfNeeded =
@@ -2533,6 +2666,14 @@ class SimpleDisconnectedNetwork : public INetwork<Time> {
   double growthFactorSwap = 1.;
   double growthFactorGate = 0.7;
   size_t curMaxBondDim = 0;
+  double userTruncationThreshold =
+      0.; /**< The truncation threshold set by the user, the simulators can
+             have a smaller one, derived from the target fidelity. */
+  Simulators::MPSFidelityBudget
+      mpsFidelityBudget; /**< The truncation derived from the target fidelity
+                            for the last execution. */
+  std::vector<double> truncationErrors; /**< The truncation error bounds of the
+                                           last expectation values. */
 };
 
 }  // namespace Network
@@ -0,0 +1,809 @@
+/**
+ * @file ExtendedStabilizer.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The extended stabilizer (Clifford + T) simulator.
+ *
+ * The state is kept as a sum of stabilizer states that share the same
+ * stabilizer tableau: psi = sum_a c_a D^a |S>, where |S> is the state of the
+ * tableau and D^a is the product of the destabilizers selected by the bit
+ * mask a. The D^a |S> states are orthonormal, so the norm of the state is the
+ * sum of the squared magnitudes of the coefficients.
+ *
+ * A Clifford gate is applied only on the tableau (it conjugates the
+ * destabilizers, their signs included), the coefficients are unchanged.
+ * A Pauli operator maps each term to a single other term, with a phase, so a
+ * diagonal non-Clifford gate a I + b Z splits each term in at most two, which
+ * are merged with the existing ones. The other non-Clifford gates are
+ * decomposed into Clifford gates and phase gates. The number of terms grows
+ * at most twice with each non-Clifford gate that does not commute with the
+ * stabilizers, the terms are updated in parallel.
+ *
+ * It has the same interface as the stabilizer tableau for the Clifford gates
+ * (including the target, control order of the arguments for the two qubit
+ * gates).
+ */
+
+#pragma once
+
+#ifndef _EXTENDED_STABILIZER_H_
+#define _EXTENDED_STABILIZER_H_
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "StabilizerTableau.h"
+
+namespace Simulators {
+
+class ExtendedStabilizer {
+ public:
+  using Word = StabilizerTableau::Word;
+  using Complex = std::complex<double>;
+
+  explicit ExtendedStabilizer(size_t nrQubits)
+      : tableau(nrQubits), keyWords(tableau.halfWords) {
+    rng.seed(StabilizerTableau::GetRandomSeed());
+
+    Reset();
+  }
+
+  // the clone draws its own measurement outcomes, not the same ones
+  std::unique_ptr<ExtendedStabilizer> Clone() const {
+    auto clone = std::make_unique<ExtendedStabilizer>(*this);
+    clone->rng.seed(StabilizerTableau::GetRandomSeed());
+
+    return clone;
+  }
+
+  size_t GetNumberOfQubits() const { return tableau.GetNumberOfQubits(); }
+
+  /**
+   * @brief Returns the number of stabilizer states in the sum.
+   */
+  size_t GetNumberOfTerms() const { return coefficients.size(); }
+
+  /**
+   * @brief Resets the state to |0...0>.
+   */
+  void Reset() {
+    tableau.Reset();
+    keys.assign(keyWords, 0);
+    coefficients.assign(1, Complex(1., 0.));
+  }
+
+  void SetMultithreading(bool multithreading = true) {
+    enableMultithreading = multithreading;
+    tableau.SetMultithreading(multithreading);
+  }
+
+  /**
+   * @brief Sets the truncation threshold.
+   *
+   * The terms with the squared magnitude of the coefficient below the
+   * threshold are dropped after each non-Clifford gate and the state is
+   * renormalized. The default drops only the terms that cancel up to
+   * rounding, a larger value trades accuracy for fewer terms.
+   * @param threshold The threshold.
+   */
+  void SetTruncationThreshold(double threshold) {
+    truncationThreshold = std::max(threshold, 0.);
+  }
+
+  void SaveState() {
+    tableau.SaveState();
+    savedKeys = keys;
+    savedCoefficients = coefficients;
+  }
+
+  void RestoreState() {
+    if (savedCoefficients.empty()) return;
+
+    tableau.RestoreState();
+    keys = savedKeys;
+    coefficients = savedCoefficients;
+  }
+
+  void ClearSavedState() {
+    tableau.ClearSavedState();
+    savedKeys.clear();
+    savedCoefficients.clear();
+  }
+
+  void ApplyX(unsigned int qubit) { tableau.ApplyX(qubit); }
+  void ApplyY(unsigned int qubit) { tableau.ApplyY(qubit); }
+  void ApplyZ(unsigned int qubit) { tableau.ApplyZ(qubit); }
+  void ApplyH(unsigned int qubit) { tableau.ApplyH(qubit); }
+  void ApplyS(unsigned int qubit) { tableau.ApplyS(qubit); }
+  void ApplySdg(unsigned int qubit) { tableau.ApplySdg(qubit); }
+  void ApplySx(unsigned int qubit) { tableau.ApplySx(qubit); }
+  void ApplySxDag(unsigned int qubit) { tableau.ApplySxDag(qubit); }
+  void ApplyK(unsigned int qubit) { tableau.ApplyK(qubit); }
+
+  void ApplyCX(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    tableau.ApplyCX(tgtQubit, ctrlQubit);
+  }
+
+  void ApplyCY(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    tableau.ApplyCY(tgtQubit, ctrlQubit);
+  }
+
+  void ApplyCZ(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    tableau.ApplyCZ(tgtQubit, ctrlQubit);
+  }
+
+  void ApplySwap(unsigned int qubit1, unsigned int qubit0) {
+    tableau.ApplySwap(qubit1, qubit0);
+  }
+
+  /**
+   * @brief Applies the phase gate diag(1, e^(i lambda)).
+   *
+   * For multiples of pi/2 it's a Clifford gate and it's applied on the
+   * tableau only.
+   * @param qubit The qubit.
+   * @param lambda The phase.
+   */
+  void ApplyPhase(unsigned int qubit, double lambda) {
+    const double quarters = lambda / (0.5 * M_PI);
+    const double rounded = std::round(quarters);
+    if (std::abs(quarters - rounded) < kAngleEpsilon) {
+      switch (((static_cast<long long int>(rounded) % 4) + 4) % 4) {
+        case 1:
+          tableau.ApplyS(qubit);
+          break;
+        case 2:
+          tableau.ApplyZ(qubit);
+          break;
+        case 3:
+          tableau.ApplySdg(qubit);
+          break;
+        default:
+          break;
+      }
+      return;
+    }
+
+    // diag(1, e^(i lambda)) = a I + b Z
+    const Complex e = std::polar(1., lambda);
+    const Complex a = 0.5 * (1. + e);
+    const Complex b = 0.5 * (1. - e);
+
+    std::vector<Word> anticommuting(tableau.X(qubit),
+                                    tableau.X(qubit) + tableau.nrWords);
+    ApplyDiagonal(Decompose(anticommuting.data(), 0), a, b);
+  }
+
+  void ApplyT(unsigned int qubit) { ApplyPhase(qubit, 0.25 * M_PI); }
+  void ApplyTdg(unsigned int qubit) { ApplyPhase(qubit, -0.25 * M_PI); }
+
+  // the rotations are applied up to a global phase
+  void ApplyRz(unsigned int qubit, double theta) { ApplyPhase(qubit, theta); }
+
+  void ApplyRx(unsigned int qubit, double theta) {
+    tableau.ApplyH(qubit);
+    ApplyPhase(qubit, theta);
+    tableau.ApplyH(qubit);
+  }
+
+  void ApplyRy(unsigned int qubit, double theta) {
+    tableau.ApplySdg(qubit);
+    ApplyRx(qubit, theta);
+    tableau.ApplyS(qubit);
+  }
+
+  /**
+   * @brief Applies a generic single qubit gate.
+   *
+   * The gate is decomposed as Rz Ry Rz, up to a global phase.
+   * @param matrix The gate matrix.
+   * @param qubit The qubit.
+   */
+  void ApplyGate(const Eigen::Matrix2cd &matrix, unsigned int qubit) {
+    double phase, beta, gamma, delta;
+    EulerAngles(matrix, phase, beta, gamma, delta);
+
+    ApplyRz(qubit, delta);
+    ApplyRy(qubit, gamma);
+    ApplyRz(qubit, beta);
+  }
+
+  /**
+   * @brief Applies a controlled single qubit gate.
+   *
+   * With U = e^(i alpha) A X B X C and ABC = I, the controlled gate is
+   * C, CX, B, CX, A on the target, followed by a phase gate of alpha on the
+   * control.
+   * @param matrix The matrix of the gate applied on the target.
+   * @param tgtQubit The target qubit.
+   * @param ctrlQubit The control qubit.
+   */
+  void ApplyControlledGate(const Eigen::Matrix2cd &matrix,
+                           unsigned int tgtQubit, unsigned int ctrlQubit) {
+    double phase, beta, gamma, delta;
+    EulerAngles(matrix, phase, beta, gamma, delta);
+
+    ApplyRz(tgtQubit, 0.5 * (delta - beta));
+    tableau.ApplyCX(tgtQubit, ctrlQubit);
+    ApplyRz(tgtQubit, -0.5 * (delta + beta));
+    ApplyRy(tgtQubit, -0.5 * gamma);
+    tableau.ApplyCX(tgtQubit, ctrlQubit);
+    ApplyRy(tgtQubit, 0.5 * gamma);
+    ApplyRz(tgtQubit, beta);
+
+    ApplyPhase(ctrlQubit, phase);
+  }
+
+  // the decomposition with seven T gates
+  void ApplyCCX(unsigned int tgtQubit, unsigned int ctrlQubit0,
+                unsigned int ctrlQubit1) {
+    tableau.ApplyH(tgtQubit);
+    tableau.ApplyCX(tgtQubit, ctrlQubit1);
+    ApplyTdg(tgtQubit);
+    tableau.ApplyCX(tgtQubit, ctrlQubit0);
+    ApplyT(tgtQubit);
+    tableau.ApplyCX(tgtQubit, ctrlQubit1);
+    ApplyTdg(tgtQubit);
+    tableau.ApplyCX(tgtQubit, ctrlQubit0);
+    ApplyT(ctrlQubit1);
+    ApplyT(tgtQubit);
+    tableau.ApplyH(tgtQubit);
+    tableau.ApplyCX(ctrlQubit1, ctrlQubit0);
+    ApplyT(ctrlQubit0);
+    ApplyTdg(ctrlQubit1);
+    tableau.ApplyCX(ctrlQubit1, ctrlQubit0);
+  }
+
+  void ApplyCSwap(unsigned int qubit0, unsigned int qubit1,
+                  unsigned int ctrlQubit) {
+    tableau.ApplyCX(qubit0, qubit1);
+    ApplyCCX(qubit1, ctrlQubit, qubit0);
+    tableau.ApplyCX(qubit0, qubit1);
+  }
+
+  /**
+   * @brief Measures the qubit in the computational basis.
+   *
+   * @param qubit The qubit to measure.
+   * @return The outcome, the state is collapsed accordingly.
+   */
+  bool MeasureQubit(unsigned int qubit) {
+    bool outcome = false;
+    Project(qubit, kRandomOutcome, outcome);
+
+    return outcome;
+  }
+
+  /**
+   * @brief Returns the probability of a basis state.
+   *
+   * The qubits are projected in order on a copy of the state on the outcomes
+   * of the basis state, the probability is the product of the conditional
+   * probabilities.
+   * @param outcome The basis state.
+   * @return The probability.
+   */
+  double getBasisStateProbability(size_t outcome) const {
+    ExtendedStabilizer other(*this, CopyOnlyTag{});
+
+    double prob = 1.;
+    bool bit = false;
+    for (size_t q = 0; q < GetNumberOfQubits(); ++q) {
+      prob *= other.Project(q, q < 64 && ((outcome >> q) & 1) ? 1 : 0, bit);
+      if (prob <= 0.) return 0.;
+    }
+
+    return prob;
+  }
+
+  std::vector<double> AllProbabilities() const {
+    std::vector<double> probs(1ULL << GetNumberOfQubits(), 0.);
+
+    ExtendedStabilizer other(*this, CopyOnlyTag{});
+    other.FillProbabilities(0, 0, 1., probs);
+
+    return probs;
+  }
+
+  /**
+   * @brief Returns the expectation value of a Pauli string.
+   *
+   * The character at position i is the Pauli operator on qubit i (I, X, Y or
+   * Z), missing ones are identity. The string maps each term of the sum to a
+   * single other one, so the value is a sum over the terms, with the
+   * coefficient of the mapped term looked up in the sorted terms.
+   * @param pauliString The Pauli string.
+   * @return The expectation value.
+   */
+  double ExpectationValue(const std::string &pauliString) const {
+    std::vector<Word> anticommuting(tableau.nrWords);
+    size_t nrY = 0;
+    tableau.SymplecticProducts(pauliString, anticommuting.data(), nrY);
+
+    const PauliAction action =
+        Decompose(anticommuting.data(), static_cast<unsigned int>(nrY));
+
+    std::vector<Word> key(keyWords);
+    double result = 0.;
+    for (size_t t = 0; t < coefficients.size(); ++t) {
+      const Word *alpha = Key(t);
+      for (size_t w = 0; w < keyWords; ++w)
+        key[w] = alpha[w] ^ action.beta[w];
+
+      const size_t other = Find(key.data());
+      if (other == kNoTerm) continue;
+
+      result += std::real(std::conj(coefficients[other]) * coefficients[t] *
+                          ActionPhase(action, alpha));
+    }
+
+    return result;
+  }
+
+ private:
+  struct CopyOnlyTag {};
+
+  /**
+   * @brief A Pauli operator as P = i^phase D^beta S^gamma.
+   *
+   * beta selects the stabilizers the operator anticommutes with, gamma the
+   * destabilizers.
+   */
+  struct PauliAction {
+    std::vector<Word> beta;
+    std::vector<Word> gamma;
+    unsigned int phase = 0;
+    bool diagonal = true;
+  };
+
+  static constexpr size_t kNoTerm = static_cast<size_t>(-1);
+  static constexpr int kRandomOutcome = -1;
+  static constexpr size_t kMinTermsForMultithreading = 4096;
+  static constexpr double kAngleEpsilon = 1e-12;
+  static constexpr double kDefaultTruncationThreshold = 1e-24;
+
+  // copies only the state, not the saved state; the copies are projected on
+  // given outcomes only, they don't take the random generator
+  ExtendedStabilizer(const ExtendedStabilizer &other, CopyOnlyTag)
+      : tableau(other.tableau, StabilizerTableau::CopyOnlyTag{}),
+        keyWords(other.keyWords),
+        keys(other.keys),
+        coefficients(other.coefficients),
+        truncationThreshold(other.truncationThreshold),
+        enableMultithreading(other.enableMultithreading) {}
+
+  const Word *Key(size_t term) const { return keys.data() + term * keyWords; }
+  Word *Key(size_t term) { return keys.data() + term * keyWords; }
+
+  static Complex IPower(unsigned int k) {
+    switch (k % 4) {
+      case 1:
+        return Complex(0., 1.);
+      case 2:
+        return Complex(-1., 0.);
+      case 3:
+        return Complex(0., -1.);
+      default:
+        return Complex(1., 0.);
+    }
+  }
+
+  // the phase of P D^alpha |S> = i^phase (-1)^(gamma.alpha) D^(alpha^beta)|S>
+  Complex ActionPhase(const PauliAction &action, const Word *alpha) const {
+    unsigned int parity = 0;
+    for (size_t w = 0; w < keyWords; ++w)
+      parity ^= StabilizerTableau::Parity(action.gamma[w] & alpha[w]);
+
+    return IPower(action.phase + 2 * parity);
+  }
+
+  int NrThreads() const {
+    return enableMultithreading &&
+                   coefficients.size() >= kMinTermsForMultithreading
+               ? std::max(1, static_cast<int>(
+                                 std::thread::hardware_concurrency()))
+               : 1;
+  }
+
+  /**
+   * @brief Decomposes a Pauli operator on the tableau generators.
+   *
+   * The operator anticommutes with the stabilizer j if it contains the
+   * destabilizer j and with the destabilizer j if it contains the stabilizer
+   * j, so the generators in the product are given by the symplectic products
+   * with the halves swapped. The phase is the difference between the phase of
+   * the operator and the one of the product of the generators (ordered as in
+   * the tableau, the destabilizers first), both with Y counted as iXZ.
+   * @param anticommuting The mask of the generators the operator anticommutes
+   * with, for all the rows.
+   * @param pauliPhase The phase exponent of i of the operator in the XZ form.
+   * @return The decomposition.
+   */
+  PauliAction Decompose(const Word *anticommuting,
+                        unsigned int pauliPhase) const {
+    const size_t halfWords = tableau.halfWords;
+
+    PauliAction action;
+    action.beta.assign(anticommuting + halfWords,
+                       anticommuting + tableau.nrWords);
+    action.gamma.assign(anticommuting, anticommuting + halfWords);
+
+    std::vector<StabilizerTableau::SelectionWord> selection;
+    for (size_t w = 0; w < halfWords; ++w)
+      if (action.beta[w]) {
+        selection.push_back({w, action.beta[w]});
+        action.diagonal = false;
+      }
+    for (size_t w = 0; w < halfWords; ++w)
+      if (action.gamma[w]) selection.push_back({halfWords + w, action.gamma[w]});
+
+    unsigned int productPhase = 0;
+    for (const auto &sel : selection)
+      productPhase += 2 * static_cast<unsigned int>(
+                              std::bitset<64>(tableau.r[sel.index] & sel.bits)
+                                  .count());
+
+    for (size_t q = 0; q < tableau.nrQubits; ++q)
+      productPhase += StabilizerTableau::QubitPhase(
+          tableau.X(q), tableau.Z(q), selection.data(), selection.size());
+
+    action.phase = (pauliPhase + 4 - productPhase % 4) % 4;
+
+    return action;
+  }
+
+  /**
+   * @brief Applies a I + b P, for a Pauli operator P.
+   *
+   * If P is (up to the sign) in the stabilizer group, each coefficient is
+   * only multiplied, otherwise each term is split in two and the terms are
+   * merged.
+   */
+  void ApplyDiagonal(const PauliAction &action, Complex a, Complex b) {
+    const long long int nrTerms =
+        static_cast<long long int>(coefficients.size());
+    const int processor_count = NrThreads();
+
+    if (action.diagonal) {
+#pragma omp parallel for num_threads(processor_count) schedule(static)
+      for (long long int t = 0; t < nrTerms; ++t)
+        coefficients[t] *= a + b * ActionPhase(action, Key(t));
+
+      return;
+    }
+
+    std::vector<Word> newKeys(2 * keys.size());
+    std::vector<Complex> newCoefficients(2 * coefficients.size());
+
+#pragma omp parallel for num_threads(processor_count) schedule(static)
+    for (long long int t = 0; t < nrTerms; ++t) {
+      const Word *alpha = Key(t);
+      Word *key0 = newKeys.data() + 2 * t * keyWords;
+      Word *key1 = key0 + keyWords;
+
+      for (size_t w = 0; w < keyWords; ++w) {
+        key0[w] = alpha[w];
+        key1[w] = alpha[w] ^ action.beta[w];
+      }
+
+      newCoefficients[2 * t] = a * coefficients[t];
+      newCoefficients[2 * t + 1] =
+          b * coefficients[t] * ActionPhase(action, alpha);
+    }
+
+    keys.swap(newKeys);
+    coefficients.swap(newCoefficients);
+
+    Merge();
+  }
+
+  /**
+   * @brief Sorts the terms, sums the ones with the same key and drops the
+   * negligible ones.
+   *
+   * The state is renormalized if the dropped terms are not only rounding
+   * errors.
+   */
+  void Merge() {
+    std::vector<size_t> order(coefficients.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t i, size_t j) {
+      return std::lexicographical_compare(Key(i), Key(i) + keyWords, Key(j),
+                                          Key(j) + keyWords);
+    });
+
+    std::vector<Word> newKeys;
+    std::vector<Complex> newCoefficients;
+    newKeys.reserve(keys.size());
+    newCoefficients.reserve(coefficients.size());
+
+    const double threshold =
+        std::max(truncationThreshold, kDefaultTruncationThreshold);
+    double norm = 0.;
+    bool truncated = false;
+
+    for (size_t i = 0; i < order.size();) {
+      const Word *key = Key(order[i]);
+      Complex sum = coefficients[order[i]];
+      size_t j = i + 1;
+      for (; j < order.size() && std::equal(key, key + keyWords, Key(order[j]));
+           ++j)
+        sum += coefficients[order[j]];
+
+      const double n = std::norm(sum);
+      if (n >= threshold) {
+        newKeys.insert(newKeys.end(), key, key + keyWords);
+        newCoefficients.push_back(sum);
+        norm += n;
+      } else if (n > kDefaultTruncationThreshold)
+        truncated = true;
+
+      i = j;
+    }
+
+    keys.swap(newKeys);
+    coefficients.swap(newCoefficients);
+
+    if (truncated && norm > 0.) Normalize(norm);
+  }
+
+  void Normalize(double norm) {
+    const double factor = 1. / std::sqrt(norm);
+    for (auto &c : coefficients) c *= factor;
+  }
+
+  // binary search in the sorted terms
+  size_t Find(const Word *key) const {
+    size_t first = 0;
+    size_t last = coefficients.size();
+    while (first < last) {
+      const size_t mid = (first + last) / 2;
+      const Word *k = Key(mid);
+      if (std::lexicographical_compare(k, k + keyWords, key, key + keyWords))
+        first = mid + 1;
+      else
+        last = mid;
+    }
+
+    if (first < coefficients.size() &&
+        std::equal(key, key + keyWords, Key(first)))
+      return first;
+
+    return kNoTerm;
+  }
+
+  /**
+   * @brief Projects the state on an outcome of a qubit measurement.
+   *
+   * If Z on the qubit is in the stabilizer group (up to the sign), each term
+   * is an eigenstate and the terms with the other eigenvalue are dropped.
+   * Otherwise the tableau is collapsed to the outcome 0, with the stabilizer
+   * p anticommuting with Z becoming the destabilizer D'p, and the state is
+   * rewritten on the new tableau: with |S'> the normalized projection of |S>,
+   * |S> = (I + D'p)|S'> / sqrt(2) and the old destabilizers other than the
+   * one paired with p are products of the new ones with D'p, so each term
+   * gives two terms. The outcome 1 is obtained from the terms containing D'p,
+   * as D'p|S'> is the state with the sign of the stabilizer Z flipped.
+   * @param qubit The measured qubit.
+   * @param forced The outcome to project on, or kRandomOutcome to sample it.
+   * @param outcome Receives the outcome.
+   * @return The probability of the outcome.
+   */
+  double Project(size_t qubit, int forced, bool &outcome) {
+    std::vector<Word> anticommuting(tableau.X(qubit),
+                                    tableau.X(qubit) + tableau.nrWords);
+    const PauliAction zAction = Decompose(anticommuting.data(), 0);
+
+    const long long int nrTerms =
+        static_cast<long long int>(coefficients.size());
+    const int processor_count = NrThreads();
+
+    if (zAction.diagonal) {
+      std::vector<char> one(coefficients.size());
+      double prob0 = 0.;
+
+#pragma omp parallel for num_threads(processor_count) schedule(static) reduction(+ : prob0)
+      for (long long int t = 0; t < nrTerms; ++t) {
+        one[t] = std::real(ActionPhase(zAction, Key(t))) < 0.;
+        if (!one[t]) prob0 += std::norm(coefficients[t]);
+      }
+
+      outcome = ChooseOutcome(forced, prob0);
+      const double prob = outcome ? 1. - prob0 : prob0;
+      if (prob <= 0.) return 0.;
+
+      size_t kept = 0;
+      for (size_t t = 0; t < coefficients.size(); ++t)
+        if (static_cast<bool>(one[t]) == outcome) {
+          std::copy(Key(t), Key(t) + keyWords, Key(kept));
+          coefficients[kept] = coefficients[t];
+          ++kept;
+        }
+      keys.resize(kept * keyWords);
+      coefficients.resize(kept);
+
+      Normalize(prob);
+
+      return prob;
+    }
+
+    const size_t p = tableau.FindAnticommutingStabilizer(qubit);
+    const size_t d = p - tableau.halfWords * 64;
+
+    // the destabilizer paired with p, overwritten by the collapse
+    std::vector<size_t> xQubits;
+    std::vector<size_t> zQubits;
+    unsigned int pauliPhase =
+        StabilizerTableau::GetBit(tableau.r.data(), d) ? 2 : 0;
+    for (size_t q = 0; q < tableau.nrQubits; ++q) {
+      const bool px = StabilizerTableau::GetBit(tableau.X(q), d);
+      const bool pz = StabilizerTableau::GetBit(tableau.Z(q), d);
+      if (px) xQubits.push_back(q);
+      if (pz) zQubits.push_back(q);
+      if (px && pz) ++pauliPhase;
+    }
+
+    tableau.Collapse(qubit, p, false);
+
+    std::fill(anticommuting.begin(), anticommuting.end(), 0);
+    for (const size_t q : xQubits) {
+      const Word *zq = tableau.Z(q);
+      for (size_t w = 0; w < tableau.nrWords; ++w) anticommuting[w] ^= zq[w];
+    }
+    for (const size_t q : zQubits) {
+      const Word *xq = tableau.X(q);
+      for (size_t w = 0; w < tableau.nrWords; ++w) anticommuting[w] ^= xq[w];
+    }
+    const PauliAction dAction = Decompose(anticommuting.data(), pauliPhase);
+
+    const size_t dWord = d / 64;
+    const Word dBit = 1ULL << (d % 64);
+
+    std::vector<Word> newKeys(2 * keys.size());
+    std::vector<Complex> newCoefficients(2 * coefficients.size());
+
+#pragma omp parallel for num_threads(processor_count) schedule(static)
+    for (long long int t = 0; t < nrTerms; ++t) {
+      const Word *alpha = Key(t);
+      const bool hasD = (alpha[dWord] & dBit) != 0;
+      const Complex c = coefficients[t] * M_SQRT1_2;
+
+      for (size_t i = 0; i < 2; ++i) {
+        Word *key = newKeys.data() + (2 * t + i) * keyWords;
+        std::copy(alpha, alpha + keyWords, key);
+        key[dWord] &= ~dBit;
+        if (i) key[dWord] |= dBit;
+
+        if (hasD) {
+          const Complex phase = ActionPhase(dAction, key);
+          for (size_t w = 0; w < keyWords; ++w) key[w] ^= dAction.beta[w];
+          newCoefficients[2 * t + i] = c * phase;
+        } else
+          newCoefficients[2 * t + i] = c;
+      }
+    }
+
+    keys.swap(newKeys);
+    coefficients.swap(newCoefficients);
+
+    Merge();
+
+    double prob0 = 0.;
+    for (size_t t = 0; t < coefficients.size(); ++t)
+      if ((Key(t)[dWord] & dBit) == 0) prob0 += std::norm(coefficients[t]);
+
+    outcome = ChooseOutcome(forced, prob0);
+    const double prob = outcome ? 1. - prob0 : prob0;
+    if (prob <= 0.) return 0.;
+
+    size_t kept = 0;
+    for (size_t t = 0; t < coefficients.size(); ++t)
+      if (((Key(t)[dWord] & dBit) != 0) == outcome) {
+        std::copy(Key(t), Key(t) + keyWords, Key(kept));
+        Key(kept)[dWord] &= ~dBit;
+        coefficients[kept] = coefficients[t];
+        ++kept;
+      }
+    keys.resize(kept * keyWords);
+    coefficients.resize(kept);
+
+    if (outcome) StabilizerTableau::SetBit(tableau.r.data(), p);
+
+    Normalize(prob);
+
+    return prob;
+  }
+
+  bool ChooseOutcome(int forced, double prob0) {
+    if (forced != kRandomOutcome) return forced != 0;
+
+    return std::uniform_real_distribution<double>(0., 1.)(rng) >= prob0;
+  }
+
+  void FillProbabilities(size_t qubit, size_t state, double prob,
+                         std::vector<double> &probs) {
+    bool bit = false;
+    for (; qubit < GetNumberOfQubits(); ++qubit) {
+      ExtendedStabilizer other(*this, CopyOnlyTag{});
+      const double prob1 = other.Project(qubit, 1, bit);
+      if (prob1 > 0.)
+        other.FillProbabilities(qubit + 1, state | (1ULL << qubit),
+                                prob * prob1, probs);
+
+      const double prob0 = Project(qubit, 0, bit);
+      if (prob0 <= 0.) return;
+      prob *= prob0;
+    }
+
+    probs[state] = prob;
+  }
+
+  /**
+   * @brief Decomposes a single qubit gate.
+   *
+   * matrix = e^(i phase) Rz(beta) Ry(gamma) Rz(delta).
+   */
+  static void EulerAngles(const Eigen::Matrix2cd &matrix, double &phase,
+                          double &beta, double &gamma, double &delta) {
+    const Complex det = matrix.determinant();
+    const Eigen::Matrix2cd v = matrix * std::polar(1., -0.5 * std::arg(det));
+
+    const double a = std::abs(v(0, 0));
+    const double b = std::abs(v(1, 0));
+    gamma = 2. * std::atan2(b, a);
+
+    if (b < kAngleEpsilon) {
+      beta = -2. * std::arg(v(0, 0));
+      delta = 0.;
+    } else if (a < kAngleEpsilon) {
+      beta = 2. * std::arg(v(1, 0));
+      delta = 0.;
+    } else {
+      const double sum = -2. * std::arg(v(0, 0));
+      const double diff = 2. * std::arg(v(1, 0));
+      beta = 0.5 * (sum + diff);
+      delta = 0.5 * (sum - diff);
+    }
+
+    // the global phase, from tr(W^+ matrix) = 2 e^(i phase)
+    const double c = std::cos(0.5 * gamma);
+    const double s = std::sin(0.5 * gamma);
+    Eigen::Matrix2cd w;
+    w(0, 0) = std::polar(c, -0.5 * (beta + delta));
+    w(0, 1) = -std::polar(s, -0.5 * (beta - delta));
+    w(1, 0) = std::polar(s, 0.5 * (beta - delta));
+    w(1, 1) = std::polar(c, 0.5 * (beta + delta));
+
+    phase = std::arg((w.adjoint() * matrix).trace());
+  }
+
+  StabilizerTableau tableau;
+  size_t keyWords;
+
+  std::vector<Word> keys; /**< The destabilizer masks of the terms */
+  std::vector<Complex> coefficients; /**< The coefficients of the terms */
+
+  std::vector<Word> savedKeys;
+  std::vector<Complex> savedCoefficients;
+
+  double truncationThreshold = 0.;
+  bool enableMultithreading = true;
+  std::mt19937_64 rng;
+};
+
+}  // namespace Simulators
+
+#endif  // !_EXTENDED_STABILIZER_H_
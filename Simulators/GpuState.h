@@ -21,6 +21,7 @@
 
 #include "MPSDummySimulator.h"
 
+#include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <limits>
@@ -327,11 +328,20 @@ class GpuState : public ISimulator {
     if (lookaheadDepth < depth) SetLookaheadDepth(depth);
   }
 
+  void SetLookaheadAutoTune(bool enable) override {
+    lookaheadAutoTune = enable;
+    if (dummySim) dummySim->SetLookaheadAutoTune(enable);
+  }
+
   void SetUpcomingGates(
       const std::vector<std::shared_ptr<Circuits::IOperation<double>>> &gates)
       override {
     upcomingGates = gates;
     upcomingGateIndex = 0;
+    if (dummySim) {
+      dummySim->ClearLookaheadCache();
+      dummySim->ResetLookaheadTuning();
+    }
 
     if (!mps) return;
 
@@ -430,6 +440,10 @@ class GpuState : public ISimulator {
         if (mps) mps->SetMaxExtent(chi);
         if (tn) tn->SetMaxExtent(chi);
       }
+      // the automatic jacobi svd selection depends on the bond dimension
+      ApplyJacobiSvd();
+    } else if (std::string("matrix_product_state_jacobi_svd") == key) {
+      ApplyJacobiSvd();
     } else if (std::string("use_double_precision") == key) {
       const bool useDoublePrecision =
           (std::string("1") == value || std::string("true") == value);
@@ -1246,6 +1260,7 @@ class GpuState : public ISimulator {
       dummySim->SetMaxBondDimension(configuration.GetConfigurationAsInt("matrix_product_state_max_bond_dimension"));
       dummySim->setGrowthFactorGate(growthFactorGate);
       dummySim->setGrowthFactorSwap(growthFactorSwap);
+      dummySim->SetLookaheadAutoTune(lookaheadAutoTune);
     }
 
     dummySim->setTotalSwappingCost(0);
@@ -1294,10 +1309,14 @@ class GpuState : public ISimulator {
     std::cerr << std::endl;
 #endif
 
+    const auto searchStart = std::chrono::steady_clock::now();
+    const int depth = dummySim->GetTunedLookaheadDepth(lookaheadDepth);
+    const int heuristicDepth =
+        std::max(0, lookaheadDepthWithHeuristic - (lookaheadDepth - depth));
+
     double bestCost = std::numeric_limits<double>::infinity();
     int64_t res = dummySim->FindBestMeetingPosition(
-        upcomingGates, upcomingGateIndex, lookaheadDepth,
-        lookaheadDepthWithHeuristic, 0, bestCost);
+        upcomingGates, upcomingGateIndex, depth, heuristicDepth, 0, bestCost);
 
 #ifdef LOG_CALLBACK_INFO
     std::cerr << "Swapping the two qubits on position: " << res << " and "
@@ -1306,6 +1325,8 @@ class GpuState : public ISimulator {
 
     dummySim->SwapQubitsToPosition(qbits[0], qbits[1], res);
     dummySim->ApplyGate(op);
+    dummySim->RecordLookaheadDecision(searchStart,
+                                      std::chrono::steady_clock::now());
 
     // display the expected bond dimensions after applying the gate for
     // debugging
@@ -1323,10 +1344,43 @@ class GpuState : public ISimulator {
               << " with estimated cost: " << bestCost << std::endl;
 #endif
 
-
     return res;
   }
 
+  static constexpr long long int kMaxBondDimensionForJacobiSvd =
+      512; /**< The max bond dimension for which 'auto' picks the jacobi
+              svd. */
+
+  /**
+   * @brief Selects the svd used for the bond updates.
+   *
+   * Uses the 'matrix_product_state_jacobi_svd' configuration value: 'false'
+   * (the default) uses the full svd, 'true' uses the jacobi svd (gesvdj),
+   * which is faster for the small and medium sized bond matrices, and 'auto'
+   * uses the jacobi svd only if the bond dimension is limited to at most
+   * kMaxBondDimensionForJacobiSvd, when all the decomposed matrices are small
+   * enough for it. Both compute the full decomposition, the truncation is the
+   * same.
+   */
+  void ApplyJacobiSvd() {
+    if (!mps && !tn) return;
+
+    const std::string value =
+        configuration.GetConfiguration("matrix_product_state_jacobi_svd");
+
+    bool useJacobi = false;
+    if (value == "1" || value == "true")
+      useJacobi = true;
+    else if (value == "auto") {
+      const long long int chi = configuration.GetConfigurationAsInt(
+          "matrix_product_state_max_bond_dimension");
+      useJacobi = chi > 0 && chi <= kMaxBondDimensionForJacobiSvd;
+    }
+
+    if (mps) mps->SetGesvdJ(useJacobi ? 1 : 0);
+    if (tn) tn->SetGesvdJ(useJacobi ? 1 : 0);
+  }
+
   static void BondDimCallback(void* thisPtr, const int64_t* bondDims) {
     GpuState* self = static_cast<GpuState*>(thisPtr);
     
@@ -1357,6 +1411,7 @@ class GpuState : public ISimulator {
 
   int lookaheadDepth = 0;
   int lookaheadDepthWithHeuristic = 0;
+  bool lookaheadAutoTune = false;
   bool useOptimalMeetingPosition = true;
   std::vector<std::shared_ptr<Circuits::IOperation<>>> upcomingGates;
   long long int upcomingGateIndex = 0;
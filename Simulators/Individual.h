@@ -802,6 +802,17 @@ class IndividualSimulator : public ISimulator {
     return simulator->ExpectationValue(pauliString);
   }
 
+  /**
+   * @brief Returns the expected values of many Pauli strings.
+   *
+   * @param pauliStrings The Pauli strings to obtain the expected values for.
+   * @return The expected values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) override {
+    return simulator->ExpectationValues(pauliStrings);
+  }
+
   /**
    * @brief Returns the type of simulator.
    *
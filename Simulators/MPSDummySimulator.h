@@ -19,8 +19,17 @@
 #define _MPSDUMMYSIMULATOR_H_
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <deque>
+#include <exception>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <Eigen/Eigen>
 #include <unsupported/Eigen/CXX11/Tensor>
@@ -53,6 +62,7 @@ class MPSDummySimulator {
     clone->currentBondDim = currentBondDim;
 
     clone->totalSwappingCost = totalSwappingCost;
+    clone->nrBondUpdates = nrBondUpdates;
 
     clone->growthFactorSwap = growthFactorSwap;
     clone->growthFactorGate = growthFactorGate;
@@ -65,12 +75,19 @@ class MPSDummySimulator {
   double getGrowthFactorSwap() const { return growthFactorSwap; }
   double getGrowthFactorGate() const { return growthFactorGate; }
 
-  void setGrowthFactorSwap(double factor) { growthFactorSwap = factor; }
-  void setGrowthFactorGate(double factor) { growthFactorGate = factor; }
+  void setGrowthFactorSwap(double factor) {
+    if (factor != growthFactorSwap) ClearLookaheadCache();
+    growthFactorSwap = factor;
+  }
+  void setGrowthFactorGate(double factor) {
+    if (factor != growthFactorGate) ClearLookaheadCache();
+    growthFactorGate = factor;
+  }
 
   void Clear() { InitQubitsMap(); }
 
   void SetMaxBondDimension(IndexType val) {
+    ClearLookaheadCache();
     maxVirtualExtent = val;
 
     if (nrQubits == 0) return;
@@ -142,14 +159,9 @@ class MPSDummySimulator {
       // 1-qubit gates are no-ops in the dummy simulator (no swap logic)
       return;
     } else if (qbits.size() == 2) {
-      // Reuse a single static dummy 2-qubit gate to avoid heap allocation.
-      // Only getQubitsNumber() is checked; the matrix is never read.
-      static const QC::Gates::AppliedGate<MatrixClass> dummy2qGate(
-          MatrixClass::Identity(4, 4), 0, 1);
-      ApplyGate(dummy2qGate, qbits[0], qbits[1]);
+      ApplyGate(DummyTwoQubitGate(), qbits[0], qbits[1]);
     } else  if (qbits.size() == 3 && gate->GetType() == Circuits::OperationType::kGate) {
-      static const QC::Gates::AppliedGate<MatrixClass> dummy2qGate(
-          MatrixClass::Identity(4, 4), 0, 1);
+      const auto& dummy2qGate = DummyTwoQubitGate();
 
       const auto gateptr =
           std::static_pointer_cast<Circuits::IQuantumGate<>>(gate);
@@ -204,7 +216,9 @@ class MPSDummySimulator {
       // the SVD/contraction actually performed for this operation, and the
       // grown bond dimension only affects subsequent operations.
       const IndexType bond = std::min(qubit1, qubit2);
+      if (lookaheadActive) JournalSegment(bond, bond + 1);
       totalSwappingCost += bondCost[bond];
+      ++nrBondUpdates;
       // TODO: This is basic, the two qubit gates can have rank 2 and 4 (1 if
       // can be decomposed into two 1-qubit gates)
       // the controlled ones have Schmidt rank 2
@@ -231,6 +245,7 @@ class MPSDummySimulator {
       qubitsMapInv[initialMap[i]] = i;
 
     totalSwappingCost = 0;
+    nrBondUpdates = 0;
     std::fill(currentBondDim.begin(), currentBondDim.end(), 1.0);
     for (size_t i = 0; i < bondCost.size(); ++i) bondCost[i] = 1;
   }
@@ -258,263 +273,196 @@ class MPSDummySimulator {
   void setTotalSwappingCost(double cost) { totalSwappingCost = cost; }
   double getTotalSwappingCost() const { return totalSwappingCost; }
 
-  // Evaluate the total cost
-  // position, applying the current 2-qubit gate, and then simulating the
-  // next lookaheadDepth 2-qubit gates from upcomingGates.
+  // Number of bond updates (two qubit gates and swaps, each one needing a svd
+  // in the real simulator) since the qubits map was last set
+  size_t getNrBondUpdates() const { return nrBondUpdates; }
+
+  // Evaluate the total cost of meeting at meetPosition, applying the current
+  // 2-qubit gate, and then simulating the next lookaheadDepth 2-qubit gates
+  // from upcomingGates (each one at its best meeting position).
+  // bestCost is lowered if the total, including currentCost, is lower.
+  // The state of the simulator is left unchanged.
   void EvaluateMeetingPositionCost(
       IndexType meetPosition,
       const std::vector<std::shared_ptr<Circuits::IOperation<>>>& upcomingGates,
       long long int currentGateIndex, int lookaheadDepth,
-      int lookaheadDepthWithHeuristic, double currentCost, double& bestCost,
-      bool useSameDummy = false) {
-    if (currentGateIndex >= static_cast<long long int>(upcomingGates.size())) {
+      int lookaheadDepthWithHeuristic, double currentCost, double& bestCost) {
+    if (!BeginLookahead(upcomingGates, currentGateIndex, lookaheadDepth)) {
       if (currentCost < bestCost) bestCost = currentCost;
       return;
     }
 
-    // skip the 1 qubit gates, advance to the next 2-qubit gate
-    while (currentGateIndex <
-               static_cast<long long int>(upcomingGates.size()) &&
-           upcomingGates[currentGateIndex]->AffectedQubits().size() < 2)
-      ++currentGateIndex;
+    const double cost =
+        currentCost + EvaluateLookaheadPosition(0, meetPosition, lookaheadDepth,
+                                                lookaheadDepthWithHeuristic,
+                                                bestCost - currentCost, false);
+    EndLookahead();
 
-    if (currentGateIndex >= static_cast<long long int>(upcomingGates.size())) {
-      if (currentCost < bestCost) bestCost = currentCost;
-      return;
-    }
-
-    const auto& op = upcomingGates[currentGateIndex];
-    const auto qbits = op->AffectedQubits();
+    if (cost < bestCost) bestCost = cost;
+  }
 
+  // Find the meeting position that minimizes the combined cost of the
+  // current swap + lookahead gates.  Returns the optimal bond index.
+  // bestCost receives the total accumulated cost for the best position.
+  //
+  // The search works in place: the chain segment touched by each swap or gate
+  // is saved in a journal and restored afterwards, so a candidate costs only
+  // as much as the bonds it touches instead of a copy of the whole chain.
+  // The costs of the branching subtrees are memoized on the gate, the
+  // remaining depth and a hash of the chain state. The memo is kept between
+  // calls (until the upcoming gates or the cost model change).
+  IndexType FindBestMeetingPosition(
+      const std::vector<std::shared_ptr<Circuits::IOperation<>>>& upcomingGates,
+      long long int currentGateIndex, int lookaheadDepth,
+      int lookaheadDepthWithHeuristic, double currentCost, double& bestCost) {
+    const auto qbits = upcomingGates[currentGateIndex]->AffectedQubits();
     assert(qbits.size() >= 2);
 
-    const IndexType qubit1 = static_cast<IndexType>(qbits[0]);
-    const IndexType qubit2 = static_cast<IndexType>(qbits[1]);
+    IndexType bestPosition = std::min(qubitsMap[qbits[0]], qubitsMap[qbits[1]]);
+    if (!BeginLookahead(upcomingGates, currentGateIndex, lookaheadDepth))
+      return bestPosition;
 
-    // Perform the swap to the meeting position;
-    // totalSwappingCost starts at 0 and SwapQubitsToPosition accumulates
-    // per-bond costs, so the cost correctly depends on meetPosition.
+    const double cost = SearchLookahead(0, lookaheadDepth,
+                                        lookaheadDepthWithHeuristic,
+                                        bestCost - currentCost, &bestPosition);
+    EndLookahead();
 
-    IndexType realq1 = qubitsMap[qubit1];
-    IndexType realq2 = qubitsMap[qubit2];
-    if (realq1 > realq2) std::swap(realq1, realq2);
+    if (currentCost + cost < bestCost) bestCost = currentCost + cost;
 
-    if (useSameDummy) {
-      const double ccost = getTotalSwappingCost();
+    return bestPosition;
+  }
 
-      if (realq2 - realq1 > 1)
-        SwapQubitsToPosition(qubit1, qubit2, meetPosition);
+  void ClearLookaheadCache() { lookaheadCache.clear(); }
 
-      ApplyGate(op);
+  size_t GetLookaheadCacheSize() const { return lookaheadCache.size(); }
 
-      // const double importanceFactor =
-      //     pow(dimFactor, (lookaheadDepthWithHeuristic - lookaheadDepth - 1));
-      currentCost += (getTotalSwappingCost() - ccost) /** importanceFactor*/;
+  // When enabled, the lookahead depth is adapted at runtime from the measured
+  // time per decision, so that choosing the meeting positions stays a small
+  // fraction of the simulation time.
+  void SetLookaheadAutoTune(bool enable) {
+    if (enable == lookaheadAutoTune) return;
 
-      if (currentCost >= bestCost) return;
-      // No more lookahead depth: return without further recursion
-      if (lookaheadDepth <= 0) {
-        if (currentCost < bestCost) bestCost = currentCost;
-        return;
-      }
+    lookaheadAutoTune = enable;
+    ResetLookaheadTuning();
+  }
 
-      // skip the 1 qubit gates, advance over the current gate on the next
-      // 2-qubit gate
-      ++currentGateIndex;
-      while (currentGateIndex <
-                 static_cast<long long int>(upcomingGates.size()) &&
-             upcomingGates[currentGateIndex]->AffectedQubits().size() < 2)
-        ++currentGateIndex;
-
-      if (currentGateIndex >=
-          static_cast<long long int>(upcomingGates.size())) {
-        if (currentCost < bestCost) bestCost = currentCost;
-        return;
-      }
+  bool GetLookaheadAutoTune() const { return lookaheadAutoTune; }
 
-      FindBestMeetingPosition(upcomingGates, currentGateIndex,
-                              lookaheadDepth - 1, lookaheadDepthWithHeuristic,
-                              currentCost, bestCost);
-    } else {
-      MPSDummySimulator dummySim(nrQubits, LightweightInitTag{});
-      dummySim.maxVirtualExtent = maxVirtualExtent;
-      dummySim.maxBondDim = maxBondDim;
-      dummySim.currentBondDim = currentBondDim;
-      dummySim.bondCost = bondCost;
-      dummySim.qubitsMap = qubitsMap;
-      dummySim.qubitsMapInv.resize(qubitsMap.size());
-      for (size_t i = 0; i < qubitsMap.size(); ++i)
-        dummySim.qubitsMapInv[qubitsMap[i]] = static_cast<IndexType>(i);
-
-      dummySim.setTotalSwappingCost(0);
-
-      if (realq2 - realq1 > 1)
-        dummySim.SwapQubitsToPosition(qubit1, qubit2, meetPosition);
-
-      dummySim.ApplyGate(op);  // this also updates the bond dimensions in
-                               // dummySim according to the applied gate
-
-      currentCost += dummySim.getTotalSwappingCost();
-
-      // Pruning: if current accumulated cost already exceeds best known, prune
-      if (currentCost >= bestCost) return;
-
-      // No more lookahead depth: return without further recursion
-      if (lookaheadDepth <= 0) {
-        if (currentCost < bestCost) bestCost = currentCost;
-        return;
-      }
+  // Returns the lookahead depth to use for the next decision, at most
+  // maxDepth (the configured one)
+  int GetTunedLookaheadDepth(int maxDepth) {
+    if (!lookaheadAutoTune) return maxDepth;
 
-      // skip the 1 qubit gates, advance over the current gate on the next
-      // 2-qubit gate
-      ++currentGateIndex;
-      while (currentGateIndex <
-                 static_cast<long long int>(upcomingGates.size()) &&
-             upcomingGates[currentGateIndex]->AffectedQubits().size() < 2)
-        ++currentGateIndex;
-
-      if (currentGateIndex >=
-          static_cast<long long int>(upcomingGates.size())) {
-        if (currentCost < bestCost) bestCost = currentCost;
-        return;
-      }
+    maxTunedLookaheadDepth = maxDepth;
+    if (tunedLookaheadDepth < 0 || tunedLookaheadDepth > maxDepth)
+      tunedLookaheadDepth = maxDepth;
 
-      dummySim.FindBestMeetingPosition(
-          upcomingGates, currentGateIndex, lookaheadDepth - 1,
-          lookaheadDepthWithHeuristic, currentCost, bestCost);
-    }
+    return tunedLookaheadDepth;
   }
 
-  // Find the meeting position that minimizes the combined cost of the
-  // current swap + lookahead gates.  Returns the optimal bond index.
-  // outBestCost receives the total accumulated cost for the best position.
-  IndexType FindBestMeetingPosition(
-      const std::vector<std::shared_ptr<Circuits::IOperation<>>>& upcomingGates,
-      long long int currentGateIndex, int lookaheadDepth,
-      int lookaheadDepthWithHeuristic, double currentCost, double& bestCost) {
-    const auto& op = upcomingGates[currentGateIndex];
-    const auto qbits = op->AffectedQubits();
-
-    assert(qbits.size() >= 2);
-
-    const IndexType qubit1 = static_cast<IndexType>(qbits[0]);
-    const IndexType qubit2 = static_cast<IndexType>(qbits[1]);
-
-    IndexType realq1 = qubitsMap[qubit1];
-    IndexType realq2 = qubitsMap[qubit2];
+  // Records the duration of a decision (the time spent in the meeting
+  // position callback). The time between the end of the previous decision and
+  // the end of this one is the total time, and every
+  // kLookaheadDecisionsPerTuning decisions the depth is lowered if the routing
+  // took more than kMaxLookaheadTimeFraction of it, or raised back towards the
+  // configured depth if it took much less.
+  void RecordLookaheadDecision(std::chrono::steady_clock::time_point start,
+                               std::chrono::steady_clock::time_point end) {
+    if (!lookaheadAutoTune) return;
+
+    if (lastLookaheadDecisionEnd !=
+        std::chrono::steady_clock::time_point{}) {
+      lookaheadRoutingTime +=
+          std::chrono::duration<double>(end - start).count();
+      lookaheadTotalTime +=
+          std::chrono::duration<double>(end - lastLookaheadDecisionEnd)
+              .count();
+      ++nrLookaheadDecisions;
+    }
+    lastLookaheadDecisionEnd = end;
+
+    if (nrLookaheadDecisions < kLookaheadDecisionsPerTuning) return;
+
+    const double fraction = lookaheadTotalTime > 0.
+                                ? lookaheadRoutingTime / lookaheadTotalTime
+                                : 0.;
+    if (fraction > kMaxLookaheadTimeFraction && tunedLookaheadDepth > 0)
+      --tunedLookaheadDepth;
+    else if (fraction < 0.25 * kMaxLookaheadTimeFraction &&
+             tunedLookaheadDepth < maxTunedLookaheadDepth)
+      ++tunedLookaheadDepth;
+
+    nrLookaheadDecisions = 0;
+    lookaheadRoutingTime = 0.;
+    lookaheadTotalTime = 0.;
+  }
 
-    if (realq1 > realq2) std::swap(realq1, realq2);
+  void ResetLookaheadTuning() {
+    tunedLookaheadDepth = -1;
+    nrLookaheadDecisions = 0;
+    lookaheadRoutingTime = 0.;
+    lookaheadTotalTime = 0.;
+    lastLookaheadDecisionEnd = std::chrono::steady_clock::time_point{};
+  }
 
-    if (lookaheadDepth <= 0) {
-      IndexType pos = (realq2 - realq1 > 1)
-                          ? ComputeHeuristicMeetPosition(realq1, realq2)
-                          : realq1;
-      EvaluateMeetingPositionCost(pos, upcomingGates, currentGateIndex, 0,
-                                  lookaheadDepthWithHeuristic, currentCost,
-                                  bestCost, false);
-      return pos;
-    }
+  // Initial lookahead depth for a circuit, from the average number of 2-qubit
+  // gates per layer and the depth of the circuit. With auto tuning enabled
+  // this is the upper limit, the depth actually used adapts to the measured
+  // cost of the decisions.
+  static int EstimateLookaheadDepth(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>>& layers,
+      size_t nrQubits) {
+    if (layers.size() < 8 || nrQubits <= 10) return 0;
 
-    if (realq2 - realq1 <= 1) {
-      EvaluateMeetingPositionCost(
-          realq1, upcomingGates, currentGateIndex, lookaheadDepth,
-          lookaheadDepthWithHeuristic, currentCost, bestCost,
-          lookaheadDepth <= lookaheadDepthWithHeuristic);
+    double avgTwoQubitGatesPerLayer = 0.0;
+    for (const auto& layer : layers) {
+      int twoQubitGates = 0;
+      for (const auto& op : layer->GetOperations())
+        if (op->AffectedQubits().size() >= 2) ++twoQubitGates;
 
-      return realq1;
+      avgTwoQubitGatesPerLayer += twoQubitGates;
     }
+    avgTwoQubitGatesPerLayer /= layers.size();
 
-    IndexType bestPosition = realq1;
+    int lookaheadVal = static_cast<int>(4. * avgTwoQubitGatesPerLayer);
+    if (lookaheadVal > 15) lookaheadVal = 15;
 
-    if (lookaheadDepth <= lookaheadDepthWithHeuristic) {
-      bestPosition = ComputeHeuristicMeetPosition(realq1, realq2);
-      EvaluateMeetingPositionCost(bestPosition, upcomingGates, currentGateIndex,
-                                  lookaheadDepth, lookaheadDepthWithHeuristic,
-                                  currentCost, bestCost, true);
-    } else {
-      for (IndexType m = realq1; m < realq2; ++m) {
-        const double oldCost = bestCost;
-        EvaluateMeetingPositionCost(m, upcomingGates, currentGateIndex,
-                                    lookaheadDepth, lookaheadDepthWithHeuristic,
-                                    currentCost, bestCost);
+    return layers.size() < 15   ? lookaheadVal
+           : layers.size() < 25 ? static_cast<int>(1.5 * lookaheadVal)
+                                : 2 * lookaheadVal;
+  }
 
-        if (bestCost < oldCost) bestPosition = m;
-      }
-    }
+  static int EstimateLookaheadDepthWithHeuristic(size_t nrLayers,
+                                                 size_t nrQubits,
+                                                 int lookaheadDepth) {
+    const int depth = nrLayers < 10 || nrQubits <= 10 ? 0
+                      : nrLayers < 20                  ? lookaheadDepth - 1
+                                                       : lookaheadDepth - 2;
 
-    return bestPosition;
+    return std::max(depth, 0);
   }
 
+  // Searches for an initial qubits map that minimizes the swapping cost of the
+  // circuit given as layers.
+  // A portfolio of strategies runs concurrently, each one on its own clone of
+  // the dummy simulator: random perturbations with 2-opt refinement of the
+  // best seed, and simulated annealing started from the greedy chain and from
+  // the spectral ordering of the interaction graph. Each strategy is limited
+  // by its share of workBudget, the number of 2-qubit gates the cost
+  // evaluations may go through, and the winner is chosen by cost and then by
+  // the index of the strategy, so the result does not depend on the machine,
+  // on its load or on the scheduling of the threads. The identity map is
+  // always a candidate, so the result is never worse than not remapping at
+  // all.
   std::vector<long long int> ComputeOptimalQubitsMap(
       const std::vector<std::shared_ptr<Circuits::Circuit<>>>& layers,
-      int nrShuffles = 0/*25*/, int nrSwaps = 0/*10*/) {
+      int nrShuffles = 0/*25*/, int nrSwaps = 0/*10*/,
+      size_t workBudget = kDefaultLayoutSearchWorkBudget) {
     const IndexType nrQubits = getNrQubits();
 
     if (layers.empty() || nrQubits <= 2) return qubitsMap;
 
-    
-    auto evaluateCost =
-        [&, this](const std::vector<IndexType>& candidateMap) -> double {
-      auto saveQubitsMap = qubitsMap;
-      auto saveQubitsMapInv = qubitsMapInv;
-      auto saveCurrentBondDim = currentBondDim;
-      auto saveTotalSwappingCost = totalSwappingCost;
-      auto saveBondCost = bondCost;
-
-      SetInitialQubitsMap(candidateMap);
-
-      for (const auto& layer : layers) 
-          ApplyGates(layer->GetOperations());
-      auto cost = getTotalSwappingCost();
-      qubitsMap = std::move(saveQubitsMap);
-      qubitsMapInv = std::move(saveQubitsMapInv);
-      currentBondDim = std::move(saveCurrentBondDim);
-      totalSwappingCost = saveTotalSwappingCost;
-      bondCost = std::move(saveBondCost);
-
-      return cost;
-    };
-
-    auto evaluateCostBounded = [&, this](
-                                   const std::vector<IndexType>& candidateMap,
-                                   double bound) -> double {
-      auto saveQubitsMap = qubitsMap;
-      auto saveQubitsMapInv = qubitsMapInv;
-      auto saveCurrentBondDim = currentBondDim;
-      auto saveTotalSwappingCost = totalSwappingCost;
-      auto saveBondCost = bondCost;
-
-      SetInitialQubitsMap(candidateMap);
-
-      for (const auto& layer : layers) {
-        ApplyGates(layer->GetOperations());
-        auto cost = getTotalSwappingCost();
-        if (cost >= bound) {
-          // restore state
-          qubitsMap = std::move(saveQubitsMap);
-          qubitsMapInv = std::move(saveQubitsMapInv);
-          currentBondDim = std::move(saveCurrentBondDim);
-          totalSwappingCost = saveTotalSwappingCost;
-          bondCost = std::move(saveBondCost);
-          return cost;
-        }
-      }
-      auto cost = getTotalSwappingCost();
-      // restore state
-      qubitsMap = std::move(saveQubitsMap);
-      qubitsMapInv = std::move(saveQubitsMapInv);
-      currentBondDim = std::move(saveCurrentBondDim);
-      totalSwappingCost = saveTotalSwappingCost;
-      bondCost = std::move(saveBondCost);
-
-      return cost;
-    };
-    
-
     // Collect 2-qubit pairs from each layer, preserving layer boundaries
-    struct QubitPair {
-      IndexType q1, q2;
-    };
     std::vector<std::vector<QubitPair>> layerPairs;
 
     for (size_t li = 0; li < layers.size(); ++li) {
@@ -533,152 +481,345 @@ class MPSDummySimulator {
     }
     if (layerPairs.empty()) return qubitsMap;
 
-    // Build a linear qubit chain from ordered pairs using a group-merging
-    // strategy.  Pairs are processed in order (earlier = more important).
-    // - If neither qubit is placed, create a new group [q1, q2].
-    // - If one qubit is already in a group, add the other at the group
-    //   end (front or back) that minimizes distance to the existing one.
-    // - If both are in different groups, merge as [gA][gB] or [gB][gA],
-    //   whichever places q1 and q2 closer together.
-    // - If both are already in the same group, do nothing.
-    auto buildChain = [&](const std::vector<std::vector<QubitPair>>& orderedLP)
-        -> std::vector<long long int> {
-      std::vector<std::deque<IndexType>> groups;
-      std::vector<int> qubitGroup(nrQubits, -1);
-      std::unordered_set<IndexType> placedQubits;
-
-      for (const auto& lp : orderedLP) {
-        for (const auto& p : lp) {
-          const int g1 = qubitGroup[p.q1];
-          const int g2 = qubitGroup[p.q2];
-
-          if (g1 < 0 && g2 < 0) {
-            // Neither placed: create a new group
-            const int gIdx = static_cast<int>(groups.size());
-            groups.push_back({p.q1, p.q2});
-            qubitGroup[p.q1] = gIdx;
-            qubitGroup[p.q2] = gIdx;
-            placedQubits.insert(p.q1);
-            placedQubits.insert(p.q2);
-          } else if (g1 >= 0 && g2 < 0) {
-            // q1 placed, q2 not: add q2 at the closer end of q1's group
-            auto& grp = groups[g1];
-            size_t idx = 0;
-            for (size_t i = 0; i < grp.size(); ++i)
-              if (grp[i] == p.q1) {
-                idx = i;
-                break;
-              }
-            // front distance: idx + 1, back distance: grp.size() - idx
-            if (idx + 1 <= grp.size() - idx)
-              grp.push_front(p.q2);
-            else
-              grp.push_back(p.q2);
-            qubitGroup[p.q2] = g1;
-            placedQubits.insert(p.q2);
-          } else if (g1 < 0 && g2 >= 0) {
-            // q2 placed, q1 not: add q1 at the closer end of q2's group
-            auto& grp = groups[g2];
-            size_t idx = 0;
-            for (size_t i = 0; i < grp.size(); ++i)
-              if (grp[i] == p.q2) {
-                idx = i;
-                break;
-              }
-            if (idx + 1 <= grp.size() - idx)
-              grp.push_front(p.q1);
-            else
-              grp.push_back(p.q1);
-            qubitGroup[p.q1] = g2;
-            placedQubits.insert(p.q1);
-          } else if (g1 != g2) {
-            // Both in different groups: merge to minimize distance
-            auto& grpA = groups[g1];
-            auto& grpB = groups[g2];
-            size_t idxA = 0, idxB = 0;
-            for (size_t i = 0; i < grpA.size(); ++i)
-              if (grpA[i] == p.q1) {
-                idxA = i;
-                break;
-              }
-            for (size_t i = 0; i < grpB.size(); ++i)
-              if (grpB[i] == p.q2) {
-                idxB = i;
-                break;
-              }
-            // [A][B]: q1 at idxA, q2 at |A|+idxB -> dist = |A|+idxB-idxA
-            // [B][A]: q2 at idxB, q1 at |B|+idxA -> dist = |B|+idxA-idxB
-            const size_t distAB = grpA.size() + idxB - idxA;
-            const size_t distBA = grpB.size() + idxA - idxB;
-
-            int mergedGroup;
-            if (distAB <= distBA) {
-              for (const auto q : grpB) grpA.push_back(q);
-              grpB.clear();
-              mergedGroup = g1;
-            } else {
-              for (const auto q : grpA) grpB.push_back(q);
-              grpA.clear();
-              mergedGroup = g2;
+    const auto greedyMap = BuildGreedyChainMap(layerPairs, nrQubits);
+    if (layers.size() <= 2) return greedyMap;
+
+    const auto spectralMap = BuildSpectralMap(layerPairs, nrQubits);
+
+    std::vector<long long int> identityMap(nrQubits);
+    std::iota(identityMap.begin(), identityMap.end(), 0);
+    const std::vector<const std::vector<long long int>*> otherSeeds{
+        &identityMap, &spectralMap};
+
+    // the seeds are cheap to evaluate, pick the best one as the starting point
+    // for the perturbation search
+    auto bestSeedMap = greedyMap;
+    double bestSeedCost = EvaluateQubitsMapCost(layers, greedyMap);
+    for (const auto* seed : otherSeeds) {
+      const double cost = EvaluateQubitsMapCost(layers, *seed, bestSeedCost);
+      if (cost < bestSeedCost) {
+        bestSeedCost = cost;
+        bestSeedMap = *seed;
+      }
+    }
+
+    struct SearchResult {
+      std::vector<long long int> qubitsMap;
+      double cost;
+    };
+
+    std::vector<SearchResult> results{{bestSeedMap, bestSeedCost},
+                                      {greedyMap, bestSeedCost},
+                                      {spectralMap, bestSeedCost}};
+    const int nrStrategies = static_cast<int>(results.size());
+
+    size_t nrTwoQubitGates = 0;
+    for (const auto& lp : layerPairs) nrTwoQubitGates += lp.size();
+    const long long int evaluationsPerStrategy = static_cast<long long int>(
+        workBudget / (nrTwoQubitGates * static_cast<size_t>(nrStrategies)));
+
+    // the exceptions cannot leave the parallel region, they are rethrown after
+    std::vector<std::exception_ptr> errors(nrStrategies);
+
+#pragma omp parallel for num_threads(nrStrategies) schedule(static, 1)
+    for (int s = 0; s < nrStrategies; ++s) {
+      try {
+        auto sim = Clone();
+        auto& result = results[s];
+        long long int evaluations = evaluationsPerStrategy;
+
+        if (s == 0)
+          sim->PerturbQubitsMap(layers, result.qubitsMap, result.cost,
+                                nrShuffles, nrSwaps, evaluations);
+        else {
+          result.cost = sim->EvaluateQubitsMapCost(layers, result.qubitsMap);
+          sim->AnnealQubitsMap(layers, result.qubitsMap, result.cost,
+                               kLayoutSearchSeed + s, evaluations);
+        }
+      } catch (...) {
+        errors[s] = std::current_exception();
+      }
+    }
+
+    for (const auto& error : errors)
+      if (error) std::rethrow_exception(error);
+
+    // ties are resolved in the order of the strategies, to keep the result
+    // reproducible
+    size_t best = 0;
+    for (size_t s = 1; s < results.size(); ++s)
+      if (results[s].cost < results[best].cost) best = s;
+
+    return std::move(results[best].qubitsMap);
+  }
+
+  // Evaluates the swapping cost of the layers when starting from candidateMap.
+  // The evaluation stops as soon as the cost reaches bound.
+  // The state of the simulator is left unchanged.
+  double EvaluateQubitsMapCost(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>>& layers,
+      const std::vector<IndexType>& candidateMap,
+      double bound = std::numeric_limits<double>::infinity()) {
+    auto saveQubitsMap = qubitsMap;
+    auto saveQubitsMapInv = qubitsMapInv;
+    auto saveCurrentBondDim = currentBondDim;
+    auto saveTotalSwappingCost = totalSwappingCost;
+    auto saveBondCost = bondCost;
+    const auto saveNrBondUpdates = nrBondUpdates;
+
+    SetInitialQubitsMap(candidateMap);
+
+    for (const auto& layer : layers) {
+      ApplyGates(layer->GetOperations());
+      if (getTotalSwappingCost() >= bound) break;
+    }
+    const auto cost = getTotalSwappingCost();
+
+    // restore state
+    qubitsMap = std::move(saveQubitsMap);
+    qubitsMapInv = std::move(saveQubitsMapInv);
+    currentBondDim = std::move(saveCurrentBondDim);
+    totalSwappingCost = saveTotalSwappingCost;
+    bondCost = std::move(saveBondCost);
+    nrBondUpdates = saveNrBondUpdates;
+
+    return cost;
+  }
+
+  IndexType getMaxBondDimension() const { return maxVirtualExtent; }
+
+  // 2-qubit gates the layout search cost evaluations may go through
+  static constexpr size_t kDefaultLayoutSearchWorkBudget = 20000000;
+
+ private:
+  struct QubitPair {
+    IndexType q1, q2;
+  };
+
+  static constexpr unsigned int kLayoutSearchSeed = 42;
+  // above this the dense eigensolver is too slow, the spectral ordering falls
+  // back to the breadth first one
+  static constexpr IndexType kMaxSpectralOrderingQubits = 1024;
+
+  // Build a linear qubit chain from ordered pairs using a group-merging
+  // strategy.  Pairs are processed in order (earlier = more important).
+  // - If neither qubit is placed, create a new group [q1, q2].
+  // - If one qubit is already in a group, add the other at the group
+  //   end (front or back) that minimizes distance to the existing one.
+  // - If both are in different groups, merge as [gA][gB] or [gB][gA],
+  //   whichever places q1 and q2 closer together.
+  // - If both are already in the same group, do nothing.
+  static std::vector<long long int> BuildGreedyChainMap(
+      const std::vector<std::vector<QubitPair>>& orderedLP,
+      IndexType nrQubits) {
+    std::vector<std::deque<IndexType>> groups;
+    std::vector<int> qubitGroup(nrQubits, -1);
+    std::unordered_set<IndexType> placedQubits;
+
+    for (const auto& lp : orderedLP) {
+      for (const auto& p : lp) {
+        const int g1 = qubitGroup[p.q1];
+        const int g2 = qubitGroup[p.q2];
+
+        if (g1 < 0 && g2 < 0) {
+          // Neither placed: create a new group
+          const int gIdx = static_cast<int>(groups.size());
+          groups.push_back({p.q1, p.q2});
+          qubitGroup[p.q1] = gIdx;
+          qubitGroup[p.q2] = gIdx;
+          placedQubits.insert(p.q1);
+          placedQubits.insert(p.q2);
+        } else if (g1 >= 0 && g2 < 0) {
+          // q1 placed, q2 not: add q2 at the closer end of q1's group
+          auto& grp = groups[g1];
+          size_t idx = 0;
+          for (size_t i = 0; i < grp.size(); ++i)
+            if (grp[i] == p.q1) {
+              idx = i;
+              break;
+            }
+          // front distance: idx + 1, back distance: grp.size() - idx
+          if (idx + 1 <= grp.size() - idx)
+            grp.push_front(p.q2);
+          else
+            grp.push_back(p.q2);
+          qubitGroup[p.q2] = g1;
+          placedQubits.insert(p.q2);
+        } else if (g1 < 0 && g2 >= 0) {
+          // q2 placed, q1 not: add q1 at the closer end of q2's group
+          auto& grp = groups[g2];
+          size_t idx = 0;
+          for (size_t i = 0; i < grp.size(); ++i)
+            if (grp[i] == p.q2) {
+              idx = i;
+              break;
+            }
+          if (idx + 1 <= grp.size() - idx)
+            grp.push_front(p.q1);
+          else
+            grp.push_back(p.q1);
+          qubitGroup[p.q1] = g2;
+          placedQubits.insert(p.q1);
+        } else if (g1 != g2) {
+          // Both in different groups: merge to minimize distance
+          auto& grpA = groups[g1];
+          auto& grpB = groups[g2];
+          size_t idxA = 0, idxB = 0;
+          for (size_t i = 0; i < grpA.size(); ++i)
+            if (grpA[i] == p.q1) {
+              idxA = i;
+              break;
             }
-            for (const auto q : groups[mergedGroup])
-              qubitGroup[q] = mergedGroup;
+          for (size_t i = 0; i < grpB.size(); ++i)
+            if (grpB[i] == p.q2) {
+              idxB = i;
+              break;
+            }
+          // [A][B]: q1 at idxA, q2 at |A|+idxB -> dist = |A|+idxB-idxA
+          // [B][A]: q2 at idxB, q1 at |B|+idxA -> dist = |B|+idxA-idxB
+          const size_t distAB = grpA.size() + idxB - idxA;
+          const size_t distBA = grpB.size() + idxA - idxB;
+
+          int mergedGroup;
+          if (distAB <= distBA) {
+            for (const auto q : grpB) grpA.push_back(q);
+            grpB.clear();
+            mergedGroup = g1;
+          } else {
+            for (const auto q : grpA) grpB.push_back(q);
+            grpA.clear();
+            mergedGroup = g2;
           }
-          // Both in the same group: do nothing
-
-          if (placedQubits.size() == static_cast<size_t>(nrQubits))
-            break;  // all qubits placed, can stop processing pairs
+          for (const auto q : groups[mergedGroup]) qubitGroup[q] = mergedGroup;
         }
+        // Both in the same group: do nothing
 
         if (placedQubits.size() == static_cast<size_t>(nrQubits))
           break;  // all qubits placed, can stop processing pairs
       }
 
-      // Concatenate all non-empty groups
-      std::vector<IndexType> chain;
-      chain.reserve(nrQubits);
-      for (const auto& grp : groups)
-        for (const auto q : grp) chain.push_back(q);
+      if (placedQubits.size() == static_cast<size_t>(nrQubits))
+        break;  // all qubits placed, can stop processing pairs
+    }
 
-      // Append any remaining unplaced qubits
-      for (IndexType q = 0; q < nrQubits; ++q)
-        if (qubitGroup[q] < 0) chain.push_back(q);
+    // Concatenate all non-empty groups
+    std::vector<IndexType> chain;
+    chain.reserve(nrQubits);
+    for (const auto& grp : groups)
+      for (const auto q : grp) chain.push_back(q);
 
-      assert(chain.size() == static_cast<size_t>(nrQubits));
+    // Append any remaining unplaced qubits
+    for (IndexType q = 0; q < nrQubits; ++q)
+      if (qubitGroup[q] < 0) chain.push_back(q);
 
-      // Convert chain to qubitsMap: chain[physPos] = logicalQubit
-      std::vector<long long int> result(nrQubits);
-      for (size_t i = 0; i < chain.size(); ++i)
-        result[chain[i]] = static_cast<long long int>(i);
+    assert(chain.size() == static_cast<size_t>(nrQubits));
 
-      return result;
-    };
+    return ChainToQubitsMap(chain);
+  }
 
-    auto optMap = buildChain(layerPairs);
-    if (layers.size() <= 2) return optMap;
-    auto optCost = evaluateCost(optMap);
+  // Orders the qubits by the Fiedler vector of the Laplacian of the
+  // interaction graph (edges weighted by the number of 2-qubit gates), which
+  // places strongly interacting qubits close to each other on the chain.
+  // Each connected component is ordered separately, the components are
+  // concatenated and the idle qubits go at the end.
+  static std::vector<long long int> BuildSpectralMap(
+      const std::vector<std::vector<QubitPair>>& layerPairs,
+      IndexType nrQubits) {
+    std::vector<std::unordered_map<IndexType, double>> adjacency(nrQubits);
+    for (const auto& lp : layerPairs)
+      for (const auto& p : lp) {
+        adjacency[p.q1][p.q2] += 1.;
+        adjacency[p.q2][p.q1] += 1.;
+      }
+
+    std::vector<bool> visited(nrQubits, false);
+    std::vector<IndexType> chain;
+    chain.reserve(nrQubits);
+
+    for (IndexType start = 0; start < nrQubits; ++start) {
+      if (visited[start] || adjacency[start].empty()) continue;
+
+      // breadth first, this is also the fallback ordering for components too
+      // large for the eigensolver
+      std::vector<IndexType> component{start};
+      visited[start] = true;
+      for (size_t i = 0; i < component.size(); ++i)
+        for (const auto& [q, w] : adjacency[component[i]])
+          if (!visited[q]) {
+            visited[q] = true;
+            component.push_back(q);
+          }
+
+      const IndexType sz = static_cast<IndexType>(component.size());
+      if (sz > 2 && sz <= kMaxSpectralOrderingQubits) {
+        std::unordered_map<IndexType, IndexType> localIndex;
+        for (IndexType i = 0; i < sz; ++i) localIndex[component[i]] = i;
+
+        Eigen::MatrixXd laplacian = Eigen::MatrixXd::Zero(sz, sz);
+        for (IndexType i = 0; i < sz; ++i)
+          for (const auto& [q, w] : adjacency[component[i]]) {
+            laplacian(i, localIndex[q]) -= w;
+            laplacian(i, i) += w;
+          }
 
-    std::vector<long long int> qubitsMap(nrQubits);
-    std::iota(qubitsMap.begin(), qubitsMap.end(), 0);
-    double tryCost = evaluateCostBounded(qubitsMap, optCost);
-    if (tryCost < optCost) {
-      optCost = tryCost;
-      optMap = qubitsMap;
+        const Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(laplacian);
+        if (solver.info() == Eigen::Success) {
+          const Eigen::VectorXd fiedler = solver.eigenvectors().col(1);
+          std::vector<IndexType> order(sz);
+          std::iota(order.begin(), order.end(), 0);
+          std::stable_sort(order.begin(), order.end(),
+                           [&fiedler](IndexType a, IndexType b) {
+                             return fiedler(a) < fiedler(b);
+                           });
+          for (const auto i : order) chain.push_back(component[i]);
+          continue;
+        }
+      }
+
+      chain.insert(chain.end(), component.begin(), component.end());
     }
 
+    for (IndexType q = 0; q < nrQubits; ++q)
+      if (!visited[q]) chain.push_back(q);
+
+    assert(chain.size() == static_cast<size_t>(nrQubits));
+
+    return ChainToQubitsMap(chain);
+  }
+
+  // Convert chain to qubitsMap: chain[physPos] = logicalQubit
+  static std::vector<long long int> ChainToQubitsMap(
+      const std::vector<IndexType>& chain) {
+    std::vector<long long int> result(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i)
+      result[chain[i]] = static_cast<long long int>(i);
+
+    return result;
+  }
+
+  // Random perturbations of a few swaps each, followed by a 2-opt local
+  // search, keeping only the improvements. Stops when the evaluations are
+  // used up.
+  void PerturbQubitsMap(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>>& layers,
+      std::vector<long long int>& optMap, double& optCost, int nrShuffles,
+      int nrSwaps, long long int& evaluations) {
+    const IndexType nrQubits = getNrQubits();
+
     // try some random shuffles as well, in case the heuristic ordering is not
     // optimal
-    std::mt19937 rng(42);
-    for (int i = 0; i < nrShuffles; ++i) {
-      std::shuffle(qubitsMap.begin(), qubitsMap.end(), rng);
-      tryCost = evaluateCostBounded(qubitsMap, optCost);
+    std::mt19937 rng(kLayoutSearchSeed);
+    std::vector<long long int> shuffledMap = optMap;
+    for (int i = 0; i < nrShuffles && evaluations > 0; ++i, --evaluations) {
+      std::shuffle(shuffledMap.begin(), shuffledMap.end(), rng);
+      const double tryCost =
+          EvaluateQubitsMapCost(layers, shuffledMap, optCost);
       if (tryCost < optCost) {
         optCost = tryCost;
-        optMap = qubitsMap;
+        optMap = shuffledMap;
       }
     }
 
-
     std::uniform_int_distribution<IndexType> qubitDist(0, nrQubits - 1);
     std::uniform_int_distribution<int> nrSwapsDist(
         1, std::min<int>(3, static_cast<int>(nrQubits) / 2));
@@ -687,17 +828,19 @@ class MPSDummySimulator {
     const int maxTotalShuffles = maxNoImprove * 3;
     int noImproveCount = 0;
 
-    for (int s = 0; s < maxTotalShuffles && noImproveCount < maxNoImprove; ++s) {
+    for (int s = 0; s < maxTotalShuffles && noImproveCount < maxNoImprove &&
+                    evaluations > 0;
+         ++s, --evaluations) {
       auto tryMap = optMap;
-      const int nrSwaps = nrSwapsDist(rng);
-      for (int sw = 0; sw < nrSwaps; ++sw) {
+      const int nrSwapsTry = nrSwapsDist(rng);
+      for (int sw = 0; sw < nrSwapsTry; ++sw) {
         const IndexType a = qubitDist(rng);
         IndexType b = qubitDist(rng);
         while (b == a) b = qubitDist(rng);
         std::swap(tryMap[a], tryMap[b]);
       }
 
-      auto cost = evaluateCostBounded(tryMap, optCost);
+      const auto cost = EvaluateQubitsMapCost(layers, tryMap, optCost);
       if (cost < optCost) {
         optMap = tryMap;
         optCost = cost;
@@ -709,31 +852,79 @@ class MPSDummySimulator {
 
     // 2-opt local search: iteratively swap pairs of positions in the best map
     // and keep improvements, until no single swap can reduce the cost
-    {  
-      auto candidate = optMap;
-      bool improved = true;
-      for (int improvementCount = 0; improved && improvementCount < nrSwaps;
-           ++improvementCount) {
-        improved = false;
-        for (IndexType i = 0; i < nrQubits; ++i) {
-          for (IndexType j = i + 1; j < nrQubits; ++j) {
-            // swap the mapped positions of qubits i and j
+    auto candidate = optMap;
+    bool improved = true;
+    for (int improvementCount = 0; improved && improvementCount < nrSwaps;
+         ++improvementCount) {
+      improved = false;
+      for (IndexType i = 0; i < nrQubits; ++i) {
+        for (IndexType j = i + 1; j < nrQubits; ++j) {
+          if (evaluations <= 0) return;
+          --evaluations;
+
+          // swap the mapped positions of qubits i and j
+          std::swap(candidate[i], candidate[j]);
+          const auto cost = EvaluateQubitsMapCost(layers, candidate, optCost);
+          if (cost < optCost) {
+            optMap = candidate;
+            optCost = cost;
+            improved = true;
+          } else {
+            // revert
             std::swap(candidate[i], candidate[j]);
-            auto cost = evaluateCostBounded(candidate, optCost);
-            if (cost < optCost) {
-              optMap = candidate;
-              optCost = cost;
-              improved = true;
-            } else {
-              // revert
-              std::swap(candidate[i], candidate[j]);
-            }
           }
         }
       }
     }
+  }
 
-    return optMap;
+  // Simulated annealing over transpositions of the qubits map.
+  // The acceptance test is turned into a bound for the cost evaluation
+  // (draw u first, accept if cost < current * (1 - T log u)), so rejected
+  // candidates are abandoned as soon as they exceed it. Stops when the
+  // evaluations are used up.
+  void AnnealQubitsMap(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>>& layers,
+      std::vector<long long int>& bestMap, double& bestCost,
+      unsigned int seed, long long int& evaluations) {
+    const IndexType nrQubits = getNrQubits();
+    if (nrQubits < 2) return;
+
+    constexpr double startTemperature = 0.1;
+    constexpr double endTemperature = 1e-3;
+    const int nrIterations = 20 * static_cast<int>(nrQubits);
+    const double cooling = std::pow(endTemperature / startTemperature,
+                                    1. / static_cast<double>(nrIterations));
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<IndexType> qubitDist(0, nrQubits - 1);
+    std::uniform_real_distribution<double> uniform(
+        std::numeric_limits<double>::min(), 1.);
+
+    auto currentMap = bestMap;
+    double currentCost = bestCost;
+    double temperature = startTemperature;
+
+    for (int it = 0; it < nrIterations && evaluations > 0;
+         ++it, --evaluations, temperature *= cooling) {
+      const IndexType a = qubitDist(rng);
+      IndexType b = qubitDist(rng);
+      while (b == a) b = qubitDist(rng);
+
+      const double bound =
+          currentCost * (1. - temperature * std::log(uniform(rng)));
+
+      std::swap(currentMap[a], currentMap[b]);
+      const double cost = EvaluateQubitsMapCost(layers, currentMap, bound);
+      if (cost < bound) {
+        currentCost = cost;
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestMap = currentMap;
+        }
+      } else
+        std::swap(currentMap[a], currentMap[b]);
+    }
   }
 
  private:
@@ -745,6 +936,7 @@ class MPSDummySimulator {
       qubitsMapInv[i] = qubitsMap[i] = i;
 
     totalSwappingCost = 0;
+    nrBondUpdates = 0;
     if (!currentBondDim.empty())
       std::fill(currentBondDim.begin(), currentBondDim.end(), 1.0);
   }
@@ -771,6 +963,278 @@ class MPSDummySimulator {
     SwapQubitsToPosition(qubit1, qubit2, meetPos);
   }
 
+  // Lookahead search state
+
+  struct LookaheadGate {
+    const std::shared_ptr<Circuits::IOperation<>>* op;
+    IndexType qubit1, qubit2;
+    bool twoQubits;
+  };
+
+  // Reuse a single static dummy 2-qubit gate to avoid heap allocation.
+  // Only getQubitsNumber() is checked; the matrix is never read.
+  static const QC::Gates::AppliedGate<MatrixClass>& DummyTwoQubitGate() {
+    static const QC::Gates::AppliedGate<MatrixClass> dummy2qGate(
+        MatrixClass::Identity(4, 4), 0, 1);
+    return dummy2qGate;
+  }
+
+  // The chain segment [first, last] saved before a swap or a gate: the qubits
+  // on the positions and the bonds in between, starting at dataOffset in the
+  // saved values stacks
+  struct LookaheadJournalEntry {
+    IndexType first, last;
+    size_t dataOffset;
+  };
+
+  struct LookaheadKey {
+    const Circuits::IOperation<>* op;
+    int depth;
+    int heuristicDepth;
+    int nrGatesAhead;
+    uint64_t stateHash;
+
+    bool operator==(const LookaheadKey& other) const {
+      return op == other.op && depth == other.depth &&
+             heuristicDepth == other.heuristicDepth &&
+             nrGatesAhead == other.nrGatesAhead &&
+             stateHash == other.stateHash;
+    }
+  };
+
+  struct LookaheadKeyHash {
+    size_t operator()(const LookaheadKey& key) const {
+      uint64_t h = Mix(reinterpret_cast<uintptr_t>(key.op) ^ key.stateHash);
+      h = Mix(h ^ (static_cast<uint64_t>(key.depth) << 32) ^
+              (static_cast<uint64_t>(key.heuristicDepth) << 16) ^
+              static_cast<uint64_t>(key.nrGatesAhead));
+      return static_cast<size_t>(h);
+    }
+  };
+
+  struct LookaheadCacheEntry {
+    double cost = 0.;
+    bool exact = false;  // otherwise cost is only a lower bound
+  };
+
+  static constexpr size_t kMaxLookaheadCacheEntries = 1 << 18;
+  static constexpr int kLookaheadDecisionsPerTuning = 32;
+  static constexpr double kMaxLookaheadTimeFraction = 0.1;
+
+  // The state hash is updated for every change of the chain during the
+  // search, so it has to be cheap: a multiply and a xor-shift per entry
+  static uint64_t Mix(uint64_t x) {
+    x *= 0xbf58476d1ce4e5b9ULL;
+    return x ^ (x >> 31);
+  }
+
+  static uint64_t PositionHash(IndexType qubit, IndexType position) {
+    return Mix((static_cast<uint64_t>(qubit) << 32) ^
+               static_cast<uint64_t>(position));
+  }
+
+  uint64_t BondHash(IndexType bond) const {
+    uint64_t dimBits, costBits;
+    std::memcpy(&dimBits, &currentBondDim[bond], sizeof(dimBits));
+    std::memcpy(&costBits, &bondCost[bond], sizeof(costBits));
+
+    return Mix(dimBits ^ (costBits * 0x94d049bb133111ebULL) ^
+               ~static_cast<uint64_t>(bond));
+  }
+
+  void JournalSegment(IndexType first, IndexType last) {
+    lookaheadJournal.push_back({first, last, lookaheadSavedBonds.size()});
+    for (IndexType b = first; b < last; ++b) {
+      lookaheadSavedBonds.push_back(currentBondDim[b]);
+      lookaheadSavedBonds.push_back(bondCost[b]);
+    }
+    lookaheadSavedQubits.insert(lookaheadSavedQubits.end(),
+                                qubitsMapInv.begin() + first,
+                                qubitsMapInv.begin() + last + 1);
+  }
+
+  // Collects the 2-qubit gates the search can reach and starts journaling
+  bool BeginLookahead(
+      const std::vector<std::shared_ptr<Circuits::IOperation<>>>& upcomingGates,
+      long long int currentGateIndex, int lookaheadDepth) {
+    lookaheadWindow.clear();
+
+    const size_t windowSize =
+        static_cast<size_t>(std::max(lookaheadDepth, 0)) + 1;
+    for (size_t i = static_cast<size_t>(std::max(currentGateIndex, 0LL));
+         i < upcomingGates.size() && lookaheadWindow.size() < windowSize;
+         ++i) {
+      const auto qbits = upcomingGates[i]->AffectedQubits();
+      if (qbits.size() >= 2)
+        lookaheadWindow.push_back({&upcomingGates[i],
+                                   static_cast<IndexType>(qbits[0]),
+                                   static_cast<IndexType>(qbits[1]),
+                                   qbits.size() == 2});
+    }
+    if (lookaheadWindow.empty()) return false;
+
+    lookaheadHash = 0;
+    for (IndexType q = 0; q < static_cast<IndexType>(qubitsMap.size()); ++q)
+      lookaheadHash ^= PositionHash(q, qubitsMap[q]);
+    for (IndexType b = 0; b < static_cast<IndexType>(currentBondDim.size());
+         ++b)
+      lookaheadHash ^= BondHash(b);
+
+    if (lookaheadCache.size() >= kMaxLookaheadCacheEntries)
+      lookaheadCache.clear();
+
+    lookaheadJournal.clear();
+    lookaheadSavedBonds.clear();
+    lookaheadSavedQubits.clear();
+    lookaheadSavedSwappingCost = totalSwappingCost;
+    lookaheadSavedNrBondUpdates = nrBondUpdates;
+    lookaheadActive = true;
+
+    return true;
+  }
+
+  void EndLookahead() {
+    RollbackLookahead(0);
+    totalSwappingCost = lookaheadSavedSwappingCost;
+    nrBondUpdates = lookaheadSavedNrBondUpdates;
+    lookaheadActive = false;
+  }
+
+  // Minimal cost of the gates of the window starting at windowIndex, with
+  // depth levels of lookahead left.
+  // The result is exact if below bound, otherwise it's only a lower bound (the
+  // subtrees exceeding the bound are abandoned).
+  // With a single candidate position the changes are not rolled back here,
+  // the caller rolls back the whole chain at once.
+  double SearchLookahead(size_t windowIndex, int depth, int heuristicDepth,
+                         double bound, IndexType* bestPosition = nullptr) {
+    const auto& gate = lookaheadWindow[windowIndex];
+
+    IndexType realq1 = qubitsMap[gate.qubit1];
+    IndexType realq2 = qubitsMap[gate.qubit2];
+    if (realq1 > realq2) std::swap(realq1, realq2);
+
+    IndexType firstPosition = realq1;
+    IndexType lastPosition = realq1;
+    if (realq2 - realq1 > 1) {
+      if (depth <= 0 || depth <= heuristicDepth)
+        firstPosition = lastPosition =
+            ComputeHeuristicMeetPosition(realq1, realq2);
+      else
+        lastPosition = realq2 - 1;
+    }
+
+    if (firstPosition == lastPosition) {
+      if (bestPosition) *bestPosition = firstPosition;
+      return EvaluateLookaheadPosition(windowIndex, firstPosition, depth,
+                                       heuristicDepth, bound, false);
+    }
+
+    // only the branching nodes are memoized, the chains of single candidates
+    // are cheaper to walk than to look up
+    const int nrGatesAhead =
+        static_cast<int>(lookaheadWindow.size() - windowIndex - 1);
+    const bool memoize = !bestPosition && nrGatesAhead > 0;
+
+    const LookaheadKey key{gate.op->get(), depth, heuristicDepth,
+                           std::min(depth, nrGatesAhead), lookaheadHash};
+    if (memoize) {
+      const auto it = lookaheadCache.find(key);
+      if (it != lookaheadCache.end() &&
+          (it->second.exact || it->second.cost >= bound))
+        return it->second.cost;
+    }
+
+    double lowest = std::numeric_limits<double>::infinity();
+    for (IndexType m = firstPosition; m <= lastPosition; ++m) {
+      const double cost =
+          EvaluateLookaheadPosition(windowIndex, m, depth, heuristicDepth,
+                                    std::min(bound, lowest), true);
+      if (cost < lowest) {
+        lowest = cost;
+        if (bestPosition) *bestPosition = m;
+      }
+    }
+
+    if (memoize) {
+      auto& entry = lookaheadCache[key];
+      if (lowest < bound)
+        entry = {lowest, true};
+      else if (!entry.exact)
+        entry.cost = std::max(entry.cost, lowest);
+    }
+
+    return lowest;
+  }
+
+  // Cost of meeting at meetPosition for the gate at windowIndex and of the
+  // rest of the window after it.
+  double EvaluateLookaheadPosition(size_t windowIndex, IndexType meetPosition,
+                                   int depth, int heuristicDepth, double bound,
+                                   bool rollback) {
+    const auto& gate = lookaheadWindow[windowIndex];
+
+    const size_t journalMark = lookaheadJournal.size();
+    const double savedSwappingCost = totalSwappingCost;
+    const size_t savedNrBondUpdates = nrBondUpdates;
+    const uint64_t savedHash = lookaheadHash;
+
+    if (std::abs(qubitsMap[gate.qubit1] - qubitsMap[gate.qubit2]) > 1)
+      SwapQubitsToPosition(gate.qubit1, gate.qubit2, meetPosition);
+    if (gate.twoQubits)
+      ApplyGate(DummyTwoQubitGate(), gate.qubit1, gate.qubit2);
+    else
+      ApplyGate(*gate.op);
+
+    double cost = totalSwappingCost - savedSwappingCost;
+    if (cost < bound && depth > 0 && windowIndex + 1 < lookaheadWindow.size())
+      cost += SearchLookahead(windowIndex + 1, depth - 1, heuristicDepth,
+                              bound - cost);
+
+    if (rollback) {
+      RollbackLookahead(journalMark);
+      totalSwappingCost = savedSwappingCost;
+      nrBondUpdates = savedNrBondUpdates;
+      lookaheadHash = savedHash;
+    }
+
+    return cost;
+  }
+
+  void RollbackLookahead(size_t journalMark) {
+    while (lookaheadJournal.size() > journalMark) {
+      const auto& entry = lookaheadJournal.back();
+
+      size_t offset = entry.dataOffset;
+      for (IndexType b = entry.first; b < entry.last; ++b) {
+        currentBondDim[b] = lookaheadSavedBonds[offset++];
+        bondCost[b] = lookaheadSavedBonds[offset++];
+      }
+      lookaheadSavedBonds.resize(entry.dataOffset);
+
+      const size_t qubitsOffset =
+          lookaheadSavedQubits.size() - (entry.last - entry.first + 1);
+      for (IndexType pos = entry.first; pos <= entry.last; ++pos) {
+        const IndexType qubit =
+            lookaheadSavedQubits[qubitsOffset + (pos - entry.first)];
+        qubitsMapInv[pos] = qubit;
+        qubitsMap[qubit] = pos;
+      }
+      lookaheadSavedQubits.resize(qubitsOffset);
+
+      lookaheadJournal.pop_back();
+    }
+  }
+
+  void SetQubitPosition(IndexType qubit, IndexType position) {
+    if (lookaheadActive)
+      lookaheadHash ^=
+          PositionHash(qubit, qubitsMap[qubit]) ^ PositionHash(qubit, position);
+
+    qubitsMap[qubit] = position;
+    qubitsMapInv[position] = qubit;
+  }
+
   // Pick the meeting position with the lowest bond cost (i.e., lowest
   // current bond dimension), matching the real MPS simulator's
   // FindBestMeetingPositionLocal behavior.
@@ -810,6 +1274,8 @@ class MPSDummySimulator {
 
     assert(meetPosition >= realq1 && meetPosition < realq2);
 
+    if (lookaheadActive) JournalSegment(realq1, realq2);
+
     // Move lower qubit (qubit1) rightward from realq1 to meetPosition
     {
       IndexType movingReal = realq1;
@@ -817,13 +1283,11 @@ class MPSDummySimulator {
         const IndexType toReal = movingReal + 1;
         const IndexType toInv = qubitsMapInv[toReal];
 
-        qubitsMap[toInv] = movingReal;
-        qubitsMapInv[movingReal] = toInv;
-
-        qubitsMap[qubit1] = toReal;
-        qubitsMapInv[toReal] = qubit1;
+        SetQubitPosition(toInv, movingReal);
+        SetQubitPosition(qubit1, toReal);
 
         totalSwappingCost += bondCost[movingReal];
+        ++nrBondUpdates;
         growBondDimension(movingReal, true);
         movingReal = toReal;
       }
@@ -836,13 +1300,11 @@ class MPSDummySimulator {
         const IndexType toReal = movingReal - 1;
         const IndexType toInv = qubitsMapInv[toReal];
 
-        qubitsMap[toInv] = movingReal;
-        qubitsMapInv[movingReal] = toInv;
-
-        qubitsMap[qubit2] = toReal;
-        qubitsMapInv[toReal] = qubit2;
+        SetQubitPosition(toInv, movingReal);
+        SetQubitPosition(qubit2, toReal);
 
         totalSwappingCost += bondCost[toReal];
+        ++nrBondUpdates;
         growBondDimension(toReal, true);
         movingReal = toReal;
       }
@@ -864,9 +1326,29 @@ class MPSDummySimulator {
   std::vector<double> currentBondDim;
 
   double totalSwappingCost = 0;
+  size_t nrBondUpdates = 0;
 
   double growthFactorSwap = 1.;
-  double growthFactorGate = 0.7;  
+  double growthFactorGate = 0.7;
+
+  std::vector<LookaheadGate> lookaheadWindow;
+  std::vector<LookaheadJournalEntry> lookaheadJournal;
+  std::vector<double> lookaheadSavedBonds;
+  std::vector<IndexType> lookaheadSavedQubits;
+  std::unordered_map<LookaheadKey, LookaheadCacheEntry, LookaheadKeyHash>
+      lookaheadCache;
+  uint64_t lookaheadHash = 0;
+  double lookaheadSavedSwappingCost = 0.;
+  size_t lookaheadSavedNrBondUpdates = 0;
+  bool lookaheadActive = false;
+
+  bool lookaheadAutoTune = false;
+  int tunedLookaheadDepth = -1;
+  int maxTunedLookaheadDepth = 0;
+  int nrLookaheadDecisions = 0;
+  double lookaheadRoutingTime = 0.;
+  double lookaheadTotalTime = 0.;
+  std::chrono::steady_clock::time_point lastLookaheadDecisionEnd;
 
   void growBondDimension(IndexType bond, bool swap = true, int schmidtRank = 4) {
     // the left and right bond dimensions are relevant because:
@@ -896,6 +1378,8 @@ class MPSDummySimulator {
     // most min(2 * min(leftDim, rightNeighborDim), maxBondDim[bond]) and the minimum is obviously 1
 
 
+    if (lookaheadActive) lookaheadHash ^= BondHash(bond);
+
     const IndexType leftBond = bond - 1;
     const IndexType rightNeigborBond = bond + 1;
     const double betweenDim = currentBondDim[bond];
@@ -914,6 +1398,8 @@ class MPSDummySimulator {
 
     bondCost[bond] =
         currentBondDim[bond] * currentBondDim[bond] * currentBondDim[bond];
+
+    if (lookaheadActive) lookaheadHash ^= BondHash(bond);
   }
 };
 
@@ -0,0 +1,213 @@
+/**
+ * @file MPSEnvironments.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Expectation values of many Pauli strings on a matrix product state, with
+ * shared left environments.
+ *
+ * The mps is loaded from Vidal's form. Each site is stored right normalized,
+ * as its gamma tensor multiplied by the lambdas on its right, so the right
+ * environment of any site is the identity and the left environment of a site
+ * is the diagonal of the squared lambdas on its left. A Pauli string is then
+ * contracted only over its support. The strings are sorted by their first
+ * site and then by their operators, so the strings that start with the same
+ * operators share the left environments built for that common prefix, the
+ * environments are built in a single sweep over the sorted strings.
+ */
+
+#pragma once
+
+#ifndef _MPSENVIRONMENTS_H_
+#define _MPSENVIRONMENTS_H_
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+namespace Simulators {
+
+class MPSEnvironments {
+ public:
+  using MatrixClass = Eigen::MatrixXcd;
+
+  /**
+   * @brief Loads the mps from Vidal's form.
+   *
+   * The gamma tensors are indexed as (left bond, physical, right bond), the
+   * lambdas are the Schmidt values of the bonds between the sites, in the
+   * chain order.
+   *
+   * @param gammas The gamma tensors of the sites.
+   * @param lambdas The Schmidt values of the bonds.
+   * @return False if the dimensions of the tensors do not match a chain of
+   * qubits, in which case nothing is loaded.
+   */
+  template <class GammaTensor, class LambdaVector>
+  bool Load(const std::vector<GammaTensor>& gammas,
+            const std::vector<LambdaVector>& lambdas) {
+    const size_t nrSites = gammas.size();
+    if (nrSites == 0 || lambdas.size() + 1 != nrSites) return false;
+
+    for (size_t pos = 0; pos < nrSites; ++pos) {
+      const Eigen::Index leftDim =
+          pos == 0 ? 1 : static_cast<Eigen::Index>(lambdas[pos - 1].size());
+      const Eigen::Index rightDim =
+          pos == nrSites - 1 ? 1
+                             : static_cast<Eigen::Index>(lambdas[pos].size());
+      if (gammas[pos].dimension(0) != leftDim ||
+          gammas[pos].dimension(1) != 2 ||
+          gammas[pos].dimension(2) != rightDim)
+        return false;
+    }
+
+    sites.resize(nrSites);
+    leftWeights.resize(nrSites);
+
+    for (size_t pos = 0; pos < nrSites; ++pos) {
+      const auto& gamma = gammas[pos];
+      const Eigen::Index leftDim = gamma.dimension(0);
+      const Eigen::Index rightDim = gamma.dimension(2);
+      const bool hasRight = pos < nrSites - 1;
+
+      for (int s = 0; s < 2; ++s) {
+        MatrixClass& site = sites[pos][s];
+        site.resize(leftDim, rightDim);
+        for (Eigen::Index l = 0; l < leftDim; ++l)
+          for (Eigen::Index r = 0; r < rightDim; ++r)
+            site(l, r) = gamma(l, s, r) *
+                         (hasRight ? static_cast<double>(lambdas[pos][r]) : 1.);
+      }
+
+      Eigen::VectorXd& weights = leftWeights[pos];
+      weights.resize(leftDim);
+      for (Eigen::Index l = 0; l < leftDim; ++l)
+        weights[l] = pos == 0 ? 1. : std::norm(lambdas[pos - 1][l]);
+    }
+
+    return true;
+  }
+
+  size_t GetNumberOfSites() const { return sites.size(); }
+
+  /**
+   * @brief Returns the expected values of the Pauli strings.
+   *
+   * The strings are given in the chain order, they can be shorter than the
+   * chain and are expected to be in upper case. The sorted strings are split
+   * in contiguous ranges evaluated in parallel, each thread with its own
+   * environments.
+   *
+   * @param pauliStrings The Pauli strings.
+   * @param nrThreads The number of threads to use.
+   * @return The expected values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string>& pauliStrings, size_t nrThreads) const {
+    std::vector<double> result(pauliStrings.size(), 1.0);
+
+    std::vector<Term> terms;
+    terms.reserve(pauliStrings.size());
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      const std::string& pauliString = pauliStrings[i];
+      const size_t first = pauliString.find_first_not_of('I');
+      if (first == std::string::npos) continue;
+      const size_t last = pauliString.find_last_not_of('I');
+      terms.push_back({first, pauliString.substr(first, last - first + 1), i});
+    }
+
+    if (terms.empty()) return result;
+
+    std::sort(terms.begin(), terms.end(), [](const Term& a, const Term& b) {
+      return a.first < b.first || (a.first == b.first && a.ops < b.ops);
+    });
+
+    const long long int nrTerms = static_cast<long long int>(terms.size());
+    const long long int nrRanges =
+        std::max<long long int>(1, std::min<long long int>(nrThreads, nrTerms));
+
+#pragma omp parallel for num_threads(nrRanges) schedule(static, 1) \
+    if (nrRanges > 1)
+    for (long long int t = 0; t < nrRanges; ++t) {
+      const size_t startTerm = static_cast<size_t>(nrTerms * t / nrRanges);
+      const size_t endTerm = static_cast<size_t>(nrTerms * (t + 1) / nrRanges);
+
+      // envs[k] is the left environment after the first k operators of the
+      // current term
+      std::vector<MatrixClass> envs;
+      const Term* prev = nullptr;
+
+      for (size_t i = startTerm; i < endTerm; ++i) {
+        const Term& term = terms[i];
+
+        size_t common = 0;
+        if (prev && prev->first == term.first) {
+          const size_t maxCommon = std::min(prev->ops.size(), term.ops.size());
+          while (common < maxCommon && prev->ops[common] == term.ops[common])
+            ++common;
+        } else {
+          envs.resize(1);
+          envs[0] = leftWeights[term.first].cast<std::complex<double>>()
+                        .asDiagonal();
+        }
+
+        envs.resize(common + 1);
+        for (size_t k = common; k < term.ops.size(); ++k)
+          envs.emplace_back(Transfer(envs.back(), term.first + k, term.ops[k]));
+
+        result[term.position] = envs.back().trace().real();
+        prev = &term;
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  struct Term {
+    size_t first;     // the first site of the support
+    std::string ops;  // the operators, from the first to the last site
+    size_t position;  // where the result goes
+  };
+
+  /**
+   * @brief Extends a left environment over a site, with a Pauli operator.
+   *
+   * Computes sum over s, s' of O(s, s') B(s)^dagger env B(s').
+   *
+   * @param env The left environment of the site.
+   * @param pos The position of the site in the chain.
+   * @param op The Pauli operator applied on the site.
+   * @return The left environment of the next site.
+   */
+  MatrixClass Transfer(const MatrixClass& env, size_t pos, char op) const {
+    const MatrixClass& b0 = sites[pos][0];
+    const MatrixClass& b1 = sites[pos][1];
+
+    switch (op) {
+      case 'X':
+        return b0.adjoint() * (env * b1) + b1.adjoint() * (env * b0);
+      case 'Y': {
+        const std::complex<double> i(0., 1.);
+        return i * (b1.adjoint() * (env * b0) - b0.adjoint() * (env * b1));
+      }
+      case 'Z':
+        return b0.adjoint() * (env * b0) - b1.adjoint() * (env * b1);
+      default:
+        return b0.adjoint() * (env * b0) + b1.adjoint() * (env * b1);
+    }
+  }
+
+  std::vector<std::array<MatrixClass, 2>> sites;
+  std::vector<Eigen::VectorXd> leftWeights;
+};
+
+}  // namespace Simulators
+
+#endif  // _MPSENVIRONMENTS_H_
@@ -0,0 +1,211 @@
+/**
+ * @file MPSFidelityBudget.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * A fixed singular values cutoff for the MPS simulation, derived a priori from a
+ * target fidelity.
+ *
+ * It is not an adaptive budget: the discarded weight of each update is not
+ * tracked and the bond dimension is not raised where the cutoff would drop
+ * too much, the same worst case cutoff is used for all the updates.
+ *
+ * The mps simulators (qcsim and gpu) truncate by a cutoff on the singular
+ * values of the (normalized) state, at each bond update. Dropping singular
+ * values below the cutoff c from an update with at most D singular values
+ * discards a weight of at most (D - 1) * c^2 (at least one singular value is
+ * always kept), so the fidelity after n updates is at least
+ * (1 - (D - 1) * c^2)^n. The budget splits the target evenly between the bond
+ * updates of the circuit and picks the cutoff from the largest number of
+ * singular values an update can have. After the execution the same bound is
+ * evaluated with the bond dimension actually reached, which is never larger.
+ * If the max bond dimension was reached, singular values above the cutoff
+ * could have been dropped and the bound is not available.
+ */
+
+#pragma once
+
+#ifndef _MPSFIDELITYBUDGET_H_
+#define _MPSFIDELITYBUDGET_H_
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#include "MPSDummySimulator.h"
+#include "Simulator.h"
+
+namespace Simulators {
+
+class MPSFidelityBudget {
+ public:
+  /**
+   * @brief Computes the budget for a circuit.
+   *
+   * The bond updates (two qubit gates and swaps) are counted with the MPS
+   * dummy simulator, on the identity layout. An explicitly set cutoff is kept
+   * if it's smaller than the one derived from the target.
+   *
+   * @param targetFidelity The target total fidelity, no budget if it's not in
+   * (0, 1).
+   * @param operations The operations of the circuit.
+   * @param nrQubits The number of qubits of the simulator.
+   * @param maxBondDim The max bond dimension configured, 0 if not limited.
+   * @param userCutoff The truncation threshold configured, 0 if not set.
+   * @return The budget.
+   */
+  static MPSFidelityBudget Compute(
+      double targetFidelity,
+      const std::vector<std::shared_ptr<Circuits::IOperation<>>> &operations,
+      size_t nrQubits, long long int maxBondDim, double userCutoff) {
+    MPSFidelityBudget budget;
+    if (targetFidelity <= 0. || targetFidelity >= 1. || nrQubits == 0)
+      return budget;
+
+    MPSDummySimulator dummySim(nrQubits);
+    dummySim.ApplyGates(operations);
+
+    budget.enabled = true;
+    budget.nrQubits = nrQubits;
+    budget.maxBondDim = maxBondDim > 0 ? static_cast<size_t>(maxBondDim) : 0;
+    budget.nrBondUpdates = dummySim.getNrBondUpdates();
+    budget.cutoff = ComputeSingularValueCutoff(
+        targetFidelity, budget.nrBondUpdates,
+        GetMaxNrSingularValues(nrQubits, budget.maxBondDim));
+
+    if (userCutoff > 0. && (budget.cutoff <= 0. || userCutoff < budget.cutoff))
+      budget.cutoff = userCutoff;
+
+    return budget;
+  }
+
+  /**
+   * @brief Sets the cutoff on the simulator, if it's a mps one.
+   *
+   * @param sim The simulator.
+   */
+  void Apply(const std::shared_ptr<ISimulator> &sim) const {
+    if (!enabled || cutoff <= 0. || !sim ||
+        sim->GetSimulationType() != SimulationType::kMatrixProductState)
+      return;
+
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<double>::max_digits10)
+        << cutoff;
+    sim->Configure("matrix_product_state_truncation_threshold",
+                   oss.str().c_str());
+  }
+
+  /**
+   * @brief Returns the lower bound of the fidelity of the execution.
+   *
+   * The bound is evaluated with the bond dimension reached during the
+   * execution. If the max bond dimension was hit, singular values above the
+   * cutoff could have been dropped, so there is no bound.
+   *
+   * @param maxBondDimReached The max bond dimension reached.
+   * @return The lower bound of the fidelity, none if not available.
+   */
+  std::optional<double> GetFidelityLowerBound(size_t maxBondDimReached) const {
+    if (!enabled || maxBondDimReached == 0) return std::nullopt;
+    if (maxBondDim > 0 && maxBondDimReached >= maxBondDim) return std::nullopt;
+
+    return ComputeFidelityLowerBound(
+        cutoff, nrBondUpdates,
+        GetMaxNrSingularValues(nrQubits, maxBondDimReached));
+  }
+
+  bool IsEnabled() const { return enabled; }
+
+  double GetCutoff() const { return cutoff; }
+
+  size_t GetNrBondUpdates() const { return nrBondUpdates; }
+
+  /**
+   * @brief Returns how many singular values a bond update can have.
+   *
+   * The two sites tensor of a bond update has at most twice the max bond
+   * dimension singular values, and no bond of a chain of nrQubits qubits has
+   * more than 2^(nrQubits / 2) of them.
+   *
+   * @param nrQubits The number of qubits.
+   * @param maxBondDim The max bond dimension, 0 if not limited.
+   * @return The max number of singular values of a bond update.
+   */
+  static size_t GetMaxNrSingularValues(size_t nrQubits, size_t maxBondDim) {
+    const size_t halfChain = nrQubits / 2;
+    const size_t chainLimit =
+        halfChain >= std::numeric_limits<size_t>::digits - 1
+            ? std::numeric_limits<size_t>::max()
+            : (static_cast<size_t>(1) << halfChain);
+
+    if (maxBondDim == 0 ||
+        maxBondDim >= std::numeric_limits<size_t>::max() / 2)
+      return chainLimit;
+
+    return std::min(chainLimit, 2 * maxBondDim);
+  }
+
+  /**
+   * @brief Returns the singular values cutoff for a target fidelity.
+   *
+   * Each of the nrUpdates updates may discard a weight of
+   * 1 - targetFidelity^(1 / nrUpdates), spread over at most
+   * maxNrSingularValues - 1 dropped singular values.
+   *
+   * @param targetFidelity The target fidelity.
+   * @param nrUpdates The number of bond updates.
+   * @param maxNrSingularValues The max number of singular values of an update.
+   * @return The cutoff, 0 if nothing needs to be truncated.
+   */
+  static double ComputeSingularValueCutoff(double targetFidelity,
+                                           size_t nrUpdates,
+                                           size_t maxNrSingularValues) {
+    if (targetFidelity >= 1. || nrUpdates == 0 || maxNrSingularValues < 2)
+      return 0.;
+    if (targetFidelity <= 0.) return 1.;
+
+    const double discardedWeight =
+        -std::expm1(std::log(targetFidelity) / static_cast<double>(nrUpdates));
+
+    return std::sqrt(discardedWeight /
+                     static_cast<double>(maxNrSingularValues - 1));
+  }
+
+  /**
+   * @brief Returns the fidelity lower bound for a cutoff.
+   *
+   * @param cutoff The singular values cutoff.
+   * @param nrUpdates The number of bond updates.
+   * @param maxNrSingularValues The max number of singular values of an update.
+   * @return The lower bound of the fidelity.
+   */
+  static double ComputeFidelityLowerBound(double cutoff, size_t nrUpdates,
+                                          size_t maxNrSingularValues) {
+    if (cutoff <= 0. || nrUpdates == 0 || maxNrSingularValues < 2) return 1.;
+
+    const double discardedWeight = std::min(
+        1., static_cast<double>(maxNrSingularValues - 1) * cutoff * cutoff);
+    if (discardedWeight >= 1.) return 0.;
+
+    return std::exp(static_cast<double>(nrUpdates) *
+                    std::log1p(-discardedWeight));
+  }
+
+ private:
+  bool enabled = false;
+  size_t nrQubits = 0;
+  size_t maxBondDim = 0;
+  size_t nrBondUpdates = 0;
+  double cutoff = 0.;
+};
+
+}  // namespace Simulators
+
+#endif  // _MPSFIDELITYBUDGET_H_
@@ -0,0 +1,223 @@
+/**
+ * @file MPSLayerUpdate.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Two qubits gates of a circuit layer applied on a matrix product state in
+ * Vidal's form, the gates on disjoint bonds are updated in parallel.
+ *
+ * A gate acting on the neighbouring sites pos and pos + 1 changes only their
+ * gamma tensors and the lambdas of the bond between them, the lambdas of the
+ * two outer bonds are only read. The gates of a layer act on disjoint pairs
+ * of sites, so they can be applied concurrently on the same tensors, as the
+ * even and odd bond sweeps of TEBD are. Each update contracts the two sites
+ * together with the lambdas around them, applies the gate, splits the result
+ * with a truncated svd and divides the outer lambdas out again, which keeps
+ * the canonical form.
+ */
+
+#pragma once
+
+#ifndef _MPSLAYERUPDATE_H_
+#define _MPSLAYERUPDATE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+namespace Simulators {
+
+class MPSLayerUpdate {
+ public:
+  using MatrixClass = Eigen::MatrixXcd;
+
+  /**
+   * @brief A two qubits gate on a bond of the chain.
+   *
+   * The gate acts on the sites position and position + 1. The matrix is given
+   * with the qubit on the left site as the least significant bit, or with the
+   * qubit on the right site as the least significant bit if swapped is set.
+   */
+  struct BondGate {
+    Eigen::Matrix4cd matrix;
+    size_t position = 0;
+    bool swapped = false;
+  };
+
+  /**
+   * @brief Applies the gates on their bonds, in parallel.
+   *
+   * The gamma tensors are indexed as (left bond, physical, right bond), the
+   * lambdas are the Schmidt values of the bonds between the sites, in the
+   * chain order, as for MPSEnvironments::Load.
+   *
+   * @param gammas The gamma tensors of the sites.
+   * @param lambdas The Schmidt values of the bonds.
+   * @param gates The gates, each on its own pair of sites.
+   * @param maxBondDim The maximum bond dimension kept, 0 for no limit.
+   * @param cutoff The Schmidt values that are not above it are dropped.
+   * @param nrThreads The number of threads to use.
+   */
+  template <class GammaTensor, class LambdaVector>
+  static void Apply(std::vector<GammaTensor>& gammas,
+                    std::vector<LambdaVector>& lambdas,
+                    const std::vector<BondGate>& gates, size_t maxBondDim,
+                    double cutoff, int nrThreads) {
+    const size_t nrSites = gammas.size();
+    if (nrSites < 2 || lambdas.size() + 1 != nrSites)
+      throw std::invalid_argument(
+          "MPSLayerUpdate::Apply: The tensors do not form a chain.");
+
+    std::vector<bool> usedSites(nrSites, false);
+    for (const auto& gate : gates) {
+      if (gate.position + 1 >= nrSites || usedSites[gate.position] ||
+          usedSites[gate.position + 1])
+        throw std::invalid_argument(
+            "MPSLayerUpdate::Apply: The gates must act on disjoint bonds of "
+            "the chain.");
+      usedSites[gate.position] = usedSites[gate.position + 1] = true;
+    }
+
+    const long long int nrGates = static_cast<long long int>(gates.size());
+    std::vector<std::exception_ptr> errors(gates.size());
+
+#pragma omp parallel for num_threads(std::max(nrThreads, 1)) schedule(dynamic, 1)
+    for (long long int g = 0; g < nrGates; ++g) {
+      try {
+        ApplyOnBond(gammas, lambdas, gates[g], maxBondDim, cutoff);
+      } catch (...) {
+        errors[g] = std::current_exception();
+      }
+    }
+
+    for (const auto& error : errors)
+      if (error) std::rethrow_exception(error);
+  }
+
+ private:
+  // the Schmidt values below this are numerical noise of the svd, keeping
+  // them would only grow the bond for nothing
+  static constexpr double kNullSchmidtValue = 1e-14;
+
+  template <class GammaTensor, class LambdaVector>
+  static void ApplyOnBond(std::vector<GammaTensor>& gammas,
+                          std::vector<LambdaVector>& lambdas,
+                          const BondGate& gate, size_t maxBondDim,
+                          double cutoff) {
+    const size_t pos = gate.position;
+    const size_t nrSites = gammas.size();
+    GammaTensor& leftGamma = gammas[pos];
+    GammaTensor& rightGamma = gammas[pos + 1];
+
+    const Eigen::Index leftDim = leftGamma.dimension(0);
+    const Eigen::Index bondDim = leftGamma.dimension(2);
+    const Eigen::Index rightDim = rightGamma.dimension(2);
+
+    if (leftGamma.dimension(1) != 2 || rightGamma.dimension(1) != 2 ||
+        rightGamma.dimension(0) != bondDim ||
+        static_cast<Eigen::Index>(lambdas[pos].size()) != bondDim ||
+        (pos > 0 &&
+         static_cast<Eigen::Index>(lambdas[pos - 1].size()) != leftDim) ||
+        (pos + 2 < nrSites &&
+         static_cast<Eigen::Index>(lambdas[pos + 1].size()) != rightDim))
+      throw std::invalid_argument(
+          "MPSLayerUpdate::ApplyOnBond: The dimensions of the tensors do not "
+          "match.");
+
+    Eigen::VectorXd leftLambdas = Eigen::VectorXd::Ones(leftDim);
+    if (pos > 0)
+      for (Eigen::Index l = 0; l < leftDim; ++l)
+        leftLambdas[l] = static_cast<double>(lambdas[pos - 1][l]);
+
+    Eigen::VectorXd rightLambdas = Eigen::VectorXd::Ones(rightDim);
+    if (pos + 2 < nrSites)
+      for (Eigen::Index r = 0; r < rightDim; ++r)
+        rightLambdas[r] = static_cast<double>(lambdas[pos + 1][r]);
+
+    // the rows are (physical, left bond), the columns (physical, right bond)
+    MatrixClass left(2 * leftDim, bondDim);
+    for (int s = 0; s < 2; ++s)
+      for (Eigen::Index l = 0; l < leftDim; ++l)
+        for (Eigen::Index k = 0; k < bondDim; ++k)
+          left(s * leftDim + l, k) = leftLambdas[l] * leftGamma(l, s, k) *
+                                     static_cast<double>(lambdas[pos][k]);
+
+    MatrixClass right(bondDim, 2 * rightDim);
+    for (Eigen::Index k = 0; k < bondDim; ++k)
+      for (int s = 0; s < 2; ++s)
+        for (Eigen::Index r = 0; r < rightDim; ++r)
+          right(k, s * rightDim + r) = rightGamma(k, s, r) * rightLambdas[r];
+
+    const MatrixClass theta = left * right;
+
+    MatrixClass gated = MatrixClass::Zero(2 * leftDim, 2 * rightDim);
+    for (int outLeft = 0; outLeft < 2; ++outLeft)
+      for (int outRight = 0; outRight < 2; ++outRight) {
+        const int row = GateIndex(outLeft, outRight, gate.swapped);
+        for (int inLeft = 0; inLeft < 2; ++inLeft)
+          for (int inRight = 0; inRight < 2; ++inRight) {
+            const std::complex<double> element =
+                gate.matrix(row, GateIndex(inLeft, inRight, gate.swapped));
+            if (element == 0.) continue;
+            gated.block(outLeft * leftDim, outRight * rightDim, leftDim,
+                        rightDim) += element *
+                                     theta.block(inLeft * leftDim,
+                                                 inRight * rightDim, leftDim,
+                                                 rightDim);
+          }
+      }
+
+    const Eigen::BDCSVD<MatrixClass> svd(
+        gated, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::VectorXd& values = svd.singularValues();
+
+    const double threshold = std::max(cutoff, kNullSchmidtValue);
+    Eigen::Index newDim = 1;
+    while (newDim < values.size() && values[newDim] > threshold) ++newDim;
+    if (maxBondDim > 0)
+      newDim = std::min(newDim, static_cast<Eigen::Index>(maxBondDim));
+
+    double norm = values.head(newDim).norm();
+    if (norm == 0.) norm = 1.;
+
+    const MatrixClass& u = svd.matrixU();
+    const MatrixClass& v = svd.matrixV();
+
+    GammaTensor newLeftGamma(leftDim, 2, newDim);
+    for (Eigen::Index l = 0; l < leftDim; ++l) {
+      const double inverse = leftLambdas[l] > 0. ? 1. / leftLambdas[l] : 0.;
+      for (int s = 0; s < 2; ++s)
+        for (Eigen::Index k = 0; k < newDim; ++k)
+          newLeftGamma(l, s, k) = u(s * leftDim + l, k) * inverse;
+    }
+
+    GammaTensor newRightGamma(newDim, 2, rightDim);
+    for (Eigen::Index r = 0; r < rightDim; ++r) {
+      const double inverse = rightLambdas[r] > 0. ? 1. / rightLambdas[r] : 0.;
+      for (Eigen::Index k = 0; k < newDim; ++k)
+        for (int s = 0; s < 2; ++s)
+          newRightGamma(k, s, r) = std::conj(v(s * rightDim + r, k)) * inverse;
+    }
+
+    leftGamma = std::move(newLeftGamma);
+    rightGamma = std::move(newRightGamma);
+
+    lambdas[pos].resize(newDim);
+    for (Eigen::Index k = 0; k < newDim; ++k)
+      lambdas[pos][k] = values[k] / norm;
+  }
+
+  static int GateIndex(int leftBit, int rightBit, bool swapped) {
+    return swapped ? rightBit + 2 * leftBit : leftBit + 2 * rightBit;
+  }
+};
+
+}  // namespace Simulators
+
+#endif  // _MPSLAYERUPDATE_H_
@@ -0,0 +1,214 @@
+/**
+ * @file MPSLayoutCache.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Cache for the initial qubits maps computed for the MPS simulator.
+ *
+ * The initial layout search depends only on the 2-qubit gates of the circuit
+ * and on the parameters of the cost model, so it is computed once for each
+ * circuit and shared between all the jobs executing it (and between
+ * consecutive executions of the same circuit). The entries are keyed by the
+ * structure of the circuit as seen by the search, not only by its hash. When
+ * the cache is full the least recently used entry is evicted.
+ */
+
+#pragma once
+
+#ifndef _MPSLAYOUTCACHE_H_
+#define _MPSLAYOUTCACHE_H_
+
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "MPSDummySimulator.h"
+
+namespace Simulators {
+
+class MPSLayoutCache {
+ public:
+  static MPSLayoutCache &GetInstance() {
+    static MPSLayoutCache instance;
+    return instance;
+  }
+
+  /**
+   * @brief Returns the optimal initial qubits map for the layers.
+   *
+   * Returns the map from the cache if it was already computed for the same
+   * circuit and the same cost model, otherwise computes it with the dummy
+   * simulator. Concurrent callers asking for the same map wait for the one
+   * that computes it instead of repeating the search.
+   * @param dummySim The dummy simulator configured with the cost model.
+   * @param layers The circuit, split into layers.
+   * @return The initial qubits map.
+   */
+  std::vector<long long int> GetOptimalQubitsMap(
+      MPSDummySimulator &dummySim,
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>> &layers) {
+    const Key key = MakeKey(dummySim, GetLayersStructure(layers));
+
+    std::promise<std::vector<long long int>> promise;
+
+    std::unique_lock lock(mutex);
+    const auto it = cache.find(key);
+    if (it != cache.end()) {
+      // the entry becomes the most recently used one
+      lru.splice(lru.begin(), lru, it->second.lruPos);
+      const auto future = it->second.future;
+      lock.unlock();
+      return future.get();
+    }
+
+    if (cache.size() >= kMaxEntries) {
+      // the callers already waiting on the evicted entry keep their future
+      const auto evicted = cache.find(*lru.back());
+      lru.pop_back();
+      cache.erase(evicted);
+    }
+    const auto inserted =
+        cache.emplace(key, Entry{promise.get_future().share(), {}}).first;
+    lru.push_front(&inserted->first);
+    inserted->second.lruPos = lru.begin();
+    lock.unlock();
+
+    try {
+      auto result = dummySim.ComputeOptimalQubitsMap(layers);
+      promise.set_value(result);
+      return result;
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      const std::lock_guard lock(mutex);
+      // the entry might have been evicted meanwhile
+      const auto failed = cache.find(key);
+      if (failed != cache.end()) {
+        lru.erase(failed->second.lruPos);
+        cache.erase(failed);
+      }
+      throw;
+    }
+  }
+
+  void Clear() {
+    const std::lock_guard lock(mutex);
+    lru.clear();
+    cache.clear();
+  }
+
+  size_t GetSize() const {
+    const std::lock_guard lock(mutex);
+    return cache.size();
+  }
+
+  /**
+   * @brief Checks if the map for the layers is in the cache.
+   *
+   * The entry is not marked as used.
+   * @param dummySim The dummy simulator configured with the cost model.
+   * @param layers The circuit, split into layers.
+   * @return True if there is an entry for the circuit and the cost model.
+   */
+  bool IsCached(
+      const MPSDummySimulator &dummySim,
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>> &layers) const {
+    const Key key = MakeKey(dummySim, GetLayersStructure(layers));
+
+    const std::lock_guard lock(mutex);
+    return cache.find(key) != cache.end();
+  }
+
+  static constexpr size_t kMaxEntries = 64;
+
+  /**
+   * @brief Returns the circuit as seen by the layout search.
+   *
+   * Only the qubits of the multi-qubit operations and the layer boundaries
+   * are relevant for the cost model, everything else is ignored. Each
+   * operation is stored as its number of qubits followed by the qubits, each
+   * layer ends with a marker.
+   * @param layers The circuit, split into layers.
+   * @return The structure of the circuit.
+   */
+  static std::vector<size_t> GetLayersStructure(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>> &layers) {
+    std::vector<size_t> structure;
+    for (const auto &layer : layers) {
+      for (const auto &op : layer->GetOperations()) {
+        const auto qbits = op->AffectedQubits();
+        if (qbits.size() < 2) continue;
+
+        structure.push_back(qbits.size());
+        structure.insert(structure.end(), qbits.begin(), qbits.end());
+      }
+      structure.push_back(kLayerBoundary);
+    }
+
+    return structure;
+  }
+
+  /**
+   * @brief Hashes the circuit as seen by the layout search.
+   *
+   * @param layers The circuit, split into layers.
+   * @return The hash.
+   * @sa GetLayersStructure
+   */
+  static size_t HashLayers(
+      const std::vector<std::shared_ptr<Circuits::Circuit<>>> &layers) {
+    return HashStructure(GetLayersStructure(layers));
+  }
+
+ private:
+  MPSLayoutCache() = default;
+
+  static void HashCombine(size_t &seed, size_t value) {
+    seed ^= std::hash<size_t>{}(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+            (seed >> 2);
+  }
+
+  static size_t HashStructure(const std::vector<size_t> &structure) {
+    size_t seed = structure.size();
+    for (const auto value : structure) HashCombine(seed, value);
+
+    return seed;
+  }
+
+  static constexpr size_t kLayerBoundary = std::numeric_limits<size_t>::max();
+
+  // the hash goes first, so the structures are compared only when everything
+  // else is equal, the structure itself makes a collision harmless
+  using Key = std::tuple<size_t, size_t, long long int, double, double,
+                         std::vector<size_t>>;
+
+  static Key MakeKey(const MPSDummySimulator &dummySim,
+                     std::vector<size_t> &&structure) {
+    const size_t hash = HashStructure(structure);
+    return Key{hash,
+               dummySim.getNrQubits(),
+               dummySim.getMaxBondDimension(),
+               dummySim.getGrowthFactorGate(),
+               dummySim.getGrowthFactorSwap(),
+               std::move(structure)};
+  }
+
+  struct Entry {
+    std::shared_future<std::vector<long long int>> future;
+    // position of the key in the recently used list
+    std::list<const Key *>::iterator lruPos;
+  };
+
+  mutable std::mutex mutex;
+  std::map<Key, Entry> cache;
+  // the keys of the cache (owned by it), the most recently used first
+  std::list<const Key *> lru;
+};
+
+}  // namespace Simulators
+
+#endif  // !_MPSLAYOUTCACHE_H_
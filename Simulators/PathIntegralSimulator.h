@@ -243,6 +243,25 @@ namespace Simulators {
             return 0.0;
           }
 
+          std::vector<std::complex<double>> AmplitudesForOutcomes(
+              const std::vector<Types::qubit_t>& outcomes) {
+            std::vector<std::complex<double>> result(outcomes.size(), 0.0);
+
+            const auto& amplitudes = simulator.GetAmplitudes();
+            if (amplitudes.empty()) return result;
+
+            QC::PathIntegral::FastVectorBool state(
+                amplitudes.begin()->first.size());
+            for (size_t i = 0; i < outcomes.size(); ++i) {
+              for (size_t q = 0; q < state.size(); ++q)
+                state.set(q, (outcomes[i] >> q) & 1);
+              if (auto it = amplitudes.find(state); it != amplitudes.end())
+                result[i] = it->second;
+            }
+
+            return result;
+          }
+
           double Probability(size_t outcome) {
             return std::norm(AmplitudeForOutcome(outcome));
           }
@@ -0,0 +1,483 @@
+/**
+ * @file PauliFrameSampler.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The Pauli frame sampler for stabilizer circuits.
+ *
+ * The circuit is simulated only once on a stabilizer simulator, to obtain a
+ * reference sample (the outcomes of all measurements). The other shots are
+ * obtained by propagating Pauli frames through the circuit: a frame is the
+ * Pauli operator that turns the reference execution into the one of the shot,
+ * so a measurement outcome is the reference one flipped by the X component of
+ * the frame on the measured qubit.
+ * The frames are bit-packed, one bit per shot, so a gate is applied on 64
+ * shots with a single word operation and the frames for a block of shots are
+ * updated in tight loops that the compiler vectorizes.
+ *
+ * Pauli noise channels can be attached to the gates: as the errors are Pauli
+ * operators, they are sampled independently for each shot and multiplied into
+ * the frames while they are propagated, so a noisy circuit is sampled in the
+ * same single pass as a noiseless one.
+ */
+
+#pragma once
+
+#ifndef _PAULI_FRAME_SAMPLER_H_
+#define _PAULI_FRAME_SAMPLER_H_
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../Circuit/Circuit.h"
+
+namespace Simulators {
+
+/**
+ * @class PauliFrameSampler
+ * @brief Samples a stabilizer circuit by propagating Pauli frames.
+ *
+ * Can be used for circuits containing only Clifford gates, measurements and
+ * resets (no classically conditioned operations, no random generators). Mid
+ * circuit measurements and resets are supported: a measurement (or reset)
+ * collapses the qubit, which is modeled by randomizing the Z component of the
+ * frames on it.
+ * @tparam Time The time type used for operation timing.
+ */
+template <typename Time = Types::time_type>
+class PauliFrameSampler {
+ public:
+  using ExecuteResults = typename Circuits::Circuit<Time>::ExecuteResults;
+
+  static constexpr size_t kBlockWords =
+      8; /**< The number of 64 bit words per block, 512 shots */
+  static constexpr size_t kBlockShots = kBlockWords * 64;
+
+  /**
+   * @struct PauliChannel
+   * @brief A single qubit Pauli channel.
+   *
+   * Applies X, Y or Z on the qubit with the given probabilities.
+   */
+  struct PauliChannel {
+    Types::qubit_t qubit; /**< The qubit */
+    double px;            /**< The X error probability */
+    double py;            /**< The Y error probability */
+    double pz;            /**< The Z error probability */
+  };
+
+  /**
+   * @struct DepolarizingChannel2
+   * @brief A two qubit depolarizing channel.
+   *
+   * Applies one of the 15 non identity two qubit Pauli operators, each with
+   * probability p / 15.
+   */
+  struct DepolarizingChannel2 {
+    Types::qubit_t qubit0; /**< The first qubit */
+    Types::qubit_t qubit1; /**< The second qubit */
+    double p;              /**< The total error probability */
+  };
+
+  /**
+   * @struct NoiseChannels
+   * @brief The noise channels applied after a gate.
+   */
+  struct NoiseChannels {
+    std::vector<PauliChannel> pauli; /**< The single qubit channels */
+    std::vector<DepolarizingChannel2>
+        depolarizing2; /**< The two qubit depolarizing channels */
+  };
+
+  /**
+   * @brief The noise function.
+   *
+   * Called once for each gate of the circuit, it adds the channels applied
+   * after the gate.
+   */
+  using NoiseFunction = std::function<void(
+      const std::shared_ptr<Circuits::IQuantumGate<Time>> &gate,
+      NoiseChannels &channels)>;
+
+  /**
+   * @brief Constructor.
+   *
+   * Compiles the circuit into the list of frame operations.
+   * @param circuit The circuit, it must pass CanSample.
+   * @param nrQubits The number of qubits of the simulator.
+   * @param nrCbits The number of classical bits.
+   * @param noise The noise function, if empty the circuit is noiseless.
+   */
+  PauliFrameSampler(const std::shared_ptr<Circuits::Circuit<Time>> &circuit,
+                    size_t nrQubits, size_t nrCbits,
+                    const NoiseFunction &noise = nullptr)
+      : circuit(circuit), nrQubits(nrQubits), nrCbits(nrCbits) {
+    Compile(noise);
+  }
+
+  /**
+   * @brief Checks if the circuit can be sampled with Pauli frames.
+   *
+   * @param circuit The circuit to check.
+   * @return True if the circuit contains only Clifford gates, measurements and
+   * resets, false otherwise.
+   */
+  static bool CanSample(
+      const std::shared_ptr<Circuits::Circuit<Time>> &circuit) {
+    if (!circuit) return false;
+
+    for (const auto &op : circuit->GetOperations()) {
+      switch (op->GetType()) {
+        case Circuits::OperationType::kNoOp:
+        case Circuits::OperationType::kMeasurement:
+        case Circuits::OperationType::kReset:
+          break;
+        case Circuits::OperationType::kGate: {
+          if (!op->IsClifford()) return false;
+          const auto gate =
+              std::static_pointer_cast<Circuits::IQuantumGate<Time>>(op);
+          if (GetFrameOpType(gate->GetGateType()) == FrameOpType::kUnsupported)
+            return false;
+        } break;
+        default:
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Computes the reference sample.
+   *
+   * Executes the circuit once on the stabilizer simulator and records the
+   * outcomes of all measurements. The reference execution is noiseless, the
+   * noise is applied only on the frames.
+   * @param sim The simulator, initialized and in the |0> state.
+   */
+  void ComputeReference(const std::shared_ptr<ISimulator> &sim) {
+    reference.clear();
+    reference.reserve(nrMeasurements);
+
+    Circuits::OperationState state;
+    state.AllocateBits(nrCbits);
+
+    for (const auto &op : circuit->GetOperations()) {
+      if (op->GetType() == Circuits::OperationType::kMeasurement) {
+        const auto &qubits =
+            std::static_pointer_cast<Circuits::MeasurementOperation<Time>>(op)
+                ->GetQubits();
+        if (qubits.empty()) continue;
+
+        const auto res = sim->MeasureMany(qubits);
+        for (size_t i = 0; i < qubits.size(); ++i)
+          reference.push_back(i < res.size() && res[i]);
+      } else
+        op->Execute(sim, state);
+    }
+  }
+
+  /**
+   * @brief Samples the circuit.
+   *
+   * ComputeReference must be called before.
+   * @param shots The number of shots.
+   * @param nrResultCbits The number of classical bits in the results.
+   * @param seed The seed for the random number generator.
+   * @return The results, the classical bits with their counts.
+   */
+  ExecuteResults Sample(size_t shots, size_t nrResultCbits,
+                        uint64_t seed) const {
+    ExecuteResults results;
+
+    std::mt19937_64 rng(seed);
+
+    std::vector<uint64_t> x(nrQubits * kBlockWords);
+    std::vector<uint64_t> z(nrQubits * kBlockWords);
+    std::vector<uint64_t> cbits(nrCbits * kBlockWords);
+
+    std::vector<bool> bits(nrResultCbits);
+
+    while (shots > 0) {
+      const size_t blockShots = std::min(shots, kBlockShots);
+      shots -= blockShots;
+
+      // the initial state is an eigenstate of Z, so a random Z frame does not
+      // change it, but makes the outcomes of the random measurements random
+      std::fill(x.begin(), x.end(), 0);
+      for (auto &w : z) w = rng();
+      std::fill(cbits.begin(), cbits.end(), 0);
+
+      for (const auto &fop : ops) ApplyFrameOp(fop, x, z, cbits, rng);
+
+      for (size_t shot = 0; shot < blockShots; ++shot) {
+        const size_t word = shot / 64;
+        const uint64_t mask = 1ULL << (shot % 64);
+        for (size_t c = 0; c < nrResultCbits; ++c)
+          bits[c] = c < nrCbits && (cbits[c * kBlockWords + word] & mask);
+
+        ++results[bits];
+      }
+    }
+
+    return results;
+  }
+
+  /**
+   * @brief Returns the number of measured qubits in the circuit.
+   *
+   * @return The number of measurement outcomes in the reference sample.
+   */
+  size_t GetNumMeasurements() const { return nrMeasurements; }
+
+  /**
+   * @brief Returns the reference sample.
+   *
+   * @return The outcomes of the measurements, in the circuit order.
+   */
+  const std::vector<bool> &GetReference() const { return reference; }
+
+ private:
+  enum class FrameOpType : int {
+    kIdentity, /**< Pauli gates, they only change the sign of the frame */
+    kSwapXZ,   /**< H */
+    kZXorX,    /**< S, Sdg, phase(pi/2) */
+    kXXorZ,    /**< Sx, SxDag, K */
+    kSwap,
+    kCX,
+    kCY,
+    kCZ,
+    kMeasure,
+    kReset,
+    kPauliChannel,
+    kDepolarizing2,
+    kUnsupported
+  };
+
+  struct FrameOp {
+    FrameOpType type;
+    size_t q0;
+    size_t q1; /**< the target qubit or the classical bit for measurements */
+    size_t index; /**< the index in the reference sample for measurements or
+                     the index of the noise channel */
+  };
+
+  static FrameOpType GetFrameOpType(Circuits::QuantumGateType type) {
+    switch (type) {
+      case Circuits::QuantumGateType::kXGateType:
+      case Circuits::QuantumGateType::kYGateType:
+      case Circuits::QuantumGateType::kZGateType:
+        return FrameOpType::kIdentity;
+      case Circuits::QuantumGateType::kHadamardGateType:
+        return FrameOpType::kSwapXZ;
+      case Circuits::QuantumGateType::kPhaseGateType:
+      case Circuits::QuantumGateType::kSGateType:
+      case Circuits::QuantumGateType::kSdgGateType:
+        return FrameOpType::kZXorX;
+      case Circuits::QuantumGateType::kSxGateType:
+      case Circuits::QuantumGateType::kSxDagGateType:
+      case Circuits::QuantumGateType::kKGateType:
+        return FrameOpType::kXXorZ;
+      case Circuits::QuantumGateType::kSwapGateType:
+        return FrameOpType::kSwap;
+      case Circuits::QuantumGateType::kCXGateType:
+        return FrameOpType::kCX;
+      case Circuits::QuantumGateType::kCYGateType:
+        return FrameOpType::kCY;
+      case Circuits::QuantumGateType::kCZGateType:
+        return FrameOpType::kCZ;
+      default:
+        break;
+    }
+
+    return FrameOpType::kUnsupported;
+  }
+
+  void Compile(const NoiseFunction &noise) {
+    ops.clear();
+    pauliChannels.clear();
+    depolarizingChannels.clear();
+    nrMeasurements = 0;
+
+    NoiseChannels channels;
+
+    for (const auto &op : circuit->GetOperations()) {
+      const auto type = op->GetType();
+      if (type == Circuits::OperationType::kGate) {
+        const auto gate =
+            std::static_pointer_cast<Circuits::IQuantumGate<Time>>(op);
+        const auto frameOpType = GetFrameOpType(gate->GetGateType());
+        if (frameOpType != FrameOpType::kIdentity)
+          ops.push_back({frameOpType, gate->GetQubit(0),
+                         gate->GetNumQubits() > 1 ? gate->GetQubit(1) : 0, 0});
+
+        if (!noise) continue;
+
+        channels.pauli.clear();
+        channels.depolarizing2.clear();
+        noise(gate, channels);
+
+        for (const auto &channel : channels.pauli) {
+          if (channel.px + channel.py + channel.pz <= 0.) continue;
+          ops.push_back({FrameOpType::kPauliChannel, channel.qubit, 0,
+                         pauliChannels.size()});
+          pauliChannels.push_back(channel);
+        }
+        for (const auto &channel : channels.depolarizing2) {
+          if (channel.p <= 0.) continue;
+          ops.push_back({FrameOpType::kDepolarizing2, channel.qubit0,
+                         channel.qubit1, depolarizingChannels.size()});
+          depolarizingChannels.push_back(channel);
+        }
+      } else if (type == Circuits::OperationType::kMeasurement) {
+        const auto measOp =
+            std::static_pointer_cast<Circuits::MeasurementOperation<Time>>(op);
+        const auto &qubits = measOp->GetQubits();
+        const auto &bitsIndices = measOp->GetBitsIndices();
+
+        for (size_t i = 0; i < qubits.size(); ++i) {
+          if (bitsIndices[i] >= nrCbits) nrCbits = bitsIndices[i] + 1;
+          ops.push_back(
+              {FrameOpType::kMeasure, qubits[i], bitsIndices[i], nrMeasurements});
+          ++nrMeasurements;
+        }
+      } else if (type == Circuits::OperationType::kReset) {
+        const auto &qubits =
+            std::static_pointer_cast<Circuits::Reset<Time>>(op)->GetQubits();
+        for (const auto q : qubits) ops.push_back({FrameOpType::kReset, q, 0, 0});
+      }
+    }
+  }
+
+  // Calls the function for the shots of the block hit by an error of
+  // probability p. The gaps between the errors are geometrically distributed,
+  // so the cost is proportional to the number of errors, not of the shots.
+  template <class Function>
+  static void ForEachError(double p, std::mt19937_64 &rng, Function &&f) {
+    if (p >= 1.) {
+      for (size_t shot = 0; shot < kBlockShots; ++shot) f(shot);
+      return;
+    }
+
+    std::geometric_distribution<size_t> gapDist(p);
+    for (size_t shot = gapDist(rng); shot < kBlockShots;
+         shot += gapDist(rng) + 1)
+      f(shot);
+  }
+
+  // applies the Pauli operator (1 - X, 2 - Y, 3 - Z) on the frame of a shot
+  static void ApplyPauli(int pauli, uint64_t *x, uint64_t *z, size_t shot) {
+    const size_t word = shot / 64;
+    const uint64_t mask = 1ULL << (shot % 64);
+    if (pauli == 1 || pauli == 2) x[word] ^= mask;
+    if (pauli == 2 || pauli == 3) z[word] ^= mask;
+  }
+
+  void ApplyFrameOp(const FrameOp &fop, std::vector<uint64_t> &x,
+                    std::vector<uint64_t> &z, std::vector<uint64_t> &cbits,
+                    std::mt19937_64 &rng) const {
+    uint64_t *const x0 = x.data() + fop.q0 * kBlockWords;
+    uint64_t *const z0 = z.data() + fop.q0 * kBlockWords;
+
+    switch (fop.type) {
+      case FrameOpType::kSwapXZ:
+        for (size_t w = 0; w < kBlockWords; ++w) std::swap(x0[w], z0[w]);
+        break;
+      case FrameOpType::kZXorX:
+        for (size_t w = 0; w < kBlockWords; ++w) z0[w] ^= x0[w];
+        break;
+      case FrameOpType::kXXorZ:
+        for (size_t w = 0; w < kBlockWords; ++w) x0[w] ^= z0[w];
+        break;
+      case FrameOpType::kSwap: {
+        uint64_t *const x1 = x.data() + fop.q1 * kBlockWords;
+        uint64_t *const z1 = z.data() + fop.q1 * kBlockWords;
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          std::swap(x0[w], x1[w]);
+          std::swap(z0[w], z1[w]);
+        }
+      } break;
+      case FrameOpType::kCX: {
+        uint64_t *const x1 = x.data() + fop.q1 * kBlockWords;
+        uint64_t *const z1 = z.data() + fop.q1 * kBlockWords;
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          x1[w] ^= x0[w];
+          z0[w] ^= z1[w];
+        }
+      } break;
+      case FrameOpType::kCY: {
+        // X_c -> X_c Y_t, X_t -> Z_c X_t, Z_t -> Z_c Z_t
+        uint64_t *const x1 = x.data() + fop.q1 * kBlockWords;
+        uint64_t *const z1 = z.data() + fop.q1 * kBlockWords;
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          z0[w] ^= x1[w] ^ z1[w];
+          x1[w] ^= x0[w];
+          z1[w] ^= x0[w];
+        }
+      } break;
+      case FrameOpType::kCZ: {
+        uint64_t *const x1 = x.data() + fop.q1 * kBlockWords;
+        uint64_t *const z1 = z.data() + fop.q1 * kBlockWords;
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          z0[w] ^= x1[w];
+          z1[w] ^= x0[w];
+        }
+      } break;
+      case FrameOpType::kMeasure: {
+        uint64_t *const c = cbits.data() + fop.q1 * kBlockWords;
+        const uint64_t ref = reference[fop.index] ? ~0ULL : 0ULL;
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          c[w] = x0[w] ^ ref;
+          z0[w] = rng();
+        }
+      } break;
+      case FrameOpType::kReset:
+        for (size_t w = 0; w < kBlockWords; ++w) {
+          x0[w] = 0;
+          z0[w] = rng();
+        }
+        break;
+      case FrameOpType::kPauliChannel: {
+        const auto &channel = pauliChannels[fop.index];
+        const double p = channel.px + channel.py + channel.pz;
+        std::uniform_real_distribution<double> pauliDist(0., p);
+        ForEachError(p, rng, [&](size_t shot) {
+          const double r = pauliDist(rng);
+          ApplyPauli(r < channel.px ? 1 : (r < channel.px + channel.py ? 2 : 3),
+                     x0, z0, shot);
+        });
+      } break;
+      case FrameOpType::kDepolarizing2: {
+        uint64_t *const x1 = x.data() + fop.q1 * kBlockWords;
+        uint64_t *const z1 = z.data() + fop.q1 * kBlockWords;
+        // the pair index is 4 * a + b, with the identity pair (0) excluded
+        std::uniform_int_distribution<int> pairDist(1, 15);
+        ForEachError(depolarizingChannels[fop.index].p, rng, [&](size_t shot) {
+          const int pair = pairDist(rng);
+          ApplyPauli(pair / 4, x0, z0, shot);
+          ApplyPauli(pair % 4, x1, z1, shot);
+        });
+      } break;
+      default:
+        break;
+    }
+  }
+
+  std::shared_ptr<Circuits::Circuit<Time>> circuit;
+  size_t nrQubits;
+  size_t nrCbits;
+  size_t nrMeasurements = 0;
+
+  std::vector<FrameOp> ops;
+  std::vector<PauliChannel> pauliChannels;
+  std::vector<DepolarizingChannel2> depolarizingChannels;
+  std::vector<bool> reference;
+};
+
+}  // namespace Simulators
+
+#endif  // !_PAULI_FRAME_SAMPLER_H_
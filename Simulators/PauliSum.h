@@ -0,0 +1,761 @@
+/**
+ * @file PauliSum.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Weighted sum of Pauli strings, the storage used by the Pauli propagation.
+ *
+ * The strings are bit-packed and stored by columns (struct of arrays): for
+ * each 64 qubits word there is an array with the X bits of all the terms and
+ * one with the Z bits, so a gate touches only one or two pairs of contiguous
+ * arrays, with branch free word operations the compiler can vectorize. The
+ * coefficients, the tags (the observable each term comes from) and the path
+ * frequencies (the number of sine branches the term went through) are kept in
+ * their own arrays.
+ *
+ * The duplicates are merged with open addressing hash tables (linear probing,
+ * with the hashes kept in the slots, so most probes compare a single value).
+ * The terms are split in shards by their hash, each shard being merged in its
+ * own table, small enough to stay in the cache. For large sums the shards are
+ * merged in parallel and the gates are applied on ranges of terms in
+ * parallel.
+ */
+
+#pragma once
+
+#ifndef _PAULI_SUM_H_
+#define _PAULI_SUM_H_
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "QubitRegisterCalculator.h"
+
+namespace Simulators {
+
+class PauliSum {
+ public:
+  using Word = uint64_t;
+
+  explicit PauliSum(size_t nrQubits)
+      : nrQubits(nrQubits),
+        nrWords((nrQubits + 63) / 64),
+        x(nrWords),
+        z(nrWords),
+        xSpare(nrWords),
+        zSpare(nrWords) {}
+
+  size_t GetNumberOfQubits() const { return nrQubits; }
+
+  size_t size() const { return coefficients.size(); }
+
+  bool empty() const { return coefficients.empty(); }
+
+  void clear() { Resize(0); }
+
+  void SetMultithreading(bool multithreading = true) {
+    enableMultithreading = multithreading;
+  }
+
+  /**
+   * @brief Sets the number of terms from which the operations run in
+   * parallel.
+   *
+   * @param nrTerms The number of terms, 0 keeps the default.
+   */
+  void SetParallelThreshold(size_t nrTerms) {
+    minTermsForMultithreading =
+        nrTerms ? nrTerms : kDefaultMinTermsForMultithreading;
+  }
+
+  size_t GetParallelThreshold() const { return minTermsForMultithreading; }
+
+  /**
+   * @brief Adds a term to the sum.
+   *
+   * The characters other than X, Y and Z are identity, the ones past the
+   * number of qubits are ignored.
+   *
+   * @param pauliString The Pauli string, the character at position i for qubit
+   * i.
+   * @param coefficient The coefficient of the term.
+   * @param tag The tag of the term, the terms with different tags are not
+   * merged.
+   */
+  void AddTerm(const std::string &pauliString, double coefficient,
+               uint32_t tag = 0) {
+    const size_t t = size();
+    Resize(t + 1);
+
+    coefficients[t] = coefficient;
+    tags[t] = tag;
+    frequencies[t] = 0;
+
+    for (size_t w = 0; w < nrWords; ++w) {
+      x[w][t] = 0;
+      z[w][t] = 0;
+    }
+
+    const size_t len = std::min(pauliString.size(), nrQubits);
+    for (size_t q = 0; q < len; ++q) {
+      const char op = static_cast<char>(toupper(pauliString[q]));
+      const Word mask = static_cast<Word>(1) << (q & 63);
+      if (op == 'X' || op == 'Y') x[q >> 6][t] |= mask;
+      if (op == 'Z' || op == 'Y') z[q >> 6][t] |= mask;
+    }
+  }
+
+  double GetCoefficient(size_t term) const { return coefficients[term]; }
+
+  uint32_t GetTag(size_t term) const { return tags[term]; }
+
+  /**
+   * @brief Returns the path frequency of the term.
+   *
+   * It's the number of branching rotations the term took the sine branch of,
+   * since it was added. For merged terms it's the lowest one.
+   *
+   * @param term The index of the term.
+   * @return The path frequency.
+   */
+  unsigned int GetFrequency(size_t term) const { return frequencies[term]; }
+
+  /**
+   * @brief Checks if the term has only I and Z operators.
+   *
+   * @param term The term index.
+   * @return True if the term is diagonal in the computational basis.
+   */
+  bool IsDiagonal(size_t term) const {
+    for (size_t w = 0; w < nrWords; ++w)
+      if (x[w][term]) return false;
+
+    return true;
+  }
+
+  /**
+   * @brief Returns the number of qubits the term acts on.
+   *
+   * @param term The term index.
+   * @return The Pauli weight of the term.
+   */
+  size_t GetWeight(size_t term) const {
+    size_t weight = 0;
+    for (size_t w = 0; w < nrWords; ++w)
+      weight += std::bitset<64>(x[w][term] | z[w][term]).count();
+
+    return weight;
+  }
+
+  /**
+   * @brief Returns the operator of a term on a qubit.
+   *
+   * @param term The term index.
+   * @param qubit The qubit.
+   * @return 'I', 'X', 'Y' or 'Z'.
+   */
+  char GetOperator(size_t term, size_t qubit) const {
+    const size_t w = qubit >> 6;
+    const size_t b = qubit & 63;
+    const bool xb = ((x[w][term] >> b) & 1) != 0;
+    const bool zb = ((z[w][term] >> b) & 1) != 0;
+
+    return xb ? (zb ? 'Y' : 'X') : (zb ? 'Z' : 'I');
+  }
+
+  // the gates conjugate the terms, P is replaced by G^t P G; for the single
+  // qubit ones the function gets the x and z words and the bit position and
+  // returns the sign flip as 0 or 1
+
+  void ApplyX(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &, Word &zw, size_t b) {
+      return (zw >> b) & 1;
+    });
+  }
+
+  void ApplyY(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &zw, size_t b) {
+      return ((xw ^ zw) >> b) & 1;
+    });
+  }
+
+  void ApplyZ(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &, size_t b) {
+      return (xw >> b) & 1;
+    });
+  }
+
+  void ApplyH(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &zw, size_t b) {
+      const Word flip = ((xw & zw) >> b) & 1;
+      const Word diff = ((xw ^ zw) >> b) & 1;
+      xw ^= diff << b;
+      zw ^= diff << b;
+      return flip;
+    });
+  }
+
+  // X -> -Y, Y -> X
+  void ApplyS(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &zw, size_t b) {
+      const Word flip = ((xw & ~zw) >> b) & 1;
+      zw ^= xw & (static_cast<Word>(1) << b);
+      return flip;
+    });
+  }
+
+  // X -> Y, Y -> -X
+  void ApplySdg(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &zw, size_t b) {
+      const Word flip = ((xw & zw) >> b) & 1;
+      zw ^= xw & (static_cast<Word>(1) << b);
+      return flip;
+    });
+  }
+
+  // X -> -X, Y -> Z, Z -> Y
+  void ApplyK(size_t qubit) {
+    ApplySingleQubit(qubit, [](Word &xw, Word &zw, size_t b) {
+      const Word flip = ((xw & ~zw) >> b) & 1;
+      xw ^= zw & (static_cast<Word>(1) << b);
+      return flip;
+    });
+  }
+
+  void ApplyCX(size_t controlQubit, size_t targetQubit) {
+    ApplyTwoQubit(controlQubit, targetQubit,
+                  [](Word &xc, Word &zc, size_t bc, Word &xt, Word &zt,
+                     size_t bt) {
+                    const Word xcb = (xc >> bc) & 1;
+                    const Word zcb = (zc >> bc) & 1;
+                    const Word xtb = (xt >> bt) & 1;
+                    const Word ztb = (zt >> bt) & 1;
+                    xt ^= xcb << bt;
+                    zc ^= ztb << bc;
+                    return xcb & ztb & ~(xtb ^ zcb) & 1;
+                  });
+  }
+
+  void ApplyCZ(size_t qubit1, size_t qubit2) {
+    ApplyTwoQubit(qubit1, qubit2,
+                  [](Word &x1, Word &z1, size_t b1, Word &x2, Word &z2,
+                     size_t b2) {
+                    const Word x1b = (x1 >> b1) & 1;
+                    const Word z1b = (z1 >> b1) & 1;
+                    const Word x2b = (x2 >> b2) & 1;
+                    const Word z2b = (z2 >> b2) & 1;
+                    z1 ^= x2b << b1;
+                    z2 ^= x1b << b2;
+                    return x1b & x2b & (z1b ^ z2b);
+                  });
+  }
+
+  void ApplySwap(size_t qubit1, size_t qubit2) {
+    ApplyTwoQubit(qubit1, qubit2,
+                  [](Word &x1, Word &z1, size_t b1, Word &x2, Word &z2,
+                     size_t b2) {
+                    const Word dx = ((x1 >> b1) ^ (x2 >> b2)) & 1;
+                    const Word dz = ((z1 >> b1) ^ (z2 >> b2)) & 1;
+                    x1 ^= dx << b1;
+                    x2 ^= dx << b2;
+                    z1 ^= dz << b1;
+                    z2 ^= dz << b2;
+                    return static_cast<Word>(0);
+                  });
+  }
+
+  /**
+   * @brief Conjugates the terms with a rotation exp(-i angle G / 2).
+   *
+   * The terms anticommuting with G are replaced by cos(angle) P + i
+   * sin(angle) G P, the new terms are appended to the sum, with the path
+   * frequency increased. The duplicates are not merged.
+   *
+   * @param qubit The qubit.
+   * @param generator The Pauli operator G, 'X', 'Y' or 'Z'.
+   * @param angle The rotation angle.
+   * @return True if terms were added.
+   */
+  bool ApplyRotation(size_t qubit, char generator, double angle) {
+    const double c = cos(angle);
+    const double s = sin(angle);
+    const bool branch = std::abs(s) >= kNegligible;
+    const bool keep = std::abs(c) >= kNegligible;
+
+    const size_t w = qubit >> 6;
+    const size_t b = qubit & 63;
+
+    // the bits of G, they are also the bits flipped in P for G P
+    const Word gx = generator != 'Z' ? 1 : 0;
+    const Word gz = generator != 'X' ? 1 : 0;
+
+    const Word *xw = x[w].data();
+    const Word *zw = z[w].data();
+    const auto anticommutes = [=](size_t t) -> Word {
+      return ((gx & (zw[t] >> b)) ^ (gz & (xw[t] >> b))) & 1;
+    };
+
+    // the sign of i G P: X -> -Y, Y -> X for Z; Y -> -Z, Z -> Y for X; Z ->
+    // -X, X -> Z for Y
+    const auto sign = [=](size_t t) -> double {
+      const Word xb = (xw[t] >> b) & 1;
+      const Word zb = (zw[t] >> b) & 1;
+      const Word negative = generator == 'Z' ? xb & ~zb
+                            : generator == 'X' ? xb & zb
+                                               : zb & ~xb;
+      return negative ? -s : s;
+    };
+
+    if (!keep || !branch) {
+      ParallelFor(size(), [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+          if (!anticommutes(t)) continue;
+          if (keep)
+            coefficients[t] *= c;
+          else {
+            coefficients[t] *= sign(t);
+            x[w][t] ^= gx << b;
+            z[w][t] ^= gz << b;
+          }
+        }
+      });
+
+      return false;
+    }
+
+    // the new terms are appended, only the branching terms are copied, not
+    // the whole sum
+    const size_t nrTerms = size();
+    Select(anticommutes, branching);
+    if (branching.empty()) return false;
+
+    // the coefficients of the new terms are computed before resizing, which
+    // invalidates the pointers
+    branchCoefficients.resize(branching.size());
+    ParallelFor(branching.size(), [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        const size_t t = branching[i];
+        branchCoefficients[i] = coefficients[t] * sign(t);
+        coefficients[t] *= c;
+      }
+    });
+
+    Resize(nrTerms + branching.size());
+
+    for (size_t v = 0; v < nrWords; ++v) {
+      Word *xv = x[v].data();
+      Word *zv = z[v].data();
+      const Word fx = v == w ? gx << b : 0;
+      const Word fz = v == w ? gz << b : 0;
+      ParallelFor(branching.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          xv[nrTerms + i] = xv[branching[i]] ^ fx;
+          zv[nrTerms + i] = zv[branching[i]] ^ fz;
+        }
+      });
+    }
+
+    ParallelFor(branching.size(), [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        coefficients[nrTerms + i] = branchCoefficients[i];
+        tags[nrTerms + i] = tags[branching[i]];
+        frequencies[nrTerms + i] = static_cast<uint16_t>(
+            std::min<unsigned int>(frequencies[branching[i]] + 1, kMaxFrequency));
+      }
+    });
+
+    return true;
+  }
+
+  /**
+   * @brief Merges the identical terms with the same tag.
+   *
+   * The order of the terms is kept, each one is merged into its first
+   * occurrence. The terms that cancel out are removed.
+   */
+  void Merge() {
+    const size_t nrTerms = size();
+    if (nrTerms < 2) return;
+
+    ComputeHashes();
+
+    // each shard has the terms with the same high bits of the hash, so the
+    // duplicates are always in the same shard; there are enough of them to
+    // keep each table in the cache, the terms are bucketed by shard first
+    const int nrThreads = GetNumberOfThreads(nrTerms);
+    size_t nrShards = 1;
+    size_t shardBits = 0;
+    while (nrShards < static_cast<size_t>(nrThreads) ||
+           nrShards * kTermsPerShard < nrTerms) {
+      nrShards <<= 1;
+      ++shardBits;
+    }
+    if (tables.size() < nrShards) tables.resize(nrShards);
+
+    const auto shardOf = [shardBits](Word h) -> size_t {
+      return shardBits ? static_cast<size_t>(h >> (64 - shardBits)) : 0;
+    };
+
+    shardOffsets.assign(nrShards + 1, 0);
+    for (size_t t = 0; t < nrTerms; ++t) ++shardOffsets[shardOf(hashes[t]) + 1];
+    for (size_t shard = 0; shard < nrShards; ++shard)
+      shardOffsets[shard + 1] += shardOffsets[shard];
+
+    // the terms keep their order in each shard, so each one is merged into its
+    // first occurrence
+    shardTerms.resize(nrTerms);
+    {
+      std::vector<size_t> pos(shardOffsets.begin(), shardOffsets.end() - 1);
+      for (size_t t = 0; t < nrTerms; ++t)
+        shardTerms[pos[shardOf(hashes[t])]++] = t;
+    }
+
+    merged.assign(nrTerms, 0);
+
+    ForEachChunk(nrThreads, nrShards, [this](size_t shard) {
+      const size_t first = shardOffsets[shard];
+      const size_t last = shardOffsets[shard + 1];
+
+      MergeTable &table = tables[shard];
+      table.Reset(last - first);
+
+      for (size_t i = first; i < last; ++i) {
+        const size_t t = shardTerms[i];
+        const size_t found = table.FindOrInsert(
+            t, hashes[t], [this](size_t a, size_t b) { return Equal(a, b); });
+        if (found != t) {
+          coefficients[found] += coefficients[t];
+          frequencies[found] = std::min(frequencies[found], frequencies[t]);
+          merged[t] = 1;
+        }
+      }
+    });
+
+    RemoveIf([this](size_t t) {
+      return merged[t] || std::abs(coefficients[t]) < kNegligible;
+    });
+  }
+
+  /**
+   * @brief Removes the terms for which the predicate is true.
+   *
+   * The order of the remaining terms is kept.
+   *
+   * @param remove The predicate, called with the term index.
+   */
+  template <class Predicate>
+  void RemoveIf(Predicate &&remove) {
+    Select([&](size_t t) { return !remove(t); }, kept);
+    if (kept.size() == size()) return;
+
+    // the kept terms are gathered in the spare arrays, column by column
+    const size_t newSize = kept.size();
+    ResizeSpare(newSize);
+
+    for (size_t w = 0; w < nrWords; ++w) {
+      const Word *xw = x[w].data();
+      const Word *zw = z[w].data();
+      Word *xs = xSpare[w].data();
+      Word *zs = zSpare[w].data();
+      ParallelFor(newSize, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          xs[i] = xw[kept[i]];
+          zs[i] = zw[kept[i]];
+        }
+      });
+    }
+
+    ParallelFor(newSize, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        coefficientsSpare[i] = coefficients[kept[i]];
+        tagsSpare[i] = tags[kept[i]];
+        frequenciesSpare[i] = frequencies[kept[i]];
+      }
+    });
+
+    x.swap(xSpare);
+    z.swap(zSpare);
+    coefficients.swap(coefficientsSpare);
+    tags.swap(tagsSpare);
+    frequencies.swap(frequenciesSpare);
+  }
+
+ private:
+  // rotations with a sine or cosine below this don't branch, merged terms
+  // below it are dropped
+  constexpr static double kNegligible = 1E-14;
+
+  constexpr static size_t kDefaultMinTermsForMultithreading = 16384;
+
+  constexpr static unsigned int kMaxFrequency = 65535;
+
+  // the merge tables of the shards stay below a few MB
+  constexpr static size_t kTermsPerShard = 65536;
+
+  // the threads configured for the simulators, so the limits set by the
+  // caller (OpenMP settings) are honored
+  int GetNumberOfThreads(size_t nrTerms) const {
+    return enableMultithreading && nrTerms >= minTermsForMultithreading
+               ? std::max(1, QC::QubitRegisterCalculator<>::GetNumberOfThreads())
+               : 1;
+  }
+
+  // calls the function for each chunk, in parallel if there is more than one
+  // thread; with a single thread there is no parallel region at all, the
+  // small sums would pay its overhead at each operation
+  template <class Function>
+  static void ForEachChunk(int nrThreads, size_t nrChunks, Function &&func) {
+    if (nrThreads == 1) {
+      for (size_t chunk = 0; chunk < nrChunks; ++chunk) func(chunk);
+      return;
+    }
+
+#pragma omp parallel for num_threads(nrThreads) schedule(dynamic, 1)
+    for (long long int chunk = 0; chunk < static_cast<long long int>(nrChunks);
+         ++chunk)
+      func(static_cast<size_t>(chunk));
+  }
+
+  // calls the function on contiguous ranges of terms, in parallel for large
+  // sums
+  template <class Function>
+  void ParallelFor(size_t nrTerms, Function &&func) const {
+    const int nrThreads = GetNumberOfThreads(nrTerms);
+
+    ForEachChunk(nrThreads, static_cast<size_t>(nrThreads),
+                 [&](size_t chunk) {
+                   func(nrTerms * chunk / nrThreads,
+                        nrTerms * (chunk + 1) / nrThreads);
+                 });
+  }
+
+  template <class Function>
+  void ApplySingleQubit(size_t qubit, Function &&func) {
+    Word *xw = x[qubit >> 6].data();
+    Word *zw = z[qubit >> 6].data();
+    double *coeffs = coefficients.data();
+    const size_t b = qubit & 63;
+
+    ParallelFor(size(), [&](size_t first, size_t last) {
+      for (size_t t = first; t < last; ++t) {
+        const Word flip = func(xw[t], zw[t], b);
+        coeffs[t] *= 1. - 2. * static_cast<double>(flip);
+      }
+    });
+  }
+
+  template <class Function>
+  void ApplyTwoQubit(size_t qubit1, size_t qubit2, Function &&func) {
+    Word *xw1 = x[qubit1 >> 6].data();
+    Word *zw1 = z[qubit1 >> 6].data();
+    Word *xw2 = x[qubit2 >> 6].data();
+    Word *zw2 = z[qubit2 >> 6].data();
+    double *coeffs = coefficients.data();
+    const size_t b1 = qubit1 & 63;
+    const size_t b2 = qubit2 & 63;
+
+    // when the qubits share a word the same words are passed twice, the
+    // functions read all the bits before changing any
+    ParallelFor(size(), [&](size_t first, size_t last) {
+      for (size_t t = first; t < last; ++t) {
+        const Word flip = func(xw1[t], zw1[t], b1, xw2[t], zw2[t], b2);
+        coeffs[t] *= 1. - 2. * static_cast<double>(flip);
+      }
+    });
+  }
+
+  // collects, in order, the indices of the terms for which the predicate is
+  // true
+  template <class Predicate>
+  void Select(Predicate &&pred, std::vector<size_t> &indices) {
+    const size_t nrTerms = size();
+    const int nrThreads = GetNumberOfThreads(nrTerms);
+    const size_t nrChunks = static_cast<size_t>(nrThreads);
+    offsets.assign(nrChunks + 1, 0);
+
+    ForEachChunk(nrThreads, nrChunks, [&](size_t chunk) {
+      const size_t first = nrTerms * chunk / nrChunks;
+      const size_t last = nrTerms * (chunk + 1) / nrChunks;
+      size_t n = 0;
+      for (size_t t = first; t < last; ++t) n += pred(t) ? 1 : 0;
+      offsets[chunk + 1] = n;
+    });
+
+    for (size_t chunk = 0; chunk < nrChunks; ++chunk)
+      offsets[chunk + 1] += offsets[chunk];
+
+    indices.resize(offsets.back());
+
+    ForEachChunk(nrThreads, nrChunks, [&](size_t chunk) {
+      const size_t first = nrTerms * chunk / nrChunks;
+      const size_t last = nrTerms * (chunk + 1) / nrChunks;
+      size_t pos = offsets[chunk];
+      for (size_t t = first; t < last; ++t)
+        if (pred(t)) indices[pos++] = t;
+    });
+  }
+
+  // the hashes are computed column by column, to keep the accesses
+  // sequential
+  void ComputeHashes() {
+    const size_t nrTerms = size();
+    hashes.resize(nrTerms);
+
+    ParallelFor(nrTerms, [this](size_t first, size_t last) {
+      for (size_t t = first; t < last; ++t)
+        hashes[t] = (static_cast<Word>(tags[t]) + 1) * kMultiplier;
+
+      for (size_t w = 0; w < nrWords; ++w) {
+        const Word *xw = x[w].data();
+        const Word *zw = z[w].data();
+        for (size_t t = first; t < last; ++t) {
+          Word h = (hashes[t] ^ xw[t]) * kMultiplier;
+          h = (h ^ (h >> 32) ^ zw[t]) * kMultiplier;
+          hashes[t] = h ^ (h >> 29);
+        }
+      }
+
+      for (size_t t = first; t < last; ++t) {
+        Word h = hashes[t];
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        hashes[t] = h ^ (h >> 27);
+      }
+    });
+  }
+
+  bool Equal(size_t a, size_t b) const {
+    if (tags[a] != tags[b]) return false;
+
+    for (size_t w = 0; w < nrWords; ++w)
+      if (x[w][a] != x[w][b] || z[w][a] != z[w][b]) return false;
+
+    return true;
+  }
+
+  void Resize(size_t n) {
+    for (size_t w = 0; w < nrWords; ++w) {
+      x[w].resize(n);
+      z[w].resize(n);
+    }
+    coefficients.resize(n);
+    tags.resize(n);
+    frequencies.resize(n);
+  }
+
+  void ResizeSpare(size_t n) {
+    for (size_t w = 0; w < nrWords; ++w) {
+      xSpare[w].resize(n);
+      zSpare[w].resize(n);
+    }
+    coefficientsSpare.resize(n);
+    tagsSpare.resize(n);
+    frequenciesSpare.resize(n);
+  }
+
+  constexpr static Word kMultiplier = 0x9E3779B97F4A7C15ULL;
+
+  /**
+   * @class MergeTable
+   * @brief Open addressing hash table with the indices of the terms.
+   *
+   * Linear probing, the slots keep the hashes, which are compared before the
+   * terms.
+   */
+  class MergeTable {
+   public:
+    void Reset(size_t expected) {
+      size_t capacity = 16;
+      while (capacity < 2 * expected) capacity <<= 1;
+
+      slots.assign(capacity, Slot{0, kEmpty});
+      mask = capacity - 1;
+      count = 0;
+    }
+
+    // returns the index of the term equal to the given one, which is
+    // inserted if there is none
+    template <class Equal>
+    size_t FindOrInsert(size_t term, Word hash, Equal &&equal) {
+      if (4 * (count + 1) > 3 * slots.size()) Grow();
+
+      for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot &slot = slots[i];
+        if (slot.term == kEmpty) {
+          slot.hash = hash;
+          slot.term = term;
+          ++count;
+          return term;
+        }
+        if (slot.hash == hash && equal(slot.term, term)) return slot.term;
+      }
+    }
+
+   private:
+    constexpr static size_t kEmpty = static_cast<size_t>(-1);
+
+    struct Slot {
+      Word hash;
+      size_t term;
+    };
+
+    void Grow() {
+      std::vector<Slot> old(2 * slots.size(), Slot{0, kEmpty});
+      old.swap(slots);
+      mask = slots.size() - 1;
+
+      for (const Slot &slot : old) {
+        if (slot.term == kEmpty) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].term != kEmpty) i = (i + 1) & mask;
+        slots[i] = slot;
+      }
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+  };
+
+  size_t nrQubits;
+  size_t nrWords;
+
+  // the X and Z bits, by columns: x[w][t] has the bits of the qubits 64 * w to
+  // 64 * w + 63 of the term t
+  std::vector<std::vector<Word>> x;
+  std::vector<std::vector<Word>> z;
+  std::vector<double> coefficients;
+  std::vector<uint32_t> tags;
+  std::vector<uint16_t> frequencies;
+
+  // the arrays the sum is rebuilt in, kept to avoid reallocating them
+  std::vector<std::vector<Word>> xSpare;
+  std::vector<std::vector<Word>> zSpare;
+  std::vector<double> coefficientsSpare;
+  std::vector<uint32_t> tagsSpare;
+  std::vector<uint16_t> frequenciesSpare;
+
+  std::vector<size_t> offsets;
+  std::vector<size_t> kept;
+  std::vector<size_t> branching;
+  std::vector<double> branchCoefficients;
+  std::vector<Word> hashes;
+  std::vector<char> merged;
+  std::vector<size_t> shardOffsets;
+  std::vector<size_t> shardTerms;
+  std::vector<MergeTable> tables;
+
+  bool enableMultithreading = true;
+  size_t minTermsForMultithreading = kDefaultMinTermsForMultithreading;
+};
+
+}  // namespace Simulators
+
+#endif  // _PAULI_SUM_H_
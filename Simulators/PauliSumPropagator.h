@@ -0,0 +1,571 @@
+/**
+ * @file PauliSumPropagator.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Propagation of many observables at once, as a single tagged Pauli sum.
+ *
+ * The expectation values are obtained by propagating the Pauli strings
+ * backwards through the circuit (in the Heisenberg picture) and evaluating the
+ * resulting sums on |0...0>. Instead of propagating each string separately,
+ * all of them are put in a single sum, each term tagged with the index of the
+ * observable it comes from, so each gate is applied in one pass over all the
+ * terms and the duplicates are merged as they appear. Terms with different
+ * tags are never merged, the expectation values are summed up by tag at the
+ * end.
+ *
+ * The sum is kept in a PauliSum, bit-packed by columns, with the sign in the
+ * (real) coefficient.
+ *
+ * The truncation passes drop the terms by coefficient, by Pauli weight and by
+ * path frequency (the number of sine branches a term went through). Since
+ * the expectation value of a Pauli string is at most 1 in absolute value,
+ * whatever the circuit before it, dropping a term changes the result by at
+ * most the absolute value of its coefficient. Those are added up for each
+ * observable, giving a bound of the truncation error, and they can be capped
+ * by an error budget: the smallest terms are dropped first and the ones that
+ * would exceed the budget are kept.
+ *
+ * The measurement outcomes are sampled qubit by qubit, from the conditional
+ * marginal probabilities, which are expectation values of products of Z
+ * projectors. The shots with the same outcomes so far are grouped together,
+ * and the products needed by all the groups of a qubit are propagated in a
+ * single pass. The products are kept for the next groups, as they depend on
+ * which qubits are in the prefix, not on their outcomes.
+ */
+
+#pragma once
+
+#ifndef _PAULI_SUM_PROPAGATOR_H_
+#define _PAULI_SUM_PROPAGATOR_H_
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PauliSum.h"
+
+namespace Simulators {
+
+class PauliSumPropagator {
+ public:
+  /**
+   * @brief The operations the propagator knows about.
+   *
+   * The other gates are decomposed into these when recorded.
+   */
+  enum class OperationType : uint8_t {
+    kX,
+    kY,
+    kZ,
+    kH,
+    kS,
+    kSdg,
+    kK,
+    kCX,
+    kCZ,
+    kSwap,
+    kRX,
+    kRY,
+    kRZ
+  };
+
+  struct Operation {
+    OperationType type = OperationType::kX;
+    int qubit1 = 0; /**< The qubit, the control for the two qubit gates. */
+    int qubit2 = 0; /**< The target, for the two qubit gates. */
+    double angle = 0.;
+  };
+
+  explicit PauliSumPropagator(size_t nrQubits)
+      : nrQubits(nrQubits), sum(nrQubits) {}
+
+  void SetMultithreading(bool multithreading = true) {
+    sum.SetMultithreading(multithreading);
+  }
+
+  /**
+   * @brief Sets the number of terms from which the sum is processed in
+   * parallel.
+   *
+   * @param nrTerms The number of terms, 0 keeps the default.
+   */
+  void SetParallelThreshold(size_t nrTerms) {
+    sum.SetParallelThreshold(nrTerms);
+  }
+
+  /**
+   * @brief Sets the coefficient threshold used by the truncation passes.
+   *
+   * The terms with the absolute value of the coefficient below it are
+   * dropped.
+   *
+   * @param threshold The coefficient threshold.
+   */
+  void SetCoefficientThreshold(double threshold) {
+    coefficientThreshold = threshold;
+  }
+
+  /**
+   * @brief Sets the Pauli weight threshold used by the truncation passes.
+   *
+   * The terms acting on more qubits than the threshold are dropped, a
+   * threshold equal or above the number of qubits disables it.
+   *
+   * @param threshold The Pauli weight threshold.
+   */
+  void SetPauliWeightThreshold(size_t threshold) {
+    pauliWeightThreshold = threshold;
+  }
+
+  /**
+   * @brief Sets the number of operations between truncation passes.
+   *
+   * @param steps The number of operations, zero or negative for no
+   * truncation.
+   */
+  void SetStepsBetweenTrims(int steps) { stepsBetweenTrims = steps; }
+
+  /**
+   * @brief Sets the number of operations between deduplication passes.
+   *
+   * The duplicates are merged anyway as the sum grows, the deduplication
+   * passes truncate the sum as the trims do.
+   *
+   * @param steps The number of operations, zero or negative for none.
+   */
+  void SetStepsBetweenDeduplication(int steps) {
+    stepsBetweenDeduplication = steps;
+  }
+
+  /**
+   * @brief Sets the path frequency threshold used by the truncation passes.
+   *
+   * The terms that took the sine branch of more rotations than the threshold
+   * are dropped.
+   *
+   * @param threshold The path frequency threshold.
+   */
+  void SetMaxPathFrequency(size_t threshold) { maxPathFrequency = threshold; }
+
+  /**
+   * @brief Sets the truncation error budget of each observable.
+   *
+   * The truncation passes don't drop terms if the error bound of their
+   * observable would exceed it, zero or negative for no budget.
+   *
+   * @param budget The error budget.
+   */
+  void SetTruncationErrorBudget(double budget) { errorBudget = budget; }
+
+  /**
+   * @brief Returns the expectation values of the Pauli strings.
+   *
+   * All the strings are propagated together, in a single backward pass over
+   * the operations. Identical strings are propagated once.
+   * The characters past the number of qubits are treated as if measured on
+   * qubits in the |0> state.
+   *
+   * @param operations The operations of the circuit, in execution order.
+   * @param pauliStrings The Pauli strings.
+   * @return The expectation values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<Operation> &operations,
+      const std::vector<std::string> &pauliStrings) {
+    std::vector<double> result(pauliStrings.size(), 0.);
+
+    Clear();
+
+    std::vector<size_t> stringTags(pauliStrings.size(), kNoTag);
+    truncationErrors.assign(pauliStrings.size(), 0.);
+    std::unordered_map<std::string, uint32_t> tagsMap;
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      std::string pauliString = pauliStrings[i];
+      bool zero = false;
+      for (size_t q = 0; q < pauliString.size(); ++q) {
+        pauliString[q] = static_cast<char>(toupper(pauliString[q]));
+        if (pauliString[q] != 'X' && pauliString[q] != 'Y' &&
+            pauliString[q] != 'Z')
+          pauliString[q] = 'I';
+        else if (q >= nrQubits && pauliString[q] != 'Z')
+          zero = true;
+      }
+      if (zero) continue;
+      if (pauliString.size() > nrQubits) pauliString.resize(nrQubits);
+
+      const auto it = tagsMap.find(pauliString);
+      if (it != tagsMap.end()) {
+        stringTags[i] = it->second;
+        continue;
+      }
+
+      const uint32_t tag = static_cast<uint32_t>(tagsMap.size());
+      tagsMap.emplace(pauliString, tag);
+      stringTags[i] = tag;
+      sum.AddTerm(pauliString, 1., tag);
+    }
+    maxNrTerms = sum.size();
+    tagErrors.assign(tagsMap.size(), 0.);
+
+    size_t step = 0;
+    for (auto it = operations.rbegin(); it != operations.rend(); ++it) {
+      if (sum.empty()) break;
+
+      Apply(*it);
+
+      ++step;
+      if ((stepsBetweenTrims > 0 &&
+           step % static_cast<size_t>(stepsBetweenTrims) == 0) ||
+          (stepsBetweenDeduplication > 0 &&
+           step % static_cast<size_t>(stepsBetweenDeduplication) == 0))
+        Trim();
+    }
+
+    // only the strings with no X or Y have a non zero expectation value on
+    // |0...0>
+    std::vector<double> values(tagsMap.size(), 0.);
+    for (size_t t = 0; t < sum.size(); ++t)
+      if (sum.IsDiagonal(t)) values[sum.GetTag(t)] += sum.GetCoefficient(t);
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i)
+      if (stringTags[i] != kNoTag) {
+        result[i] = values[stringTags[i]];
+        truncationErrors[i] = tagErrors[stringTags[i]];
+      }
+
+    return result;
+  }
+
+  /**
+   * @brief Samples the outcomes of measuring the qubits.
+   *
+   * The qubits are sampled one by one, the shots with the same outcomes for
+   * the prefix being split between the two outcomes of the next qubit with a
+   * binomial draw, from the conditional probability. The projector of a
+   * prefix is restricted to the qubits with a random outcome, for a qubit
+   * with a certain outcome (given the prefix) the projector doesn't change
+   * the probabilities of the next ones. So the conditional probability of a
+   * qubit needs the expectation values of the Z products on it and any of
+   * the random qubits in the prefix, which are propagated together for all
+   * the prefixes of the same length and reused for the next ones. The cost
+   * is exponential in the number of qubits with a random outcome, not in the
+   * number of sampled qubits, and doesn't depend much on the number of shots.
+   *
+   * The truncation settings are used for the propagation.
+   *
+   * @param operations The operations of the circuit, in execution order.
+   * @param qubits The qubits to be sampled.
+   * @param shots The number of shots.
+   * @param rng The random number generator.
+   * @return A map with the counts for the outcomes, the outcome for the i-th
+   * qubit in qubits being at the position i.
+   */
+  template <class Generator>
+  std::unordered_map<std::vector<bool>, size_t> SampleCounts(
+      const std::vector<Operation> &operations,
+      const std::vector<size_t> &qubits, size_t shots, Generator &rng) {
+    std::unordered_map<std::vector<bool>, size_t> result;
+    if (qubits.empty() || shots == 0) return result;
+
+    // the distinct qubits, in the order they are sampled
+    std::vector<size_t> order;
+    std::vector<size_t> positions(qubits.size());
+    for (size_t i = 0; i < qubits.size(); ++i) {
+      const auto it = std::find(order.begin(), order.end(), qubits[i]);
+      positions[i] = it - order.begin();
+      if (it == order.end()) order.push_back(qubits[i]);
+    }
+
+    std::vector<SamplingNode> level(1);
+    level[0].shots = shots;
+
+    std::unordered_map<std::string, double> correlations;
+
+    for (const size_t qubit : order) {
+      // the expectation values not known yet, for all the prefixes
+      std::vector<std::string> missing;
+      for (const auto &node : level)
+        ForEachCorrelation(node, qubit,
+                           [&](const std::string &pauliString, double) {
+                             if (correlations.emplace(pauliString, 0.).second)
+                               missing.push_back(pauliString);
+                           });
+
+      if (!missing.empty()) {
+        const auto values = ExpectationValues(operations, missing);
+        for (size_t i = 0; i < missing.size(); ++i)
+          correlations[missing[i]] = values[i];
+      }
+
+      std::vector<SamplingNode> next;
+      next.reserve(2 * level.size());
+
+      for (auto &node : level) {
+        // the expectation value of the prefix projector times Z on the qubit
+        double correlation = 0.;
+        ForEachCorrelation(node, qubit,
+                           [&](const std::string &pauliString, double sign) {
+                             correlation += sign * correlations[pauliString];
+                           });
+        correlation =
+            std::ldexp(correlation, -static_cast<int>(node.random.size()));
+
+        const double joint0 = std::clamp(0.5 * (node.probability + correlation),
+                                         0., node.probability);
+        const double prob0 =
+            node.probability > 0. ? joint0 / node.probability : 0.5;
+
+        // a qubit with a certain outcome is not added to the projector
+        const bool random = prob0 >= kMinBranchProbability &&
+                            prob0 <= 1. - kMinBranchProbability;
+
+        size_t shots0;
+        if (random)
+          shots0 = std::binomial_distribution<size_t>(node.shots, prob0)(rng);
+        else
+          shots0 = prob0 < kMinBranchProbability ? 0 : node.shots;
+
+        const size_t branchShots[2] = {shots0, node.shots - shots0};
+        const double branchProbabilities[2] = {
+            joint0, std::max(node.probability - joint0, 0.)};
+
+        for (int outcome = 0; outcome < 2; ++outcome) {
+          if (branchShots[outcome] == 0) continue;
+
+          SamplingNode child;
+          child.prefix = node.prefix;
+          child.prefix.push_back(outcome == 1);
+          child.random = node.random;
+          child.outcomes = node.outcomes;
+          child.shots = branchShots[outcome];
+          child.probability = node.probability;
+          if (random) {
+            child.random.push_back(qubit);
+            child.outcomes.push_back(outcome == 1);
+            child.probability = branchProbabilities[outcome];
+          }
+
+          next.emplace_back(std::move(child));
+        }
+      }
+
+      level.swap(next);
+    }
+
+    for (const auto &node : level) {
+      std::vector<bool> outcome(qubits.size());
+      for (size_t i = 0; i < qubits.size(); ++i)
+        outcome[i] = node.prefix[positions[i]];
+
+      result[outcome] += node.shots;
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Returns the maximum number of terms the sum had during the last
+   * propagation.
+   *
+   * @return The maximum number of terms.
+   */
+  size_t GetMaxNrTerms() const { return maxNrTerms; }
+
+  /**
+   * @brief Returns the truncation error bounds of the last propagation.
+   *
+   * For each Pauli string, the sum of the absolute values of the
+   * coefficients of the terms dropped by the truncation passes, which bounds
+   * the error of its expectation value (up to the rounding errors).
+   *
+   * @return The error bounds, in the order of the Pauli strings.
+   */
+  const std::vector<double> &GetTruncationErrors() const {
+    return truncationErrors;
+  }
+
+ private:
+  constexpr static size_t kNoTag = static_cast<size_t>(-1);
+
+  constexpr static double kMinBranchProbability =
+      1e-12; /**< Branches less probable than this don't get shots. */
+
+  // the shots with the same outcomes so far
+  struct SamplingNode {
+    std::vector<bool> prefix;   // the outcomes of the sampled qubits
+    std::vector<size_t> random; // the qubits with a random outcome
+    std::vector<bool> outcomes; // their outcomes
+    size_t shots = 0;
+    double probability = 1.;  // of the projector on the random qubits
+  };
+
+  // calls the function for the Z products on the qubit and any of the random
+  // qubits of the node, with the sign of the product of their outcomes; the
+  // subsets are visited in Gray code order, so a single qubit changes from
+  // one to the next
+  template <class Function>
+  void ForEachCorrelation(const SamplingNode &node, size_t qubit,
+                          Function &&func) const {
+    std::string pauliString(nrQubits, 'I');
+    pauliString[qubit] = 'Z';
+
+    double sign = 1.;
+    func(pauliString, sign);
+
+    const size_t nrSubsets = static_cast<size_t>(1) << node.random.size();
+    for (size_t i = 1; i < nrSubsets; ++i) {
+      size_t j = 0;
+      while (((i >> j) & 1) == 0) ++j;
+
+      char &op = pauliString[node.random[j]];
+      op = op == 'I' ? 'Z' : 'I';
+      if (node.outcomes[j]) sign = -sign;
+
+      func(pauliString, sign);
+    }
+  }
+
+  void Clear() {
+    sum.clear();
+    maxNrTerms = 0;
+    mergedNrTerms = 1;
+    unmerged = false;
+  }
+
+  // the term P is replaced by G^t P G, G being the operation
+  void Apply(const Operation &op) {
+    const size_t q1 = static_cast<size_t>(op.qubit1);
+    const size_t q2 = static_cast<size_t>(op.qubit2);
+
+    switch (op.type) {
+      case OperationType::kX:
+        sum.ApplyX(q1);
+        break;
+      case OperationType::kY:
+        sum.ApplyY(q1);
+        break;
+      case OperationType::kZ:
+        sum.ApplyZ(q1);
+        break;
+      case OperationType::kH:
+        sum.ApplyH(q1);
+        break;
+      case OperationType::kS:
+        sum.ApplyS(q1);
+        break;
+      case OperationType::kSdg:
+        sum.ApplySdg(q1);
+        break;
+      case OperationType::kK:
+        sum.ApplyK(q1);
+        break;
+      case OperationType::kCX:
+        sum.ApplyCX(q1, q2);
+        break;
+      case OperationType::kCZ:
+        sum.ApplyCZ(q1, q2);
+        break;
+      case OperationType::kSwap:
+        sum.ApplySwap(q1, q2);
+        break;
+      case OperationType::kRX:
+        ApplyRotation(q1, 'X', op.angle);
+        break;
+      case OperationType::kRY:
+        ApplyRotation(q1, 'Y', op.angle);
+        break;
+      case OperationType::kRZ:
+        ApplyRotation(q1, 'Z', op.angle);
+        break;
+    }
+  }
+
+  void ApplyRotation(size_t qubit, char generator, double angle) {
+    if (!sum.ApplyRotation(qubit, generator, angle)) return;
+
+    // merging is linear in the number of terms, it's done only after the sum
+    // doubled since the last merge
+    unmerged = true;
+    maxNrTerms = std::max(maxNrTerms, sum.size());
+    if (sum.size() >= 2 * mergedNrTerms) Merge();
+  }
+
+  void Merge() {
+    sum.Merge();
+
+    mergedNrTerms = std::max<size_t>(sum.size(), 1);
+    unmerged = false;
+  }
+
+  // drops the terms below the coefficient threshold or above the Pauli weight
+  // or path frequency thresholds, the duplicates are merged first, so their
+  // coefficients are compared summed up; the dropped coefficients are added
+  // to the error bound of their observable
+  void Trim() {
+    if (unmerged) Merge();
+
+    const bool checkWeight = pauliWeightThreshold < nrQubits;
+
+    candidates.clear();
+    for (size_t t = 0; t < sum.size(); ++t)
+      if (std::abs(sum.GetCoefficient(t)) < coefficientThreshold ||
+          sum.GetFrequency(t) > maxPathFrequency ||
+          (checkWeight && sum.GetWeight(t) > pauliWeightThreshold))
+        candidates.push_back(t);
+
+    if (candidates.empty()) return;
+
+    // with a budget the smallest terms go first, so as many terms as possible
+    // are dropped
+    const bool budget = errorBudget > 0.;
+    if (budget)
+      std::stable_sort(candidates.begin(), candidates.end(),
+                       [this](size_t a, size_t b) {
+                         return std::abs(sum.GetCoefficient(a)) <
+                                std::abs(sum.GetCoefficient(b));
+                       });
+
+    dropped.assign(sum.size(), 0);
+    for (const size_t t : candidates) {
+      const uint32_t tag = sum.GetTag(t);
+      const double error = std::abs(sum.GetCoefficient(t));
+      if (budget && tagErrors[tag] + error > errorBudget) continue;
+
+      tagErrors[tag] += error;
+      dropped[t] = 1;
+    }
+
+    sum.RemoveIf([this](size_t t) { return dropped[t] != 0; });
+  }
+
+  size_t nrQubits;
+  PauliSum sum;
+
+  size_t maxNrTerms = 0;
+  size_t mergedNrTerms = 1;
+  bool unmerged = false;
+
+  double coefficientThreshold = 0.;
+  size_t pauliWeightThreshold = static_cast<size_t>(-1);
+  size_t maxPathFrequency = static_cast<size_t>(-1);
+  double errorBudget = 0.;
+  int stepsBetweenTrims = 0;
+  int stepsBetweenDeduplication = 0;
+
+  std::vector<size_t> candidates;
+  std::vector<char> dropped;
+  std::vector<double> tagErrors;
+  std::vector<double> truncationErrors;
+};
+
+}  // namespace Simulators
+
+#endif  // _PAULI_SUM_PROPAGATOR_H_
@@ -64,7 +64,8 @@ class QCSimSimulator : public QCSimState {
                                 const Eigen::Matrix2cd& gate) override {
     if (GetSimulationType() != SimulationType::kMatrixProductState &&
         GetSimulationType() != SimulationType::kTensorNetwork&&
-        GetSimulationType() != SimulationType::kStatevector)
+        GetSimulationType() != SimulationType::kStatevector &&
+        GetSimulationType() != SimulationType::kExtendedStabilizer)
         throw std::runtime_error("QCSimSimulator::ApplyGenericOneQubitGate: Unsupported simulation type.");
 
     const QC::Gates::AppliedGate<> agate(gate, qubit);
@@ -75,6 +76,8 @@ class QCSimSimulator : public QCSimState {
       tensorNetwork->AddGate(agate, qubit);
     else if (GetSimulationType() == SimulationType::kStatevector)
       state->ApplyGate(agate);
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyGate(gate, static_cast<unsigned int>(qubit));
 
     NotifyObservers({qubit});
   }
@@ -97,7 +100,7 @@ class QCSimSimulator : public QCSimState {
     const QC::Gates::AppliedGate<> agate(gate, qubit0, qubit1);
 
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(agate);
+      ApplyMPSTwoQubitsGate(agate, qubit0, qubit1);
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(agate, qubit0, qubit1);
     else if (GetSimulationType() == SimulationType::kStatevector)
@@ -123,7 +126,9 @@ class QCSimSimulator : public QCSimState {
             "QCSimSimulator::ApplyP: Invalid phase shift "
             "angle for a Clifford gate.");
       cliffordSimulator->ApplyS(static_cast<unsigned int>(qubit));
-    } else if (GetSimulationType() == SimulationType::kTensorNetwork)
+    } else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyPhase(static_cast<unsigned int>(qubit), lambda);
+    else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(pgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
       pp->ApplyP(static_cast<unsigned int>(qubit), lambda);
@@ -147,6 +152,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(xgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyX(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyX(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(xgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -171,6 +178,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(ygate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyY(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyY(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(ygate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -195,6 +204,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(zgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyZ(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyZ(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(zgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -219,6 +230,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(h, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyH(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyH(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(h, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -243,6 +256,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(sgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyS(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyS(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(sgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -267,6 +282,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(sdggate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplySdg(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplySdg(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(sdggate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -293,6 +310,8 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyT: The stabilizer simulator does not support "
           "non-clifford gates.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyT(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(tgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -319,6 +338,8 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyTDG: The stabilizer simulator does not support "
           "non-clifford gates.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyTdg(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(tdggate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -343,6 +364,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(sxgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplySx(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplySx(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(sxgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -367,6 +390,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(sxdaggate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplySxDag(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplySxDag(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(sxdaggate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -391,6 +416,8 @@ class QCSimSimulator : public QCSimState {
       mpsSimulator->ApplyGate(k, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyK(static_cast<unsigned int>(qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyK(static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(k, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -419,6 +446,8 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyRx: The stabilizer "
           "simulator does not support the Rx gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyRx(static_cast<unsigned int>(qubit), theta);
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(rxgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -447,6 +476,8 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyRy: The stabilizer "
           "simulator does not support the Ry gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyRy(static_cast<unsigned int>(qubit), theta);
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(rygate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -475,6 +506,8 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyRz: The stabilizer "
           "simulator does not support the Rz gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyRz(static_cast<unsigned int>(qubit), theta);
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(rzgate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -507,6 +540,9 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyU: The stabilizer "
           "simulator does not support the U gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyGate(ugate.getRawOperatorMatrix(),
+                                    static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(ugate, static_cast<unsigned int>(qubit));
     else if (GetSimulationType() == SimulationType::kPauliPropagator)
@@ -529,11 +565,13 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplyCX(Types::qubit_t ctrl_qubit, Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(cxgate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(cxgate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyCX(static_cast<unsigned int>(tgt_qubit),
                                  static_cast<unsigned int>(ctrl_qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyCX(static_cast<unsigned int>(tgt_qubit),
+                                  static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(cxgate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -560,11 +598,13 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplyCY(Types::qubit_t ctrl_qubit, Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(cygate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(cygate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyCY(static_cast<unsigned int>(tgt_qubit),
                                  static_cast<unsigned int>(ctrl_qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyCY(static_cast<unsigned int>(tgt_qubit),
+                                  static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(cygate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -591,11 +631,13 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplyCZ(Types::qubit_t ctrl_qubit, Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(czgate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(czgate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplyCZ(static_cast<unsigned int>(tgt_qubit),
                                  static_cast<unsigned int>(ctrl_qubit));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyCZ(static_cast<unsigned int>(tgt_qubit),
+                                  static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(czgate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -625,12 +667,17 @@ class QCSimSimulator : public QCSimState {
                double lambda) override {
     cpgate.SetPhaseShift(lambda);
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(cpgate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(cpgate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCP: The stabilizer "
           "simulator does not support the CP gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      pgate.SetPhaseShift(lambda);
+      extendedStabilizer->ApplyControlledGate(
+          pgate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
+    }
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(cpgate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -660,12 +707,17 @@ class QCSimSimulator : public QCSimState {
                 double theta) override {
     crxgate.SetTheta(theta);
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(crxgate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(crxgate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCRx: The stabilizer "
           "simulator does not support the CRx gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      rxgate.SetTheta(theta);
+      extendedStabilizer->ApplyControlledGate(
+          rxgate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
+    }
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(crxgate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -695,12 +747,17 @@ class QCSimSimulator : public QCSimState {
                 double theta) override {
     crygate.SetTheta(theta);
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(crygate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(crygate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCRy: The stabilizer "
           "simulator does not support the CRy gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      rygate.SetTheta(theta);
+      extendedStabilizer->ApplyControlledGate(
+          rygate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
+    }
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(crygate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -730,12 +787,17 @@ class QCSimSimulator : public QCSimState {
                 double theta) override {
     crzgate.SetTheta(theta);
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(crzgate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(crzgate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCRz: The stabilizer "
           "simulator does not support the CRz gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      rzgate.SetTheta(theta);
+      extendedStabilizer->ApplyControlledGate(
+          rzgate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
+    }
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(crzgate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -762,12 +824,15 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplyCH(Types::qubit_t ctrl_qubit, Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(ch, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(ch, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCH: The stabilizer "
           "simulator does not support the CH gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyControlledGate(
+          h.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(ch, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -794,12 +859,15 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplyCSx(Types::qubit_t ctrl_qubit, Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(csx, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(csx, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCSx: The stabilizer "
           "simulator does not support the CSx gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyControlledGate(
+          sxgate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(csx, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -827,12 +895,16 @@ class QCSimSimulator : public QCSimState {
   void ApplyCSxDAG(Types::qubit_t ctrl_qubit,
                    Types::qubit_t tgt_qubit) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(csxdag, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(csxdag, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCSxDAG: The stabilizer "
           "simulator does not support the CSxDag gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplyControlledGate(
+          sxdaggate.getRawOperatorMatrix(),
+          static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(csxdag, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -859,11 +931,13 @@ class QCSimSimulator : public QCSimState {
    */
   void ApplySwap(Types::qubit_t qubit0, Types::qubit_t qubit1) override {
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(swapgate, static_cast<unsigned int>(qubit1),
-                              static_cast<unsigned int>(qubit0));
+      ApplyMPSTwoQubitsGate(swapgate, qubit1, qubit0);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       cliffordSimulator->ApplySwap(static_cast<unsigned int>(qubit1),
                                    static_cast<unsigned int>(qubit0));
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->ApplySwap(static_cast<unsigned int>(qubit1),
+                                    static_cast<unsigned int>(qubit0));
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(swapgate, static_cast<unsigned int>(qubit0),
                              static_cast<unsigned int>(qubit1));
@@ -920,7 +994,12 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyCCX: The stabilizer "
           "simulator does not support the CCX gate.");
-    else if (GetSimulationType() == SimulationType::kTensorNetwork) {
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      extendedStabilizer->ApplyCCX(static_cast<unsigned int>(qubit2),
+                                   static_cast<unsigned int>(qubit0),
+                                   static_cast<unsigned int>(qubit1));
+      NotifyObservers({qubit2, qubit1, qubit0});
+    } else if (GetSimulationType() == SimulationType::kTensorNetwork) {
       const size_t q1 = qubit0;  // control 1
       const size_t q2 = qubit1;  // control 2
       const size_t q3 = qubit2;  // target
@@ -1022,7 +1101,12 @@ class QCSimSimulator : public QCSimState {
       throw std::runtime_error(
           "QCSimSimulator::ApplyCSwap: The stabilizer "
           "simulator does not support the CSwap gate.");
-    else if (GetSimulationType() == SimulationType::kTensorNetwork) {
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      extendedStabilizer->ApplyCSwap(static_cast<unsigned int>(qubit0),
+                                     static_cast<unsigned int>(qubit1),
+                                     static_cast<unsigned int>(ctrl_qubit));
+      NotifyObservers({qubit1, qubit0, ctrl_qubit});
+    } else if (GetSimulationType() == SimulationType::kTensorNetwork) {
       const size_t q1 = ctrl_qubit;  // control
       const size_t q2 = qubit0;
       const size_t q3 = qubit1;
@@ -1100,12 +1184,17 @@ class QCSimSimulator : public QCSimState {
                double theta, double phi, double lambda, double gamma) override {
     cugate.SetParams(theta, phi, lambda, gamma);
     if (GetSimulationType() == SimulationType::kMatrixProductState)
-      mpsSimulator->ApplyGate(cugate, static_cast<unsigned int>(tgt_qubit),
-                              static_cast<unsigned int>(ctrl_qubit));
+      ApplyMPSTwoQubitsGate(cugate, tgt_qubit, ctrl_qubit);
     else if (GetSimulationType() == SimulationType::kStabilizer)
       throw std::runtime_error(
           "QCSimSimulator::ApplyCU: The stabilizer "
           "simulator does not support the CU gate.");
+    else if (GetSimulationType() == SimulationType::kExtendedStabilizer) {
+      ugate.SetParams(theta, phi, lambda, gamma);
+      extendedStabilizer->ApplyControlledGate(
+          ugate.getRawOperatorMatrix(), static_cast<unsigned int>(tgt_qubit),
+          static_cast<unsigned int>(ctrl_qubit));
+    }
     else if (GetSimulationType() == SimulationType::kTensorNetwork)
       tensorNetwork->AddGate(cugate, static_cast<unsigned int>(ctrl_qubit),
                              static_cast<unsigned int>(tgt_qubit));
@@ -1183,6 +1272,9 @@ class QCSimSimulator : public QCSimState {
     if (cliffordSimulator)
       cloned->cliffordSimulator = cliffordSimulator->Clone();
 
+    if (extendedStabilizer)
+      cloned->extendedStabilizer = extendedStabilizer->Clone();
+
     if (tensorNetwork) cloned->tensorNetwork = tensorNetwork->Clone();
 
     if (pp) cloned->pp = pp->Clone();
@@ -18,25 +18,31 @@
 #ifdef INCLUDED_BY_FACTORY
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <limits>
 #include <sstream>
 #include <random>
+#include <type_traits>
 
 #include "Simulator.h"
 
-#include "Clifford.h"
 #include "MPSSimulator.h"
 #include "QubitRegister.h"
 #include "QcsimPauliPropagator.h"
 #include "PathIntegralSimulator.h"
+#include "StabilizerTableau.h"
+#include "ExtendedStabilizer.h"
 
 #include "../TensorNetworks/ForestContractor.h"
+#include "../TensorNetworks/PartitionContractor.h"
 #include "../TensorNetworks/TensorNetwork.h"
 
 #include "../Utils/Alias.h"
 
 #include "MPSDummySimulator.h"
+#include "MPSEnvironments.h"
+#include "MPSLayerUpdate.h"
 #include "Configuration.h"
 
 namespace Simulators {
@@ -79,6 +85,7 @@ class QCSimState : public ISimulator {
             configuration.GetConfigurationAsInt("matrix_product_state_max_bond_dimension"));
         dummySim->setGrowthFactorGate(growthFactorGate);
         dummySim->setGrowthFactorSwap(growthFactorSwap);
+        dummySim->SetLookaheadAutoTune(lookaheadAutoTune);
       }
 
       // Seed dummy with current real simulator state
@@ -128,10 +135,14 @@ class QCSimState : public ISimulator {
       std::cerr << std::endl;
 #endif
 
+      const auto searchStart = std::chrono::steady_clock::now();
+      const int depth = dummySim->GetTunedLookaheadDepth(lookaheadDepth);
+      const int heuristicDepth = std::max(
+          0, lookaheadDepthWithHeuristic - (lookaheadDepth - depth));
+
       double bestCost = std::numeric_limits<double>::infinity();
       auto res = dummySim->FindBestMeetingPosition(
-          upcomingGates, upcomingGateIndex, lookaheadDepth,
-          lookaheadDepthWithHeuristic, 0, bestCost);
+          upcomingGates, upcomingGateIndex, depth, heuristicDepth, 0, bestCost);
 
 #ifdef LOG_CALLBACK_INFO
        std::cerr << "Swapping the two qubits on position: " << res << " and " << (res + 1) << std::endl;
@@ -139,6 +150,8 @@ class QCSimState : public ISimulator {
 
       dummySim->SwapQubitsToPosition(qbits[0], qbits[1], res);
       dummySim->ApplyGate(op);
+      dummySim->RecordLookaheadDecision(searchStart,
+                                        std::chrono::steady_clock::now());
 
       // display the expected bond dimensions after applying the gate for
       // debugging
@@ -183,17 +196,16 @@ class QCSimState : public ISimulator {
         mpsSimulator->SetBondDimensionCallback(bondDimensionCallback);
         
         curMaxBondDim = 1;
+        mpsLayerOpen = false;
+        pendingMPSGates.clear();
       } else if (simulationType == SimulationType::kStabilizer)
-        cliffordSimulator =
-            std::make_unique<QC::Clifford::StabilizerSimulator>(nrQubits);
+        cliffordSimulator = std::make_unique<StabilizerTableau>(nrQubits);
+      else if (simulationType == SimulationType::kExtendedStabilizer)
+        extendedStabilizer = std::make_unique<ExtendedStabilizer>(nrQubits);
       else if (simulationType == SimulationType::kTensorNetwork) {
         tensorNetwork =
             std::make_unique<TensorNetworks::TensorNetwork>(nrQubits);
-        // for now the only used contractor is the forest one, but we'll use
-        // more in the future
-        const auto tensorContractor =
-            std::make_shared<TensorNetworks::ForestContractor>();
-        tensorNetwork->SetContractor(tensorContractor);
+        SetTensorNetworkContractor();
       } else if (simulationType == SimulationType::kPauliPropagator) {
         pp = std::make_unique<Simulators::QcsimPauliPropagator>();
         pp->SetNrQubits(static_cast<int>(nrQubits));
@@ -331,8 +343,12 @@ class QCSimState : public ISimulator {
     if (mpsSimulator) {
       mpsSimulator->Clear();
       curMaxBondDim = 1;
+      mpsLayerOpen = false;
+      pendingMPSGates.clear();
     } else if (cliffordSimulator)
       cliffordSimulator->Reset();
+    else if (extendedStabilizer)
+      extendedStabilizer->Reset();
     else if (tensorNetwork)
       tensorNetwork->Clear();
     else if (state)
@@ -395,11 +411,20 @@ class QCSimState : public ISimulator {
     if (lookaheadDepth < depth) SetLookaheadDepth(depth);
   }
 
+  void SetLookaheadAutoTune(bool enable) override {
+    lookaheadAutoTune = enable;
+    if (dummySim) dummySim->SetLookaheadAutoTune(enable);
+  }
+
   void SetUpcomingGates(
       const std::vector<std::shared_ptr<Circuits::IOperation<double>>> &gates)
       override {
     upcomingGates = gates;
     upcomingGateIndex = 0;
+    if (dummySim) {
+      dummySim->ClearLookaheadCache();
+      dummySim->ResetLookaheadTuning();
+    }
 
     if (!mpsSimulator) return;
 
@@ -450,6 +475,31 @@ class QCSimState : public ISimulator {
    */
   void IncrementGatesCounter() override { ++upcomingGateIndex; }
 
+  /**
+   * @brief Starts a layer of gates acting on disjoint qubits.
+   *
+   * For the mps simulator the two qubits gates of the layer are deferred until
+   * the layer ends, then the ones on neighbouring qubits are applied in
+   * parallel on the tensors of the mps.
+   * @sa QCSimState::EndLayer
+   */
+  void BeginLayer() override {
+    if (!mpsSimulator) return;
+    FlushMPSLayer();
+    mpsLayerOpen = true;
+  }
+
+  /**
+   * @brief Ends the layer of gates started with BeginLayer.
+   *
+   * Applies the deferred two qubits gates of the layer.
+   * @sa QCSimState::BeginLayer
+   */
+  void EndLayer() override {
+    mpsLayerOpen = false;
+    FlushMPSLayer();
+  }
+
   double getGrowthFactorSwap() const override { return growthFactorSwap; }
   double getGrowthFactorGate() const override { return growthFactorGate; }
 
@@ -479,6 +529,8 @@ class QCSimState : public ISimulator {
         simulationType = SimulationType::kMatrixProductState;
       else if (std::string("stabilizer") == value)
         simulationType = SimulationType::kStabilizer;
+      else if (std::string("extended_stabilizer") == value)
+        simulationType = SimulationType::kExtendedStabilizer;
       else if (std::string("tensor_network") == value)
         simulationType = SimulationType::kTensorNetwork;
       else if (std::string("pauli_propagator") == value)
@@ -487,6 +539,10 @@ class QCSimState : public ISimulator {
         simulationType = SimulationType::kPathIntegral;
     }
 
+    // 'matrix_product_state_jacobi_svd' is stored and ignored, the bond
+    // updates of the cpu mps always use the full svd; the network passes the
+    // same configuration to the gpu simulators, which use it
+
     if (!configuration.WasApplied(key, value))
         configuration.SetConfiguration(key, value);
 
@@ -511,9 +567,26 @@ class QCSimState : public ISimulator {
                  "pauli_propagator_num_gates_between_deduplications") {
         pp->SetStepsBetweenDeduplication(
             configuration.GetConfigurationAsInt(key));
+      } else if (std::string(key) == "pauli_propagator_max_path_frequency") {
+        pp->SetMaxPathFrequency(configuration.GetConfigurationAsUnsigned(key));
+      } else if (std::string(key) ==
+                 "pauli_propagator_truncation_error_budget") {
+        pp->SetTruncationErrorBudget(
+            configuration.GetConfigurationAsDouble(key));
       }
     }
 
+    if (extendedStabilizer) {
+      if (std::string(key) == "extended_stabilizer_truncation_threshold")
+        extendedStabilizer->SetTruncationThreshold(
+            configuration.GetConfigurationAsDouble(key));
+    }
+
+    if (tensorNetwork) {
+      if (std::string(key) == "tensor_network_memory_limit")
+        SetTensorNetworkContractor();
+    }
+
     if (pathIntegralSimulator) {
       if (std::string(key) == "path_integral_threshold") {
         pathIntegralSimulator->SetTrimValue(configuration.GetConfigurationAsDouble(key));
@@ -537,6 +610,8 @@ class QCSimState : public ISimulator {
           return "matrix_product_state";
         case SimulationType::kStabilizer:
           return "stabilizer";
+        case SimulationType::kExtendedStabilizer:
+          return "extended_stabilizer";
         case SimulationType::kTensorNetwork:
           return "tensor_network";
         case SimulationType::kPauliPropagator:
@@ -563,6 +638,8 @@ class QCSimState : public ISimulator {
         (simulationType == SimulationType::kMatrixProductState &&
          mpsSimulator) ||
         (simulationType == SimulationType::kStabilizer && cliffordSimulator) ||
+        (simulationType == SimulationType::kExtendedStabilizer &&
+         extendedStabilizer) ||
         (simulationType == SimulationType::kTensorNetwork && tensorNetwork))
       return 0;
 
@@ -592,8 +669,14 @@ class QCSimState : public ISimulator {
   void Clear() override {
     state = nullptr;
     mpsSimulator = nullptr;
+    mpsLayerOpen = false;
+    pendingMPSGates.clear();
     cliffordSimulator = nullptr;
-    tensorNetwork = nullptr;
+    extendedStabilizer = nullptr;
+    if (tensorNetwork) {
+      tensorNetwork = nullptr;
+      Utils::TensorMemoryPool::Trim();
+    }
     pp = nullptr;
     pathIntegralSimulator = nullptr;
     dummySim = nullptr;
@@ -637,6 +720,12 @@ class QCSimState : public ISimulator {
           res |= mask;
         mask <<= 1;
       }
+    } else if (simulationType == SimulationType::kExtendedStabilizer) {
+      for (size_t qubit : qubits) {
+        if (extendedStabilizer->MeasureQubit(static_cast<unsigned int>(qubit)))
+          res |= mask;
+        mask <<= 1;
+      }
     } else if (simulationType == SimulationType::kTensorNetwork) {
       for (size_t qubit : qubits) {
         if (tensorNetwork->Measure(static_cast<unsigned int>(qubit)))
@@ -702,6 +791,11 @@ class QCSimState : public ISimulator {
         if (cliffordSimulator->MeasureQubit(
                 static_cast<unsigned int>(qubits[q])))
           res[q] = true;
+    } else if (simulationType == SimulationType::kExtendedStabilizer) {
+      for (size_t q = 0; q < qubits.size(); ++q)
+        if (extendedStabilizer->MeasureQubit(
+                static_cast<unsigned int>(qubits[q])))
+          res[q] = true;
     } else if (simulationType == SimulationType::kTensorNetwork) {
       for (size_t q = 0; q < qubits.size(); ++q)
         if (tensorNetwork->Measure(static_cast<unsigned int>(qubits[q])))
@@ -742,6 +836,10 @@ class QCSimState : public ISimulator {
       for (size_t qubit : qubits)
         if (cliffordSimulator->MeasureQubit(static_cast<unsigned int>(qubit)))
           cliffordSimulator->ApplyX(static_cast<unsigned int>(qubit));
+    } else if (simulationType == SimulationType::kExtendedStabilizer) {
+      for (size_t qubit : qubits)
+        if (extendedStabilizer->MeasureQubit(static_cast<unsigned int>(qubit)))
+          extendedStabilizer->ApplyX(static_cast<unsigned int>(qubit));
     } else if (simulationType == SimulationType::kTensorNetwork) {
       for (size_t qubit : qubits)
         if (tensorNetwork->Measure(static_cast<unsigned int>(qubit)))
@@ -787,6 +885,8 @@ class QCSimState : public ISimulator {
     else if (simulationType == SimulationType::kStabilizer)
       return cliffordSimulator->getBasisStateProbability(
           static_cast<unsigned int>(outcome));
+    else if (simulationType == SimulationType::kExtendedStabilizer)
+      return extendedStabilizer->getBasisStateProbability(outcome);
     else if (simulationType == SimulationType::kTensorNetwork)
       return tensorNetwork->getBasisStateProbability(outcome);
     else if (simulationType == SimulationType::kPauliPropagator)
@@ -813,14 +913,13 @@ class QCSimState : public ISimulator {
           static_cast<unsigned int>(outcome));
     else if (simulationType == SimulationType::kPathIntegral)
       return pathIntegralSimulator->AmplitudeForOutcome(outcome);
-    else if (simulationType == SimulationType::kStabilizer)
+    else if (simulationType == SimulationType::kStabilizer ||
+             simulationType == SimulationType::kExtendedStabilizer)
       throw std::runtime_error(
           "QCSimState::Amplitude: Invalid simulation type for obtaining the "
           "amplitude of the specified outcome.");
     else if (simulationType == SimulationType::kTensorNetwork)
-      throw std::runtime_error(
-          "QCSimState::Amplitude: Not supported for the "
-          "tensor network simulator.");
+      return tensorNetwork->Amplitudes({outcome})[0];
     else if (simulationType == SimulationType::kPauliPropagator)
       throw std::runtime_error(
           "QCSimState::Amplitude: Invalid simulation type for obtaining the "
@@ -829,6 +928,30 @@ class QCSimState : public ISimulator {
     return state->getBasisStateAmplitude(static_cast<unsigned int>(outcome));
   }
 
+  /**
+   * @brief Returns the amplitudes of the specified states.
+   *
+   * For the tensor network simulator the contractions are shared between the
+   * outcomes, with some qubits left open, so one contraction gives many
+   * amplitudes, and the intermediate tensors that do not depend on the
+   * outcome are computed only once. For the path integral simulator the
+   * amplitudes are looked up directly. For the other simulation types each
+   * amplitude is obtained separately.
+   *
+   * @param outcomes The outcomes to obtain the amplitudes for.
+   * @return The amplitudes, in the order of the outcomes.
+   * @sa QCSimState::Amplitude
+   */
+  std::vector<std::complex<double>> Amplitudes(
+      const std::vector<Types::qubit_t> &outcomes) override {
+    if (simulationType == SimulationType::kTensorNetwork)
+      return tensorNetwork->Amplitudes(outcomes);
+    else if (simulationType == SimulationType::kPathIntegral)
+      return pathIntegralSimulator->AmplitudesForOutcomes(outcomes);
+
+    return ISimulator::Amplitudes(outcomes);
+  }
+
   /**
    * @brief Projects the state onto the zero state.
    *
@@ -867,6 +990,8 @@ class QCSimState : public ISimulator {
           "simulation type for obtaining probabilities.");
     else if (simulationType == SimulationType::kStabilizer)
       return cliffordSimulator->AllProbabilities();
+    else if (simulationType == SimulationType::kExtendedStabilizer)
+      return extendedStabilizer->AllProbabilities();
     else if (simulationType == SimulationType::kPauliPropagator) {
       const size_t nrBasisStates = 1ULL << GetNumberOfQubits();
       std::vector<double> result(nrBasisStates);
@@ -905,7 +1030,8 @@ class QCSimState : public ISimulator {
    */
   std::vector<double> Probabilities(
       const Types::qubits_vector &qubits) override {
-    if (simulationType == SimulationType::kStabilizer)
+    if (simulationType == SimulationType::kStabilizer ||
+        simulationType == SimulationType::kExtendedStabilizer)
       throw std::runtime_error(
           "QCSimState::Probabilities: Invalid simulation "
           "type for obtaining probabilities.");
@@ -975,42 +1101,32 @@ class QCSimState : public ISimulator {
       if (!configuration.IsSet("mps_sample_measure_algorithm") || configuration.GetConfiguration("mps_sample_measure_algorithm") == "mps_probabilities") {
         // check to see if it can be used
         const std::set<Eigen::Index> qset(qubits.begin(), qubits.end());
-        if (qset.size() == GetNumberOfQubits()) {
+        if (qset.size() > 1) {
           // it can!
           normal = false;
-          for (size_t shot = 0; shot < shots; ++shot) {
-            const size_t measRaw = MeasureNoCollapse();
-            size_t meas = 0;
-            size_t mask = 1ULL;
+          const std::vector<Eigen::Index> order(qset.begin(), qset.end());
+          std::vector<size_t> positions(qubits.size());
+          for (size_t i = 0; i < qubits.size(); ++i)
+            positions[i] = std::lower_bound(order.begin(), order.end(),
+                                            static_cast<Eigen::Index>(
+                                                qubits[i])) -
+                           order.begin();
 
-            // translate the measurement
-            for (auto q : qubits) {
-              const size_t qubitMask = 1ULL << q;
-              if (measRaw & qubitMask) meas |= mask;
-              mask <<= 1ULL;
-            }
+          const auto treeCounts = SampleMPSTree(qset, shots);
 
-            ++result[meas];
-          }
-        } else if (qset.size() > 1) {
-          mpsSimulator->MoveAtBeginningOfChain(qset);
-          // now sample
-          normal = false;
-          for (size_t shot = 0; shot < shots; ++shot) {
-            const auto measRaw = mpsSimulator->MeasureNoCollapse(qset);
+          for (const auto &[measRaw, count] : treeCounts) {
             size_t meas = 0;
             size_t mask = 1ULL;
 
             // might not be in the requested order
             // translate the measurement
-            for (auto q : qubits) {
-              if (measRaw.at(q)) meas |= mask;
+            for (size_t i = 0; i < positions.size(); ++i) {
+              if (measRaw[positions[i]]) meas |= mask;
               mask <<= 1ULL;
             }
 
-            ++result[meas];
+            result[meas] += count;
           }
-
         } else if (qset.size() == 1) {
           // if only one qubit is measured, we can use the probability
           normal = false;
@@ -1044,25 +1160,36 @@ class QCSimState : public ISimulator {
         cliffordSimulator->RestoreState();
       }
       cliffordSimulator->ClearSavedState();
-    } else if (simulationType == SimulationType::kTensorNetwork) {
-      tensorNetwork->SaveState();
+    } else if (simulationType == SimulationType::kExtendedStabilizer) {
+      extendedStabilizer->SaveState();
       for (size_t shot = 0; shot < shots; ++shot) {
         const size_t meas = Measure(qubits);
         ++result[meas];
-        tensorNetwork->RestoreState();
+        extendedStabilizer->RestoreState();
+      }
+      extendedStabilizer->ClearSavedState();
+    } else if (simulationType == SimulationType::kTensorNetwork) {
+      const auto counts = tensorNetwork->SampleCounts(qubits, shots);
+      for (const auto &[measVec, count] : counts) {
+        size_t meas = 0;
+        size_t mask = 1ULL;
+        for (size_t i = 0; i < measVec.size(); ++i) {
+          if (measVec[i]) meas |= mask;
+          mask <<= 1ULL;
+        }
+
+        result[meas] += count;
       }
-      tensorNetwork->ClearSavedState();
     } else if (simulationType == SimulationType::kPauliPropagator) {
       std::vector<int> qubitsInt(qubits.begin(), qubits.end());
-      for (size_t shot = 0; shot < shots; ++shot) {
-        const auto res = pp->Sample(qubitsInt);
-
+      const auto counts = pp->SampleCounts(qubitsInt, shots);
+      for (const auto &[measVec, count] : counts) {
         size_t meas = 0;
-        for (size_t i = 0; i < qubits.size(); ++i) {
-          if (res[i]) meas |= (1ULL << i);
+        for (size_t i = 0; i < measVec.size(); ++i) {
+          if (measVec[i]) meas |= (1ULL << i);
         }
 
-        ++result[meas];
+        result[meas] += count;
       }
     } else if (simulationType == SimulationType::kPathIntegral) {
       if (nrQubits < 64) {
@@ -1169,34 +1296,32 @@ class QCSimState : public ISimulator {
       if (!configuration.IsSet("mps_sample_measure_algorithm") || configuration.GetConfiguration("mps_sample_measure_algorithm") == "mps_probabilities") {
         // check to see if it can be used
         const std::set<Eigen::Index> qset(qubits.begin(), qubits.end());
-        if (qset.size() == GetNumberOfQubits()) {
+        if (qset.size() > 1) {
           // it can!
           normal = false;
-          for (size_t shot = 0; shot < shots; ++shot) {
-            const auto meas = MeasureNoCollapseMany();
-
-            // might not be in the requested order
-            // translate the measurement
-            std::vector<bool> measVec(qubits.size());
-            for (size_t i = 0; i < qubits.size(); ++i)
-              measVec[i] = meas[qubits[i]];
-
-            ++result[measVec];
-          }
-        } else if (qset.size() > 1) {
-          mpsSimulator->MoveAtBeginningOfChain(qset);
-          // now sample
-          normal = false;
-          for (size_t shot = 0; shot < shots; ++shot) {
-            const auto meas = mpsSimulator->MeasureNoCollapse(qset);
-
-            // might not be in the requested order
-            // translate the measurement
-            std::vector<bool> measVec(qubits.size());
-            for (size_t i = 0; i < qubits.size(); ++i)
-              measVec[i] = meas.at(qubits[i]);
-
-            ++result[measVec];
+          const std::vector<Eigen::Index> order(qset.begin(), qset.end());
+          std::vector<size_t> positions(qubits.size());
+          for (size_t i = 0; i < qubits.size(); ++i)
+            positions[i] = std::lower_bound(order.begin(), order.end(),
+                                            static_cast<Eigen::Index>(
+                                                qubits[i])) -
+                           order.begin();
+
+          auto treeCounts = SampleMPSTree(qset, shots);
+
+          // might not be in the requested order
+          // translate the measurement
+          if (qubits.size() == order.size() &&
+              std::equal(qubits.begin(), qubits.end(), order.begin()))
+            result = std::move(treeCounts);
+          else {
+            for (const auto &[meas, count] : treeCounts) {
+              std::vector<bool> measVec(qubits.size());
+              for (size_t i = 0; i < qubits.size(); ++i)
+                measVec[i] = meas[positions[i]];
+
+              result[measVec] += count;
+            }
           }
         } else if (qset.size() == 1) {
           // if only one qubit is measured, we can use the probability
@@ -1227,20 +1352,20 @@ class QCSimState : public ISimulator {
         cliffordSimulator->RestoreState();
       }
       cliffordSimulator->ClearSavedState();
-    } else if (simulationType == SimulationType::kTensorNetwork) {
-      tensorNetwork->SaveState();
+    } else if (simulationType == SimulationType::kExtendedStabilizer) {
+      extendedStabilizer->SaveState();
       for (size_t shot = 0; shot < shots; ++shot) {
         const auto meas = MeasureMany(qubits);
         ++result[meas];
-        tensorNetwork->RestoreState();
+        extendedStabilizer->RestoreState();
       }
-      tensorNetwork->ClearSavedState();
+      extendedStabilizer->ClearSavedState();
+    } else if (simulationType == SimulationType::kTensorNetwork) {
+      result = tensorNetwork->SampleCounts(qubits, shots);
     } else if (simulationType == SimulationType::kPauliPropagator) {
       std::vector<int> qubitsInt(qubits.begin(), qubits.end());
-      for (size_t shot = 0; shot < shots; ++shot) {
-        const auto meas = pp->Sample(qubitsInt);
-        ++result[meas];
-      }
+      const auto counts = pp->SampleCounts(qubitsInt, shots);
+      for (const auto &[meas, count] : counts) result[meas] += count;
     } else if (simulationType == SimulationType::kPathIntegral) {
       if (nrQubits < 64) {
         if (shots > 1) {
@@ -1333,33 +1458,342 @@ class QCSimState : public ISimulator {
    * The Pauli string is a string of characters representing the Pauli
    * operators, e.g. "XIZY". The length of the string should be less or equal
    * to the number of qubits (if it's less, it's completed with I).
+   * For the Pauli propagator it's evaluated as by ExpectationValues, with the
+   * same truncation and its error bound.
    *
    * @param pauliString The Pauli string to obtain the expected value for.
    * @return The expected value of the specified Pauli string.
    */
   double ExpectationValue(const std::string &pauliStringOrig) override {
+    if (simulationType == SimulationType::kPauliPropagator)
+      return ExpectationValues(std::vector<std::string>{pauliStringOrig})
+          .front();
+
     if (pauliStringOrig.empty()) return 1.0;
 
     std::string pauliString = pauliStringOrig;
-    if (pauliString.size() > GetNumberOfQubits()) {
-      for (size_t i = GetNumberOfQubits(); i < pauliString.size(); ++i) {
-        const auto pauliOp = toupper(pauliString[i]);
-        if (pauliOp != 'I' && pauliOp != 'Z') return 0.0;
-      }
-
-      pauliString.resize(GetNumberOfQubits());
-    }
+    if (!TruncatePauliString(pauliString)) return 0.0;
 
     if (simulationType == SimulationType::kStabilizer)
       return cliffordSimulator->ExpectationValue(pauliString);
+    else if (simulationType == SimulationType::kExtendedStabilizer)
+      return extendedStabilizer->ExpectationValue(pauliString);
     else if (simulationType == SimulationType::kTensorNetwork)
       return tensorNetwork->ExpectationValue(pauliString);
-    else if (simulationType == SimulationType::kPauliPropagator)
-      return pp->ExpectationValue(pauliString);
     else if (simulationType == SimulationType::kPathIntegral)
       return pathIntegralSimulator->ExpectationValue(pauliString);
 
     // statevector or mps
+    const auto pauliStringVec = PauliStringToGates(pauliString);
+
+    if (pauliStringVec.empty()) return 1.0;
+
+    if (simulationType == SimulationType::kMatrixProductState)
+      return mpsSimulator->ExpectationValue(pauliStringVec).real();
+
+    return state->ExpectationValue(pauliStringVec).real();
+  }
+
+  /**
+   * @brief Returns the expected values of many Pauli strings.
+   *
+   * For the mps simulator the terms are deduplicated and evaluated together,
+   * with the left environments shared by the terms with a common prefix, see
+   * MPSEnvironments. If the tensors of the mps do not form a chain of the
+   * qubits, the terms are contracted by the mps simulator, in parallel. For the
+   * stabilizer simulator the terms are evaluated together on the tableau. For
+   * the tensor network simulator the network is simplified once, for the
+   * light cone of all the terms, and shared by them. For the Pauli propagator
+   * the terms are propagated together, in a single backward pass over the
+   * circuit, and the truncation error bounds are kept. For the other
+   * simulation types each term is evaluated separately.
+   *
+   * @param pauliStrings The Pauli strings to obtain the expected values for.
+   * @return The expected values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) override {
+    if (simulationType == SimulationType::kStabilizer &&
+        pauliStrings.size() > 1)
+      return TruncatedExpectationValues(
+          pauliStrings, [this](const std::vector<std::string> &truncated) {
+            return cliffordSimulator->ExpectationValues(truncated);
+          });
+    else if (simulationType == SimulationType::kTensorNetwork &&
+             pauliStrings.size() > 1)
+      return TruncatedExpectationValues(
+          pauliStrings, [this](const std::vector<std::string> &truncated) {
+            return tensorNetwork->ExpectationValues(truncated);
+          });
+    else if (simulationType == SimulationType::kPauliPropagator) {
+      std::vector<std::string> truncated;
+      std::vector<size_t> positions;
+      TruncatePauliStrings(pauliStrings, truncated, positions);
+
+      const auto values = pp->ExpectationValues(truncated);
+
+      // the strings with a zero expected value have no error
+      std::vector<double> result(pauliStrings.size(), 0.0);
+      truncationErrors.clear();
+      if (pp->HasTruncationErrors())
+        truncationErrors.assign(pauliStrings.size(), 0.0);
+
+      const auto &errors = pp->GetTruncationErrors();
+      for (size_t k = 0; k < positions.size(); ++k) {
+        result[positions[k]] = values[k];
+        if (!truncationErrors.empty())
+          truncationErrors[positions[k]] = errors[k];
+      }
+
+      return result;
+    }
+
+    if (simulationType != SimulationType::kMatrixProductState ||
+        pauliStrings.size() < 2)
+      return ISimulator::ExpectationValues(pauliStrings);
+
+    std::vector<double> result(pauliStrings.size(), 1.0);
+
+    // the distinct terms that need a contraction
+    std::vector<std::string> terms;
+    std::vector<std::vector<size_t>> termPositions;  // where the results go
+    std::unordered_map<std::string, size_t> termIndex;
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      std::string pauliString = pauliStrings[i];
+      if (!TruncatePauliString(pauliString)) {
+        result[i] = 0.0;
+        continue;
+      }
+
+      const size_t last = pauliString.find_last_of("XYZ");
+      if (last == std::string::npos) continue;  // identity
+      pauliString.resize(last + 1);
+
+      const auto it = termIndex.find(pauliString);
+      if (it != termIndex.end())
+        termPositions[it->second].push_back(i);
+      else {
+        termIndex.emplace(pauliString, terms.size());
+        terms.emplace_back(std::move(pauliString));
+        termPositions.push_back({i});
+      }
+    }
+
+    if (terms.empty()) return result;
+
+    const size_t nrThreads =
+        enableMultithreading
+            ? static_cast<size_t>(
+                  QC::QubitRegisterCalculator<>::GetNumberOfThreads())
+            : 1;
+
+    std::vector<double> values;
+    MPSEnvironments environments;
+    std::vector<size_t> positions;
+    if (LoadMPSEnvironments(environments, positions)) {
+      // the strings are given to the environments in the chain order
+      std::vector<std::string> chainTerms;
+      chainTerms.reserve(terms.size());
+      for (const auto &term : terms) {
+        std::string chainTerm(positions.size(), 'I');
+        for (size_t q = 0; q < term.size(); ++q)
+          chainTerm[positions[q]] = term[q];
+        chainTerms.emplace_back(std::move(chainTerm));
+      }
+
+      values = environments.ExpectationValues(chainTerms, nrThreads);
+    } else
+      values = ContractExpectationValues(terms, nrThreads);
+
+    for (size_t t = 0; t < terms.size(); ++t)
+      for (const auto pos : termPositions[t]) result[pos] = values[t];
+
+    return result;
+  }
+
+ private:
+  /**
+   * @brief Returns the expected values of many Pauli strings, evaluated
+   * together.
+   *
+   * The strings are truncated to the number of qubits as in ExpectationValue,
+   * the ones with X or Y past it have a zero expected value. The rest are
+   * passed together to the evaluation function.
+   *
+   * @param pauliStrings The Pauli strings to obtain the expected values for.
+   * @param evaluate The function that evaluates the truncated strings.
+   * @return The expected values, in the order of the Pauli strings.
+   */
+  template <class Evaluator>
+  std::vector<double> TruncatedExpectationValues(
+      const std::vector<std::string> &pauliStrings,
+      Evaluator &&evaluate) const {
+    std::vector<double> result(pauliStrings.size(), 0.0);
+
+    std::vector<std::string> truncated;
+    std::vector<size_t> positions;
+    TruncatePauliStrings(pauliStrings, truncated, positions);
+
+    const auto values = evaluate(truncated);
+    for (size_t k = 0; k < positions.size(); ++k)
+      result[positions[k]] = values[k];
+
+    return result;
+  }
+
+  /**
+   * @brief Truncates the Pauli strings to the number of qubits.
+   *
+   * The strings with a zero expected value because of the operators past the
+   * last qubit are skipped, see TruncatePauliString.
+   *
+   * @param pauliStrings The Pauli strings.
+   * @param truncated The truncated strings with a possibly non zero expected
+   * value.
+   * @param positions The positions of the truncated strings in pauliStrings.
+   */
+  void TruncatePauliStrings(const std::vector<std::string> &pauliStrings,
+                            std::vector<std::string> &truncated,
+                            std::vector<size_t> &positions) const {
+    truncated.clear();
+    positions.clear();
+    truncated.reserve(pauliStrings.size());
+    positions.reserve(pauliStrings.size());
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      std::string pauliString = pauliStrings[i];
+      if (!TruncatePauliString(pauliString)) continue;
+
+      truncated.emplace_back(std::move(pauliString));
+      positions.push_back(i);
+    }
+  }
+
+  // QCSim keeps the mps in Vidal's form, the tensors are taken from the saved
+  // state
+  template <class MPSState, class = void>
+  struct HasVidalTensors : std::false_type {};
+
+  template <class MPSState>
+  struct HasVidalTensors<
+      MPSState,
+      std::void_t<decltype(std::declval<const MPSState &>().gammas),
+                  decltype(std::declval<const MPSState &>().lambdas),
+                  decltype(std::declval<const MPSState &>().qubitsMap)>>
+      : std::true_type {};
+
+  /**
+   * @brief Loads the mps in the shared environments evaluator.
+   *
+   * @param environments The environments evaluator.
+   * @param positions The positions of the qubits in the chain.
+   * @return False if the tensors of the mps do not form a chain of the
+   * qubits, in which case the expected values have to be obtained from the mps
+   * simulator.
+   */
+  bool LoadMPSEnvironments(MPSEnvironments &environments,
+                           std::vector<size_t> &positions) const {
+    using MPSState = std::decay_t<decltype(mpsSimulator->getState())>;
+
+    // without the tensors each term would be contracted on its own, which is
+    // what the shared environments avoid
+    static_assert(HasVidalTensors<MPSState>::value,
+                  "The saved state of the mps simulator must expose the "
+                  "gammas, lambdas and qubitsMap of the mps.");
+
+    const auto mpsState = mpsSimulator->getState();
+
+    const size_t nrQubitsState = GetNumberOfQubits();
+    if (mpsState.qubitsMap.size() != nrQubitsState) return false;
+
+    positions.assign(mpsState.qubitsMap.begin(), mpsState.qubitsMap.end());
+    std::vector<bool> used(nrQubitsState, false);
+    for (const auto pos : positions) {
+      if (pos >= nrQubitsState || used[pos]) return false;
+      used[pos] = true;
+    }
+
+    return environments.Load(mpsState.gammas, mpsState.lambdas);
+  }
+
+  /**
+   * @brief Returns the expected values of the Pauli strings, contracted by
+   * the mps simulator.
+   *
+   * The strings are split in contiguous ranges, each evaluated in parallel on
+   * its own copy of the mps.
+   *
+   * @param terms The Pauli strings, already truncated.
+   * @param nrThreads The number of threads to use.
+   * @return The expected values, in the order of the strings.
+   */
+  std::vector<double> ContractExpectationValues(
+      const std::vector<std::string> &terms, size_t nrThreads) const {
+    std::vector<double> values(terms.size());
+
+    const long long int nrTerms = static_cast<long long int>(terms.size());
+    const long long int nrRanges =
+        std::min<long long int>(static_cast<long long int>(nrThreads), nrTerms);
+
+    if (nrRanges <= 1) {
+      for (size_t t = 0; t < terms.size(); ++t)
+        values[t] =
+            mpsSimulator->ExpectationValue(PauliStringToGates(terms[t])).real();
+      return values;
+    }
+
+#pragma omp parallel for num_threads(nrRanges) schedule(static, 1)
+    for (long long int r = 0; r < nrRanges; ++r) {
+      const long long int startTerm = nrTerms * r / nrRanges;
+      const long long int endTerm = nrTerms * (r + 1) / nrRanges;
+
+      auto sim = mpsSimulator->Clone();
+      sim->SetMeetingPositionCallback(nullptr);
+      sim->SetBondDimensionCallback(nullptr);
+
+      for (long long int t = startTerm; t < endTerm; ++t)
+        values[t] = sim->ExpectationValue(PauliStringToGates(terms[t])).real();
+    }
+
+    return values;
+  }
+
+  /**
+   * @brief Truncates a Pauli string to the number of qubits.
+   *
+   * The string is converted to upper case. The operators past the last qubit
+   * act on qubits in the zero state, so I and Z can be dropped, while X or Y
+   * give a zero expected value.
+   *
+   * @param pauliString The Pauli string, truncated in place.
+   * @return False if the expected value is zero because of the operators past
+   * the last qubit.
+   */
+  bool TruncatePauliString(std::string &pauliString) const {
+    for (auto &op : pauliString) op = static_cast<char>(toupper(op));
+
+    const size_t nrQubitsState = GetNumberOfQubits();
+    if (pauliString.size() > nrQubitsState) {
+      if (pauliString.find_first_of("XY", nrQubitsState) != std::string::npos)
+        return false;
+
+      pauliString.resize(nrQubitsState);
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Converts a Pauli string to the Pauli gates applied on the qubits.
+   *
+   * The identities are skipped.
+   *
+   * @param pauliString The Pauli string.
+   * @return The Pauli gates, in the order of the qubits.
+   */
+  static std::vector<QC::Gates::AppliedGate<Eigen::MatrixXcd>>
+  PauliStringToGates(const std::string &pauliString) {
     static const QC::Gates::PauliXGate<> xgate;
     static const QC::Gates::PauliYGate<> ygate;
     static const QC::Gates::PauliZGate<> zgate;
@@ -1391,14 +1825,11 @@ class QCSimState : public ISimulator {
       }
     }
 
-    if (pauliStringVec.empty()) return 1.0;
-
-    if (simulationType == SimulationType::kMatrixProductState)
-      return mpsSimulator->ExpectationValue(pauliStringVec).real();
-
-    return state->ExpectationValue(pauliStringVec).real();
+    return pauliStringVec;
   }
 
+ public:
+
   /**
    * @brief Returns the type of simulator.
    *
@@ -1423,10 +1854,10 @@ class QCSimState : public ISimulator {
    *
    * This function is called to flush the applied operations.
    * It is used to flush the operations that were applied to the state.
-   * qcsim applies them right away, so this has no effect on it, but qiskit
-   * aer does not.
+   * qcsim applies them right away, except the two qubits gates deferred by
+   * the mps simulator in an open layer, which are applied now.
    */
-  void Flush() override {}
+  void Flush() override { FlushMPSLayer(); }
 
   /**
    * @brief Saves the state to internal storage.
@@ -1461,6 +1892,8 @@ class QCSimState : public ISimulator {
       mpsSimulator->SaveState();
     else if (simulationType == SimulationType::kStabilizer)
       cliffordSimulator->SaveState();
+    else if (simulationType == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->SaveState();
     else if (simulationType == SimulationType::kTensorNetwork)
       tensorNetwork->SaveState();
     else if (simulationType == SimulationType::kPauliPropagator)
@@ -1484,6 +1917,8 @@ class QCSimState : public ISimulator {
       mpsSimulator->RestoreState();
     else if (simulationType == SimulationType::kStabilizer)
       cliffordSimulator->RestoreState();
+    else if (simulationType == SimulationType::kExtendedStabilizer)
+      extendedStabilizer->RestoreState();
     else if (simulationType == SimulationType::kTensorNetwork)
       tensorNetwork->RestoreState();
     else if (simulationType == SimulationType::kPauliPropagator)
@@ -1517,6 +1952,8 @@ class QCSimState : public ISimulator {
     enableMultithreading = multithreading;
     if (state) state->SetMultithreading(multithreading);
     if (cliffordSimulator) cliffordSimulator->SetMultithreading(multithreading);
+    if (extendedStabilizer)
+      extendedStabilizer->SetMultithreading(multithreading);
     if (tensorNetwork) tensorNetwork->SetMultithreading(multithreading);
     if (pp) {
       if (multithreading)
@@ -1672,8 +2109,292 @@ class QCSimState : public ISimulator {
    */
   size_t GetCurrentMaxBondDimension() const override { return curMaxBondDim; }
 
+  /**
+   * @brief Returns the truncation error bounds of the last expectation values.
+   *
+   * Available for the pauli propagator, for circuits without measurements.
+   */
+  std::vector<double> GetTruncationErrors() const override {
+    return truncationErrors;
+  }
+
   const Configuration& GetConfiguration() const { return configuration; }
 
+ private:
+  /**
+   * @brief A node of the mps sampling tree.
+   *
+   * Holds the state collapsed on the outcomes already sampled (the prefix) and
+   * the number of shots that share that prefix.
+   */
+  struct MPSSamplingNode {
+    std::unique_ptr<QC::TensorNetworks::MPSSimulator> sim;
+    std::vector<bool> prefix;
+    size_t shots = 0;
+  };
+
+  static constexpr size_t kMinShotsForSplit =
+      4; /**< Nodes with less shots are sampled shot by shot. */
+  static constexpr double kMinBranchProbability =
+      1e-12; /**< Branches less probable than this don't get shots. */
+
+  /**
+   * @brief Samples the mps for all the shots at once, using a sampling tree.
+   *
+   * The qubits are sampled one by one, in the chain order. The shots that got
+   * the same outcomes for the already sampled qubits are grouped together,
+   * so the conditional probability and the collapse of the state are computed
+   * once for each distinct prefix, not once for each shot. The shots are split
+   * between the two outcomes of the next qubit with a binomial draw. Nodes
+   * with only a few shots left are sampled shot by shot, that's cheaper than
+   * collapsing the state for each of them. The first levels of the tree are
+   * expanded breadth first, until there are enough subtrees to keep all
+   * threads busy, then the subtrees are sampled in parallel.
+   *
+   * The state of the simulator is not changed.
+   *
+   * @param qset The qubits to be sampled.
+   * @param shots The number of shots.
+   * @return A map with the counts for the outcomes, the outcome for the i-th
+   * qubit in qset being at the position i.
+   */
+  std::unordered_map<std::vector<bool>, Types::qubit_t> SampleMPSTree(
+      const std::set<Eigen::Index> &qset, size_t shots) {
+    std::vector<Eigen::Index> order(qset.begin(), qset.end());
+    const bool allQubits = qset.size() == GetNumberOfQubits();
+
+    MPSSamplingNode root;
+    root.sim = mpsSimulator->Clone();
+    // the sampling does not apply gates, the callbacks would only interfere
+    // with the state of this object
+    root.sim->SetMeetingPositionCallback(nullptr);
+    root.sim->SetBondDimensionCallback(nullptr);
+    root.shots = shots;
+
+    // the collapse of a qubit is followed by a two qubit update with the next
+    // sampled one, they have to be neighbours in the chain: all the qubits are
+    // sampled in the chain order, a part of them is moved at the beginning of
+    // the chain, on the copy, so the layout of the simulator is kept
+    if (allQubits) {
+      const auto qubitsMap = root.sim->getState().qubitsMap;
+      std::sort(order.begin(), order.end(),
+                [&qubitsMap](Eigen::Index q1, Eigen::Index q2) {
+                  return qubitsMap[q1] < qubitsMap[q2];
+                });
+    } else
+      root.sim->MoveAtBeginningOfChain(qset);
+
+    const size_t nrThreads =
+        enableMultithreading
+            ? static_cast<size_t>(
+                  QC::QubitRegisterCalculator<>::GetNumberOfThreads())
+            : 1;
+
+    std::vector<MPSSamplingNode> frontier;
+    std::vector<MPSSamplingNode> tasks;
+    frontier.emplace_back(std::move(root));
+
+    while (!frontier.empty() && frontier.size() + tasks.size() < nrThreads) {
+      std::vector<MPSSamplingNode> next;
+      for (auto &node : frontier) {
+        if (node.prefix.size() == order.size() ||
+            node.shots < kMinShotsForSplit)
+          tasks.emplace_back(std::move(node));
+        else
+          SplitMPSSamplingNode(node, order, rng, next);
+      }
+      frontier.swap(next);
+    }
+
+    for (auto &node : frontier) tasks.emplace_back(std::move(node));
+
+    std::vector<std::unordered_map<std::vector<bool>, Types::qubit_t>>
+        taskCounts(tasks.size());
+    std::vector<std::mt19937_64::result_type> seeds(tasks.size());
+    for (auto &seed : seeds) seed = rng();
+
+    const long long int nrTasks = static_cast<long long int>(tasks.size());
+
+#pragma omp parallel for num_threads(nrThreads) schedule(dynamic) \
+    if (nrThreads > 1 && nrTasks > 1)
+    for (long long int t = 0; t < nrTasks; ++t) {
+      std::mt19937_64 gen(seeds[t]);
+      SampleMPSSubtree(tasks[t], order, qset, allQubits, gen, taskCounts[t]);
+    }
+
+    std::unordered_map<std::vector<bool>, Types::qubit_t> result;
+    for (auto &counts : taskCounts) {
+      if (result.empty())
+        result = std::move(counts);
+      else
+        for (const auto &[meas, count] : counts) result[meas] += count;
+    }
+
+    // the outcomes are in the sampling order, they go in the qubits order
+    if (!std::is_sorted(order.begin(), order.end())) {
+      std::unordered_map<std::vector<bool>, Types::qubit_t> reordered;
+      std::vector<bool> outcomes(order.size());
+      for (const auto &[meas, count] : result) {
+        for (size_t i = 0; i < order.size(); ++i) outcomes[order[i]] = meas[i];
+        reordered[outcomes] += count;
+      }
+      result.swap(reordered);
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Samples the subtree rooted at the specified node, depth first.
+   *
+   * @param node The root of the subtree, its state is consumed.
+   * @param order The qubits to be sampled, in the sampling order.
+   * @param qset The qubits to be sampled, as a set.
+   * @param allQubits True if all the qubits are sampled.
+   * @param gen The random number generator used for splitting the shots.
+   * @param counts The map where the counts are accumulated.
+   */
+  static void SampleMPSSubtree(
+      MPSSamplingNode &node, const std::vector<Eigen::Index> &order,
+      const std::set<Eigen::Index> &qset, bool allQubits, std::mt19937_64 &gen,
+      std::unordered_map<std::vector<bool>, Types::qubit_t> &counts) {
+    if (node.prefix.size() == order.size()) {
+      counts[node.prefix] += node.shots;
+      return;
+    } else if (node.shots < kMinShotsForSplit) {
+      // the prefix is already collapsed in the state, so sampling all the
+      // qubits reproduces it
+      for (size_t shot = 0; shot < node.shots; ++shot) {
+        std::vector<bool> meas(order.size());
+        if (allQubits) {
+          const auto measured = node.sim->MeasureNoCollapse();
+          for (size_t i = 0; i < order.size(); ++i)
+            meas[i] = measured.at(order[i]);
+        } else {
+          const auto measured = node.sim->MeasureNoCollapse(qset);
+          for (size_t i = 0; i < order.size(); ++i)
+            meas[i] = measured.at(order[i]);
+        }
+        ++counts[meas];
+      }
+      return;
+    }
+
+    std::vector<MPSSamplingNode> children;
+    SplitMPSSamplingNode(node, order, gen, children);
+    for (auto &child : children)
+      SampleMPSSubtree(child, order, qset, allQubits, gen, counts);
+  }
+
+  /**
+   * @brief Splits a sampling tree node on the next qubit.
+   *
+   * The shots are distributed between the two outcomes with a binomial draw,
+   * then the collapsed states are obtained only for the outcomes that got
+   * shots, by projecting the qubit on the outcome, see CollapseMPSQubit. After
+   * the last qubit no state is needed, the children only hold the counts.
+   *
+   * @param node The node to split, its state is consumed.
+   * @param order The qubits to be sampled, in the sampling order.
+   * @param gen The random number generator used for splitting the shots.
+   * @param children The vector where the children are added.
+   */
+  static void SplitMPSSamplingNode(MPSSamplingNode &node,
+                                   const std::vector<Eigen::Index> &order,
+                                   std::mt19937_64 &gen,
+                                   std::vector<MPSSamplingNode> &children) {
+    const size_t level = node.prefix.size();
+    const Eigen::Index qubit = order[level];
+    const bool last = level + 1 == order.size();
+
+    const double prob0 = std::clamp(node.sim->GetProbability(qubit), 0., 1.);
+    const double probs[2] = {prob0, 1. - prob0};
+
+    size_t shots0;
+    if (prob0 < kMinBranchProbability)
+      shots0 = 0;
+    else if (prob0 > 1. - kMinBranchProbability)
+      shots0 = node.shots;
+    else
+      shots0 = std::binomial_distribution<size_t>(node.shots, prob0)(gen);
+
+    const size_t branchShots[2] = {shots0, node.shots - shots0};
+
+    for (int outcome = 0; outcome < 2; ++outcome) {
+      if (branchShots[outcome] == 0) continue;
+
+      MPSSamplingNode child;
+      child.prefix = node.prefix;
+      child.prefix.push_back(outcome == 1);
+      child.shots = branchShots[outcome];
+
+      if (!last) {
+        // the original state goes to the last branch that needs it
+        if (outcome == 0 && branchShots[1] != 0)
+          child.sim = node.sim->Clone();
+        else
+          child.sim = std::move(node.sim);
+
+        CollapseMPSQubit(*child.sim, qubit, order[level + 1], outcome == 1,
+                         probs[outcome]);
+      }
+
+      children.emplace_back(std::move(child));
+    }
+  }
+
+  /**
+   * @brief Projects a qubit of the mps on a measurement outcome.
+   *
+   * The qubits before it in the chain are already collapsed, so the projector
+   * normalized with the outcome probability, applied together with the
+   * identity on the next qubit in the chain, leaves the mps normalized and in
+   * canonical form: the two qubit update recomputes the bond between them, the
+   * rest of the chain on the right is not changed.
+   *
+   * @param sim The mps simulator.
+   * @param qubit The qubit to project.
+   * @param nextQubit The next qubit in the chain.
+   * @param outcome The outcome to project on.
+   * @param prob The probability of the outcome.
+   */
+  static void CollapseMPSQubit(QC::TensorNetworks::MPSSimulator &sim,
+                               Eigen::Index qubit, Eigen::Index nextQubit,
+                               bool outcome, double prob) {
+    // the first qubit of the gate is the low bit of the matrix index
+    const double norm = 1. / std::sqrt(prob);
+    Eigen::MatrixXcd projector = Eigen::MatrixXcd::Zero(4, 4);
+    for (int i = 0; i < 4; ++i)
+      if (((i & 1) == 1) == outcome) projector(i, i) = norm;
+
+    const QC::Gates::AppliedGate<> gate(
+        projector, static_cast<Types::qubit_t>(qubit),
+        static_cast<Types::qubit_t>(nextQubit));
+    sim.ApplyGate(gate);
+  }
+
+  /**
+   * @brief Sets the contractor of the tensor network.
+   *
+   * The forest contractor is used by default. With a memory limit configured
+   * (in bytes), the partition contractor is used instead, it slices the
+   * contractions that do not fit in the limit.
+   */
+  void SetTensorNetworkContractor() {
+    const long long int memoryLimit =
+        configuration.GetConfigurationAsInt("tensor_network_memory_limit");
+
+    if (memoryLimit > 0) {
+      const auto tensorContractor =
+          std::make_shared<TensorNetworks::PartitionContractor>();
+      tensorContractor->SetMemoryLimit(static_cast<size_t>(memoryLimit));
+      tensorNetwork->SetContractor(tensorContractor);
+    } else
+      tensorNetwork->SetContractor(
+          std::make_shared<TensorNetworks::ForestContractor>());
+  }
+
+ public:
   const std::unordered_map<std::string, std::string>& GetConfigMap()
       const override {
     return configuration.GetConfigMap();
@@ -1686,8 +2407,10 @@ class QCSimState : public ISimulator {
   std::unique_ptr<QC::QubitRegister<>> state; /**< The qcsim state. */
   std::unique_ptr<QC::TensorNetworks::MPSSimulator>
       mpsSimulator; /**< The qcsim mps simulator. */
-  std::unique_ptr<QC::Clifford::StabilizerSimulator>
-      cliffordSimulator; /**< The qcsim clifford simulator. */
+  std::unique_ptr<StabilizerTableau>
+      cliffordSimulator; /**< The bit-packed stabilizer tableau. */
+  std::unique_ptr<ExtendedStabilizer>
+      extendedStabilizer; /**< The sum of stabilizer states. */
   std::unique_ptr<TensorNetworks::TensorNetwork>
       tensorNetwork;                        /**< The qcsim tensor network. */
   std::unique_ptr<QcsimPauliPropagator> pp; /**< The qcsim pauli propagator. */
@@ -1700,6 +2423,7 @@ class QCSimState : public ISimulator {
 
   int lookaheadDepth = 0;
   int lookaheadDepthWithHeuristic = 0;
+  bool lookaheadAutoTune = false;
   bool useOptimalMeetingPosition = true;
   std::vector<std::shared_ptr<Circuits::IOperation<>>> upcomingGates;
   long long int upcomingGateIndex = 0;
@@ -1709,6 +2433,9 @@ class QCSimState : public ISimulator {
   std::unique_ptr<Simulators::MPSDummySimulator> dummySim;
 
   size_t curMaxBondDim = 0;
+  std::vector<double> truncationErrors; /**< The error bounds of the last
+                                           pauli propagator expectation
+                                           values. */
   QC::TensorNetworks::MPSSimulator::MeetingPositionCallback meetingPositionCallback = nullptr;
   QC::TensorNetworks::MPSSimulator::BondDimensionCallback bondDimensionCallback = nullptr;
 
@@ -1724,6 +2451,117 @@ class QCSimState : public ISimulator {
   };
   std::shared_ptr<GateCounterObserver> gateCounterObserver;
 
+  // a two qubits gate deferred in an open layer, with the position in the
+  // upcoming gates it had when it was deferred
+  struct PendingMPSGate {
+    Eigen::Matrix4cd matrix;
+    Types::qubit_t qubit;
+    Types::qubit_t controllingQubit;
+    long long int gateIndex;
+  };
+  bool mpsLayerOpen = false;
+  std::vector<PendingMPSGate> pendingMPSGates;
+
+  // below this bond dimension a layer is applied gate by gate, copying the
+  // tensors out of the mps simulator and back costs more than the parallel
+  // updates save
+  static constexpr size_t kMinParallelLayerBondDim = 32;
+
+  /**
+   * @brief Applies a two qubits gate on the mps, or defers it in an open
+   * layer.
+   *
+   * @param gate The gate.
+   * @param qubit The qubit that is the least significant in the gate matrix.
+   * @param controllingQubit The other qubit.
+   * @sa QCSimState::BeginLayer
+   */
+  template <class Gate>
+  void ApplyMPSTwoQubitsGate(const Gate &gate, Types::qubit_t qubit,
+                             Types::qubit_t controllingQubit) {
+    if (mpsLayerOpen) {
+      pendingMPSGates.push_back({gate.getRawOperatorMatrix(), qubit,
+                                 controllingQubit, upcomingGateIndex});
+      return;
+    }
+
+    mpsSimulator->ApplyGate(gate, static_cast<unsigned int>(qubit),
+                            static_cast<unsigned int>(controllingQubit));
+  }
+
+  /**
+   * @brief Applies the two qubits gates deferred in the open layer.
+   *
+   * The gates on qubits that are neighbours in the chain act on disjoint bonds
+   * and are applied in parallel on the tensors of the mps, the others are
+   * applied by the mps simulator, which swaps their qubits together first.
+   */
+  void FlushMPSLayer() {
+    if (pendingMPSGates.empty()) return;
+
+    std::vector<PendingMPSGate> gates;
+    gates.swap(pendingMPSGates);
+
+    std::vector<bool> applied(gates.size(), false);
+
+    const int nrThreads =
+        enableMultithreading
+            ? static_cast<int>(
+                  QC::QubitRegisterCalculator<>::GetNumberOfThreads())
+            : 1;
+
+    if (gates.size() > 1 && nrThreads > 1 &&
+        curMaxBondDim >= kMinParallelLayerBondDim) {
+      auto mpsState = mpsSimulator->getState();
+
+      std::vector<MPSLayerUpdate::BondGate> bondGates;
+      std::vector<size_t> bondGatesIndices;
+      for (size_t i = 0; i < gates.size(); ++i) {
+        const auto pos =
+            static_cast<size_t>(mpsState.qubitsMap[gates[i].qubit]);
+        const auto ctrlPos =
+            static_cast<size_t>(mpsState.qubitsMap[gates[i].controllingQubit]);
+        if (pos + 1 != ctrlPos && ctrlPos + 1 != pos) continue;
+
+        // the qubit is the least significant in the gate matrix
+        bondGates.push_back(
+            {gates[i].matrix, std::min(pos, ctrlPos), ctrlPos < pos});
+        bondGatesIndices.push_back(i);
+      }
+
+      if (bondGates.size() > 1) {
+        const long long int maxBondDim = configuration.GetConfigurationAsInt(
+            "matrix_product_state_max_bond_dimension");
+        const double cutoff = configuration.GetConfigurationAsDouble(
+            "matrix_product_state_truncation_threshold");
+
+        MPSLayerUpdate::Apply(
+            mpsState.gammas, mpsState.lambdas, bondGates,
+            maxBondDim > 0 ? static_cast<size_t>(maxBondDim) : 0, cutoff,
+            nrThreads);
+        mpsSimulator->setState(mpsState);
+
+        for (const auto i : bondGatesIndices) applied[i] = true;
+        for (const auto &lambda : mpsState.lambdas)
+          curMaxBondDim =
+              std::max(curMaxBondDim, static_cast<size_t>(lambda.size()));
+      }
+    }
+
+    // the meeting position of a remaining gate is chosen by the lookahead from
+    // the place the gate has in the upcoming gates
+    const long long int gateIndex = upcomingGateIndex;
+    for (size_t i = 0; i < gates.size(); ++i) {
+      if (applied[i]) continue;
+
+      upcomingGateIndex = gates[i].gateIndex;
+      const QC::Gates::AppliedGate<> agate(gates[i].matrix, gates[i].qubit,
+                                           gates[i].controllingQubit);
+      mpsSimulator->ApplyGate(agate);
+    }
+    upcomingGateIndex = gateIndex;
+  }
+
   std::mt19937_64 rng;
   std::uniform_real_distribution<double> uniformZeroOne;
 
@@ -7,6 +7,11 @@
  * The qcsim pauli propagator class.
  *
  * The main role is to extend the qcsim pauli propagator with more gates.
+ *
+ * The gates are also recorded, decomposed into the operations known by the
+ * in-tree Pauli sum propagator, which is used to obtain the expectation values
+ * of many observables in a single backward pass and to sample the measurement
+ * outcomes from the conditional marginal probabilities.
  */
 
 #pragma once
@@ -14,13 +19,244 @@
 #ifndef _QCSIM_PAULI_PROPAGATOR_H
 #define _QCSIM_PAULI_PROPAGATOR_H 1
 
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "PauliPropagator.h"
+#include "PauliSumPropagator.h"
 #include "../Circuit/Circuit.h"
 
 namespace Simulators {
 
 class QcsimPauliPropagator : public QC::PauliPropagator {
  public:
+  using RecordedOperation = PauliSumPropagator::Operation;
+  using RecordedOperationType = PauliSumPropagator::OperationType;
+
+  // the gates implemented by the qcsim propagator, recorded as they are
+  // applied
+
+  void ApplyX(int qubit) {
+    QC::PauliPropagator::ApplyX(qubit);
+    Record(RecordedOperationType::kX, qubit);
+  }
+
+  void ApplyY(int qubit) {
+    QC::PauliPropagator::ApplyY(qubit);
+    Record(RecordedOperationType::kY, qubit);
+  }
+
+  void ApplyZ(int qubit) {
+    QC::PauliPropagator::ApplyZ(qubit);
+    Record(RecordedOperationType::kZ, qubit);
+  }
+
+  void ApplyH(int qubit) {
+    QC::PauliPropagator::ApplyH(qubit);
+    Record(RecordedOperationType::kH, qubit);
+  }
+
+  void ApplyS(int qubit) {
+    QC::PauliPropagator::ApplyS(qubit);
+    Record(RecordedOperationType::kS, qubit);
+  }
+
+  void ApplySDG(int qubit) {
+    QC::PauliPropagator::ApplySDG(qubit);
+    Record(RecordedOperationType::kSdg, qubit);
+  }
+
+  void ApplySX(int qubit) {
+    QC::PauliPropagator::ApplySX(qubit);
+    Record(RecordedOperationType::kH, qubit);
+    Record(RecordedOperationType::kS, qubit);
+    Record(RecordedOperationType::kH, qubit);
+  }
+
+  void ApplySXDG(int qubit) {
+    QC::PauliPropagator::ApplySXDG(qubit);
+    Record(RecordedOperationType::kH, qubit);
+    Record(RecordedOperationType::kSdg, qubit);
+    Record(RecordedOperationType::kH, qubit);
+  }
+
+  void ApplyK(int qubit) {
+    QC::PauliPropagator::ApplyK(qubit);
+    Record(RecordedOperationType::kK, qubit);
+  }
+
+  void ApplyRX(int qubit, double angle) {
+    QC::PauliPropagator::ApplyRX(qubit, angle);
+    Record(RecordedOperationType::kRX, qubit, 0, angle);
+  }
+
+  void ApplyRY(int qubit, double angle) {
+    QC::PauliPropagator::ApplyRY(qubit, angle);
+    Record(RecordedOperationType::kRY, qubit, 0, angle);
+  }
+
+  void ApplyRZ(int qubit, double angle) {
+    QC::PauliPropagator::ApplyRZ(qubit, angle);
+    Record(RecordedOperationType::kRZ, qubit, 0, angle);
+  }
+
+  void ApplyCX(int controlQubit, int targetQubit) {
+    QC::PauliPropagator::ApplyCX(controlQubit, targetQubit);
+    Record(RecordedOperationType::kCX, controlQubit, targetQubit);
+  }
+
+  void ApplyCY(int controlQubit, int targetQubit) {
+    QC::PauliPropagator::ApplyCY(controlQubit, targetQubit);
+    Record(RecordedOperationType::kSdg, targetQubit);
+    Record(RecordedOperationType::kCX, controlQubit, targetQubit);
+    Record(RecordedOperationType::kS, targetQubit);
+  }
+
+  void ApplyCZ(int controlQubit, int targetQubit) {
+    QC::PauliPropagator::ApplyCZ(controlQubit, targetQubit);
+    Record(RecordedOperationType::kCZ, controlQubit, targetQubit);
+  }
+
+  void ApplySWAP(int qubit1, int qubit2) {
+    QC::PauliPropagator::ApplySWAP(qubit1, qubit2);
+    Record(RecordedOperationType::kSwap, qubit1, qubit2);
+  }
+
+  // the measurements add projectors the Pauli sum propagator doesn't know
+  // about
+  auto Measure(const std::vector<int> &qubits) {
+    recordedOnlyGates = false;
+    return QC::PauliPropagator::Measure(qubits);
+  }
+
+  void ClearOperations() {
+    QC::PauliPropagator::ClearOperations();
+    recordedOperations.clear();
+    recordedOnlyGates = true;
+  }
+
+  void SaveState() {
+    QC::PauliPropagator::SaveState();
+    savedOperations = recordedOperations;
+    savedOnlyGates = recordedOnlyGates;
+  }
+
+  void RestoreState() {
+    QC::PauliPropagator::RestoreState();
+    recordedOperations = savedOperations;
+    recordedOnlyGates = savedOnlyGates;
+  }
+
+  /**
+   * @brief Sets the path frequency threshold of the truncation passes.
+   *
+   * The terms that took the sine branch of more rotations than the threshold
+   * are dropped. Only used by ExpectationValues, for circuits without
+   * measurements.
+   *
+   * @param threshold The path frequency threshold.
+   */
+  void SetMaxPathFrequency(size_t threshold) { maxPathFrequency = threshold; }
+
+  size_t GetMaxPathFrequency() const { return maxPathFrequency; }
+
+  /**
+   * @brief Sets the truncation error budget of each Pauli string.
+   *
+   * The truncation passes stop dropping the terms of a Pauli string once its
+   * error bound would exceed the budget. Only used by ExpectationValues, for
+   * circuits without measurements.
+   *
+   * @param budget The error budget, zero or negative for no budget.
+   */
+  void SetTruncationErrorBudget(double budget) { errorBudget = budget; }
+
+  double GetTruncationErrorBudget() const { return errorBudget; }
+
+  /**
+   * @brief Returns the expectation values of many Pauli strings.
+   *
+   * The strings are propagated together, as a single Pauli sum with the terms
+   * tagged by the string they come from, in one backward pass over the
+   * circuit, using the same truncation settings, and the truncation error
+   * bounds are kept. If the circuit has measurements, each string is
+   * propagated separately, with no error bounds.
+   *
+   * @param pauliStrings The Pauli strings.
+   * @return The expectation values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) {
+    truncationErrors.clear();
+
+    if (!recordedOnlyGates) {
+      std::vector<double> result(pauliStrings.size());
+      for (size_t i = 0; i < pauliStrings.size(); ++i)
+        result[i] = ExpectationValue(pauliStrings[i]);
+
+      return result;
+    }
+
+    PauliSumPropagator propagator = CreatePropagator();
+    auto result = propagator.ExpectationValues(recordedOperations, pauliStrings);
+    truncationErrors = propagator.GetTruncationErrors();
+
+    return result;
+  }
+
+  /**
+   * @brief Samples the outcomes of measuring the qubits.
+   *
+   * For circuits without measurements the qubits are sampled one by one from
+   * their conditional marginal probabilities, with the shots sharing a prefix
+   * of outcomes grouped together, see PauliSumPropagator::SampleCounts.
+   * Otherwise each shot is sampled separately.
+   *
+   * The state is not changed.
+   *
+   * @param qubits The qubits to be sampled.
+   * @param shots The number of shots.
+   * @return A map with the counts for the outcomes, the outcome for the i-th
+   * qubit in qubits being at the position i.
+   */
+  std::unordered_map<std::vector<bool>, size_t> SampleCounts(
+      const std::vector<int> &qubits, size_t shots) {
+    if (!recordedOnlyGates) {
+      std::unordered_map<std::vector<bool>, size_t> result;
+      for (size_t shot = 0; shot < shots; ++shot) ++result[Sample(qubits)];
+
+      return result;
+    }
+
+    PauliSumPropagator propagator = CreatePropagator();
+    const std::vector<size_t> sampledQubits(qubits.begin(), qubits.end());
+
+    return propagator.SampleCounts(recordedOperations, sampledQubits, shots,
+                                   rng);
+  }
+
+  /**
+   * @brief Checks if ExpectationValues gives error bounds for the circuit.
+   *
+   * @return False if the circuit has measurements, the strings are then
+   * propagated separately.
+   */
+  bool HasTruncationErrors() const { return recordedOnlyGates; }
+
+  /**
+   * @brief Returns the truncation error bounds of the last ExpectationValues
+   * call.
+   *
+   * @return The bounds of the errors of the expectation values, in the order
+   * of the Pauli strings.
+   */
+  const std::vector<double> &GetTruncationErrors() const {
+    return truncationErrors;
+  }
+
   void ApplyP(int qubit, double lambda) { ApplyRZ(qubit, lambda); }
 
   void ApplyT(int qubit) { ApplyRZ(qubit, M_PI_4); }
@@ -174,13 +410,45 @@ class QcsimPauliPropagator : public QC::PauliPropagator {
     clone->SetSavePosition(GetSavePosition());
     if (IsParallelEnabled()) clone->EnableParallel();
 
+    clone->maxPathFrequency = maxPathFrequency;
+    clone->errorBudget = errorBudget;
+    clone->recordedOperations = recordedOperations;
+    clone->savedOperations = savedOperations;
+    clone->recordedOnlyGates = recordedOnlyGates;
+    clone->savedOnlyGates = savedOnlyGates;
+
     return clone;
   }
 
   static double GetSamplingCost(
       const std::shared_ptr<Circuits::Circuit<>>& circuit,
       size_t nrQubitsSampled, size_t samples) {
-    return samples * GetCost(circuit) * exp2(nrQubitsSampled - 1);
+    if (!circuit || nrQubitsSampled == 0) return 0.;
+
+    const double cost = GetCost(circuit);
+
+    // mid-circuit measurements and resets are sampled shot by shot
+    size_t nrBranchingGates = 0;
+    for (const auto& op : circuit->GetOperations()) {
+      if (op->GetType() != Circuits::OperationType::kGate)
+        return samples * cost * exp2(nrQubitsSampled - 1);
+      if (IsBranchingGate(op)) ++nrBranchingGates;
+    }
+
+    // the outcomes are sampled qubit by qubit from marginals shared by all
+    // shots, each level propagates the Z products over the random qubits once
+    // and combines them for each distinct prefix of outcomes; a qubit can be
+    // random only if some gate puts it in superposition
+    const size_t randomQubits = std::min(nrQubitsSampled, nrBranchingGates);
+    double samplingCost = 0.;
+    for (size_t k = 0; k < nrQubitsSampled; ++k) {
+      const double prefixes =
+          std::min(static_cast<double>(samples), exp2(static_cast<double>(k)));
+      samplingCost += (cost + prefixes) *
+                      exp2(static_cast<double>(std::min(k, randomQubits)));
+    }
+
+    return samplingCost;
   }
 
   static double GetCost(const std::shared_ptr<Circuits::Circuit<>>& circuit) {
@@ -205,6 +473,42 @@ class QcsimPauliPropagator : public QC::PauliPropagator {
   }
 
  private:
+  // the in-tree propagator, with the same settings
+  PauliSumPropagator CreatePropagator() {
+    PauliSumPropagator propagator(static_cast<size_t>(GetNrQubits()));
+    propagator.SetMultithreading(IsParallelEnabled());
+    const auto parallelThreshold = GetParallelThreshold();
+    propagator.SetParallelThreshold(
+        parallelThreshold > 0 ? static_cast<size_t>(parallelThreshold) : 0);
+    propagator.SetCoefficientThreshold(GetCoefficientThreshold());
+    propagator.SetPauliWeightThreshold(
+        static_cast<size_t>(GetPauliWeightThreshold()));
+    propagator.SetStepsBetweenTrims(static_cast<int>(StepsBetweenTrims()));
+    propagator.SetStepsBetweenDeduplication(
+        static_cast<int>(StepsBetweenDeduplication()));
+    propagator.SetMaxPathFrequency(maxPathFrequency);
+    propagator.SetTruncationErrorBudget(errorBudget);
+
+    return propagator;
+  }
+
+  void Record(RecordedOperationType type, int qubit1, int qubit2 = 0,
+              double angle = 0.) {
+    recordedOperations.push_back({type, qubit1, qubit2, angle});
+  }
+
+  std::vector<RecordedOperation>
+      recordedOperations; /**< The gates, for the Pauli sum propagator. */
+  std::vector<RecordedOperation> savedOperations;
+  bool recordedOnlyGates = true;
+  bool savedOnlyGates = true;
+
+  size_t maxPathFrequency = static_cast<size_t>(-1);
+  double errorBudget = 0.;
+  std::vector<double> truncationErrors;
+
+  std::mt19937_64 rng{std::random_device{}()};
+
   static double GetOpCost(const std::shared_ptr<Circuits::Circuit<>>& circuit,
                           const std::shared_ptr<Circuits::IOperation<>>& op,
                           int pos) {
@@ -321,6 +625,50 @@ class QcsimPauliPropagator : public QC::PauliPropagator {
     return 1.;
   }
 
+  // gates that can take a computational basis state into a superposition
+  static bool IsBranchingGate(
+      const std::shared_ptr<Circuits::IOperation<>>& op) {
+    const auto gate = std::static_pointer_cast<Circuits::IQuantumGate<>>(op);
+    switch (gate->GetGateType()) {
+      case Circuits::QuantumGateType::kPhaseGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kXGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kYGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kZGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kSGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kSdgGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kTGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kTdgGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kRzGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kSwapGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCXGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCYGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCZGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCPGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCRzGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCSwapGateType:
+        [[fallthrough]];
+      case Circuits::QuantumGateType::kCCXGateType:
+        return false;
+      default:
+        return true;
+    }
+  }
+
   static double GetOpMultiplication(
       const std::shared_ptr<Circuits::IOperation<>>& op) {
     if (!op) return 1.;
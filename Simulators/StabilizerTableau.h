@@ -0,0 +1,728 @@
+/**
+ * @file StabilizerTableau.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The bit-packed stabilizer tableau simulator.
+ *
+ * Aaronson-Gottesman tableau stored by columns: for each qubit, the X and Z
+ * bits of all the destabilizers and stabilizers are packed in 64 bit words,
+ * so a gate is applied with a few word operations for 64 generators at a time
+ * (O(n/64) per gate).
+ * The generator products needed by the measurements are done for all the
+ * affected rows at once, with the phases accumulated in bit-sliced counters,
+ * so a measurement is O(n^2/64).
+ *
+ * It has the same interface as the qcsim stabilizer simulator (including the
+ * target, control order of the arguments for the two qubit gates), to be used
+ * in its place.
+ */
+
+#pragma once
+
+#ifndef _STABILIZER_TABLEAU_H_
+#define _STABILIZER_TABLEAU_H_
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Simulators {
+
+class ExtendedStabilizer;
+
+class StabilizerTableau {
+ public:
+  using Word = uint64_t;
+
+  explicit StabilizerTableau(size_t nrQubits)
+      : nrQubits(nrQubits),
+        halfWords((nrQubits + 63) / 64),
+        nrWords(2 * halfWords) {
+    rng.seed(GetRandomSeed());
+
+    Reset();
+  }
+
+  // the clone draws its own measurement outcomes, not the same ones
+  std::unique_ptr<StabilizerTableau> Clone() const {
+    auto clone = std::make_unique<StabilizerTableau>(*this);
+    clone->rng.seed(GetRandomSeed());
+
+    return clone;
+  }
+
+  size_t GetNumberOfQubits() const { return nrQubits; }
+
+  /**
+   * @brief Resets the state to |0...0>.
+   *
+   * The destabilizers are X on each qubit, the stabilizers Z on each qubit.
+   */
+  void Reset() {
+    x.assign(nrQubits * nrWords, 0);
+    z.assign(nrQubits * nrWords, 0);
+    r.assign(nrWords, 0);
+
+    for (size_t q = 0; q < nrQubits; ++q) {
+      SetBit(X(q), q);
+      SetBit(Z(q), StabilizerRow(q));
+    }
+  }
+
+  void SetMultithreading(bool multithreading = true) {
+    enableMultithreading = multithreading;
+  }
+
+  void SaveState() {
+    savedX = x;
+    savedZ = z;
+    savedR = r;
+  }
+
+  void RestoreState() {
+    if (savedR.empty()) return;
+
+    x = savedX;
+    z = savedZ;
+    r = savedR;
+  }
+
+  void ClearSavedState() {
+    savedX.clear();
+    savedZ.clear();
+    savedR.clear();
+  }
+
+  void ApplyX(unsigned int qubit) {
+    const Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) r[w] ^= zq[w];
+  }
+
+  void ApplyY(unsigned int qubit) {
+    const Word *xq = X(qubit);
+    const Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) r[w] ^= xq[w] ^ zq[w];
+  }
+
+  void ApplyZ(unsigned int qubit) {
+    const Word *xq = X(qubit);
+    for (size_t w = 0; w < nrWords; ++w) r[w] ^= xq[w];
+  }
+
+  void ApplyH(unsigned int qubit) {
+    Word *xq = X(qubit);
+    Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xq[w] & zq[w];
+      std::swap(xq[w], zq[w]);
+    }
+  }
+
+  void ApplyS(unsigned int qubit) {
+    const Word *xq = X(qubit);
+    Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xq[w] & zq[w];
+      zq[w] ^= xq[w];
+    }
+  }
+
+  void ApplySdg(unsigned int qubit) {
+    const Word *xq = X(qubit);
+    Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xq[w] & ~zq[w];
+      zq[w] ^= xq[w];
+    }
+  }
+
+  void ApplySx(unsigned int qubit) {
+    Word *xq = X(qubit);
+    const Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= zq[w] & ~xq[w];
+      xq[w] ^= zq[w];
+    }
+  }
+
+  void ApplySxDag(unsigned int qubit) {
+    Word *xq = X(qubit);
+    const Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xq[w] & zq[w];
+      xq[w] ^= zq[w];
+    }
+  }
+
+  // K = (Y + Z) / sqrt(2): X -> -X, Y <-> Z
+  void ApplyK(unsigned int qubit) {
+    Word *xq = X(qubit);
+    const Word *zq = Z(qubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xq[w] & ~zq[w];
+      xq[w] ^= zq[w];
+    }
+  }
+
+  void ApplyCX(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    const Word *xc = X(ctrlQubit);
+    Word *zc = Z(ctrlQubit);
+    Word *xt = X(tgtQubit);
+    const Word *zt = Z(tgtQubit);
+    for (size_t w = 0; w < nrWords; ++w) {
+      r[w] ^= xc[w] & zt[w] & ~(xt[w] ^ zc[w]);
+      xt[w] ^= xc[w];
+      zc[w] ^= zt[w];
+    }
+  }
+
+  void ApplyCY(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    ApplySdg(tgtQubit);
+    ApplyCX(tgtQubit, ctrlQubit);
+    ApplyS(tgtQubit);
+  }
+
+  void ApplyCZ(unsigned int tgtQubit, unsigned int ctrlQubit) {
+    ApplyH(tgtQubit);
+    ApplyCX(tgtQubit, ctrlQubit);
+    ApplyH(tgtQubit);
+  }
+
+  void ApplySwap(unsigned int qubit1, unsigned int qubit0) {
+    if (qubit0 == qubit1) return;
+
+    std::swap_ranges(X(qubit0), X(qubit0) + nrWords, X(qubit1));
+    std::swap_ranges(Z(qubit0), Z(qubit0) + nrWords, Z(qubit1));
+  }
+
+  /**
+   * @brief Measures the qubit in the computational basis.
+   *
+   * @param qubit The qubit to measure.
+   * @return The outcome, the state is collapsed accordingly.
+   */
+  bool MeasureQubit(unsigned int qubit) {
+    const size_t p = FindAnticommutingStabilizer(qubit);
+    if (p == kNoRow) return DeterministicOutcome(qubit);
+
+    const bool outcome = (rng() & 1) != 0;
+    Collapse(qubit, p, outcome);
+
+    return outcome;
+  }
+
+  /**
+   * @brief Returns the probability of a basis state.
+   *
+   * The qubits are measured in order on a copy of the tableau, choosing the
+   * outcomes of the basis state: each random measurement halves the
+   * probability, a deterministic one different from the basis state gives
+   * zero.
+   * @param outcome The basis state.
+   * @return The probability.
+   */
+  double getBasisStateProbability(size_t outcome) const {
+    StabilizerTableau tableau(*this, CopyOnlyTag{});
+
+    double prob = 1.;
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const bool bit = q < 64 && ((outcome >> q) & 1);
+      const size_t p = tableau.FindAnticommutingStabilizer(q);
+      if (p == kNoRow) {
+        if (tableau.DeterministicOutcome(q) != bit) return 0.;
+      } else {
+        prob *= 0.5;
+        tableau.Collapse(q, p, bit);
+      }
+    }
+
+    return prob;
+  }
+
+  std::vector<double> AllProbabilities() const {
+    std::vector<double> probs(1ULL << nrQubits, 0.);
+
+    StabilizerTableau tableau(*this, CopyOnlyTag{});
+    tableau.FillProbabilities(0, 0, 1., probs);
+
+    return probs;
+  }
+
+  /**
+   * @brief Returns the expectation value of a Pauli string.
+   *
+   * The character at position i is the Pauli operator on qubit i (I, X, Y or
+   * Z), missing ones are identity. The value is 0 if the string anticommutes
+   * with a stabilizer, otherwise it is (up to the sign) an element of the
+   * stabilizer group and the value is the sign.
+   * @param pauliString The Pauli string.
+   * @return The expectation value, 0, 1 or -1.
+   */
+  double ExpectationValue(const std::string &pauliString) const {
+    std::vector<Word> anticommuting(nrWords);
+    size_t nrY = 0;
+
+    if (!SymplecticProducts(pauliString, anticommuting.data(), nrY)) return 0.;
+
+    // the string is the product of the stabilizers paired with the
+    // destabilizers it anticommutes with
+    const unsigned int phase = ProductPhase(anticommuting.data());
+
+    return ((phase + 4 - nrY % 4) % 4) == 0 ? 1. : -1.;
+  }
+
+  /**
+   * @brief Returns the expectation values of many Pauli strings.
+   *
+   * Gives the same values as ExpectationValue for each string, but shares the
+   * work between them: the strings that anticommute with a stabilizer are
+   * dropped after the symplectic products, the phases of the others are
+   * computed in a single pass over the tableau columns, for blocks of strings
+   * at once (the blocks in parallel for large batches).
+   * No elimination is needed for any of them, the destabilizers give
+   * directly the stabilizers whose product is the string.
+   * @param pauliStrings The Pauli strings.
+   * @return The expectation values, in the order of the strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) const {
+    std::vector<double> result(pauliStrings.size(), 0.);
+
+    // the strings commuting with all the stabilizers, with their destabilizer
+    // selections packed contiguously
+    std::vector<size_t> commuting;
+    std::vector<SelectionWord> selections;
+    std::vector<size_t> offsets(1, 0);
+    std::vector<unsigned int> phases;
+
+    std::vector<Word> anticommuting(nrWords);
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      size_t nrY = 0;
+      if (!SymplecticProducts(pauliStrings[i], anticommuting.data(), nrY))
+        continue;
+
+      commuting.push_back(i);
+      AppendSelection(anticommuting.data(), selections);
+      offsets.push_back(selections.size());
+      phases.push_back(static_cast<unsigned int>(4 - nrY % 4));
+    }
+
+    ProductPhases(selections, offsets, phases);
+
+    for (size_t k = 0; k < commuting.size(); ++k)
+      result[commuting[k]] = phases[k] % 4 == 0 ? 1. : -1.;
+
+    return result;
+  }
+
+ private:
+  // keeps a sum of stabilizer states on the same tableau
+  friend class ExtendedStabilizer;
+
+  struct CopyOnlyTag {};
+
+  static constexpr size_t kNoRow = static_cast<size_t>(-1);
+  static constexpr size_t kMinQubitsForMultithreading = 2048;
+  static constexpr size_t kChunkWords = 32;
+  static constexpr size_t kStringsBlock = 64;
+
+  // a nonzero word of a destabilizers selection
+  struct SelectionWord {
+    size_t index;
+    Word bits;
+  };
+
+  static uint64_t GetRandomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+  }
+
+  // copies only the tableau, not the saved state; the copies are projected on
+  // given outcomes only, they don't take the random generator
+  StabilizerTableau(const StabilizerTableau &other, CopyOnlyTag)
+      : nrQubits(other.nrQubits),
+        halfWords(other.halfWords),
+        nrWords(other.nrWords),
+        x(other.x),
+        z(other.z),
+        r(other.r),
+        enableMultithreading(other.enableMultithreading) {}
+
+  Word *X(size_t qubit) { return x.data() + qubit * nrWords; }
+  const Word *X(size_t qubit) const { return x.data() + qubit * nrWords; }
+  Word *Z(size_t qubit) { return z.data() + qubit * nrWords; }
+  const Word *Z(size_t qubit) const { return z.data() + qubit * nrWords; }
+
+  // the destabilizers are in the first half of the words, the stabilizers in
+  // the second, so the stabilizer paired with a destabilizer is at a fixed
+  // word offset
+  size_t StabilizerRow(size_t row) const { return row + halfWords * 64; }
+
+  static bool GetBit(const Word *bits, size_t row) {
+    return ((bits[row / 64] >> (row % 64)) & 1) != 0;
+  }
+
+  static void SetBit(Word *bits, size_t row) {
+    bits[row / 64] |= 1ULL << (row % 64);
+  }
+
+  static void ClearBit(Word *bits, size_t row) {
+    bits[row / 64] &= ~(1ULL << (row % 64));
+  }
+
+  static unsigned int Parity(Word w) {
+    return static_cast<unsigned int>(std::bitset<64>(w).count() & 1);
+  }
+
+  // bit k of the result is the parity of the bits 0..k
+  static Word PrefixParity(Word w) {
+    w ^= w << 1;
+    w ^= w << 2;
+    w ^= w << 4;
+    w ^= w << 8;
+    w ^= w << 16;
+    w ^= w << 32;
+    return w;
+  }
+
+  size_t FindAnticommutingStabilizer(size_t qubit) const {
+    const Word *xq = X(qubit);
+    for (size_t w = halfWords; w < nrWords; ++w)
+      if (xq[w]) {
+        size_t bit = 0;
+        while (((xq[w] >> bit) & 1) == 0) ++bit;
+        return w * 64 + bit;
+      }
+
+    return kNoRow;
+  }
+
+  /**
+   * @brief The phase of a product of stabilizers.
+   *
+   * Computes the phase of the product of the stabilizers paired with the
+   * selected destabilizers. Each qubit contributes independently: with Y = iXZ
+   * and ZX = -XZ, reordering the product on a qubit gives i for each Y and -1
+   * for each Z before an X.
+   * @param destabilizers The selection, as a destabilizers rows mask (only
+   * the first half of the words is used).
+   * @return The phase exponent of i, with Y in the product counted as iXZ.
+   */
+  unsigned int ProductPhase(const Word *destabilizers) const {
+    std::vector<SelectionWord> selection;
+    AppendSelection(destabilizers, selection);
+
+    const SelectionWord *sel = selection.data();
+    const size_t count = selection.size();
+
+    unsigned int phase = SignsPhase(sel, count);
+    for (size_t q = 0; q < nrQubits; ++q)
+      phase += QubitPhase(X(q) + halfWords, Z(q) + halfWords, sel, count);
+
+    return phase % 4;
+  }
+
+  /**
+   * @brief The phases of many products of stabilizers.
+   *
+   * ProductPhase for each selection, with the columns traversed once for a
+   * block of selections, so they are loaded once for all of them.
+   * @param selections The nonzero words of the selections, one after the
+   * other.
+   * @param offsets Where each selection starts in selections, with the end
+   * of the last one appended.
+   * @param phases The phase exponents to add the products phases to, one for
+   * each selection.
+   */
+  void ProductPhases(const std::vector<SelectionWord> &selections,
+                     const std::vector<size_t> &offsets,
+                     std::vector<unsigned int> &phases) const {
+    const long long int nrBlocks = static_cast<long long int>(
+        (phases.size() + kStringsBlock - 1) / kStringsBlock);
+
+    const int processor_count =
+        enableMultithreading && nrBlocks > 1 &&
+                phases.size() * nrQubits >= kMinQubitsForMultithreading * 64
+            ? std::max(1, static_cast<int>(std::thread::hardware_concurrency()))
+            : 1;
+
+#pragma omp parallel for num_threads(processor_count) schedule(dynamic)
+    for (long long int block = 0; block < nrBlocks; ++block) {
+      const size_t first = static_cast<size_t>(block) * kStringsBlock;
+      const size_t last = std::min(first + kStringsBlock, phases.size());
+
+      for (size_t s = first; s < last; ++s)
+        phases[s] += SignsPhase(selections.data() + offsets[s],
+                                offsets[s + 1] - offsets[s]);
+
+      for (size_t q = 0; q < nrQubits; ++q) {
+        const Word *xq = X(q) + halfWords;
+        const Word *zq = Z(q) + halfWords;
+
+        for (size_t s = first; s < last; ++s)
+          phases[s] += QubitPhase(xq, zq, selections.data() + offsets[s],
+                                  offsets[s + 1] - offsets[s]);
+      }
+    }
+  }
+
+  // appends the nonzero words of a destabilizers selection, the products
+  // usually involve few generators, so only those words are visited for
+  // each qubit
+  void AppendSelection(const Word *destabilizers,
+                       std::vector<SelectionWord> &selection) const {
+    for (size_t w = 0; w < halfWords; ++w)
+      if (destabilizers[w]) selection.push_back({w, destabilizers[w]});
+  }
+
+  // the phase from the signs of the selected stabilizers
+  unsigned int SignsPhase(const SelectionWord *selection, size_t count) const {
+    unsigned int phase = 0;
+    for (size_t i = 0; i < count; ++i)
+      phase += 2 * static_cast<unsigned int>(
+                       std::bitset<64>(r[halfWords + selection[i].index] &
+                                       selection[i].bits)
+                           .count());
+
+    return phase;
+  }
+
+  // the phase from reordering the Paulis of the selected stabilizers on a
+  // qubit, xq and zq are the stabilizers half of the qubit columns
+  static unsigned int QubitPhase(const Word *xq, const Word *zq,
+                                 const SelectionWord *selection,
+                                 size_t count) {
+    unsigned int phase = 0;
+    unsigned int zParity = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+      const Word sel = selection[i].bits;
+      const Word sx = xq[selection[i].index] & sel;
+      const Word sz = zq[selection[i].index] & sel;
+
+      phase += static_cast<unsigned int>(std::bitset<64>(sx & sz).count());
+
+      // the z parity before each x, within the word and from the previous
+      // words
+      const Word zBefore = (PrefixParity(sz) << 1) ^ (zParity ? ~0ULL : 0ULL);
+      phase += 2 * Parity(sx & zBefore);
+
+      zParity ^= Parity(sz);
+    }
+
+    return phase;
+  }
+
+  /**
+   * @brief The symplectic products of a Pauli string with the generators.
+   *
+   * @param pauliString The Pauli string, characters past the number of qubits
+   * are ignored.
+   * @param anticommuting Receives the mask of the generators the string
+   * anticommutes with, nrWords words.
+   * @param nrY Receives the number of Y operators in the string.
+   * @return True if the string commutes with all the stabilizers.
+   */
+  bool SymplecticProducts(const std::string &pauliString, Word *anticommuting,
+                          size_t &nrY) const {
+    std::fill(anticommuting, anticommuting + nrWords, 0);
+    nrY = 0;
+
+    const size_t len = std::min(pauliString.size(), nrQubits);
+    for (size_t q = 0; q < len; ++q) {
+      if (pauliString[q] == 'I' || pauliString[q] == 'i') continue;
+
+      const char op = static_cast<char>(toupper(pauliString[q]));
+      const bool px = op == 'X' || op == 'Y';
+      const bool pz = op == 'Z' || op == 'Y';
+      if (px && pz) ++nrY;
+
+      if (pz) {
+        const Word *xq = X(q);
+        for (size_t w = 0; w < nrWords; ++w) anticommuting[w] ^= xq[w];
+      }
+      if (px) {
+        const Word *zq = Z(q);
+        for (size_t w = 0; w < nrWords; ++w) anticommuting[w] ^= zq[w];
+      }
+    }
+
+    for (size_t w = halfWords; w < nrWords; ++w)
+      if (anticommuting[w]) return false;
+
+    return true;
+  }
+
+  bool DeterministicOutcome(size_t qubit) const {
+    // the result is the product of the stabilizers paired with the
+    // destabilizers that anticommute with Z on the qubit, it has no Y
+    return ProductPhase(X(qubit)) == 2;
+  }
+
+  /**
+   * @brief Collapses the state after a random measurement.
+   *
+   * All the generators anticommuting with Z on the qubit (except the
+   * stabilizer p) are multiplied by p, then p becomes the destabilizer and
+   * the stabilizer becomes +-Z on the qubit.
+   * @param qubit The measured qubit.
+   * @param p The row of the first stabilizer anticommuting with Z.
+   * @param outcome The measurement outcome.
+   */
+  void Collapse(size_t qubit, size_t p, bool outcome) {
+    std::vector<Word> rows(X(qubit), X(qubit) + nrWords);
+    ClearBit(rows.data(), p);
+
+    MultiplyRows(rows.data(), p);
+
+    // the destabilizer paired with p becomes the old p
+    const size_t d = p - halfWords * 64;
+    for (size_t q = 0; q < nrQubits; ++q) {
+      Word *xq = X(q);
+      Word *zq = Z(q);
+
+      if (GetBit(xq, p)) SetBit(xq, d); else ClearBit(xq, d);
+      if (GetBit(zq, p)) SetBit(zq, d); else ClearBit(zq, d);
+
+      ClearBit(xq, p);
+      ClearBit(zq, p);
+    }
+    if (GetBit(r.data(), p)) SetBit(r.data(), d); else ClearBit(r.data(), d);
+
+    SetBit(Z(qubit), p);
+    if (outcome) SetBit(r.data(), p); else ClearBit(r.data(), p);
+  }
+
+  /**
+   * @brief Multiplies the selected rows by the row p.
+   *
+   * The phase exponents (in powers of i) are accumulated in two bit planes,
+   * for all the rows in a word at once.
+   * @param rows The mask of the rows to multiply.
+   * @param p The row to multiply them with.
+   */
+  void MultiplyRows(const Word *rows, size_t p) {
+    const bool rp = GetBit(r.data(), p);
+
+    // the Pauli operators of p, only the qubits where it's not identity
+    std::vector<std::pair<size_t, int>> pauliP;
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const int pauli = (GetBit(X(q), p) ? 1 : 0) | (GetBit(Z(q), p) ? 2 : 0);
+      if (pauli) pauliP.emplace_back(q, pauli);
+    }
+
+    const int processor_count =
+        enableMultithreading && nrQubits >= kMinQubitsForMultithreading
+            ? std::max(1, static_cast<int>(std::thread::hardware_concurrency()))
+            : 1;
+
+    // the words are split in chunks, for each chunk the columns are traversed
+    // in order, to keep the memory accesses sequential
+    const long long int nrChunks =
+        static_cast<long long int>((nrWords + kChunkWords - 1) / kChunkWords);
+
+#pragma omp parallel for num_threads(processor_count) schedule(static)
+    for (long long int chunk = 0; chunk < nrChunks; ++chunk) {
+      const size_t first = static_cast<size_t>(chunk) * kChunkWords;
+      const size_t last = std::min(first + kChunkWords, nrWords);
+
+      bool empty = true;
+      for (size_t w = first; w < last; ++w)
+        if (rows[w]) empty = false;
+      if (empty) continue;
+
+      Word c0[kChunkWords] = {};
+      Word c1[kChunkWords] = {};
+
+      for (const auto &[q, pauli] : pauliP) {
+        Word *xq = X(q);
+        Word *zq = Z(q);
+
+        // the exponent of i from multiplying the Pauli of p with the row's
+        if (pauli == 1)  // X
+          for (size_t w = first; w < last; ++w) {
+            const Word plus = zq[w] & xq[w];
+            const Word minus = zq[w] & ~xq[w];
+            Accumulate(c0[w - first], c1[w - first], plus, minus);
+            xq[w] ^= rows[w];
+          }
+        else if (pauli == 2)  // Z
+          for (size_t w = first; w < last; ++w) {
+            const Word plus = xq[w] & ~zq[w];
+            const Word minus = xq[w] & zq[w];
+            Accumulate(c0[w - first], c1[w - first], plus, minus);
+            zq[w] ^= rows[w];
+          }
+        else  // Y
+          for (size_t w = first; w < last; ++w) {
+            const Word plus = zq[w] & ~xq[w];
+            const Word minus = xq[w] & ~zq[w];
+            Accumulate(c0[w - first], c1[w - first], plus, minus);
+            xq[w] ^= rows[w];
+            zq[w] ^= rows[w];
+          }
+      }
+
+      // the accumulated exponent is 0 or 2
+      for (size_t w = first; w < last; ++w)
+        r[w] ^= rows[w] & (c1[w - first] ^ (rp ? ~0ULL : 0ULL));
+    }
+  }
+
+  // adds plus and subtracts minus from the bit-sliced counters modulo 4
+  static void Accumulate(Word &c0, Word &c1, Word plus, Word minus) {
+    c1 ^= c0 & plus;
+    c0 ^= plus;
+    c1 ^= ~c0 & minus;
+    c0 ^= minus;
+  }
+
+  void FillProbabilities(size_t qubit, size_t state, double prob,
+                         std::vector<double> &probs) {
+    for (; qubit < nrQubits; ++qubit) {
+      const size_t p = FindAnticommutingStabilizer(qubit);
+      if (p == kNoRow) {
+        if (DeterministicOutcome(qubit)) state |= 1ULL << qubit;
+        continue;
+      }
+
+      prob *= 0.5;
+
+      StabilizerTableau other(*this, CopyOnlyTag{});
+      other.Collapse(qubit, p, true);
+      other.FillProbabilities(qubit + 1, state | (1ULL << qubit), prob, probs);
+
+      Collapse(qubit, p, false);
+    }
+
+    probs[state] = prob;
+  }
+
+  size_t nrQubits;
+  size_t halfWords;
+  size_t nrWords;
+
+  std::vector<Word> x; /**< The X bits, by qubit then by row */
+  std::vector<Word> z; /**< The Z bits, by qubit then by row */
+  std::vector<Word> r; /**< The signs, by row */
+
+  std::vector<Word> savedX;
+  std::vector<Word> savedZ;
+  std::vector<Word> savedR;
+
+  bool enableMultithreading = true;
+  std::mt19937_64 rng;
+};
+
+}  // namespace Simulators
+
+#endif  // !_STABILIZER_TABLEAU_H_
@@ -225,6 +225,16 @@ class IState {
    */
   virtual void SetLookaheadDepthWithHeuristic(int /*depth*/) {}
 
+  /**
+   * @brief Enables the runtime tuning of the lookahead depth.
+   *
+   * When enabled, the depth set with SetLookaheadDepth becomes an upper limit
+   * and the depth actually used is adapted from the measured time per swap
+   * decision, so that the lookahead stays a small fraction of the simulation
+   * time.  Only effective for MPS simulators.
+   */
+  virtual void SetLookaheadAutoTune(bool /*enable*/) {}
+
   /**
    * @brief Supplies upcoming gates for lookahead swap optimization.
    *
@@ -261,6 +271,25 @@ class IState {
    */
   virtual void IncrementGatesCounter() {}
 
+  /**
+   * @brief Starts a layer of gates acting on disjoint qubits.
+   *
+   * Usually does nothing, except for MPS simulators that can apply the two
+   * qubits gates of a layer on disjoint bonds in parallel. Until the layer is
+   * ended the two qubits gates can be deferred, so the state must not be
+   * queried in between.
+   * @sa IState::EndLayer
+   */
+  virtual void BeginLayer() {}
+
+  /**
+   * @brief Ends the layer of gates started with BeginLayer.
+   *
+   * Applies the deferred gates of the layer, if any.
+   * @sa IState::BeginLayer
+   */
+  virtual void EndLayer() {}
+
   // the following four functions are also for MPS swaps optimizations, might be removed in the future
 
   virtual double getGrowthFactorSwap() const { return 0.; }
@@ -368,6 +397,28 @@ class IState {
    */
   virtual std::complex<double> Amplitude(Types::qubit_t outcome) = 0;
 
+  /**
+   * @brief Returns the amplitudes of the specified states.
+   *
+   * Use it to obtain many amplitudes at once, for example for cross entropy
+   * benchmarking. The default implementation calls Amplitude for each
+   * outcome, the simulators that can share work between the outcomes override
+   * it.
+   *
+   * @param outcomes The outcomes to obtain the amplitudes for.
+   * @return The amplitudes, in the order of the outcomes.
+   * @sa IState::Amplitude
+   */
+  virtual std::vector<std::complex<double>> Amplitudes(
+      const std::vector<Types::qubit_t> &outcomes) {
+    std::vector<std::complex<double>> result(outcomes.size());
+
+    for (size_t i = 0; i < outcomes.size(); ++i)
+      result[i] = Amplitude(outcomes[i]);
+
+    return result;
+  }
+
   /**
    * @brief Projects the state onto the zero state.
    *
@@ -457,6 +508,27 @@ class IState {
    */
   virtual double ExpectationValue(const std::string &pauliString) = 0;
 
+  /**
+   * @brief Returns the expected values of many Pauli strings.
+   *
+   * Use it to obtain the expected values of all the terms of an observable at
+   * once. The default implementation calls ExpectationValue for each string,
+   * the simulators that can share work between the terms override it.
+   *
+   * @param pauliStrings The Pauli strings to obtain the expected values for.
+   * @return The expected values, in the order of the Pauli strings.
+   * @sa IState::ExpectationValue
+   */
+  virtual std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) {
+    std::vector<double> result(pauliStrings.size());
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i)
+      result[i] = ExpectationValue(pauliStrings[i]);
+
+    return result;
+  }
+
   /**
    * @brief Registers an observer.
    *
@@ -638,6 +710,16 @@ class IState {
    */
   virtual size_t GetCurrentMaxBondDimension() const { return 0; }
 
+  /**
+   * @brief Returns the truncation error bounds of the last expectation values.
+   *
+   * Returns, for each Pauli string of the last ExpectationValues call, a bound
+   * of the error the truncation introduced in its expectation value, if
+   * applicable (qcsim pauli propagator, for circuits without measurements).
+   * Empty if not available.
+   */
+  virtual std::vector<double> GetTruncationErrors() const { return {}; }
+
   virtual const std::unordered_map<std::string, std::string>& GetConfigMap() const = 0;
 
  protected:
@@ -19,6 +19,8 @@
 
 #include <random>
 
+#include <boost/container_hash/hash.hpp>
+
 namespace TensorNetworks {
 
 /**
@@ -30,6 +32,201 @@ class BaseContractor : public ITensorContractor {
  public:
   using TensorsMap = ITensorContractor::TensorsMap;
 
+  /**
+   * @brief Contract the tensor network.
+   *
+   * The contraction path found for a network structure is cached, together
+   * with the intermediate tensors. If a network with the same structure is
+   * contracted again (the same qubit probability in another shot, for example)
+   * the path search is skipped and only the intermediate tensors that depend on
+   * a changed tensor are recomputed, that is, the ones on the path from the
+   * changed leaves to the root. The cache is bounded both by the number of
+   * paths and by the memory held by their tensors.
+   *
+   * @param network The tensor network to contract.
+   * @param qubit The qubit whose group is contracted.
+   * @return The result of the contraction.
+   */
+  double Contract(const TensorNetwork &network, Types::qubit_t qubit) override {
+    if (maxCachedPaths == 0) return ContractNetwork(network, qubit);
+
+    auto key = GetStructureKey(network, qubit);
+    const auto it = pathsCache.find(key);
+    if (it != pathsCache.end()) return ReplayPath(network, qubit, it->second);
+
+    CachedPath path;
+    recordedPath = &path;
+    double result;
+    try {
+      result = ContractNetwork(network, qubit);
+    } catch (...) {
+      recordedPath = nullptr;
+      throw;
+    }
+    recordedPath = nullptr;
+
+    if (!path.cacheable) return result;
+
+    const auto &qubitGroup = network.GetQubitGroup(qubit);
+    for (const auto &tensor : network.GetTensors())
+      if (tensor && qubitGroup.find(tensor->qubits[0]) != qubitGroup.end())
+        path.leaves[tensor->GetId()] = tensor->tensor;
+
+    AddToCache(std::move(key), std::move(path));
+
+    return result;
+  }
+
+  /**
+   * @brief Contract the tensor network, finding the contraction path.
+   *
+   * Implemented by the derived contractors, called by Contract if there is no
+   * cached path for the network structure.
+   *
+   * @param network The tensor network to contract.
+   * @param qubit The qubit whose group is contracted.
+   * @return The result of the contraction.
+   */
+  virtual double ContractNetwork(const TensorNetwork &network,
+                                 Types::qubit_t qubit) = 0;
+
+  /**
+   * @brief Clear the cached contraction paths.
+   *
+   * Releases the cached paths, together with the intermediate tensors.
+   */
+  void ClearCache() override {
+    pathsCache.clear();
+    cachedBytes = 0;
+  }
+
+  /**
+   * @brief Save the cached contraction paths.
+   *
+   * The intermediate tensors and the leaves the paths were computed from are
+   * saved as well, so a loaded path is replayed recomputing only what depends
+   * on the tensors changed since.
+   *
+   * @param writer The writer for the tensors.
+   */
+  void SaveCache(TensorsWriter &writer) const override {
+    auto &binaryWriter = writer.GetWriter();
+
+    binaryWriter.WriteSize(pathsCache.size());
+    for (const auto &[key, path] : pathsCache) {
+      binaryWriter.WriteVector(key);
+
+      binaryWriter.WriteSize(path.steps.size());
+      for (const auto &step : path.steps) {
+        binaryWriter.Write(step.tensor1Id);
+        binaryWriter.Write(step.tensor2Id);
+        binaryWriter.Write(step.resultRank);
+        writer.Write(step.result);
+      }
+
+      binaryWriter.WriteSize(path.leaves.size());
+      for (const auto &[tensorId, tensor] : path.leaves) {
+        binaryWriter.Write(tensorId);
+        writer.Write(tensor);
+      }
+
+      binaryWriter.Write(path.resultId);
+    }
+  }
+
+  /**
+   * @brief Load the cached contraction paths.
+   *
+   * @param reader The reader for the tensors.
+   */
+  void LoadCache(TensorsReader &reader) override {
+    auto &binaryReader = reader.GetReader();
+
+    ClearCache();
+
+    const size_t nrPaths = binaryReader.ReadSize();
+    for (size_t p = 0; p < nrPaths; ++p) {
+      auto key = binaryReader.ReadVector<Eigen::Index>();
+
+      CachedPath path;
+      const size_t nrSteps = binaryReader.ReadSize();
+      for (size_t s = 0; s < nrSteps; ++s) {
+        ContractionStep step;
+        step.tensor1Id = binaryReader.Read<Eigen::Index>();
+        step.tensor2Id = binaryReader.Read<Eigen::Index>();
+        step.resultRank = binaryReader.Read<Eigen::Index>();
+        step.result = reader.Read();
+        if (!step.result)
+          throw std::runtime_error(
+              "Invalid contraction path in the binary data.");
+
+        path.steps.emplace_back(std::move(step));
+      }
+
+      const size_t nrLeaves = binaryReader.ReadSize();
+      for (size_t l = 0; l < nrLeaves; ++l) {
+        const auto tensorId = binaryReader.Read<Eigen::Index>();
+        path.leaves[tensorId] = reader.Read();
+      }
+
+      path.resultId = binaryReader.Read<Eigen::Index>();
+
+      const size_t pathBytes = GetPathBytes(path);
+      if (pathsCache.size() < maxCachedPaths &&
+          cachedBytes + pathBytes <= maxCachedBytes) {
+        cachedBytes += pathBytes;
+        pathsCache.emplace(std::move(key), std::move(path));
+      }
+    }
+  }
+
+  /**
+   * @brief Set the maximum number of cached contraction paths.
+   *
+   * Zero disables the caching. If the limit is reached, the cache is cleared.
+   *
+   * @param maxPaths The maximum number of cached paths.
+   */
+  void SetMaxCachedPaths(size_t maxPaths) {
+    maxCachedPaths = maxPaths;
+    if (pathsCache.size() > maxCachedPaths) ClearCache();
+  }
+
+  /**
+   * @brief Get the maximum number of cached contraction paths.
+   *
+   * @return The maximum number of cached paths.
+   */
+  size_t GetMaxCachedPaths() const { return maxCachedPaths; }
+
+  /**
+   * @brief Set the maximum memory held by the cached contraction paths.
+   *
+   * Counts the intermediate tensors and the leaves kept by the paths. A path
+   * that needs more than the limit is not cached, if the limit is reached the
+   * cache is cleared.
+   *
+   * @param maxBytes The maximum number of bytes.
+   */
+  void SetMaxCachedBytes(size_t maxBytes) {
+    maxCachedBytes = maxBytes;
+    if (cachedBytes > maxCachedBytes) ClearCache();
+  }
+
+  /**
+   * @brief Get the maximum memory held by the cached contraction paths.
+   *
+   * @return The maximum number of bytes.
+   */
+  size_t GetMaxCachedBytes() const { return maxCachedBytes; }
+
+  /**
+   * @brief Get the memory held by the cached contraction paths.
+   *
+   * @return The number of bytes.
+   */
+  size_t GetCachedBytes() const { return cachedBytes; }
+
   TensorsMap InitializeTensors(
       const TensorNetwork &network, Types::qubit_t qubit,
       std::vector<Eigen::Index> &keys,
@@ -118,12 +315,15 @@ class BaseContractor : public ITensorContractor {
     return tensors;
   }
 
+  // if the result tensor is passed, only the network is updated, the tensors
+  // are not contracted, unless contractIntoResult is set, then the contraction
+  // is written into it, reusing its storage
   template <class PassedTensorsMap = TensorsMap>
-  inline Eigen::Index ContractNodes(Types::qubit_t qubit,
-                                    PassedTensorsMap &tensors,
-                                    Eigen::Index tensor1Id,
-                                    Eigen::Index tensor2Id,
-                                    Eigen::Index resultRank) {
+  inline Eigen::Index ContractNodes(
+      Types::qubit_t qubit, PassedTensorsMap &tensors, Eigen::Index tensor1Id,
+      Eigen::Index tensor2Id, Eigen::Index resultRank,
+      const std::shared_ptr<Utils::Tensor<>> &resultTensor = nullptr,
+      bool contractIntoResult = false) {
     const auto &tensor1 = tensors[tensor1Id];
     const auto &tensor2 = tensors[tensor2Id];
 
@@ -136,11 +336,22 @@ class BaseContractor : public ITensorContractor {
     maxTensorRank = std::max<size_t>(maxTensorRank, resultRank);
 
     const auto resultNode = std::make_shared<TensorNode>();
-    resultNode->tensor =
-        std::make_shared<Utils::Tensor<>>(tensor1->tensor->Contract(
-            *(tensor2->tensor), indices, enableMultithreading));
+    if (resultTensor) {
+      resultNode->tensor = resultTensor;
+      if (contractIntoResult)
+        tensor1->tensor->Contract(*(tensor2->tensor), indices, *resultTensor,
+                                  enableMultithreading);
+    } else
+      resultNode->tensor =
+          std::make_shared<Utils::Tensor<>>(tensor1->tensor->Contract(
+              *(tensor2->tensor), indices, enableMultithreading));
     resultNode->SetId(tensor1Id);
 
+    // the dummy contractions done while searching for a path are not recorded
+    if (recordedPath && !resultNode->tensor->IsDummy())
+      recordedPath->steps.push_back(
+          {tensor1Id, tensor2Id, resultRank, resultNode->tensor});
+
     const auto newRank = resultNode->GetRank();
 
     resultNode->connections.resize(newRank);
@@ -170,11 +381,13 @@ class BaseContractor : public ITensorContractor {
         resultNode->qubits[pos] = tensor1->qubits[i];
 
         // also need to update the 'other' tensor that is connected to the first
-        // tensor
+        // tensor (the open indices are not connected to anything)
         // tensors[connectedTensorId]->connections[otherTensorIndex] =
         // tensor1Id; // no need to update this, the new tensor inherits the id
         // from tensor1
-        tensors[connectedTensorId]->connectionsIndices[otherTensorIndex] = pos;
+        if (connectedTensorId != TensorNode::NotConnected)
+          tensors[connectedTensorId]->connectionsIndices[otherTensorIndex] =
+              pos;
 
         ++pos;
       }
@@ -194,8 +407,11 @@ class BaseContractor : public ITensorContractor {
 
         // also need to update the 'other' tensor that is connected to the
         // second tensor
-        tensors[connectedTensorId]->connections[otherTensorIndex] = tensor1Id;
-        tensors[connectedTensorId]->connectionsIndices[otherTensorIndex] = pos;
+        if (connectedTensorId != TensorNode::NotConnected) {
+          tensors[connectedTensorId]->connections[otherTensorIndex] = tensor1Id;
+          tensors[connectedTensorId]->connectionsIndices[otherTensorIndex] =
+              pos;
+        }
 
         ++pos;
       }
@@ -235,6 +451,15 @@ class BaseContractor : public ITensorContractor {
 
   size_t GetMaxTensorRank() const override { return maxTensorRank; }
 
+  /**
+   * @brief Get the tensor node the last contraction resulted in.
+   *
+   * @return The node with the result of the last contraction.
+   */
+  std::shared_ptr<TensorNode> GetLastResult() const override {
+    return lastResult;
+  }
+
   /**
    * @brief Enable/disable multithreading.
    *
@@ -256,11 +481,172 @@ class BaseContractor : public ITensorContractor {
    */
   bool GetMultithreading() const override { return enableMultithreading; }
 
+  /**
+   * @brief Get the memory limit.
+   *
+   * Only the contractors that slice the contractions have a limit.
+   *
+   * @return Zero, there is no limit.
+   */
+  size_t GetMemoryLimit() const override { return 0; }
+
  protected:
+  // returns the value the network was contracted to, remembering the tensor
+  // that holds it if the contraction path is recorded
+  double GetContractionResult(const TensorsMap &tensors,
+                              Eigen::Index tensorId) {
+    if (recordedPath) recordedPath->resultId = tensorId;
+
+    lastResult = tensors.at(tensorId);
+
+    return std::real(lastResult->tensor->atOffset(0));
+  }
+
+  // for contractions that do not end in a node from the tensors map
+  double SetContractionResult(std::complex<double> value) {
+    lastResult = std::make_shared<TensorNode>();
+    lastResult->tensor =
+        std::make_shared<Utils::Tensor<>>(std::vector<size_t>{1});
+    (*lastResult->tensor)[0] = value;
+
+    return std::real(value);
+  }
+
+  // for contractions that are not done only with ContractNodes, the recorded
+  // path cannot be replayed
+  void DoNotCachePath() {
+    if (recordedPath) recordedPath->cacheable = false;
+  }
+
   size_t maxTensorRank =
       0; /**< The maximum rank of the tensors in the network. */
   bool enableMultithreading =
       true; /**< A flag to indicate if multithreading should be enabled. */
+  size_t maxCachedPaths =
+      256; /**< The maximum number of cached contraction paths. */
+  size_t maxCachedBytes =
+      256ULL << 20; /**< The maximum memory held by the cached paths. */
+  std::shared_ptr<TensorNode> lastResult; /**< The result of the last
+                                             contraction. */
+
+ private:
+  struct ContractionStep {
+    Eigen::Index tensor1Id;
+    Eigen::Index tensor2Id;
+    Eigen::Index resultRank;
+    std::shared_ptr<Utils::Tensor<>> result;
+  };
+
+  struct CachedPath {
+    std::vector<ContractionStep> steps;
+    // the network tensors the intermediate results were computed from
+    std::unordered_map<Eigen::Index, std::shared_ptr<Utils::Tensor<>>> leaves;
+    Eigen::Index resultId = 0;
+    bool cacheable = true;
+  };
+
+  using StructureKey = std::vector<Eigen::Index>;
+
+  static size_t GetTensorBytes(const std::shared_ptr<Utils::Tensor<>> &tensor) {
+    if (!tensor || tensor->IsDummy()) return 0;
+
+    return tensor->GetSize() * sizeof(std::complex<double>);
+  }
+
+  // the same structure gives tensors of the same sizes, so the memory held by
+  // a path does not change when it's replayed
+  static size_t GetPathBytes(const CachedPath &path) {
+    size_t bytes = 0;
+    for (const auto &step : path.steps) bytes += GetTensorBytes(step.result);
+    for (const auto &[tensorId, tensor] : path.leaves)
+      bytes += GetTensorBytes(tensor);
+
+    return bytes;
+  }
+
+  void AddToCache(StructureKey &&key, CachedPath &&path) {
+    const size_t pathBytes = GetPathBytes(path);
+    if (pathBytes > maxCachedBytes) return;
+
+    if (pathsCache.size() >= maxCachedPaths ||
+        cachedBytes + pathBytes > maxCachedBytes)
+      ClearCache();
+
+    cachedBytes += pathBytes;
+    pathsCache.emplace(std::move(key), std::move(path));
+  }
+
+  // the contraction path depends only on how the tensors are connected, not on
+  // their values
+  static StructureKey GetStructureKey(const TensorNetwork &network,
+                                      Types::qubit_t qubit) {
+    StructureKey key;
+    key.push_back(static_cast<Eigen::Index>(qubit));
+
+    const auto &qubitGroup = network.GetQubitGroup(qubit);
+    for (const auto &tensor : network.GetTensors()) {
+      if (!tensor || qubitGroup.find(tensor->qubits[0]) == qubitGroup.end())
+        continue;
+
+      key.push_back(tensor->GetId());
+      key.push_back(static_cast<Eigen::Index>(tensor->qubits.size()));
+      for (size_t i = 0; i < tensor->qubits.size(); ++i) {
+        key.push_back(static_cast<Eigen::Index>(tensor->qubits[i]));
+        key.push_back(tensor->connections[i]);
+        key.push_back(tensor->connectionsIndices[i]);
+      }
+    }
+
+    return key;
+  }
+
+  // Tensors are never changed in place in the network, a gate applied on a
+  // tensor replaces it with a new one, so a changed leaf is detected by
+  // comparing the pointers. The cache keeps the old ones alive, so the
+  // addresses cannot be reused.
+  // The intermediate results are not leaves, a changed one is recomputed into
+  // the old tensor if nobody else holds it, to reuse its storage.
+  double ReplayPath(const TensorNetwork &network, Types::qubit_t qubit,
+                    CachedPath &path) {
+    lastResult.reset();
+
+    std::vector<Eigen::Index> keys;
+    std::unordered_map<Eigen::Index, Eigen::Index> keysKeys;
+    TensorsMap tensors =
+        InitializeTensors(network, qubit, keys, keysKeys, false, false);
+
+    std::unordered_map<Eigen::Index, bool> changed;
+    for (const auto &[tensorId, tensor] : tensors) {
+      auto &leaf = path.leaves[tensorId];
+      changed[tensorId] = leaf != tensor->tensor;
+      leaf = tensor->tensor;
+    }
+
+    for (auto &step : path.steps) {
+      const bool stepChanged =
+          changed[step.tensor1Id] || changed[step.tensor2Id];
+
+      const bool reuse =
+          stepChanged && step.result && step.result.use_count() == 1;
+
+      ContractNodes(qubit, tensors, step.tensor1Id, step.tensor2Id,
+                    step.resultRank,
+                    stepChanged && !reuse ? nullptr : step.result, reuse);
+
+      if (stepChanged) step.result = tensors[step.tensor1Id]->tensor;
+      changed[step.tensor1Id] = stepChanged;
+    }
+
+    lastResult = tensors.at(path.resultId);
+
+    return std::real(lastResult->tensor->atOffset(0));
+  }
+
+  std::unordered_map<StructureKey, CachedPath, boost::hash<StructureKey>>
+      pathsCache; /**< The cached contraction paths. */
+  size_t cachedBytes = 0; /**< The memory held by the cached paths. */
+  CachedPath *recordedPath =
+      nullptr; /**< The path being recorded, if any. */
 };
 
 }  // namespace TensorNetworks
@@ -42,7 +42,8 @@ class DumbContractor : public BaseContractor {
    * @param network The tensor network to contract.
    * @return The result of the contraction.
    */
-  double Contract(const TensorNetwork &network, Types::qubit_t qubit) override {
+  double ContractNetwork(const TensorNetwork &network,
+                         Types::qubit_t qubit) override {
     std::vector<Eigen::Index> keys;
     std::unordered_map<Eigen::Index, Eigen::Index> keysKeys;
 
@@ -113,7 +114,7 @@ class DumbContractor : public BaseContractor {
 
       if (resultRank == 0) {
         if (tensors.size() == 1 || tensor->contractsTheNeededQubit)
-          return std::real(tensor->tensor->atOffset(0));
+          return GetContractionResult(tensors, tensor1Id);
         // erasing this tensor happens because (not the case anymore, it's
         // avoided) the tensor network might be a disjoint one and a subnetwork
         // is contracted that does not contain the needed qubit
@@ -128,7 +129,7 @@ class DumbContractor : public BaseContractor {
       }
     }
 
-    return std::real(tensors.begin()->second->tensor->atOffset(0));
+    return GetContractionResult(tensors, tensors.begin()->first);
   }
 
   void SetContractTheLowestTensorId(bool c) { contractTheLowestTensorId = c; }
@@ -147,6 +148,8 @@ class DumbContractor : public BaseContractor {
 
     cloned->maxTensorRank = maxTensorRank;
     cloned->enableMultithreading = enableMultithreading;
+    cloned->maxCachedPaths = maxCachedPaths;
+    cloned->maxCachedBytes = maxCachedBytes;
     cloned->contractTheLowestTensorId = contractTheLowestTensorId;
 
     return cloned;
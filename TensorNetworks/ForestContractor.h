@@ -41,7 +41,8 @@ class ForestContractor : public BaseContractor {
    * @param network The tensor network to contract.
    * @return The result of the contraction.
    */
-  double Contract(const TensorNetwork &network, Types::qubit_t qubit) override {
+  double ContractNetwork(const TensorNetwork &network,
+                         Types::qubit_t qubit) override {
     std::vector<Eigen::Index> keys;
     std::unordered_map<Eigen::Index, Eigen::Index> keysKeys;
 
@@ -137,7 +138,7 @@ class ForestContractor : public BaseContractor {
 
       if (resultRank == 0) {
         if (tensors.size() == 1 || tensors[tensor1Id]->contractsTheNeededQubit)
-          return std::real(tensors[tensor1Id]->tensor->atOffset(0));
+          return GetContractionResult(tensors, tensor1Id);
 
         // erasing this tensor happens because (not the case anymore, it's
         // avoided) the tensor network might be a disjoint one and a subnetwork
@@ -148,7 +149,7 @@ class ForestContractor : public BaseContractor {
       }
     }
 
-    return std::real(tensors.begin()->second->tensor->atOffset(0));
+    return GetContractionResult(tensors, tensors.begin()->first);
   }
 
   /**
@@ -161,6 +162,8 @@ class ForestContractor : public BaseContractor {
 
     cloned->maxTensorRank = maxTensorRank;
     cloned->enableMultithreading = enableMultithreading;
+    cloned->maxCachedPaths = maxCachedPaths;
+    cloned->maxCachedBytes = maxCachedBytes;
 
     return cloned;
   }
@@ -0,0 +1,1006 @@
+/**
+ * @file PartitionContractor.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The Partition Tensor Contractor.
+ * The contraction tree is found by recursively bisecting the hypergraph of the
+ * network (the tensors are the vertices, the indices the hyperedges; here each
+ * index joins two tensors, so it's a graph) in balanced parts with a small cut.
+ * The indices that are cut at the top levels are contracted last, so the big
+ * tensors are contracted over as few indices as possible. The small parts at
+ * the bottom are contracted greedily. The tree is then refined by rotating
+ * subtrees as long as that lowers the contraction cost.
+ * Several randomized trials are run in parallel, within a time budget, and the
+ * cheapest tree is used. The idea is similar to the one used by cotengra.
+ * If a memory limit is set and the largest intermediate tensor of a connected
+ * component of the network does not fit, some indices of the component are
+ * sliced: their values are fixed, the component is contracted for each
+ * combination of values (in parallel, as many slices at once as fit together
+ * in the limit) and the results are summed up. The open indices are never
+ * sliced, they are the indices of the summed up result.
+ *
+ * Tensor contractions using the Partition contraction method.
+ */
+
+#pragma once
+
+#ifndef __PARTITION_CONTRACTOR_H_
+#define __PARTITION_CONTRACTOR_H_ 1
+
+#include "BaseContractor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <thread>
+
+namespace TensorNetworks {
+
+/**
+ * @brief The Partition Tensor Contractor.
+ *
+ * Tensor contractions using contraction trees found by recursive bisection of
+ * the tensor network hypergraph.
+ */
+class PartitionContractor : public BaseContractor {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * Constructs the Partition Tensor Contractor.
+   * Initializes the random number generator.
+   */
+  PartitionContractor() : gen(std::random_device{}()) {}
+
+  /**
+   * @brief Contract the tensor network.
+   *
+   * @param network The tensor network to contract.
+   * @return The result of the contraction.
+   */
+  double ContractNetwork(const TensorNetwork &network,
+                         Types::qubit_t qubit) override {
+    std::vector<Eigen::Index> keys;
+    std::unordered_map<Eigen::Index, Eigen::Index> keysKeys;
+
+    TensorsMap tensors = InitializeTensors(network, qubit, keys, keysKeys);
+    if (tensors.size() == 1)
+      return GetContractionResult(tensors, tensors.begin()->first);
+
+    const Graph graph = BuildGraph(tensors, keys, keysKeys);
+    const Tree tree = FindTree(graph);
+    lastPathCost = tree.cost;
+    lastSlicedIndices = 0;
+
+    const size_t maxRank = GetMaxIntermediateRank();
+    for (size_t c = 0; c < tree.roots.size(); ++c) {
+      const int root = tree.roots[c];
+      if (tree.nodes[root].left < 0) continue;
+
+      const std::vector<int> nodes = GetSubtreeNodes(tree, root);
+      if (GetMaxRank(tree, nodes) > maxRank) {
+        DoNotCachePath();
+
+        const auto &component = graph.components[c];
+
+        // a subnetwork that does not contain the needed qubit is dropped, like
+        // below, so there is no need to contract it
+        if (tensors.size() > component.size() &&
+            !ContainsQubit(tensors, keys, component, qubit)) {
+          for (const auto t : component) tensors.erase(keys[t]);
+          continue;
+        }
+
+        lastResult = ContractSliced(tensors, keys, graph, tree, component,
+                                    nodes, maxRank);
+
+        return std::real(lastResult->tensor->atOffset(0));
+      }
+
+      const Eigen::Index tensor1Id =
+          ContractSubtree(qubit, tensors, keys, tree, root);
+
+      if (tree.nodes[root].legs.empty()) {
+        if (tensors.size() == 1 || tensors[tensor1Id]->contractsTheNeededQubit)
+          return GetContractionResult(tensors, tensor1Id);
+
+        // a subnetwork that does not contain the needed qubit, like in the
+        // other contractors
+        tensors.erase(tensor1Id);
+      }
+    }
+
+    return GetContractionResult(tensors, tensors.begin()->first);
+  }
+
+  /**
+   * @brief Get the number of trials.
+   *
+   * @return The number of randomized trials for finding the contraction tree.
+   */
+  size_t GetNumberOfTrials() const { return numberOfTrials; }
+
+  /**
+   * @brief Set the number of trials.
+   *
+   * The trials are run in parallel if multithreading is enabled. At least one
+   * trial is run, even if the time budget is exceeded.
+   *
+   * @param trials The number of randomized trials for finding the contraction
+   * tree.
+   */
+  void SetNumberOfTrials(size_t trials) {
+    numberOfTrials = std::max<size_t>(1, trials);
+  }
+
+  /**
+   * @brief Get the time budget.
+   *
+   * @return The time allowed for finding the contraction tree, in seconds.
+   */
+  double GetTimeBudget() const { return timeBudget; }
+
+  /**
+   * @brief Set the time budget.
+   *
+   * The trials not started and the tree refinements not done when the time
+   * budget is exceeded are skipped.
+   *
+   * @param seconds The time allowed for finding the contraction tree.
+   */
+  void SetTimeBudget(double seconds) { timeBudget = seconds; }
+
+  /**
+   * @brief Get the maximum imbalance of the bisections.
+   *
+   * @return The maximum imbalance of the bisections.
+   */
+  double GetMaxImbalance() const { return maxImbalance; }
+
+  /**
+   * @brief Set the maximum imbalance of the bisections.
+   *
+   * The part sizes can deviate from half by this fraction. Each trial picks
+   * randomly an imbalance between zero and this value.
+   *
+   * @param imbalance The maximum imbalance of the bisections.
+   */
+  void SetMaxImbalance(double imbalance) {
+    maxImbalance = std::clamp(imbalance, 0., 1.);
+  }
+
+  /**
+   * @brief Get the memory limit.
+   *
+   * @return The maximum size of an intermediate tensor, in bytes, zero if
+   * there is no limit.
+   */
+  size_t GetMemoryLimit() const override { return memoryLimit; }
+
+  /**
+   * @brief Set the memory limit.
+   *
+   * If the largest intermediate tensor of a connected component of the network
+   * is bigger, the contraction of the component is sliced until it fits. The
+   * limit is for all the slices contracted in parallel, only as many of them
+   * as fit together are contracted at once.
+   *
+   * @param bytes The maximum size of an intermediate tensor, in bytes, zero
+   * for no limit.
+   */
+  void SetMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+
+  /**
+   * @brief Get the number of sliced indices of the last contraction.
+   *
+   * @return The number of indices sliced in the last contraction, the number
+   * of slices is two to this power.
+   */
+  size_t GetLastSlicedIndices() const { return lastSlicedIndices; }
+
+  /**
+   * @brief Get the cost of the last contraction tree.
+   *
+   * The cost is the number of multiply-adds of the contractions, estimated
+   * from the tensor ranks.
+   *
+   * @return The cost of the last contraction tree that was found.
+   */
+  double GetLastPathCost() const { return lastPathCost; }
+
+  /**
+   * @brief Clone the tensor contractor.
+   *
+   * @return A shared pointer to the cloned tensor contractor.
+   */
+  std::shared_ptr<ITensorContractor> Clone() const override {
+    auto cloned = std::make_shared<PartitionContractor>();
+
+    cloned->maxTensorRank = maxTensorRank;
+    cloned->enableMultithreading = enableMultithreading;
+    cloned->maxCachedPaths = maxCachedPaths;
+    cloned->maxCachedBytes = maxCachedBytes;
+    cloned->numberOfTrials = numberOfTrials;
+    cloned->timeBudget = timeBudget;
+    cloned->maxImbalance = maxImbalance;
+    cloned->memoryLimit = memoryLimit;
+
+    return cloned;
+  }
+
+ protected:
+  // the parts up to this size are contracted greedily
+  static constexpr size_t greedyPartSize = 12;
+  static constexpr size_t maxRefinePasses = 10;
+  // the slices are counted with 64 bit integers
+  static constexpr size_t maxSlicedIndices = 62;
+
+  using Legs = std::vector<int>;
+  using Clock = std::chrono::steady_clock;
+
+  struct Graph {
+    std::vector<Legs> legs;  // the sorted indices of each tensor
+    std::vector<Legs>
+        orderedLegs;  // the indices of each tensor, in the tensor order
+    std::vector<std::vector<std::pair<size_t, int>>>
+        adjacency;  // the neighbours of each tensor and the number of indices
+                    // shared with them
+    std::vector<std::vector<size_t>> components;
+  };
+
+  // the first nodes are the leaves, in the order of the keys
+  struct TreeNode {
+    int left = -1;
+    int right = -1;
+    Legs legs;
+    double cost = 0;
+  };
+
+  struct Tree {
+    std::vector<TreeNode> nodes;
+    std::vector<int> roots;  // one for each connected component
+    double cost = 0;
+    size_t maxRank = 0;
+  };
+
+  static Graph BuildGraph(
+      const TensorsMap &tensors, const std::vector<Eigen::Index> &keys,
+      const std::unordered_map<Eigen::Index, Eigen::Index> &keysKeys) {
+    Graph graph;
+    const size_t nrTensors = keys.size();
+
+    std::vector<std::vector<int>> edges(nrTensors);
+    for (size_t t = 0; t < nrTensors; ++t)
+      edges[t].resize(tensors.at(keys[t])->connections.size(), -1);
+
+    graph.legs.resize(nrTensors);
+    graph.orderedLegs.resize(nrTensors);
+    graph.adjacency.resize(nrTensors);
+
+    int nextEdge = 0;
+    for (size_t t = 0; t < nrTensors; ++t) {
+      const auto &tensor = tensors.at(keys[t]);
+      std::unordered_map<size_t, int> neighbours;
+
+      for (size_t i = 0; i < tensor->connections.size(); ++i) {
+        const auto otherId = tensor->connections[i];
+        const bool connected = otherId != TensorNode::NotConnected;
+
+        if (edges[t][i] < 0) {
+          edges[t][i] = nextEdge;
+          if (connected)
+            edges[keysKeys.at(otherId)][tensor->connectionsIndices[i]] =
+                nextEdge;
+          ++nextEdge;
+        }
+
+        if (connected) {
+          const size_t other = keysKeys.at(otherId);
+          if (other != t) ++neighbours[other];
+        }
+      }
+
+      graph.orderedLegs[t] = edges[t];
+      graph.legs[t] = edges[t];
+      std::sort(graph.legs[t].begin(), graph.legs[t].end());
+      graph.adjacency[t].assign(neighbours.begin(), neighbours.end());
+      std::sort(graph.adjacency[t].begin(), graph.adjacency[t].end());
+    }
+
+    std::vector<bool> visited(nrTensors, false);
+    for (size_t t = 0; t < nrTensors; ++t) {
+      if (visited[t]) continue;
+
+      std::vector<size_t> component{t};
+      visited[t] = true;
+      for (size_t pos = 0; pos < component.size(); ++pos)
+        for (const auto &[other, weight] : graph.adjacency[component[pos]])
+          if (!visited[other]) {
+            visited[other] = true;
+            component.push_back(other);
+          }
+
+      graph.components.emplace_back(std::move(component));
+    }
+
+    return graph;
+  }
+
+  Tree FindTree(const Graph &graph) {
+    const auto deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(timeBudget));
+
+    std::vector<std::mt19937::result_type> seeds(numberOfTrials);
+    for (auto &seed : seeds) seed = gen();
+
+    std::vector<Tree> trees(numberOfTrials);
+    std::vector<char> done(numberOfTrials, 0);
+
+    const int processor_count =
+        enableMultithreading
+            ? static_cast<int>(std::min<size_t>(
+                  numberOfTrials,
+                  std::max(1U, std::thread::hardware_concurrency())))
+            : 1;
+
+#pragma omp parallel for num_threads(processor_count) schedule(dynamic, 1)
+    for (long long int trial = 0;
+         trial < static_cast<long long int>(numberOfTrials); ++trial) {
+      if (trial > 0 && Clock::now() >= deadline) continue;
+
+      std::mt19937 rng(seeds[trial]);
+      std::uniform_real_distribution<double> imbalanceDist(0., maxImbalance);
+      TreeBuilder builder(graph, rng, imbalanceDist(rng));
+
+      trees[trial] = builder.Build(deadline);
+      done[trial] = 1;
+    }
+
+    size_t best = 0;
+    for (size_t trial = 1; trial < numberOfTrials; ++trial)
+      if (done[trial] && IsBetter(trees[trial], trees[best])) best = trial;
+
+    return std::move(trees[best]);
+  }
+
+  static bool IsBetter(const Tree &tree, const Tree &other) {
+    if (tree.cost < other.cost * (1. - 1E-12)) return true;
+    if (other.cost < tree.cost * (1. - 1E-12)) return false;
+
+    return tree.maxRank < other.maxRank;
+  }
+
+  Eigen::Index ContractSubtree(Types::qubit_t qubit, TensorsMap &tensors,
+                               const std::vector<Eigen::Index> &keys,
+                               const Tree &tree, int node) {
+    const auto &treeNode = tree.nodes[node];
+    if (treeNode.left < 0) return keys[node];
+
+    const Eigen::Index tensor1Id =
+        ContractSubtree(qubit, tensors, keys, tree, treeNode.left);
+    const Eigen::Index tensor2Id =
+        ContractSubtree(qubit, tensors, keys, tree, treeNode.right);
+
+    const Eigen::Index resultRank =
+        GetResultRank(tensors[tensor1Id], tensors[tensor2Id]);
+
+    return ContractNodes(qubit, tensors, tensor1Id, tensor2Id, resultRank);
+  }
+
+  size_t GetMaxIntermediateRank() const {
+    if (memoryLimit == 0) return std::numeric_limits<size_t>::max();
+
+    size_t elements = memoryLimit / sizeof(std::complex<double>);
+    size_t rank = 0;
+    while (elements > 1) {
+      elements >>= 1;
+      ++rank;
+    }
+
+    return rank;
+  }
+
+  static std::vector<int> GetSubtreeNodes(const Tree &tree, int root) {
+    std::vector<int> nodes{root};
+    for (size_t pos = 0; pos < nodes.size(); ++pos) {
+      const auto &treeNode = tree.nodes[nodes[pos]];
+      if (treeNode.left < 0) continue;
+
+      nodes.push_back(treeNode.left);
+      nodes.push_back(treeNode.right);
+    }
+
+    return nodes;
+  }
+
+  static size_t GetMaxRank(const Tree &tree, const std::vector<int> &nodes) {
+    size_t maxRank = 0;
+    for (const auto node : nodes)
+      maxRank = std::max(maxRank, tree.nodes[node].legs.size());
+
+    return maxRank;
+  }
+
+  static bool ContainsQubit(const TensorsMap &tensors,
+                            const std::vector<Eigen::Index> &keys,
+                            const std::vector<size_t> &component,
+                            Types::qubit_t qubit) {
+    for (const auto t : component) {
+      const auto &qubits = tensors.at(keys[t])->qubits;
+      if (std::find(qubits.begin(), qubits.end(), qubit) != qubits.end())
+        return true;
+    }
+
+    return false;
+  }
+
+  // greedily slices the index shared by most of the tensors that do not fit,
+  // weighted by how much they exceed the limit, until all of them fit; also
+  // returns the max rank of the sliced tensors
+  // the open indices (the ones of the root) are not sliced
+  static std::vector<int> SelectSlicedIndices(const Tree &tree,
+                                              const std::vector<int> &nodes,
+                                              size_t maxRank,
+                                              size_t &slicedMaxRank) {
+    const Legs &openLegs = tree.nodes[nodes[0]].legs;
+
+    std::vector<size_t> ranks(nodes.size());
+    for (size_t n = 0; n < nodes.size(); ++n)
+      ranks[n] = tree.nodes[nodes[n]].legs.size();
+
+    std::vector<int> sliced;
+    for (;;) {
+      slicedMaxRank = *std::max_element(ranks.begin(), ranks.end());
+      if (slicedMaxRank <= maxRank) break;
+
+      if (sliced.size() >= maxSlicedIndices)
+        throw std::runtime_error(
+            "The memory limit is too low for slicing the tensor network "
+            "contraction.");
+
+      std::unordered_map<int, size_t> counts;
+      for (size_t n = 0; n < nodes.size(); ++n)
+        if (ranks[n] > maxRank)
+          for (const auto leg : tree.nodes[nodes[n]].legs)
+            if (std::find(sliced.begin(), sliced.end(), leg) == sliced.end() &&
+                !std::binary_search(openLegs.begin(), openLegs.end(), leg))
+              counts[leg] += ranks[n] - maxRank;
+
+      if (counts.empty())
+        throw std::runtime_error(
+            "The memory limit is too low for the open indices of the tensor "
+            "network contraction.");
+
+      int bestLeg = -1;
+      size_t bestCount = 0;
+      for (const auto &[leg, count] : counts)
+        if (count > bestCount || (count == bestCount && leg < bestLeg)) {
+          bestLeg = leg;
+          bestCount = count;
+        }
+
+      sliced.push_back(bestLeg);
+      for (size_t n = 0; n < nodes.size(); ++n)
+        if (std::binary_search(tree.nodes[nodes[n]].legs.begin(),
+                               tree.nodes[nodes[n]].legs.end(), bestLeg))
+          --ranks[n];
+    }
+
+    return sliced;
+  }
+
+  // contracts the subtree of a component for each combination of values of
+  // the sliced indices and sums up the results; the slices are contracted in
+  // parallel, as many at once as fit together in the memory limit
+  // returns a node with the sum, its indices are the open ones of the
+  // component, if any
+  std::shared_ptr<TensorNode> ContractSliced(
+      const TensorsMap &tensors, const std::vector<Eigen::Index> &keys,
+      const Graph &graph, const Tree &tree,
+      const std::vector<size_t> &component, const std::vector<int> &nodes,
+      size_t maxRank) {
+    size_t slicedMaxRank = 0;
+    const std::vector<int> sliced =
+        SelectSlicedIndices(tree, nodes, maxRank, slicedMaxRank);
+    lastSlicedIndices = sliced.size();
+
+    const size_t nrLeaves = graph.legs.size();
+    const int root = nodes[0];
+
+    // the indices of each node without the sliced ones, in the tensor order,
+    // and for the leaves, which tensor indices are fixed by which slice bit
+    std::vector<Legs> legs(tree.nodes.size());
+    std::vector<std::vector<std::pair<size_t, size_t>>> fixedIndices(nrLeaves);
+    for (const auto t : component)
+      for (size_t i = 0; i < graph.orderedLegs[t].size(); ++i) {
+        const int leg = graph.orderedLegs[t][i];
+        const auto it = std::find(sliced.begin(), sliced.end(), leg);
+        if (it == sliced.end())
+          legs[t].push_back(leg);
+        else
+          fixedIndices[t].emplace_back(i, it - sliced.begin());
+      }
+
+    struct Step {
+      int node;
+      std::vector<std::pair<size_t, size_t>> indices;
+    };
+
+    std::vector<Step> steps;
+    std::vector<std::pair<int, bool>> stack{{root, false}};
+    while (!stack.empty()) {
+      const auto [node, childrenDone] = stack.back();
+      stack.pop_back();
+
+      const auto &treeNode = tree.nodes[node];
+      if (treeNode.left < 0) continue;
+
+      if (!childrenDone) {
+        stack.emplace_back(node, true);
+        stack.emplace_back(treeNode.right, false);
+        stack.emplace_back(treeNode.left, false);
+        continue;
+      }
+
+      const auto &legs1 = legs[treeNode.left];
+      const auto &legs2 = legs[treeNode.right];
+
+      Step step{node, {}};
+      for (size_t i = 0; i < legs1.size(); ++i) {
+        const auto it = std::find(legs2.begin(), legs2.end(), legs1[i]);
+        if (it == legs2.end())
+          legs[node].push_back(legs1[i]);
+        else
+          step.indices.emplace_back(i, it - legs2.begin());
+      }
+      for (const auto leg : legs2)
+        if (std::find(legs1.begin(), legs1.end(), leg) == legs1.end())
+          legs[node].push_back(leg);
+
+      maxTensorRank = std::max(maxTensorRank, legs[node].size());
+      steps.emplace_back(std::move(step));
+    }
+
+    // the open indices of the component, in the order of the result, each one
+    // belongs to a qubit
+    const Legs &openLegs = legs[root];
+    auto result = std::make_shared<TensorNode>();
+    for (const auto leg : openLegs)
+      for (const auto t : component) {
+        const auto &ordered = graph.orderedLegs[t];
+        const auto it = std::find(ordered.begin(), ordered.end(), leg);
+        if (it != ordered.end()) {
+          result->qubits.push_back(
+              tensors.at(keys[t])->qubits[it - ordered.begin()]);
+          break;
+        }
+      }
+    result->tensor = std::make_shared<Utils::Tensor<>>(
+        openLegs.empty() ? std::vector<size_t>{1}
+                         : std::vector<size_t>(openLegs.size(), 2));
+
+    const long long int nrSlices = 1LL << sliced.size();
+    // with open indices each thread also keeps its partial sum
+    const long long int nrFittingSlices = std::max<long long int>(
+        1, static_cast<long long int>(
+               (memoryLimit / sizeof(std::complex<double>)) >>
+               (slicedMaxRank + (openLegs.empty() ? 0 : 1))));
+    const int processor_count =
+        enableMultithreading
+            ? static_cast<int>(std::min<long long int>(
+                  {nrSlices, nrFittingSlices,
+                   std::max(1U, std::thread::hardware_concurrency())}))
+            : 1;
+    const bool multithreadedContraction =
+        enableMultithreading && processor_count == 1;
+
+#pragma omp parallel num_threads(processor_count)
+    {
+      Utils::Tensor<> partial(result->tensor->GetDims());
+
+#pragma omp for schedule(dynamic, 1)
+      for (long long int slice = 0; slice < nrSlices; ++slice) {
+        std::vector<std::shared_ptr<Utils::Tensor<>>> values(
+            tree.nodes.size());
+
+        for (const auto t : component) {
+          const auto &tensor = tensors.at(keys[t])->tensor;
+          if (fixedIndices[t].empty()) {
+            values[t] = tensor;
+            continue;
+          }
+
+          std::vector<std::pair<size_t, size_t>> fixed(fixedIndices[t]);
+          for (auto &[index, value] : fixed) value = (slice >> value) & 1;
+
+          values[t] = std::make_shared<Utils::Tensor<>>(tensor->Slice(fixed));
+        }
+
+        for (const auto &step : steps) {
+          const auto &treeNode = tree.nodes[step.node];
+          const auto &tensor1 = values[treeNode.left];
+          const auto &tensor2 = values[treeNode.right];
+
+          // the scalars are multiplied, the contraction would add them a
+          // dimension
+          if (legs[treeNode.left].empty())
+            values[step.node] = std::make_shared<Utils::Tensor<>>(
+                *tensor2 * tensor1->atOffset(0));
+          else if (legs[treeNode.right].empty())
+            values[step.node] = std::make_shared<Utils::Tensor<>>(
+                *tensor1 * tensor2->atOffset(0));
+          else
+            values[step.node] = std::make_shared<Utils::Tensor<>>(
+                tensor1->Contract(*tensor2, step.indices,
+                                  multithreadedContraction));
+
+          values[treeNode.left].reset();
+          values[treeNode.right].reset();
+        }
+
+        if (openLegs.empty())
+          partial[0] += values[root]->atOffset(0);
+        else
+          partial += *values[root];
+      }
+
+#pragma omp critical
+      *result->tensor += partial;
+
+      // the memory kept by the threads for the slices is not needed anymore
+      Utils::TensorMemoryPool::Trim();
+    }
+
+    return result;
+  }
+
+  // builds a contraction tree for one trial, each trial has its own builder
+  class TreeBuilder {
+   public:
+    TreeBuilder(const Graph &graph, std::mt19937 &rng, double imbalance)
+        : graph(graph),
+          rng(rng),
+          imbalance(imbalance),
+          localPos(graph.legs.size(), -1) {}
+
+    Tree Build(const Clock::time_point &deadline) {
+      const size_t nrTensors = graph.legs.size();
+      tree.nodes.reserve(2 * nrTensors);
+      tree.nodes.resize(nrTensors);
+      for (size_t t = 0; t < nrTensors; ++t)
+        tree.nodes[t].legs = graph.legs[t];
+
+      for (const auto &component : graph.components)
+        tree.roots.push_back(Bisect(component));
+
+      Refine(deadline);
+
+      for (const auto &node : tree.nodes) {
+        tree.cost += node.cost;
+        tree.maxRank = std::max(tree.maxRank, node.legs.size());
+      }
+
+      return std::move(tree);
+    }
+
+   private:
+    static size_t SharedLegs(const Legs &legs1, const Legs &legs2) {
+      size_t shared = 0;
+      for (auto it1 = legs1.begin(), it2 = legs2.begin();
+           it1 != legs1.end() && it2 != legs2.end();) {
+        if (*it1 < *it2)
+          ++it1;
+        else if (*it2 < *it1)
+          ++it2;
+        else {
+          ++shared;
+          ++it1;
+          ++it2;
+        }
+      }
+
+      return shared;
+    }
+
+    // the number of multiply-adds for contracting the two tensors, all
+    // indices have dimension 2
+    static double ContractionCost(const Legs &legs1, const Legs &legs2) {
+      return std::exp2(static_cast<double>(legs1.size() + legs2.size() -
+                                           SharedLegs(legs1, legs2)));
+    }
+
+    void SetChildren(int node, int left, int right) {
+      auto &treeNode = tree.nodes[node];
+      const auto &legs1 = tree.nodes[left].legs;
+      const auto &legs2 = tree.nodes[right].legs;
+
+      treeNode.left = left;
+      treeNode.right = right;
+      treeNode.cost = ContractionCost(legs1, legs2);
+      treeNode.legs.clear();
+      std::set_symmetric_difference(legs1.begin(), legs1.end(), legs2.begin(),
+                                    legs2.end(),
+                                    std::back_inserter(treeNode.legs));
+    }
+
+    int Join(int left, int right) {
+      tree.nodes.emplace_back();
+      const int node = static_cast<int>(tree.nodes.size()) - 1;
+      SetChildren(node, left, right);
+
+      return node;
+    }
+
+    int Bisect(const std::vector<size_t> &part) {
+      if (part.size() == 1) return static_cast<int>(part[0]);
+      if (part.size() <= greedyPartSize) return GreedyJoin(part);
+
+      std::vector<size_t> part1;
+      std::vector<size_t> part2;
+      Partition(part, part1, part2);
+
+      if (part1.empty() || part2.empty()) return GreedyJoin(part);
+
+      const int left = Bisect(part1);
+      const int right = Bisect(part2);
+
+      return Join(left, right);
+    }
+
+    // contracts the pair with the lowest rank increase first, the ties are
+    // broken randomly
+    int GreedyJoin(const std::vector<size_t> &part) {
+      std::vector<int> nodes(part.begin(), part.end());
+      std::uniform_real_distribution<double> noiseDist(0., 0.5);
+
+      while (nodes.size() > 1) {
+        size_t best1 = 0;
+        size_t best2 = 1;
+        bool bestShares = false;
+        double bestCost = std::numeric_limits<double>::infinity();
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          const auto &legs1 = tree.nodes[nodes[i]].legs;
+          for (size_t j = i + 1; j < nodes.size(); ++j) {
+            const auto &legs2 = tree.nodes[nodes[j]].legs;
+            const size_t shared = SharedLegs(legs1, legs2);
+
+            // outer products only if nothing else is left
+            if (bestShares && shared == 0) continue;
+
+            const double resultRank =
+                static_cast<double>(legs1.size() + legs2.size() - 2 * shared);
+            const double cost =
+                resultRank -
+                static_cast<double>(legs1.size() + legs2.size()) / 2. +
+                noiseDist(rng);
+
+            if ((shared > 0 && !bestShares) || cost < bestCost) {
+              best1 = i;
+              best2 = j;
+              bestCost = cost;
+              bestShares = shared > 0;
+            }
+          }
+        }
+
+        nodes[best1] = Join(nodes[best1], nodes[best2]);
+        nodes[best2] = nodes.back();
+        nodes.pop_back();
+      }
+
+      return nodes[0];
+    }
+
+    // a balanced bisection with a small cut, grown from a random tensor then
+    // improved with Fiduccia-Mattheyses passes
+    void Partition(const std::vector<size_t> &part, std::vector<size_t> &part1,
+                   std::vector<size_t> &part2) {
+      const size_t nrTensors = part.size();
+      for (size_t i = 0; i < nrTensors; ++i)
+        localPos[part[i]] = static_cast<int>(i);
+
+      std::vector<std::vector<std::pair<size_t, int>>> adjacency(nrTensors);
+      for (size_t i = 0; i < nrTensors; ++i)
+        for (const auto &[other, weight] : graph.adjacency[part[i]])
+          if (localPos[other] >= 0)
+            adjacency[i].emplace_back(localPos[other], weight);
+
+      for (const auto t : part) localPos[t] = -1;
+
+      const size_t half = nrTensors / 2;
+      const size_t slack = std::max<size_t>(
+          1, static_cast<size_t>(imbalance * static_cast<double>(half)));
+      const size_t minSize = half > slack ? half - slack : 1;
+      const size_t maxSize = nrTensors - minSize;
+
+      // side 0 is grown breadth first, from random tensors
+      std::vector<int> side(nrTensors, 1);
+      std::vector<size_t> order(nrTensors);
+      std::iota(order.begin(), order.end(), 0);
+      std::shuffle(order.begin(), order.end(), rng);
+
+      size_t size0 = 0;
+      std::queue<size_t> queue;
+      for (size_t pos = 0; size0 < half;) {
+        if (queue.empty()) {
+          while (side[order[pos]] == 0) ++pos;
+          side[order[pos]] = 0;
+          ++size0;
+          queue.push(order[pos]);
+          continue;
+        }
+
+        const size_t t = queue.front();
+        queue.pop();
+        for (const auto &[other, weight] : adjacency[t])
+          if (side[other] == 1 && size0 < half) {
+            side[other] = 0;
+            ++size0;
+            queue.push(other);
+          }
+      }
+
+      std::vector<int> gain(nrTensors, 0);
+      for (size_t t = 0; t < nrTensors; ++t)
+        for (const auto &[other, weight] : adjacency[t])
+          gain[t] += side[other] != side[t] ? weight : -weight;
+
+      const auto move = [&](size_t t) {
+        side[t] = 1 - side[t];
+        if (side[t] == 0)
+          ++size0;
+        else
+          --size0;
+
+        gain[t] = -gain[t];
+        for (const auto &[other, weight] : adjacency[t])
+          gain[other] += side[other] == side[t] ? -2 * weight : 2 * weight;
+      };
+
+      std::vector<bool> locked(nrTensors);
+      std::vector<size_t> moves;
+      moves.reserve(nrTensors);
+
+      for (size_t pass = 0; pass < maxRefinePasses; ++pass) {
+        std::fill(locked.begin(), locked.end(), false);
+        moves.clear();
+
+        int cumulatedGain = 0;
+        int bestGain = 0;
+        size_t bestMoves = 0;
+
+        const size_t start =
+            std::uniform_int_distribution<size_t>(0, nrTensors - 1)(rng);
+
+        for (;;) {
+          bool found = false;
+          size_t bestTensor = 0;
+
+          for (size_t i = 0; i < nrTensors; ++i) {
+            const size_t t = (start + i) % nrTensors;
+            if (locked[t]) continue;
+
+            const size_t newSize0 = side[t] == 0 ? size0 - 1 : size0 + 1;
+            if (newSize0 < minSize || newSize0 > maxSize) continue;
+
+            if (!found || gain[t] > gain[bestTensor]) {
+              bestTensor = t;
+              found = true;
+            }
+          }
+
+          if (!found) break;
+
+          cumulatedGain += gain[bestTensor];
+          move(bestTensor);
+          locked[bestTensor] = true;
+          moves.push_back(bestTensor);
+
+          if (cumulatedGain > bestGain) {
+            bestGain = cumulatedGain;
+            bestMoves = moves.size();
+          }
+        }
+
+        // undo the moves after the best cut
+        while (moves.size() > bestMoves) {
+          move(moves.back());
+          moves.pop_back();
+        }
+
+        if (bestGain <= 0) break;
+      }
+
+      for (size_t t = 0; t < nrTensors; ++t)
+        if (side[t] == 0)
+          part1.push_back(part[t]);
+        else
+          part2.push_back(part[t]);
+    }
+
+    // rotates (a, (b, c)) into (b, (a, c)) or (c, (a, b)) when it's cheaper;
+    // the indices of the result do not change, so the ancestors are not
+    // affected
+    void Refine(const Clock::time_point &deadline) {
+      const int nrNodes = static_cast<int>(tree.nodes.size());
+      const int nrLeaves = static_cast<int>(graph.legs.size());
+
+      bool improved = true;
+      for (size_t pass = 0; improved && pass < maxRefinePasses; ++pass) {
+        if (Clock::now() >= deadline) break;
+        improved = false;
+
+        for (int node = nrLeaves; node < nrNodes; ++node)
+          for (int childPos = 0; childPos < 2; ++childPos) {
+            auto &treeNode = tree.nodes[node];
+            const int child = childPos == 0 ? treeNode.left : treeNode.right;
+            const int a = childPos == 0 ? treeNode.right : treeNode.left;
+            if (child < nrLeaves) continue;
+
+            const int b = tree.nodes[child].left;
+            const int c = tree.nodes[child].right;
+            const auto &legsA = tree.nodes[a].legs;
+            const auto &legsB = tree.nodes[b].legs;
+            const auto &legsC = tree.nodes[c].legs;
+
+            const double cost = treeNode.cost + tree.nodes[child].cost;
+
+            // (b, (a, c))
+            Legs legsAC;
+            std::set_symmetric_difference(legsA.begin(), legsA.end(),
+                                          legsC.begin(), legsC.end(),
+                                          std::back_inserter(legsAC));
+            const double costB = ContractionCost(legsA, legsC) +
+                                 ContractionCost(legsB, legsAC);
+
+            // (c, (a, b))
+            Legs legsAB;
+            std::set_symmetric_difference(legsA.begin(), legsA.end(),
+                                          legsB.begin(), legsB.end(),
+                                          std::back_inserter(legsAB));
+            const double costC = ContractionCost(legsA, legsB) +
+                                 ContractionCost(legsC, legsAB);
+
+            if (std::min(costB, costC) >= cost * (1. - 1E-9)) continue;
+
+            if (costB <= costC) {
+              SetChildren(child, a, c);
+              SetChildren(node, b, child);
+            } else {
+              SetChildren(child, a, b);
+              SetChildren(node, c, child);
+            }
+
+            improved = true;
+          }
+      }
+    }
+
+    const Graph &graph;
+    std::mt19937 &rng;
+    double imbalance;
+    std::vector<int> localPos;
+    Tree tree;
+  };
+
+  std::mt19937 gen;
+  size_t numberOfTrials = 8; /**< The number of randomized trials. */
+  double timeBudget =
+      1.; /**< The time allowed for finding the contraction tree, in seconds. */
+  double maxImbalance = 0.2; /**< The maximum imbalance of the bisections. */
+  double lastPathCost = 0; /**< The cost of the last contraction tree. */
+  size_t memoryLimit =
+      0; /**< The maximum size of an intermediate tensor, zero for no limit. */
+  size_t lastSlicedIndices =
+      0; /**< The number of indices sliced in the last contraction. */
+};
+
+}  // namespace TensorNetworks
+
+#endif  // __PARTITION_CONTRACTOR_H_
@@ -44,7 +44,8 @@ class StochasticContractor : public BaseContractor {
    * @param network The tensor network to contract.
    * @return The result of the contraction.
    */
-  double Contract(const TensorNetwork &network, Types::qubit_t qubit) override {
+  double ContractNetwork(const TensorNetwork &network,
+                         Types::qubit_t qubit) override {
     // algorithm very similar with the 'Algorithm 2' from arXiv:1709.03636v2
     // [quant-ph] 22 Dec 2018 qTorch: The quantum tensor contraction handler
     // there are some changes, though, in picking up the contraction
@@ -76,6 +77,7 @@ class StochasticContractor : public BaseContractor {
           0LL, static_cast<Eigen::Index>(tensor1->connections.size()) - 1);
       auto pos2 = tensor2Dist(gen);
       Eigen::Index tensor2Id = tensor1->connections[pos2];
+      if (tensor2Id == TensorNode::NotConnected) continue;
 
       auto t1 = tensor1Id;
       auto t2 = tensor2Id;
@@ -122,7 +124,7 @@ class StochasticContractor : public BaseContractor {
         if (resultRank == 0) {
           if (tensors.size() == 1 ||
               tensors[tensor1Id]->contractsTheNeededQubit)
-            return std::real(tensors[tensor1Id]->tensor->atOffset(0));
+            return GetContractionResult(tensors, tensor1Id);
 
           // erasing this tensor happens because (not the case anymore, it's
           // avoided) the tensor network might be a disjoint one and a
@@ -144,7 +146,7 @@ class StochasticContractor : public BaseContractor {
       }
     }
 
-    return std::real(tensors.begin()->second->tensor->atOffset(0));
+    return GetContractionResult(tensors, tensors.begin()->first);
   }
 
   size_t GetMaxRejections() const { return MaxRejections; }
@@ -161,6 +163,8 @@ class StochasticContractor : public BaseContractor {
 
     cloned->maxTensorRank = maxTensorRank;
     cloned->enableMultithreading = enableMultithreading;
+    cloned->maxCachedPaths = maxCachedPaths;
+    cloned->maxCachedBytes = maxCachedBytes;
     cloned->MaxRejections = MaxRejections;
 
     return cloned;
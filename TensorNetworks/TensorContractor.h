@@ -53,6 +53,45 @@ class ITensorContractor {
 
   virtual size_t GetMaxTensorRank() const = 0;
 
+  /**
+   * @brief Get the tensor node the last contraction resulted in.
+   *
+   * Contract returns only the real part of a scalar result. If the network
+   * has indices that are not connected, the result is a tensor with those
+   * indices, in the order given by the qubits of the node.
+   *
+   * @return The node with the result of the last contraction.
+   */
+  virtual std::shared_ptr<TensorNode> GetLastResult() const = 0;
+
+  /**
+   * @brief Clear the cached contraction data.
+   *
+   * Releases the contraction paths and intermediate tensors kept for reuse.
+   */
+  virtual void ClearCache() = 0;
+
+  /**
+   * @brief Save the cached contraction data.
+   *
+   * The paths are saved together with the intermediate tensors, the tensors
+   * shared with the network are written only once.
+   *
+   * @param writer The writer for the tensors.
+   * @sa TensorNetwork::Save
+   */
+  virtual void SaveCache(TensorsWriter &writer) const = 0;
+
+  /**
+   * @brief Load the cached contraction data.
+   *
+   * Replaces the cached data with the one saved by SaveCache.
+   *
+   * @param reader The reader for the tensors.
+   * @sa TensorNetwork::Load
+   */
+  virtual void LoadCache(TensorsReader &reader) = 0;
+
   /**
    * @brief Enable/disable multithreading.
    *
@@ -72,6 +111,14 @@ class ITensorContractor {
    */
   virtual bool GetMultithreading() const = 0;
 
+  /**
+   * @brief Get the memory limit.
+   *
+   * @return The maximum size of an intermediate tensor, in bytes, zero if
+   * there is no limit.
+   */
+  virtual size_t GetMemoryLimit() const = 0;
+
   /**
    * @brief Clone the tensor contractor.
    *
@@ -16,12 +16,19 @@
 #define __TENSOR_NETWORK_H_ 1
 
 #include <Eigen/Eigen>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "TensorContractor.h"
 #include "TensorNode.h"
 
+#include "../Utils/MappedFileReader.h"
+
 namespace TensorNetworks {
 
 class TensorNetwork {
@@ -61,6 +68,11 @@ class TensorNetwork {
     tensors.clear();
     qubitsGroups.clear();
     Clean(GetNumQubits());
+
+    if (contractor) contractor->ClearCache();
+
+    // the simulation is done, return the tensors memory
+    Utils::TensorMemoryPool::Trim();
   }
 
   void AddGate(
@@ -120,55 +132,109 @@ class TensorNetwork {
    * @return The expected value of the specified Pauli string.
    */
   double ExpectationValue(const std::string &pauliString) {
-    if (pauliString.empty())
-      return 1.;
-    else if (!contractor)
-      return 0.;
+    return ExpectationValues(std::vector<std::string>{pauliString})[0];
+  }
+
+  /**
+   * @brief Returns the expected values of many Pauli strings.
+   *
+   * The gates outside the light cone of the qubits the Pauli strings act on
+   * cancel with their adjoints (U^dagger U = I), so if light cone cancellation
+   * is enabled they are removed from the network before the contraction. The
+   * network is simplified once, for all the qubits used by the strings, and
+   * then it's shared by all of them.
+   *
+   * @param pauliStrings The Pauli strings to obtain the expected values for.
+   * @return The expected values, in the order of the Pauli strings.
+   */
+  std::vector<double> ExpectationValues(
+      const std::vector<std::string> &pauliStrings) {
+    std::vector<double> results(pauliStrings.size(), 1.);
+
+    std::vector<bool> usedQubits(GetNumQubits(), false);
+    bool anyUsed = false;
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      const auto &pauliString = pauliStrings[i];
+      if (pauliString.empty()) continue;
+
+      if (!contractor) {
+        results[i] = 0.;
+        continue;
+      }
+
+      for (Types::qubit_t q = 0;
+           q < pauliString.size() && q < GetNumQubits(); ++q) {
+        const char op = toupper(pauliString[q]);
+        if (op == 'X' || op == 'Y' || op == 'Z') {
+          usedQubits[q] = true;
+          anyUsed = true;
+        }
+      }
+    }
 
-    auto savedTensorsNrLocal = tensors.size();
-    auto saveLastTensorsLocal = lastTensors;
-    auto saveLastTensorIndicesLocal = lastTensorIndices;
+    if (!anyUsed) return results;
+
+    contractor->SetMultithreading(enableMultithreading);
+
+    // the connections of the nodes are changed, so work on copies of them (the
+    // tensors are not copied) and restore the originals at the end
+    auto saveTensorsLocal = tensors;
+    for (auto &tensor : tensors) tensor = tensor->CloneWithoutTensorCopy();
+
+    Connect();
+    if (lightConeCancellation) CancelOutsideLightCone(usedQubits);
+
+    const auto savedTensorsNrLocal = tensors.size();
+    const auto saveLastTensorsLocal = lastTensors;
+    const auto saveLastTensorIndicesLocal = lastTensorIndices;
 
     // add the gates from the Pauli string
     const QC::Gates::PauliXGate<TensorNode::MatrixClass> XGate;
     const QC::Gates::PauliYGate<TensorNode::MatrixClass> YGate;
     const QC::Gates::PauliZGate<TensorNode::MatrixClass> ZGate;
 
-    std::unordered_set<Types::qubit_t> usedQubits;
-
-    for (Types::qubit_t q = 0; q < pauliString.size(); ++q) {
-      const char op = toupper(pauliString[q]);
-      switch (op) {
-        case 'X':
-          AddOneQubitExpectationValueOp(XGate, q);
-          usedQubits.insert(q);
-          break;
-        case 'Y':
-          AddOneQubitExpectationValueOp(YGate, q);
-          usedQubits.insert(q);
-          break;
-        case 'Z':
-          AddOneQubitExpectationValueOp(ZGate, q);
-          usedQubits.insert(q);
-          break;
-        case 'I':
-          [[fallthrough]];
-        default:
-          break;
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      const auto &pauliString = pauliStrings[i];
+      if (pauliString.empty()) continue;
+
+      std::vector<Types::qubit_t> stringQubits;
+
+      for (Types::qubit_t q = 0;
+           q < pauliString.size() && q < GetNumQubits(); ++q) {
+        const char op = toupper(pauliString[q]);
+        switch (op) {
+          case 'X':
+            AddOneQubitExpectationValueOp(XGate, q);
+            stringQubits.push_back(q);
+            break;
+          case 'Y':
+            AddOneQubitExpectationValueOp(YGate, q);
+            stringQubits.push_back(q);
+            break;
+          case 'Z':
+            AddOneQubitExpectationValueOp(ZGate, q);
+            stringQubits.push_back(q);
+            break;
+          case 'I':
+            [[fallthrough]];
+          default:
+            break;
+        }
       }
-    }
 
-    if (usedQubits.empty()) return 1.;
+      if (stringQubits.empty()) continue;
 
-    const double result = Contract(usedQubits);
+      Connect();
+      results[i] = ContractParts(stringQubits);
 
-    tensors.resize(savedTensorsNrLocal);
-    lastTensors.swap(saveLastTensorsLocal);
-    lastTensorIndices.swap(saveLastTensorIndicesLocal);
+      tensors.resize(savedTensorsNrLocal);
+      lastTensors = saveLastTensorsLocal;
+      lastTensorIndices = saveLastTensorIndicesLocal;
+    }
 
-    Disconnect();
+    tensors.swap(saveTensorsLocal);
 
-    return result;
+    return results;
   }
 
   double getBasisStateProbability(size_t outcome) {
@@ -191,6 +257,167 @@ class TensorNetwork {
     return prob;
   }
 
+  /**
+   * @brief Returns the amplitudes of many basis states.
+   *
+   * Only the ket part of the network is contracted, each qubits group
+   * separately, the amplitude being the product of the ones of the groups. In
+   * a group, some qubits are left open, so one contraction gives the
+   * amplitudes for all their values (a slab). The other qubits are closed with
+   * basis state tensors, with one contraction for each of their values needed
+   * by the outcomes. The contraction path is cached, so the intermediate
+   * tensors that do not depend on the values of the closed qubits are computed
+   * only once for the whole batch.
+   *
+   * @param outcomes The basis states to obtain the amplitudes for.
+   * @return The amplitudes, in the order of the outcomes.
+   * @sa TensorNetwork::SetMaxOpenQubits
+   */
+  std::vector<std::complex<double>> Amplitudes(
+      const std::vector<Types::qubit_t> &outcomes) {
+    std::vector<std::complex<double>> results(outcomes.size(), 1.);
+    if (outcomes.empty()) return results;
+
+    if (!contractor) {
+      std::fill(results.begin(), results.end(), 0.);
+      return results;
+    }
+
+    contractor->SetMultithreading(enableMultithreading);
+    const size_t memoryLimit = contractor->GetMemoryLimit();
+
+    // the connections of the nodes are changed and the super tensors are not
+    // needed, so work on copies of the ket ones and restore the originals at
+    // the end
+    auto saveTensorsLocal = tensors;
+    for (size_t i = 0; i < tensors.size(); ++i)
+      tensors[i] = i % 2 ? nullptr : tensors[i]->CloneWithoutTensorCopy();
+
+    for (Types::qubit_t q = 0; q < GetNumQubits(); ++q) {
+      const auto &lastTensor = tensors[lastTensors[q]];
+      lastTensor->connections[lastTensorIndices[q]] = TensorNode::NotConnected;
+      lastTensor->connectionsIndices[lastTensorIndices[q]] =
+          TensorNode::NotConnected;
+    }
+
+    // the same tensors are used for all the contractions, so the contractor
+    // sees as changed only the ones of the qubits with changed values
+    const std::shared_ptr<Utils::Tensor<>> basisTensors[2] = {
+        Factory::CreateQubit0Tensor(), Factory::CreateQubit1Tensor()};
+
+    const auto savedTensorsNrLocal = tensors.size();
+
+    for (const auto &[groupId, group] : qubitsGroups) {
+      std::vector<Types::qubit_t> groupQubits(group.begin(), group.end());
+      std::sort(groupQubits.begin(), groupQubits.end());
+
+      // a qubit alone in its group has the one qubit gates contracted into
+      // its tensor
+      const auto &firstTensor = tensors[lastTensors[groupQubits[0]]];
+      if (groupQubits.size() == 1 && firstTensor->GetRank() == 1) {
+        const auto q = groupQubits[0];
+        for (size_t i = 0; i < outcomes.size(); ++i)
+          results[i] *= (*firstTensor->tensor)[(outcomes[i] >> q) & 1];
+        continue;
+      }
+
+      Types::qubit_t groupMask = 0;
+      for (const auto q : groupQubits) groupMask |= 1ULL << q;
+
+      std::vector<Types::qubit_t> keys(outcomes.size());
+      for (size_t i = 0; i < outcomes.size(); ++i)
+        keys[i] = outcomes[i] & groupMask;
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+      // open as many qubits as the slab does not exceed the number of
+      // outcomes, the ones with the values split most evenly among them
+      // with a memory limit the slab takes at most half of it, the open
+      // indices cannot be sliced, so the rest is left for the slices
+      size_t nrOpen = 0;
+      while (nrOpen < maxOpenQubits && nrOpen < groupQubits.size() &&
+             (2ULL << nrOpen) <= keys.size() &&
+             (memoryLimit == 0 ||
+              (sizeof(std::complex<double>) << (nrOpen + 2)) <= memoryLimit))
+        ++nrOpen;
+
+      std::vector<std::pair<size_t, Types::qubit_t>> balance;
+      for (const auto q : groupQubits) {
+        size_t ones = 0;
+        for (const auto key : keys) ones += (key >> q) & 1;
+        balance.emplace_back(std::min(ones, keys.size() - ones), q);
+      }
+      std::sort(balance.begin(), balance.end(),
+                [](const auto &a, const auto &b) { return a.first > b.first; });
+
+      Types::qubit_t closedMask = groupMask;
+      for (size_t i = 0; i < nrOpen; ++i)
+        closedMask &= ~(1ULL << balance[i].second);
+
+      // the values of the closed qubits are visited in the Gray code order, so
+      // that consecutive contractions differ in few of them
+      std::vector<std::pair<Types::qubit_t, Types::qubit_t>> orderedKeys;
+      orderedKeys.reserve(keys.size());
+      for (const auto key : keys) {
+        Types::qubit_t code = 0;
+        size_t bit = 0;
+        for (const auto q : groupQubits)
+          if ((closedMask >> q) & 1) code |= ((key >> q) & 1) << bit++;
+        for (size_t shift = 1; shift < 64; shift <<= 1) code ^= code >> shift;
+
+        orderedKeys.emplace_back(code, key);
+      }
+      std::sort(orderedKeys.begin(), orderedKeys.end());
+
+      std::unordered_map<Types::qubit_t, std::complex<double>> groupAmplitudes;
+
+      for (size_t start = 0; start < orderedKeys.size();) {
+        const Types::qubit_t closed = orderedKeys[start].second & closedMask;
+        size_t end = start + 1;
+        while (end < orderedKeys.size() &&
+               (orderedKeys[end].second & closedMask) == closed)
+          ++end;
+
+        for (const auto q : groupQubits)
+          if ((closedMask >> q) & 1)
+            AddBasisStateTensor(q, basisTensors[(closed >> q) & 1]);
+
+        contractor->Contract(*this, groupQubits[0]);
+
+        // the open qubits are the indices of the result, the first one
+        // changing the fastest
+        const auto result = contractor->GetLastResult();
+        for (size_t k = start; k < end; ++k) {
+          const auto key = orderedKeys[k].second;
+
+          size_t offset = 0;
+          for (size_t i = 0; i < nrOpen; ++i)
+            if ((key >> result->qubits[i]) & 1) offset |= 1ULL << i;
+
+          groupAmplitudes[key] = (*result->tensor)[offset];
+        }
+
+        tensors.resize(savedTensorsNrLocal);
+        start = end;
+      }
+
+      for (const auto q : groupQubits) {
+        const auto &lastTensor = tensors[lastTensors[q]];
+        lastTensor->connections[lastTensorIndices[q]] =
+            TensorNode::NotConnected;
+        lastTensor->connectionsIndices[lastTensorIndices[q]] =
+            TensorNode::NotConnected;
+      }
+
+      for (size_t i = 0; i < outcomes.size(); ++i)
+        results[i] *= groupAmplitudes[outcomes[i] & groupMask];
+    }
+
+    tensors.swap(saveTensorsLocal);
+
+    return results;
+  }
+
   bool Measure(Types::qubit_t qubit) {
     const double p0 = Probability(qubit, false);
     const double prob = uniformZeroOne(rng);
@@ -205,6 +432,67 @@ class TensorNetwork {
     return false;
   }
 
+  /**
+   * @brief Samples the outcomes of measuring the specified qubits.
+   *
+   * The qubits are sampled one by one, from their conditional marginal
+   * probabilities. The shots that got the same outcomes for the already
+   * sampled qubits are grouped together, so a conditional marginal is
+   * computed with a single contraction for each distinct prefix, not for each
+   * shot, and the shots are split between the two outcomes of the next qubit
+   * with a binomial draw. The networks for the prefixes of the same length
+   * have the same structure, differing only in the projectors values, so the
+   * contractor reuses the cached path and the intermediate tensors that do not
+   * depend on the changed projectors. The qubits groups are independent, a
+   * marginal is conditioned only on the prefix qubits in the same group.
+   *
+   * The network is not changed.
+   *
+   * @param qubits The qubits to be sampled.
+   * @param shots The number of shots.
+   * @return A map with the counts for the outcomes, the outcome for the i-th
+   * qubit in qubits being at the position i.
+   */
+  std::unordered_map<std::vector<bool>, Types::qubit_t> SampleCounts(
+      const std::vector<Types::qubit_t> &qubits, size_t shots) {
+    if (qubits.empty() || shots == 0 || !contractor) return {};
+    contractor->SetMultithreading(enableMultithreading);
+
+    SamplingContext context;
+    std::vector<size_t> positions(qubits.size());
+    for (size_t i = 0; i < qubits.size(); ++i) {
+      const auto it =
+          std::find(context.order.begin(), context.order.end(), qubits[i]);
+      positions[i] = it - context.order.begin();
+      if (it == context.order.end()) context.order.push_back(qubits[i]);
+
+      context.groupsProbabilities[qubitsMap[qubits[i]]] = 1.;
+    }
+
+    // shared by all projectors, a projector with an unchanged value is not
+    // seen as a changed leaf of the cached contraction path
+    context.projectors[0] = Factory::CreateProjectionTensor(true);
+    context.projectors[1] = Factory::CreateProjectionTensor(false);
+
+    std::vector<bool> prefix;
+    prefix.reserve(context.order.size());
+    SampleSubtree(shots, prefix, context);
+
+    if (context.order.size() == qubits.size()) return context.counts;
+
+    // some qubits are repeated
+    std::unordered_map<std::vector<bool>, Types::qubit_t> result;
+    for (const auto &[meas, count] : context.counts) {
+      std::vector<bool> outcome(qubits.size());
+      for (size_t i = 0; i < qubits.size(); ++i)
+        outcome[i] = meas[positions[i]];
+
+      result[outcome] += count;
+    }
+
+    return result;
+  }
+
   void AddProjector(Types::qubit_t qubit, bool zero = true) {
     // add a projector tensor for the qubit, either zero or one
     auto tensorNode = std::make_shared<TensorNode>();
@@ -361,6 +649,9 @@ class TensorNetwork {
       const auto &lastTensor = tensors[lastTensorId];
       const auto &lastTensorSuper = tensors[lastTensorSuperId];
 
+      // removed by the light cone cancellation
+      if (!lastTensor || !lastTensorSuper) continue;
+
       const auto tensorIndexOnQubit = lastTensorIndices[q];
       const auto tensorSuperIndexOnQubit = lastTensorIndicesSuper[q];
 
@@ -383,6 +674,8 @@ class TensorNetwork {
       const auto &lastTensor = tensors[lastTensorId];
       const auto &lastTensorSuper = tensors[lastTensorSuperId];
 
+      if (!lastTensor || !lastTensorSuper) continue;
+
       const auto tensorIndexOnQubit = lastTensorIndices[q];
       const auto tensorSuperIndexOnQubit = lastTensorIndicesSuper[q];
 
@@ -420,6 +713,208 @@ class TensorNetwork {
    */
   bool GetMultithreading() const { return enableMultithreading; }
 
+  /**
+   * @brief Enable/disable the light cone cancellation.
+   *
+   * If enabled, the gates outside the light cone of the qubits used in the
+   * expectation values are removed before contraction. Default is enabled.
+   *
+   * @param enable A flag to indicate if light cone cancellation should be
+   * enabled.
+   */
+  void SetLightConeCancellation(bool enable = true) {
+    lightConeCancellation = enable;
+  }
+
+  /**
+   * @brief Get the light cone cancellation flag.
+   *
+   * @return The light cone cancellation flag.
+   */
+  bool GetLightConeCancellation() const { return lightConeCancellation; }
+
+  /**
+   * @brief Set the maximum number of qubits left open in a contraction.
+   *
+   * Used when obtaining many amplitudes at once, a contraction with n open
+   * qubits gives 2^n amplitudes, but the intermediate tensors can get up to
+   * 2^n times larger. Default is 10.
+   *
+   * @param maxOpen The maximum number of open qubits.
+   * @sa TensorNetwork::Amplitudes
+   */
+  void SetMaxOpenQubits(size_t maxOpen) { maxOpenQubits = maxOpen; }
+
+  /**
+   * @brief Get the maximum number of qubits left open in a contraction.
+   *
+   * @return The maximum number of open qubits.
+   */
+  size_t GetMaxOpenQubits() const { return maxOpenQubits; }
+
+  /**
+   * @brief Save the network in the binary format.
+   *
+   * Saves the tensors, the saved state and the settings, optionally the
+   * contraction paths cached by the contractor, together with their
+   * intermediate tensors. The tensors shared between nodes are written only
+   * once. The contractor itself is not saved.
+   *
+   * @param stream The stream to write to, opened in binary mode.
+   * @param withContractionCache Save the cached contraction paths as well.
+   * @sa TensorNetwork::Load
+   */
+  void Save(std::ostream &stream, bool withContractionCache = true) const {
+    Utils::BinaryWriter binaryWriter(stream);
+    TensorsWriter writer(binaryWriter);
+
+    binaryWriter.Write(FileMagic);
+    binaryWriter.Write(FileVersion);
+    binaryWriter.WriteSize(GetNumQubits());
+
+    SaveNodes(writer, tensors);
+    binaryWriter.WriteVector(lastTensors);
+    binaryWriter.WriteVector(lastTensorsSuper);
+    binaryWriter.WriteVector(lastTensorIndices);
+    binaryWriter.WriteVector(lastTensorIndicesSuper);
+    binaryWriter.WriteVector(qubitsMap);
+    SaveGroups(binaryWriter, qubitsGroups);
+
+    binaryWriter.WriteSize(savedTensorsNr);
+    SaveNodes(writer, saveTensors);
+    binaryWriter.WriteVector(saveLastTensors);
+    binaryWriter.WriteVector(saveLastTensorsSuper);
+    binaryWriter.WriteVector(saveLastTensorIndices);
+    binaryWriter.WriteVector(saveLastTensorIndicesSuper);
+    binaryWriter.WriteVector(saveQubitsMap);
+    SaveGroups(binaryWriter, saveQubitsGroups);
+
+    binaryWriter.Write(enableMultithreading);
+    binaryWriter.Write(lightConeCancellation);
+    binaryWriter.Write(maxOpenQubits);
+
+    // last, so it can be skipped if there is no contractor when loading
+    const bool withCache = withContractionCache && contractor;
+    binaryWriter.Write(withCache);
+    if (withCache) contractor->SaveCache(writer);
+  }
+
+  /**
+   * @brief Save the network in a binary file.
+   *
+   * @param fileName The name of the file.
+   * @param withContractionCache Save the cached contraction paths as well.
+   * @sa TensorNetwork::Save
+   */
+  void Save(const std::string &fileName,
+            bool withContractionCache = true) const {
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Cannot open the file " + fileName);
+
+    Save(file, withContractionCache);
+  }
+
+  /**
+   * @brief Load a network saved in the binary format.
+   *
+   * Replaces the network, including the number of qubits. The contractor set
+   * on this network is kept, its cache is replaced with the saved one, if any.
+   *
+   * @param stream The stream to read from, opened in binary mode.
+   * @sa TensorNetwork::Save
+   */
+  void Load(std::istream &stream) {
+    Utils::BinaryReader binaryReader(stream);
+    Load(binaryReader);
+  }
+
+  /**
+   * @brief Load a network from a binary file.
+   *
+   * @param fileName The name of the file.
+   * @param memoryMapped Map the file in memory instead of reading it through a
+   * stream.
+   * @sa TensorNetwork::Load
+   */
+  void Load(const std::string &fileName, bool memoryMapped = true) {
+    if (memoryMapped) {
+      Utils::MappedFileReader file(fileName);
+      Load(file.GetReader());
+      return;
+    }
+
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open the file " + fileName);
+
+    Load(file);
+  }
+
+  /**
+   * @brief Load a network saved in the binary format.
+   *
+   * @param binaryReader The reader for the binary data.
+   * @sa TensorNetwork::Save
+   */
+  void Load(Utils::BinaryReader &binaryReader) {
+    if (binaryReader.Read<uint32_t>() != FileMagic)
+      throw std::runtime_error("Not a tensor network binary file.");
+    if (binaryReader.Read<uint32_t>() > FileVersion)
+      throw std::runtime_error(
+          "The tensor network binary file has a newer version.");
+
+    TensorsReader reader(binaryReader);
+
+    // loaded separately, to leave this network unchanged if the data is
+    // invalid
+    TensorNetwork loaded(0);
+
+    const size_t numQubits = binaryReader.ReadSize();
+
+    loaded.tensors = LoadNodes(reader);
+    loaded.lastTensors = binaryReader.ReadVector<Index>();
+    loaded.lastTensorsSuper = binaryReader.ReadVector<Index>();
+    loaded.lastTensorIndices = binaryReader.ReadVector<Index>();
+    loaded.lastTensorIndicesSuper = binaryReader.ReadVector<Index>();
+    loaded.qubitsMap = binaryReader.ReadVector<size_t>();
+    loaded.qubitsGroups = LoadGroups(binaryReader);
+
+    loaded.savedTensorsNr = binaryReader.ReadSize();
+    loaded.saveTensors = LoadNodes(reader);
+    loaded.saveLastTensors = binaryReader.ReadVector<Index>();
+    loaded.saveLastTensorsSuper = binaryReader.ReadVector<Index>();
+    loaded.saveLastTensorIndices = binaryReader.ReadVector<Index>();
+    loaded.saveLastTensorIndicesSuper = binaryReader.ReadVector<Index>();
+    loaded.saveQubitsMap = binaryReader.ReadVector<size_t>();
+    loaded.saveQubitsGroups = LoadGroups(binaryReader);
+
+    loaded.enableMultithreading = binaryReader.Read<bool>();
+    loaded.lightConeCancellation = binaryReader.Read<bool>();
+    loaded.maxOpenQubits = binaryReader.Read<size_t>();
+
+    if (!loaded.IsValid(numQubits))
+      throw std::runtime_error("Invalid tensor network binary data.");
+
+    // if the cached paths are invalid, the network is still left unchanged,
+    // but the cache is cleared
+    if (contractor) {
+      try {
+        if (binaryReader.Read<bool>())
+          contractor->LoadCache(reader);
+        else
+          contractor->ClearCache();
+      } catch (...) {
+        contractor->ClearCache();
+        throw;
+      }
+
+      contractor->SetMultithreading(loaded.enableMultithreading);
+    }
+
+    loaded.contractor = contractor;
+    loaded.rng = rng;
+    *this = std::move(loaded);
+  }
+
   std::unique_ptr<TensorNetwork> Clone() const {
     auto cloned = std::make_unique<TensorNetwork>(0);
 
@@ -513,6 +1008,97 @@ class TensorNetwork {
     lastTensorIndices[q] = 1;
   }
 
+  struct SamplingContext {
+    std::vector<Types::qubit_t> order;  // the distinct qubits to be sampled
+    std::unordered_map<size_t, double>
+        groupsProbabilities;  // the probabilities of the current prefix,
+                              // restricted to each qubits group
+    std::shared_ptr<Utils::Tensor<>> projectors[2];
+    std::unordered_map<std::vector<bool>, Types::qubit_t> counts;
+  };
+
+  constexpr static double kMinBranchProbability =
+      1e-12; /**< Branches less probable than this don't get shots. */
+
+  // samples depth first the subtree of the prefix, with the projectors for the
+  // prefix already in the network
+  void SampleSubtree(size_t shots, std::vector<bool> &prefix,
+                     SamplingContext &context) {
+    if (prefix.size() == context.order.size()) {
+      context.counts[prefix] += shots;
+      return;
+    }
+
+    const auto qubit = context.order[prefix.size()];
+    const auto group = qubitsMap[qubit];
+    const double prefixProbability = context.groupsProbabilities[group];
+
+    const auto lastTensorIdOnQubit = lastTensors[qubit];
+    const auto lastTensorIndexOnQubit = lastTensorIndices[qubit];
+
+    AddProjector(qubit, true);
+    const auto projector = tensors.back();
+    projector->tensor = context.projectors[0];
+
+    Connect();
+    const double joint0 = std::max(contractor->Contract(*this, qubit), 0.);
+    const double prob0 = std::clamp(joint0 / prefixProbability, 0., 1.);
+
+    size_t shots0;
+    if (prob0 < kMinBranchProbability)
+      shots0 = 0;
+    else if (prob0 > 1. - kMinBranchProbability)
+      shots0 = shots;
+    else
+      shots0 = std::binomial_distribution<size_t>(shots, prob0)(rng);
+
+    const size_t branchShots[2] = {shots0, shots - shots0};
+    const double branchProbabilities[2] = {
+        joint0, std::max(prefixProbability - joint0, 0.)};
+
+    for (int outcome = 0; outcome < 2; ++outcome) {
+      if (branchShots[outcome] == 0) continue;
+
+      projector->tensor = context.projectors[outcome];
+      context.groupsProbabilities[group] = branchProbabilities[outcome];
+
+      prefix.push_back(outcome == 1);
+      SampleSubtree(branchShots[outcome], prefix, context);
+      prefix.pop_back();
+    }
+
+    context.groupsProbabilities[group] = prefixProbability;
+
+    // remove the projector, as in Probability
+    lastTensors[qubit] = lastTensorIdOnQubit;
+    lastTensorIndices[qubit] = lastTensorIndexOnQubit;
+    tensors.resize(tensors.size() - 1);
+  }
+
+  // closes the output of the last tensor on the qubit with a basis state,
+  // without making it the last tensor, the network is restored by removing it
+  void AddBasisStateTensor(
+      Types::qubit_t qubit, const std::shared_ptr<Utils::Tensor<>> &basis) {
+    auto tensorNode = std::make_shared<TensorNode>();
+    tensorNode->qubits.push_back(qubit);
+    tensorNode->tensor = basis;
+
+    const auto newTensorId = static_cast<Index>(tensors.size());
+    tensorNode->SetId(newTensorId);
+
+    const auto tensorOnQubitId = lastTensors[qubit];
+    const auto indexOnQubit = lastTensorIndices[qubit];
+
+    const auto &lastTensor = tensors[tensorOnQubitId];
+    lastTensor->connections[indexOnQubit] = newTensorId;
+    lastTensor->connectionsIndices[indexOnQubit] = 0;
+
+    tensorNode->connections.push_back(tensorOnQubitId);
+    tensorNode->connectionsIndices.push_back(indexOnQubit);
+
+    tensors.emplace_back(std::move(tensorNode));
+  }
+
   void AddOneQubitGate(
       const QC::Gates::QuantumGateWithOp<TensorNode::MatrixClass> &gate,
       Types::qubit_t q, bool contractWithTwoQubitTensors = false,
@@ -822,41 +1408,335 @@ class TensorNetwork {
     return result;
   }
 
-  double Contract(const std::unordered_set<Types::qubit_t> &qubits) {
-    if (!contractor) return 0;
-    contractor->SetMultithreading(enableMultithreading);
-
-    Connect();
+  // contracts the parts of the network that contain the qubits, the network
+  // must be connected; after the light cone cancellation a qubits group can be
+  // split in several parts, each one is contracted separately
+  double ContractParts(const std::vector<Types::qubit_t> &qubits) {
+    std::unordered_set<Index> visited;
 
-    // contract the network, save result to return
     double result = 1;
 
-    for (auto &group : qubitsGroups) {
-      // this is probably less costly than contracting
-      for (const auto q : group.second)
-        if (qubits.find(q) != qubits.end()) {
-          // this group has at least one qubit in the set, contract it
-          // break to avoid contracting it multiple times
-          const double groupResult = contractor->Contract(
-              *this, q);  // doesn't really matter which qubit is passed as long
-                          // it belongs to the group
-          if (groupResult == 0) return 0;
-          result *= groupResult;
+    for (const auto q : qubits) {
+      const Index tensorId = lastTensors[q];
+      if (!visited.insert(tensorId).second) continue;
+
+      // mark the part that contains the qubit
+      std::vector<Index> toVisit{tensorId};
+      while (!toVisit.empty()) {
+        const auto &tensor = tensors[toVisit.back()];
+        toVisit.pop_back();
+
+        for (const auto connectedId : tensor->connections)
+          if (connectedId != TensorNode::NotConnected &&
+              visited.insert(connectedId).second)
+            toVisit.push_back(connectedId);
+      }
+
+      const double partResult = contractor->Contract(
+          *this, q);  // the contractor stops when the part with the qubit is
+                      // contracted
+      if (partResult == 0) return 0;
+      result *= partResult;
+    }
+
+    return result;
+  }
+
+  // Removes the pairs of tensors that cancel out with their super (adjoint)
+  // ones, going backwards from the ends of the qubits. A tensor cancels if all
+  // its output indices are connected to the same indices of the super tensor
+  // and it is unitary (U^dagger U = I), then its input indices are connected
+  // directly to the ones of the super tensor. The ends of the used qubits are
+  // kept, so their light cone is not removed, and the non unitary tensors
+  // (projectors) stop the cancellation. The network must be connected.
+  void CancelOutsideLightCone(const std::vector<bool> &usedQubits) {
+    // each tensor is followed by its super one
+    if (tensors.size() % 2) return;
+
+    std::unordered_set<Index> kept;
+    for (Types::qubit_t q = 0; q < GetNumQubits(); ++q)
+      if (usedQubits[q]) kept.insert(lastTensors[q]);
+
+    // the last tensors are checked first
+    std::vector<Index> toCheck;
+    toCheck.reserve(tensors.size() / 2);
+    for (Index tensorId = 0; tensorId < static_cast<Index>(tensors.size());
+         tensorId += 2)
+      toCheck.push_back(tensorId);
+
+    while (!toCheck.empty()) {
+      const Index tensorId = toCheck.back();
+      toCheck.pop_back();
+
+      const auto &tensor = tensors[tensorId];
+      if (!tensor || kept.find(tensorId) != kept.end()) continue;
+
+      const Index superId = tensorId + 1;
+      const auto &superTensor = tensors[superId];
+
+      // the input indices are the first half, for the qubit tensors there is
+      // only the output one
+      const size_t rank = tensor->connections.size();
+      const size_t nrInputs = rank / 2;
+
+      bool cancels = true;
+      for (size_t i = nrInputs; i < rank; ++i)
+        if (tensor->connections[i] != superId ||
+            tensor->connectionsIndices[i] != static_cast<Index>(i)) {
+          cancels = false;
           break;
         }
+
+      if (!cancels || !IsUnitary(*tensor->tensor, nrInputs)) continue;
+
+      for (size_t i = 0; i < nrInputs; ++i) {
+        const Index inputId = tensor->connections[i];
+        const Index inputIndex = tensor->connectionsIndices[i];
+        const Index superInputId = superTensor->connections[i];
+        const Index superInputIndex = superTensor->connectionsIndices[i];
+
+        tensors[inputId]->connections[inputIndex] = superInputId;
+        tensors[inputId]->connectionsIndices[inputIndex] = superInputIndex;
+        tensors[superInputId]->connections[superInputIndex] = inputId;
+        tensors[superInputId]->connectionsIndices[superInputIndex] = inputIndex;
+
+        toCheck.push_back(inputId);
+      }
+
+      tensors[tensorId].reset();
+      tensors[superId].reset();
     }
+  }
 
-    // no need to actually disconnect the indices, as they are not used unless
-    // they are connected again when adding a new gate/projection for
-    // measurement, they are reconnected anyway, the same goes for doing another
-    // contraction
+  // checks if the tensor contracted over the output indices with its conjugate
+  // gives the identity on the input indices (for a qubit tensor, that it's
+  // normalized)
+  static bool IsUnitary(const Utils::Tensor<> &tensor, size_t nrInputs) {
+    constexpr double precision = 1E-10;
+
+    size_t rows = 1;
+    for (size_t i = 0; i < nrInputs; ++i) rows *= tensor.GetDim(i);
+    const size_t cols = tensor.GetSize() / rows;
+
+    // fortran layout, the input indices are the fastest changing ones
+    for (size_t row1 = 0; row1 < rows; ++row1)
+      for (size_t row2 = row1; row2 < rows; ++row2) {
+        std::complex<double> sum = 0;
+        for (size_t col = 0; col < cols; ++col)
+          sum += tensor[row1 + rows * col] *
+                 std::conj(tensor[row2 + rows * col]);
+
+        if (std::abs(sum - (row1 == row2 ? 1. : 0.)) > precision) return false;
+      }
 
-    // return the result
-    return result;
+    return true;
   }
 
   void Clean(size_t numQubits) { SetQubitsTensors(numQubits); }
 
+  using QubitsGroups =
+      std::unordered_map<size_t, std::unordered_set<Types::qubit_t>>;
+
+  static void SaveNodes(TensorsWriter &writer,
+                        const std::vector<std::shared_ptr<TensorNode>> &nodes) {
+    auto &binaryWriter = writer.GetWriter();
+
+    binaryWriter.WriteSize(nodes.size());
+    for (const auto &node : nodes) {
+      binaryWriter.Write(static_cast<bool>(node));
+      if (node) node->Save(writer);
+    }
+  }
+
+  static std::vector<std::shared_ptr<TensorNode>> LoadNodes(
+      TensorsReader &reader) {
+    auto &binaryReader = reader.GetReader();
+
+    // grown as the nodes are read, the size of the data is not always known
+    // to check the number of nodes against it
+    const size_t nrNodes = binaryReader.ReadSize();
+    std::vector<std::shared_ptr<TensorNode>> nodes;
+    for (size_t n = 0; n < nrNodes; ++n) {
+      auto &node = nodes.emplace_back();
+      if (!binaryReader.Read<bool>()) continue;
+
+      node = std::make_shared<TensorNode>();
+      node->Load(reader);
+    }
+
+    return nodes;
+  }
+
+  static void SaveGroups(Utils::BinaryWriter &binaryWriter,
+                         const QubitsGroups &groups) {
+    binaryWriter.WriteSize(groups.size());
+    for (const auto &[groupId, group] : groups) {
+      binaryWriter.Write(groupId);
+      binaryWriter.WriteVector(
+          std::vector<Types::qubit_t>(group.begin(), group.end()));
+    }
+  }
+
+  static QubitsGroups LoadGroups(Utils::BinaryReader &binaryReader) {
+    QubitsGroups groups;
+
+    const size_t nrGroups = binaryReader.ReadSize();
+    for (size_t g = 0; g < nrGroups; ++g) {
+      const auto groupId = binaryReader.Read<size_t>();
+      const auto group = binaryReader.ReadVector<Types::qubit_t>();
+      groups[groupId].insert(group.begin(), group.end());
+    }
+
+    return groups;
+  }
+
+  // checks the loaded indices, so they can be used without bounds checking
+  bool IsValid(size_t numQubits) const {
+    if (lastTensors.size() != numQubits ||
+        lastTensorsSuper.size() != numQubits ||
+        lastTensorIndices.size() != numQubits ||
+        lastTensorIndicesSuper.size() != numQubits ||
+        qubitsMap.size() != numQubits || savedTensorsNr > tensors.size())
+      return false;
+
+    const auto validId = [this](Index id) {
+      return id >= 0 && static_cast<size_t>(id) < tensors.size();
+    };
+
+    for (Types::qubit_t q = 0; q < numQubits; ++q)
+      if (!validId(lastTensors[q]) || !validId(lastTensorsSuper[q]) ||
+          qubitsGroups.find(qubitsMap[q]) == qubitsGroups.end())
+        return false;
+
+    for (const auto &tensor : tensors)
+      if (tensor && !IsNodeValid(*tensor)) return false;
+
+    return AreConnectionsValid(tensors, lastTensors, lastTensorIndices,
+                               lastTensorsSuper, lastTensorIndicesSuper) &&
+           IsSavedStateValid(numQubits);
+  }
+
+  // the saved state is checked as well, restoring it must not go out of
+  // bounds either; the last tensors are saved without the tensors for the
+  // probabilities, so each part can be missing
+  bool IsSavedStateValid(size_t numQubits) const {
+    const bool hasSavedLast = !saveLastTensors.empty() ||
+                              !saveLastTensorsSuper.empty() ||
+                              !saveLastTensorIndices.empty() ||
+                              !saveLastTensorIndicesSuper.empty();
+    const bool hasSavedTensors = !saveTensors.empty() ||
+                                 !saveQubitsMap.empty() ||
+                                 !saveQubitsGroups.empty();
+
+    if (hasSavedTensors) {
+      if (saveQubitsMap.size() != numQubits ||
+          savedTensorsNr > saveTensors.size())
+        return false;
+
+      for (Types::qubit_t q = 0; q < numQubits; ++q)
+        if (saveQubitsGroups.find(saveQubitsMap[q]) == saveQubitsGroups.end())
+          return false;
+
+      // restoring clones all the saved tensors
+      for (const auto &tensor : saveTensors)
+        if (!tensor || !IsNodeValid(*tensor)) return false;
+    }
+
+    if (!hasSavedLast) return true;
+
+    if (saveLastTensors.size() != numQubits ||
+        saveLastTensorsSuper.size() != numQubits ||
+        saveLastTensorIndices.size() != numQubits ||
+        saveLastTensorIndicesSuper.size() != numQubits)
+      return false;
+
+    // the tensors are truncated to the saved number when restoring
+    const auto validIndex = [this](Index id, Index index) {
+      return id >= 0 && static_cast<size_t>(id) < savedTensorsNr &&
+             tensors[id] && index >= 0 &&
+             static_cast<size_t>(index) < tensors[id]->connections.size();
+    };
+
+    for (Types::qubit_t q = 0; q < numQubits; ++q)
+      if (!validIndex(saveLastTensors[q], saveLastTensorIndices[q]) ||
+          !validIndex(saveLastTensorsSuper[q], saveLastTensorIndicesSuper[q]))
+        return false;
+
+    if (!hasSavedTensors) return true;
+
+    return AreConnectionsValid(saveTensors, saveLastTensors,
+                               saveLastTensorIndices, saveLastTensorsSuper,
+                               saveLastTensorIndicesSuper);
+  }
+
+  static bool IsNodeValid(const TensorNode &node) {
+    return node.tensor && !node.qubits.empty() &&
+           node.GetRank() == node.qubits.size();
+  }
+
+  // The connections must be to the loaded tensors, on one of their indices.
+  // The exception are the open indices of the last tensors on the qubits, ket
+  // and super, the temporary tensors added there for probabilities and
+  // expectation values leave connections past the end, overwritten when adding
+  // tensors.
+  static bool AreConnectionsValid(
+      const std::vector<std::shared_ptr<TensorNode>> &tensors,
+      const std::vector<Index> &lastIds, const std::vector<Index> &lastIndices,
+      const std::vector<Index> &lastIdsSuper,
+      const std::vector<Index> &lastIndicesSuper) {
+    const auto areLastValid = [&tensors](const std::vector<Index> &ids,
+                                         const std::vector<Index> &indices) {
+      for (size_t q = 0; q < ids.size(); ++q) {
+        const auto &lastTensor = tensors[ids[q]];
+        if (!lastTensor || indices[q] < 0 ||
+            static_cast<size_t>(indices[q]) >= lastTensor->connections.size())
+          return false;
+      }
+
+      return true;
+    };
+
+    if (!areLastValid(lastIds, lastIndices) ||
+        !areLastValid(lastIdsSuper, lastIndicesSuper))
+      return false;
+
+    const auto isOpenIndex = [&](Index id, size_t index) {
+      for (size_t q = 0; q < lastIds.size(); ++q)
+        if ((lastIds[q] == id &&
+             static_cast<size_t>(lastIndices[q]) == index) ||
+            (lastIdsSuper[q] == id &&
+             static_cast<size_t>(lastIndicesSuper[q]) == index))
+          return true;
+
+      return false;
+    };
+
+    for (size_t t = 0; t < tensors.size(); ++t) {
+      const auto &tensor = tensors[t];
+      if (!tensor) continue;
+
+      for (size_t i = 0; i < tensor->connections.size(); ++i) {
+        const Index connectedId = tensor->connections[i];
+        if (connectedId == TensorNode::NotConnected) continue;
+
+        const bool valid =
+            connectedId >= 0 &&
+            static_cast<size_t>(connectedId) < tensors.size() &&
+            tensor->connectionsIndices[i] >= 0 &&
+            (!tensors[connectedId] ||
+             static_cast<size_t>(tensor->connectionsIndices[i]) <
+                 tensors[connectedId]->connections.size());
+
+        if (!valid && !isOpenIndex(static_cast<Index>(t), i)) return false;
+      }
+    }
+
+    return true;
+  }
+
+  constexpr static uint32_t FileMagic = 0x4E54534D;  // "MSTN"
+  constexpr static uint32_t FileVersion = 1;
+
   void SetQubitsTensors(size_t numQubits) {
     for (Types::qubit_t q = 0; q < numQubits; ++q) {
       qubitsMap[q] = q;  // the qubit group id is the qubit number itself
@@ -940,6 +1820,8 @@ class TensorNetwork {
   std::shared_ptr<ITensorContractor> contractor;
 
   bool enableMultithreading = true;
+  bool lightConeCancellation = true;
+  size_t maxOpenQubits = 10;
 
   std::mt19937_64 rng;
   std::uniform_real_distribution<double> uniformZeroOne;
@@ -21,9 +21,77 @@
 #include "Factory.h"
 #include <Eigen/Eigen>
 #include <memory>
+#include <unordered_map>
 
 namespace TensorNetworks {
 
+/**
+ * @brief Writes the tensors of the nodes, each tensor only once.
+ *
+ * The nodes share tensors (the saved state, the cached contraction paths or
+ * the qubit tensors, for example), a shared tensor is written the first time
+ * it's met, afterwards only its index is written, so the sharing is restored
+ * on loading.
+ */
+class TensorsWriter {
+ public:
+  explicit TensorsWriter(Utils::BinaryWriter &writer) : writer(writer) {}
+
+  Utils::BinaryWriter &GetWriter() { return writer; }
+
+  void Write(const std::shared_ptr<Utils::Tensor<>> &tensor) {
+    if (!tensor) {
+      writer.Write<int64_t>(-1);
+      return;
+    }
+
+    const auto it = indices.find(tensor.get());
+    if (it != indices.end()) {
+      writer.Write(it->second);
+      return;
+    }
+
+    const int64_t index = static_cast<int64_t>(indices.size());
+    indices[tensor.get()] = index;
+
+    writer.Write(index);
+    tensor->Save(writer);
+  }
+
+ private:
+  Utils::BinaryWriter &writer;
+  std::unordered_map<const Utils::Tensor<> *, int64_t> indices;
+};
+
+/**
+ * @brief Reads the tensors written by a TensorsWriter.
+ */
+class TensorsReader {
+ public:
+  explicit TensorsReader(Utils::BinaryReader &reader) : reader(reader) {}
+
+  Utils::BinaryReader &GetReader() { return reader; }
+
+  std::shared_ptr<Utils::Tensor<>> Read() {
+    const auto index = reader.Read<int64_t>();
+    if (index < 0) return nullptr;
+
+    if (static_cast<size_t>(index) < tensors.size()) return tensors[index];
+    if (static_cast<size_t>(index) != tensors.size())
+      throw std::runtime_error("Invalid tensor index in the binary data.");
+
+    auto tensor = std::make_shared<Utils::Tensor<>>();
+    tensor->Load(reader);
+    tensors.push_back(tensor);
+
+    return tensor;
+  }
+
+ private:
+  Utils::BinaryReader &reader;
+  std::vector<std::shared_ptr<Utils::Tensor<>>> tensors;
+};
+
 class TensorNode {
  public:
   using Index = Eigen::Index;
@@ -148,6 +216,43 @@ class TensorNode {
     return cloned;
   }
 
+  void Save(TensorsWriter &writer) const {
+    auto &binaryWriter = writer.GetWriter();
+
+    binaryWriter.Write(id);
+    binaryWriter.WriteVector(qubits);
+    binaryWriter.WriteVector(connections);
+    binaryWriter.WriteVector(connectionsIndices);
+    binaryWriter.Write(contractsTheNeededQubit);
+    writer.Write(tensor);
+  }
+
+  void Load(TensorsReader &reader) {
+    auto &binaryReader = reader.GetReader();
+
+    id = binaryReader.Read<Index>();
+    qubits = binaryReader.ReadVector<Types::qubit_t>();
+    connections = binaryReader.ReadVector<Index>();
+    connectionsIndices = binaryReader.ReadVector<Index>();
+    contractsTheNeededQubit = binaryReader.Read<bool>();
+    tensor = reader.Read();
+
+    if (connections.size() != qubits.size() ||
+        connectionsIndices.size() != qubits.size())
+      throw std::runtime_error("Invalid tensor node in the binary data.");
+  }
+
+  // a node on its own, with its tensor
+  void Save(Utils::BinaryWriter &writer) const {
+    TensorsWriter tensorsWriter(writer);
+    Save(tensorsWriter);
+  }
+
+  void Load(Utils::BinaryReader &reader) {
+    TensorsReader tensorsReader(reader);
+    Load(tensorsReader);
+  }
+
   constexpr static Index NotConnected = -1;
 
   Index id = 0;
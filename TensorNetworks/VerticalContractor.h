@@ -37,7 +37,8 @@ class VerticalContractor : public BaseContractor {
    * @param network The tensor network to contract.
    * @return The result of the contraction.
    */
-  double Contract(const TensorNetwork &network, Types::qubit_t qubit) override {
+  double ContractNetwork(const TensorNetwork &network,
+                         Types::qubit_t qubit) override {
     std::vector<Eigen::Index> keys;
     std::unordered_map<Eigen::Index, Eigen::Index> keysKeys;
 
@@ -122,7 +123,7 @@ class VerticalContractor : public BaseContractor {
       if (resultRankBest == 0) {
         if (tensors.size() == 1 ||
             tensors[tensor1IdBest]->contractsTheNeededQubit)
-          return std::real(tensors[tensor1IdBest]->tensor->atOffset(0));
+          return GetContractionResult(tensors, tensor1IdBest);
         // erasing this tensor happens because (not the case anymore, it's
         // avoided) the tensor network might be a disjoint one and a subnetwork
         // is contracted that does not contain the needed qubit
@@ -130,7 +131,7 @@ class VerticalContractor : public BaseContractor {
       }
     }
 
-    return std::real(tensors.begin()->second->tensor->atOffset(0));
+    return GetContractionResult(tensors, tensors.begin()->first);
   }
 
   /**
@@ -142,6 +143,8 @@ class VerticalContractor : public BaseContractor {
     auto cloned = std::make_shared<VerticalContractor>();
     cloned->maxTensorRank = maxTensorRank;
     cloned->enableMultithreading = enableMultithreading;
+    cloned->maxCachedPaths = maxCachedPaths;
+    cloned->maxCachedBytes = maxCachedBytes;
     return cloned;
   }
 };
@@ -0,0 +1,310 @@
+/**
+ * @file BinaryStream.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Binary writer and reader, used for saving and loading tensors and tensor
+ * networks.
+ *
+ * The data is stored little endian, whatever the platform is. The integers are
+ * stored on 64 bits, the floating point values (and the complex ones, as pairs
+ * of real values) with their own size. On little endian platforms the arrays of
+ * floating point values are copied in bulk.
+ *
+ * The reader can read from a stream or from a memory buffer, for example a
+ * memory mapped file (see MappedFileReader.h).
+ */
+
+#pragma once
+
+#ifndef _BINARY_STREAM_H_
+#define _BINARY_STREAM_H_
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+namespace Utils {
+
+namespace BinaryStreamDetails {
+
+template <class T>
+struct IsComplex : std::false_type {};
+
+template <class T>
+struct IsComplex<std::complex<T>> : std::is_floating_point<T> {};
+
+// the floating point values and the complex ones are stored as they are (but
+// little endian), the integers are widened to 64 bits
+template <class T>
+constexpr bool IsStoredAsIs() {
+  return std::is_floating_point<T>::value || IsComplex<T>::value;
+}
+
+constexpr bool IsLittleEndian() {
+  return boost::endian::order::native == boost::endian::order::little;
+}
+
+template <class T>
+void ReverseComponents(T &value) {
+  if constexpr (IsComplex<T>::value) {
+    using R = typename T::value_type;
+    R parts[2] = {value.real(), value.imag()};
+    ReverseComponents(parts[0]);
+    ReverseComponents(parts[1]);
+    value = T(parts[0], parts[1]);
+  } else {
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(&value);
+    for (size_t i = 0; i < sizeof(T) / 2; ++i)
+      std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+  }
+}
+
+}  // namespace BinaryStreamDetails
+
+/**
+ * @class BinaryWriter
+ * @brief Writes values in the binary format to a stream.
+ */
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::ostream &stream) : stream(stream) {}
+
+  void WriteBytes(const void *data, size_t size) {
+    stream.write(static_cast<const char *>(data),
+                 static_cast<std::streamsize>(size));
+    if (!stream) throw std::runtime_error("Failed writing the binary data.");
+  }
+
+  template <class T>
+  void Write(const T &value) {
+    using namespace BinaryStreamDetails;
+
+    if constexpr (std::is_same<T, bool>::value) {
+      const uint8_t byte = value ? 1 : 0;
+      WriteBytes(&byte, 1);
+    } else if constexpr (std::is_integral<T>::value) {
+      using Stored = typename std::conditional<std::is_signed<T>::value,
+                                               int64_t, uint64_t>::type;
+      const Stored stored =
+          boost::endian::native_to_little(static_cast<Stored>(value));
+      WriteBytes(&stored, sizeof(Stored));
+    } else {
+      static_assert(IsStoredAsIs<T>(),
+                    "Only integers, floating point and complex values can be "
+                    "written");
+      T stored = value;
+      if constexpr (!IsLittleEndian()) ReverseComponents(stored);
+      WriteBytes(&stored, sizeof(T));
+    }
+  }
+
+  void WriteSize(size_t size) { Write(static_cast<uint64_t>(size)); }
+
+  template <class T>
+  void WriteArray(const T *values, size_t count) {
+    using namespace BinaryStreamDetails;
+
+    if constexpr (IsStoredAsIs<T>() && IsLittleEndian())
+      WriteBytes(values, count * sizeof(T));
+    else
+      for (size_t i = 0; i < count; ++i) Write(values[i]);
+  }
+
+  template <class T>
+  void WriteVector(const std::vector<T> &values) {
+    WriteSize(values.size());
+    if constexpr (std::is_same<T, bool>::value) {
+      for (const bool value : values) Write(value);
+    } else
+      WriteArray(values.data(), values.size());
+  }
+
+  void WriteString(const std::string &str) {
+    WriteSize(str.size());
+    WriteBytes(str.data(), str.size());
+  }
+
+ private:
+  std::ostream &stream;
+};
+
+/**
+ * @class BinaryReader
+ * @brief Reads values in the binary format from a stream or from memory.
+ *
+ * Reading past the end of the data throws a std::runtime_error, as well as
+ * reading a size larger than the data left. For a stream that cannot seek the
+ * data left is not known, the vectors and strings are then read in chunks, so
+ * a corrupted size fails at the end of the data instead of allocating.
+ */
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::istream &stream) : stream(&stream) {
+    const auto start = stream.tellg();
+    if (start == std::istream::pos_type(-1)) {
+      stream.clear();
+      return;
+    }
+
+    stream.seekg(0, std::ios::end);
+    const auto end = stream.tellg();
+    stream.clear();
+    stream.seekg(start);
+
+    if (end != std::istream::pos_type(-1) && end >= start) {
+      size = static_cast<size_t>(end - start);
+      sizeKnown = true;
+    }
+  }
+
+  BinaryReader(const void *data, size_t size)
+      : data(static_cast<const char *>(data)), size(size), sizeKnown(true) {}
+
+  void ReadBytes(void *dst, size_t count) {
+    if (stream) {
+      if (sizeKnown && count > size - pos)
+        throw std::runtime_error("Unexpected end of the binary data.");
+
+      stream->read(static_cast<char *>(dst),
+                   static_cast<std::streamsize>(count));
+      if (static_cast<size_t>(stream->gcount()) != count)
+        throw std::runtime_error("Unexpected end of the binary data.");
+      pos += count;
+      return;
+    }
+
+    if (count > size - pos)
+      throw std::runtime_error("Unexpected end of the binary data.");
+
+    if (count) std::memcpy(dst, data + pos, count);
+    pos += count;
+  }
+
+  template <class T>
+  T Read() {
+    using namespace BinaryStreamDetails;
+
+    if constexpr (std::is_same<T, bool>::value) {
+      uint8_t byte;
+      ReadBytes(&byte, 1);
+      return byte != 0;
+    } else if constexpr (std::is_integral<T>::value) {
+      using Stored = typename std::conditional<std::is_signed<T>::value,
+                                               int64_t, uint64_t>::type;
+      Stored stored;
+      ReadBytes(&stored, sizeof(Stored));
+      return static_cast<T>(boost::endian::little_to_native(stored));
+    } else {
+      static_assert(IsStoredAsIs<T>(),
+                    "Only integers, floating point and complex values can be "
+                    "read");
+      T value;
+      ReadBytes(&value, sizeof(T));
+      if constexpr (!IsLittleEndian()) ReverseComponents(value);
+      return value;
+    }
+  }
+
+  // the sizes are checked against the remaining data, if known, to fail
+  // before allocating for a corrupted size
+  size_t ReadSize(size_t elementSize = 1) {
+    const uint64_t result = Read<uint64_t>();
+
+    if (result > std::numeric_limits<size_t>::max())
+      throw std::runtime_error("Invalid size in the binary data.");
+    CheckSize(static_cast<size_t>(result), elementSize);
+
+    return static_cast<size_t>(result);
+  }
+
+  /**
+   * @brief Checks that the data left can hold some elements.
+   *
+   * Nothing is checked if the size of the data is not known.
+   *
+   * @param count The number of elements.
+   * @param elementSize The size of an element, in bytes.
+   */
+  void CheckSize(size_t count, size_t elementSize) const {
+    if (sizeKnown && elementSize && count > (size - pos) / elementSize)
+      throw std::runtime_error("Invalid size in the binary data.");
+  }
+
+  bool IsSizeKnown() const { return sizeKnown; }
+
+  template <class T>
+  void ReadArray(T *values, size_t count) {
+    using namespace BinaryStreamDetails;
+
+    if constexpr (IsStoredAsIs<T>() && IsLittleEndian())
+      ReadBytes(values, count * sizeof(T));
+    else
+      for (size_t i = 0; i < count; ++i) values[i] = Read<T>();
+  }
+
+  template <class T>
+  std::vector<T> ReadVector() {
+    const size_t count = ReadSize(
+        std::is_integral<T>::value && !std::is_same<T, bool>::value
+            ? sizeof(uint64_t)
+            : sizeof(T));
+
+    std::vector<T> values;
+    for (size_t done = 0; done < count;) {
+      const size_t chunk = GetChunkSize(count - done);
+      values.resize(done + chunk);
+      if constexpr (std::is_same<T, bool>::value) {
+        for (size_t i = done; i < done + chunk; ++i) values[i] = Read<bool>();
+      } else
+        ReadArray(values.data() + done, chunk);
+      done += chunk;
+    }
+
+    return values;
+  }
+
+  std::string ReadString() {
+    const size_t count = ReadSize();
+
+    std::string str;
+    for (size_t done = 0; done < count;) {
+      const size_t chunk = GetChunkSize(count - done);
+      str.resize(done + chunk);
+      ReadBytes(str.data() + done, chunk);
+      done += chunk;
+    }
+
+    return str;
+  }
+
+ private:
+  // the number of elements allocated at once when the size of the data is
+  // not known
+  static constexpr size_t kUncheckedChunkSize = 1 << 16;
+
+  size_t GetChunkSize(size_t left) const {
+    return sizeKnown ? left : std::min(left, kUncheckedChunkSize);
+  }
+
+  std::istream *stream = nullptr;
+  const char *data = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+  bool sizeKnown = false;
+};
+
+}  // namespace Utils
+
+#endif  // _BINARY_STREAM_H_
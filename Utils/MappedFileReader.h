@@ -0,0 +1,48 @@
+/**
+ * @file MappedFileReader.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Memory mapped file, read in the binary format of BinaryStream.h.
+ */
+
+#pragma once
+
+#ifndef _MAPPED_FILE_READER_H_
+#define _MAPPED_FILE_READER_H_
+
+#include <string>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "BinaryStream.h"
+
+namespace Utils {
+
+/**
+ * @class MappedFileReader
+ * @brief Maps a file in memory, for reading it with a BinaryReader.
+ *
+ * The values are copied from the mapping as they are read, without going
+ * through the stream buffers.
+ */
+class MappedFileReader {
+ public:
+  explicit MappedFileReader(const std::string &fileName)
+      : mapping(fileName.c_str(), boost::interprocess::read_only),
+        region(mapping, boost::interprocess::read_only),
+        reader(region.get_address(), region.get_size()) {}
+
+  BinaryReader &GetReader() { return reader; }
+
+ private:
+  boost::interprocess::file_mapping mapping;
+  boost::interprocess::mapped_region region;
+  BinaryReader reader;
+};
+
+}  // namespace Utils
+
+#endif  // _MAPPED_FILE_READER_H_
@@ -0,0 +1,403 @@
+/**
+ * @file PooledStorage.h
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Storage for the tensor values, backed by a per thread memory pool.
+ *
+ * The contractors create and drop a lot of intermediate tensors, usually with
+ * the same sizes over and over again (the same contraction path is followed
+ * for each slice, amplitude or probability). The pool keeps the released
+ * blocks in free lists, one for each size class (powers of two), so they are
+ * reused instead of going each time through the system allocator. The blocks
+ * are aligned to the cache line, which is also enough for any SIMD
+ * instructions the matrix products use. The memory kept in the free lists of
+ * all the threads is bounded, and it's returned to the system when a
+ * contraction or a simulation that needs it is done.
+ */
+
+#pragma once
+
+#ifndef _POOLED_STORAGE_H_
+#define _POOLED_STORAGE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Utils {
+
+/**
+ * @struct TensorMemoryStatistics
+ * @brief Allocation statistics of the tensors memory pool.
+ *
+ * They are gathered over all threads, since the last reset.
+ */
+struct TensorMemoryStatistics {
+  unsigned long long int allocations =
+      0; /**< The number of blocks requested. */
+  unsigned long long int poolHits =
+      0; /**< The number of blocks served from the free lists. */
+  unsigned long long int deallocations =
+      0; /**< The number of blocks released. */
+  size_t bytesInUse = 0;     /**< The bytes currently held by the storages. */
+  size_t peakBytesInUse = 0; /**< The maximum of bytesInUse. */
+  size_t bytesCached = 0; /**< The bytes kept in the free lists. */
+};
+
+/**
+ * @class TensorMemoryPool
+ * @brief Memory pool for the tensors storage.
+ *
+ * Each thread has its own free lists, so no locking is needed. A block
+ * released on a different thread than the one that allocated it goes in the
+ * free lists of the releasing thread. The blocks larger than the largest size
+ * class and the ones that would exceed the cache limit, shared by all the
+ * threads, are returned to the system.
+ */
+class TensorMemoryPool {
+ public:
+  constexpr static size_t Alignment = 64;
+  constexpr static size_t MinBlockSizeLog = 6;  // 64 bytes
+  constexpr static size_t NrSizeClasses = 25;   // up to 1 GiB
+
+  /**
+   * @brief Returns the size of the block that will be used for a request.
+   *
+   * @param bytes The requested size, in bytes.
+   * @return The size of the allocated block, in bytes.
+   */
+  static size_t GetBlockSize(size_t bytes) {
+    const size_t sizeClass = GetSizeClass(bytes);
+    if (sizeClass >= NrSizeClasses) return bytes;
+
+    return static_cast<size_t>(1) << (sizeClass + MinBlockSizeLog);
+  }
+
+  /**
+   * @brief Allocates a block.
+   *
+   * @param bytes The size of the block, as returned by GetBlockSize.
+   * @return The allocated block, aligned to Alignment.
+   */
+  static void *Allocate(size_t bytes) {
+    Statistics &stats = GetStats();
+
+    void *block = nullptr;
+
+    const size_t sizeClass = GetSizeClass(bytes);
+    ThreadCache *cache = GetThreadCache();
+    if (cache && sizeClass < NrSizeClasses &&
+        !cache->freeLists[sizeClass].empty()) {
+      block = cache->freeLists[sizeClass].back();
+      cache->freeLists[sizeClass].pop_back();
+      cache->cachedBytes -= bytes;
+      stats.bytesCached.fetch_sub(bytes, std::memory_order_relaxed);
+      stats.poolHits.fetch_add(1, std::memory_order_relaxed);
+    } else
+      block = ::operator new(bytes, std::align_val_t(Alignment));
+
+    stats.allocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t inUse =
+        stats.bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = stats.peakBytesInUse.load(std::memory_order_relaxed);
+    while (inUse > peak && !stats.peakBytesInUse.compare_exchange_weak(
+                               peak, inUse, std::memory_order_relaxed)) {
+    }
+
+    return block;
+  }
+
+  /**
+   * @brief Releases a block.
+   *
+   * @param block The block to release.
+   * @param bytes The size of the block, as passed to Allocate.
+   */
+  static void Deallocate(void *block, size_t bytes) {
+    if (!block) return;
+
+    Statistics &stats = GetStats();
+
+    stats.deallocations.fetch_add(1, std::memory_order_relaxed);
+    stats.bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+
+    const size_t sizeClass = GetSizeClass(bytes);
+    ThreadCache *cache = GetThreadCache();
+    if (cache && sizeClass < NrSizeClasses) {
+      // reserve the bytes in the limit shared by the threads first
+      if (stats.bytesCached.fetch_add(bytes, std::memory_order_relaxed) +
+              bytes <=
+          maxCachedBytes.load(std::memory_order_relaxed)) {
+        cache->freeLists[sizeClass].push_back(block);
+        cache->cachedBytes += bytes;
+        return;
+      }
+
+      stats.bytesCached.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    ::operator delete(block, std::align_val_t(Alignment));
+  }
+
+  /**
+   * @brief Returns the cached blocks of the calling thread to the system.
+   *
+   * Called when a contraction or a simulation is done, by each thread that
+   * took part in it, the free lists of a thread are not reachable from the
+   * others.
+   */
+  static void Trim() {
+    ThreadCache *cache = GetThreadCache();
+    if (cache) cache->Release();
+  }
+
+  /**
+   * @brief Sets the maximum number of bytes kept in the free lists of all the
+   * threads.
+   *
+   * Setting it to zero disables the pooling, the blocks are still aligned.
+   * Lowering it does not release the blocks already cached.
+   *
+   * @param bytes The maximum number of cached bytes.
+   */
+  static void SetMaxCachedBytes(size_t bytes) {
+    maxCachedBytes.store(bytes, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Returns the maximum number of bytes kept in the free lists of all
+   * the threads.
+   *
+   * @return The maximum number of cached bytes.
+   */
+  static size_t GetMaxCachedBytes() {
+    return maxCachedBytes.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Returns the allocation statistics.
+   *
+   * @return The statistics gathered since the last reset.
+   */
+  static TensorMemoryStatistics GetStatistics() {
+    Statistics &stats = GetStats();
+
+    TensorMemoryStatistics result;
+
+    result.allocations = stats.allocations.load(std::memory_order_relaxed);
+    result.poolHits = stats.poolHits.load(std::memory_order_relaxed);
+    result.deallocations = stats.deallocations.load(std::memory_order_relaxed);
+    result.bytesInUse = stats.bytesInUse.load(std::memory_order_relaxed);
+    result.peakBytesInUse =
+        stats.peakBytesInUse.load(std::memory_order_relaxed);
+    result.bytesCached = stats.bytesCached.load(std::memory_order_relaxed);
+
+    return result;
+  }
+
+  /**
+   * @brief Resets the counters.
+   *
+   * The bytes in use and cached are not counters, they are kept, the peak
+   * starts again from the bytes currently in use.
+   */
+  static void ResetStatistics() {
+    Statistics &stats = GetStats();
+
+    stats.allocations.store(0, std::memory_order_relaxed);
+    stats.poolHits.store(0, std::memory_order_relaxed);
+    stats.deallocations.store(0, std::memory_order_relaxed);
+    stats.peakBytesInUse.store(stats.bytesInUse.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+  }
+
+ private:
+  static size_t GetSizeClass(size_t bytes) {
+    size_t sizeClass = 0;
+    while ((static_cast<size_t>(1) << (sizeClass + MinBlockSizeLog)) < bytes)
+      if (++sizeClass >= NrSizeClasses) break;
+
+    return sizeClass;
+  }
+
+  struct ThreadCache {
+    ~ThreadCache() {
+      Release();
+      destroyed = true;
+    }
+
+    void Release() {
+      Statistics &stats = GetStats();
+
+      for (auto &freeList : freeLists) {
+        for (void *block : freeList)
+          ::operator delete(block, std::align_val_t(Alignment));
+        freeList.clear();
+      }
+
+      stats.bytesCached.fetch_sub(cachedBytes, std::memory_order_relaxed);
+      cachedBytes = 0;
+    }
+
+    std::array<std::vector<void *>, NrSizeClasses> freeLists;
+    size_t cachedBytes = 0;
+  };
+
+  // tensors destroyed at exit, after the cache of the thread, are returned
+  // directly to the system
+  static ThreadCache *GetThreadCache() {
+    if (destroyed) return nullptr;
+
+    thread_local ThreadCache cache;
+
+    return &cache;
+  }
+
+  struct Statistics {
+    std::atomic<unsigned long long int> allocations{0};
+    std::atomic<unsigned long long int> poolHits{0};
+    std::atomic<unsigned long long int> deallocations{0};
+    std::atomic<size_t> bytesInUse{0};
+    std::atomic<size_t> peakBytesInUse{0};
+    std::atomic<size_t> bytesCached{0};
+  };
+
+  static Statistics &GetStats() {
+    static Statistics stats;
+
+    return stats;
+  }
+
+  inline static std::atomic<size_t> maxCachedBytes{static_cast<size_t>(256)
+                                                   << 20};
+  inline static thread_local bool destroyed = false;
+};
+
+/**
+ * @class PooledStorage
+ * @brief Tensor storage allocated from the tensors memory pool.
+ *
+ * It has the part of the std::valarray interface the tensors use, resizing
+ * sets all the values, as for std::valarray. Resizing to a size that fits in
+ * the same block keeps the block, so a tensor used as a destination for
+ * repeated contractions allocates only once.
+ *
+ * @tparam T The type of the values, must be trivially copyable.
+ */
+template <class T>
+class PooledStorage {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "The pooled storage needs trivially copyable values");
+
+ public:
+  PooledStorage() = default;
+
+  explicit PooledStorage(size_t n) { resize(n); }
+
+  PooledStorage(size_t n, const T &value) { resize(n, value); }
+
+  PooledStorage(const PooledStorage<T> &other) {
+    Reserve(other.sz);
+    if (sz) std::memcpy(ptr, other.ptr, sz * sizeof(T));
+  }
+
+  PooledStorage(PooledStorage<T> &&other) noexcept { swap(other); }
+
+  ~PooledStorage() { Release(); }
+
+  PooledStorage<T> &operator=(const PooledStorage<T> &other) {
+    if (this != &other) {
+      Reserve(other.sz);
+      if (sz) std::memcpy(ptr, other.ptr, sz * sizeof(T));
+    }
+
+    return *this;
+  }
+
+  PooledStorage<T> &operator=(PooledStorage<T> &&other) noexcept {
+    if (this != &other) {
+      Release();
+      swap(other);
+    }
+
+    return *this;
+  }
+
+  void swap(PooledStorage<T> &other) noexcept {
+    std::swap(ptr, other.ptr);
+    std::swap(sz, other.sz);
+    std::swap(blockSize, other.blockSize);
+  }
+
+  void resize(size_t n, const T &value = T()) {
+    Reserve(n);
+    std::fill(ptr, ptr + sz, value);
+  }
+
+  // as resize, but leaves the values unspecified, for the destinations that
+  // are overwritten anyway
+  void resize_uninitialized(size_t n) { Reserve(n); }
+
+  void clear() { Release(); }
+
+  size_t size() const { return sz; }
+
+  size_t capacity() const { return blockSize / sizeof(T); }
+
+  T *data() { return ptr; }
+
+  const T *data() const { return ptr; }
+
+  T &operator[](size_t i) { return ptr[i]; }
+
+  const T &operator[](size_t i) const { return ptr[i]; }
+
+  T *begin() { return ptr; }
+
+  T *end() { return ptr + sz; }
+
+  const T *begin() const { return ptr; }
+
+  const T *end() const { return ptr + sz; }
+
+ private:
+  // keeps the block if the new size has the same size class, to avoid wasting
+  // more than half of it
+  void Reserve(size_t n) {
+    if (n == 0) {
+      Release();
+      return;
+    }
+
+    const size_t bytes = TensorMemoryPool::GetBlockSize(n * sizeof(T));
+    if (bytes != blockSize) {
+      Release();
+      ptr = static_cast<T *>(TensorMemoryPool::Allocate(bytes));
+      blockSize = bytes;
+    }
+
+    sz = n;
+  }
+
+  void Release() {
+    TensorMemoryPool::Deallocate(ptr, blockSize);
+    ptr = nullptr;
+    sz = 0;
+    blockSize = 0;
+  }
+
+  T *ptr = nullptr;
+  size_t sz = 0;
+  size_t blockSize = 0;
+};
+
+}  // namespace Utils
+
+#endif  // _POOLED_STORAGE_H_
@@ -15,9 +15,14 @@
 
 #ifndef _TENSOR_H_
 
+#include <algorithm>
 #include <complex>
 #include <initializer_list>
+#include <limits>
+#include <new>
 #include <numeric>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_set>
 #include <valarray>
 #include <vector>
@@ -27,6 +32,10 @@
 #include <boost/serialization/valarray.hpp>
 #include <boost/serialization/vector.hpp>
 
+#include <Eigen/Eigen>
+
+#include "BinaryStream.h"
+#include "PooledStorage.h"
 #include "QubitRegisterCalculator.h"
 
 namespace Utils {
@@ -36,7 +45,9 @@ namespace Utils {
 // layout, so they might not work properly anymore! Accessing values and
 // contractions are working since they are used in circuit cutting and in the
 // tensor networks simulator.
-template <class T = std::complex<double>, class Storage = std::valarray<T>>
+// The default storage comes from a per thread memory pool, std::valarray<T>
+// can be used as well, or for the types that are not trivially copyable.
+template <class T = std::complex<double>, class Storage = PooledStorage<T>>
 class Tensor {
  protected:
   Storage values;
@@ -106,6 +117,45 @@ class Tensor {
     ar &dims &sz;
   }
 
+  // the binary format, see BinaryStream.h: the rank, the dimensions, a flag
+  // for dummy tensors and the values, in the fortran layout
+  void Save(BinaryWriter &writer) const {
+    writer.WriteVector(dims);
+    writer.Write(IsDummy());
+    if (!IsDummy()) writer.WriteArray(&values[0], GetSize());
+  }
+
+  void Load(BinaryReader &reader) {
+    dims = reader.ReadVector<size_t>();
+    sz = 0;
+
+    const bool dummy = reader.Read<bool>();
+    if (dummy || dims.empty()) {
+      values.resize(0);
+      return;
+    }
+
+    size_t size = 1;
+    for (const auto dim : dims) {
+      if (dim == 0 || size > std::numeric_limits<size_t>::max() / dim)
+        throw std::runtime_error("Invalid tensor dimensions.");
+      size *= dim;
+    }
+
+    reader.CheckSize(size, sizeof(T));
+
+    // if the size of the data is not known, a corrupted size can still be too
+    // large to allocate
+    try {
+      ResizeUninitialized(values, size);
+    } catch (const std::bad_alloc &) {
+      throw std::runtime_error("Invalid tensor dimensions.");
+    } catch (const std::length_error &) {
+      throw std::runtime_error("Invalid tensor dimensions.");
+    }
+    reader.ReadArray(&values[0], size);
+  }
+
   Tensor<T, Storage> &operator=(const Tensor<T, Storage> &other) {
     Tensor temp(other);
     *this = std::move(temp);
@@ -521,98 +571,36 @@ class Tensor {
                               bool allowMultithreading = true) const {
     assert(dims[ind1] == other.dims[ind2]);
 
-    std::vector<size_t> newdims;
+    const std::vector<std::pair<size_t, size_t>> indices{{ind1, ind2}};
 
-    const size_t newsize = dims.size() + other.dims.size() - 2;
-    if (newsize == 0)
-      newdims.resize(1, 1);
-    else {
-      newdims.reserve(newsize);
-
-      for (size_t i = 0; i < dims.size(); ++i)
-        if (i != ind1) newdims.push_back(dims[i]);
-
-      for (size_t i = 0; i < other.dims.size(); ++i)
-        if (i != ind2) newdims.push_back(other.dims[i]);
-    }
-
-    Tensor<T, Storage> result(newdims, IsDummy());
-
-    if (!IsDummy()) {
-      const size_t sz = result.GetSize();
-
-      if (!allowMultithreading || sz < OmpLimit) {
-        std::vector<size_t> indices1(dims.size());
-        std::vector<size_t> indices2(other.dims.size());
-
-        for (size_t offset = 0; offset < sz; ++offset) {
-          const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
-
-          size_t pos = 0;
-          for (size_t i = 0; i < dims.size(); ++i)
-            if (i != ind1) {
-              indices1[i] = indicesres[pos];
-              ++pos;
-            }
-
-          for (size_t i = 0; i < other.dims.size(); ++i)
-            if (i != ind2) {
-              indices2[i] = indicesres[pos];
-              ++pos;
-            }
-
-          // contracting more than one index would require creating a dummy
-          // tensor to iterate over all the indices that are contracted
-          for (size_t i = 0; i < dims[ind1]; ++i) {
-            indices1[ind1] = indices2[ind2] = i;
-
-            result[offset] =
-                result[offset] + values[GetOffset(indices1)] * other[indices2];
-          }
-        }
-      } else {
-        const auto processor_count = GetNumberOfThreads();
-
-#pragma omp parallel for num_threads(processor_count) \
-    schedule(static, OmpLimit / divSchedule)
-        for (long long int offset = 0; offset < static_cast<long long int>(sz);
-             ++offset) {
-          const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
-          std::vector<size_t> indices1(dims.size());
-          std::vector<size_t> indices2(other.dims.size());
-
-          size_t pos = 0;
-          for (size_t i = 0; i < dims.size(); ++i)
-            if (i != ind1) {
-              indices1[i] = indicesres[pos];
-              ++pos;
-            }
-
-          for (size_t i = 0; i < other.dims.size(); ++i)
-            if (i != ind2) {
-              indices2[i] = indicesres[pos];
-              ++pos;
-            }
-
-          // contracting more than one index would require creating a dummy
-          // tensor to iterate over all the indices that are contracted
-          for (size_t i = 0; i < dims[ind1]; ++i) {
-            indices1[ind1] = indices2[ind2] = i;
-
-            result[offset] =
-                result[offset] + values[GetOffset(indices1)] * other[indices2];
-          }
-        }
-      }
-    }
-
-    return result;
+    return Contract(other, indices, allowMultithreading);
   }
 
+  // for the numeric types the contraction is done by permuting the operands
+  // into matrices and calling the Eigen matrix product (TTGT, the last
+  // transpose is not needed, see ContractGemm), otherwise it's done element by
+  // element
   Tensor<T, Storage> Contract(
       const Tensor<T, Storage> &other,
       const std::vector<std::pair<size_t, size_t>> &indices,
       bool allowMultithreading = true) const {
+    Tensor<T, Storage> result;
+
+    Contract(other, indices, result, allowMultithreading);
+
+    return result;
+  }
+
+  // as above, but the result is written into the passed tensor, which cannot be
+  // one of the operands; its storage is reused if large enough (for the pooled
+  // storage, if the size class is the same), so a destination used for
+  // repeated contractions allocates only once
+  void Contract(const Tensor<T, Storage> &other,
+                const std::vector<std::pair<size_t, size_t>> &indices,
+                Tensor<T, Storage> &result,
+                bool allowMultithreading = true) const {
+    assert(&result != this && &result != &other);
+
     std::vector<size_t> newdims;
     std::vector<size_t> contractDims;
 
@@ -642,98 +630,21 @@ class Tensor {
           newdims.push_back(other.dims[i]);
     }
 
-    Tensor<T, Storage> result(newdims, IsDummy());
-
-    if (!IsDummy()) {
-      const Tensor<T, Storage> dummy(contractDims,
-                                     true);  // used for incrementing the index
-      const size_t sz = result.GetSize();
-
-      if (!allowMultithreading || sz < OmpLimit) {
-        std::vector<size_t> dummyIndices(
-            contractDims.size(), 0);  // the dummy index to be incremented - use
-                                      // the values to complete the real indices
-        std::vector<size_t> indices1(dims.size());
-        std::vector<size_t> indices2(other.dims.size());
-
-        for (size_t offset = 0; offset < sz; ++offset) {
-          const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
-
-          size_t pos = 0;
-          for (size_t i = 0; i < dims.size(); ++i)
-            if (indicesSet1.find(i) == indicesSet1.end()) {
-              indices1[i] = indicesres[pos];
-              ++pos;
-            }
-
-          for (size_t i = 0; i < other.dims.size(); ++i)
-            if (indicesSet2.find(i) == indicesSet2.end()) {
-              indices2[i] = indicesres[pos];
-              ++pos;
-            }
-
-          // contracting more than one index requires creating a dummy tensor to
-          // iterate over all the indices that are contracted
-          do {
-            for (size_t i = 0; i < dummyIndices.size(); ++i)
-              indices1[indices[i].first] = indices2[indices[i].second] =
-                  dummyIndices[i];
-
-            // trying to fix a linux compile bug
-            const T &val1 = values[GetOffset(indices1)];
-            const T &val2 = other[indices2];
-            auto mulRes = val1 * val2;
-            result[offset] = result[offset] + std::move(mulRes);
-          } while (dummy.IncrementIndex(dummyIndices));
-        }
-      } else {
-        const auto processor_count = GetNumberOfThreads();
-
-#pragma omp parallel for num_threads(processor_count) \
-    schedule(static, OmpLimit / divSchedule)
-        for (long long int offset = 0; offset < static_cast<long long int>(sz);
-             ++offset) {
-          const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
-          std::vector<size_t> indices1(dims.size());
-          std::vector<size_t> indices2(other.dims.size());
-
-          size_t pos = 0;
-          for (size_t i = 0; i < dims.size(); ++i)
-            if (indicesSet1.find(i) == indicesSet1.end()) {
-              indices1[i] = indicesres[pos];
-              ++pos;
-            }
-
-          for (size_t i = 0; i < other.dims.size(); ++i)
-            if (indicesSet2.find(i) == indicesSet2.end()) {
-              indices2[i] = indicesres[pos];
-              ++pos;
-            }
+    result.dims.swap(newdims);
+    result.sz = 0;
 
-          // contracting more than one index requires creating a dummy tensor to
-          // iterate over all the indices that are contracted
-          std::vector<size_t> dummyIndices(
-              contractDims.size(),
-              0);  // the dummy index to be incremented - use the values to
-                   // complete the real indices
-
-          do {
-            for (size_t i = 0; i < dummyIndices.size(); ++i)
-              indices1[indices[i].first] = indices2[indices[i].second] =
-                  dummyIndices[i];
-
-            // trying to fix a linux compile bug
-            const T &val1 = values[GetOffset(indices1)];
-            const T &val2 = other[indices2];
-
-            auto mulRes = val1 * val2;
-            result[offset] = result[offset] + std::move(mulRes);
-          } while (dummy.IncrementIndex(dummyIndices));
-        }
-      }
+    if (IsDummy())
+      result.values.resize(0);
+    else if constexpr (GemmContraction) {
+      // the matrix product overwrites all the values
+      ResizeUninitialized(result.values, result.GetSize());
+      ContractGemm(other, indices, indicesSet1, indicesSet2, result,
+                   allowMultithreading);
+    } else {
+      result.values.resize(result.GetSize());
+      ContractElementwise(other, indices, indicesSet1, indicesSet2,
+                          contractDims, result, allowMultithreading);
     }
-
-    return result;
   }
 
   T Trace() const {
@@ -899,6 +810,46 @@ class Tensor {
     return Shuffle(indices);
   }
 
+  // fixes the values of some indices, the result has the remaining indices, in
+  // the same order
+  Tensor<T, Storage> Slice(
+      const std::vector<std::pair<size_t, size_t>> &fixedIndices) const {
+    std::vector<size_t> indices(dims.size(), 0);
+    std::vector<bool> fixed(dims.size(), false);
+    for (const auto &[index, value] : fixedIndices) {
+      assert(index < dims.size() && value < dims[index]);
+
+      indices[index] = value;
+      fixed[index] = true;
+    }
+
+    std::vector<size_t> newdims;
+    std::vector<size_t> freeIndices;
+    for (size_t i = 0; i < dims.size(); ++i)
+      if (!fixed[i]) {
+        newdims.push_back(dims[i]);
+        freeIndices.push_back(i);
+      }
+
+    if (newdims.empty()) newdims.push_back(1);
+
+    Tensor<T, Storage> result(newdims, values.size() == 0);
+
+    if (values.size() != 0)
+      for (size_t offset = 0; offset < result.GetSize(); ++offset) {
+        // fortran layout, the first free index changes the fastest
+        size_t rest = offset;
+        for (const auto i : freeIndices) {
+          indices[i] = rest % dims[i];
+          rest /= dims[i];
+        }
+
+        result.values[offset] = values[GetOffset(indices)];
+      }
+
+    return result;
+  }
+
   Tensor<T, Storage> Reshape(const std::vector<size_t> &newdims) const {
     Tensor<T, Storage> result(newdims, values.size() == 0);
 
@@ -930,6 +881,293 @@ class Tensor {
   }
 
  private:
+  // the matrix product is used for contractions only for the types Eigen knows
+  // how to multiply efficiently
+  constexpr static bool GemmContraction =
+      std::is_arithmetic<T>::value ||
+      std::is_same<T, std::complex<double>>::value ||
+      std::is_same<T, std::complex<float>>::value;
+
+  using GemmMatrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+  template <class S, class = void>
+  struct HasUninitializedResize : std::false_type {};
+
+  template <class S>
+  struct HasUninitializedResize<
+      S, std::void_t<decltype(std::declval<S &>().resize_uninitialized(0))>>
+      : std::true_type {};
+
+  // for buffers that are going to be overwritten, skips zeroing them if the
+  // storage allows it
+  static void ResizeUninitialized(Storage &storage, size_t n) {
+    if constexpr (HasUninitializedResize<Storage>::value)
+      storage.resize_uninitialized(n);
+    else
+      storage.resize(n);
+  }
+
+  // Transpose-transpose-GEMM(-transpose) contraction. The free indices of this
+  // tensor form the rows, the contracted ones the inner dimension and the free
+  // indices of the other tensor the columns. Due to the fortran layout, the
+  // matrix product has already the layout of the result, and an operand whose
+  // contracted indices are already grouped at the right end is used in place,
+  // as it is or transposed, without copying.
+  void ContractGemm(const Tensor<T, Storage> &other,
+                    const std::vector<std::pair<size_t, size_t>> &indices,
+                    const std::unordered_set<size_t> &indicesSet1,
+                    const std::unordered_set<size_t> &indicesSet2,
+                    Tensor<T, Storage> &result,
+                    bool allowMultithreading) const {
+    std::vector<size_t> freeFirst1;  // free indices, then contracted ones
+    std::vector<size_t> freeLast1;   // contracted indices, then free ones
+    std::vector<size_t> freeFirst2;
+    std::vector<size_t> freeLast2;
+    freeFirst1.reserve(dims.size());
+    freeLast1.reserve(dims.size());
+    freeFirst2.reserve(other.dims.size());
+    freeLast2.reserve(other.dims.size());
+
+    size_t rows = 1;
+    for (size_t i = 0; i < dims.size(); ++i)
+      if (indicesSet1.find(i) == indicesSet1.end()) {
+        freeFirst1.push_back(i);
+        rows *= dims[i];
+      }
+
+    size_t cols = 1;
+    for (size_t i = 0; i < other.dims.size(); ++i)
+      if (indicesSet2.find(i) == indicesSet2.end()) {
+        freeFirst2.push_back(i);
+        cols *= other.dims[i];
+      }
+
+    size_t inner = 1;
+    for (const auto &index : indices) {
+      freeLast1.push_back(index.first);
+      freeLast2.push_back(index.second);
+      inner *= dims[index.first];
+    }
+
+    freeLast1.insert(freeLast1.end(), freeFirst1.begin(), freeFirst1.end());
+    freeLast2.insert(freeLast2.end(), freeFirst2.begin(), freeFirst2.end());
+    for (const auto &index : indices) {
+      freeFirst1.push_back(index.first);
+      freeFirst2.push_back(index.second);
+    }
+
+    // this tensor is needed as a rows x inner matrix, the other one as a
+    // inner x cols matrix; the permutation buffers come from the same storage
+    // as the tensors, for the pooled one they are reused between contractions
+    Storage buffer1;
+    Storage buffer2;
+
+    const T *data1 = &values[0];
+    bool transpose1 = false;
+    if (!IsIdentityPermutation(freeFirst1)) {
+      if (IsIdentityPermutation(freeLast1))
+        transpose1 = true;
+      else {
+        ResizeUninitialized(buffer1, rows * inner);
+        Permute(freeFirst1, &buffer1[0], allowMultithreading);
+        data1 = &buffer1[0];
+      }
+    }
+
+    const T *data2 = &other.values[0];
+    bool transpose2 = false;
+    if (!IsIdentityPermutation(freeLast2)) {
+      if (IsIdentityPermutation(freeFirst2))
+        transpose2 = true;
+      else {
+        ResizeUninitialized(buffer2, inner * cols);
+        other.Permute(freeLast2, &buffer2[0], allowMultithreading);
+        data2 = &buffer2[0];
+      }
+    }
+
+    using ConstMap = Eigen::Map<const GemmMatrix>;
+    Eigen::Map<GemmMatrix> res(&result.values[0], rows, cols);
+
+    if (transpose1) {
+      const ConstMap mat1(data1, inner, rows);
+      if (transpose2)
+        res.noalias() =
+            mat1.transpose() * ConstMap(data2, cols, inner).transpose();
+      else
+        res.noalias() = mat1.transpose() * ConstMap(data2, inner, cols);
+    } else {
+      const ConstMap mat1(data1, rows, inner);
+      if (transpose2)
+        res.noalias() = mat1 * ConstMap(data2, cols, inner).transpose();
+      else
+        res.noalias() = mat1 * ConstMap(data2, inner, cols);
+    }
+  }
+
+  static bool IsIdentityPermutation(const std::vector<size_t> &perm) {
+    for (size_t i = 0; i < perm.size(); ++i)
+      if (perm[i] != i) return false;
+
+    return true;
+  }
+
+  // copies the values into dst, in the layout of the tensor with the indices
+  // permuted, dst index k being the index perm[k] of this tensor
+  void Permute(const std::vector<size_t> &perm, T *dst,
+               bool allowMultithreading) const {
+    const size_t rank = dims.size();
+
+    std::vector<size_t> strides(rank);
+    size_t stride = 1;
+    for (size_t i = 0; i < rank; ++i) {
+      strides[i] = stride;
+      stride *= dims[i];
+    }
+
+    std::vector<size_t> pdims(rank);
+    std::vector<size_t> pstrides(rank);
+    for (size_t k = 0; k < rank; ++k) {
+      pdims[k] = dims[perm[k]];
+      pstrides[k] = strides[perm[k]];
+    }
+
+    const auto copyRange = [&](size_t begin, size_t end) {
+      std::vector<size_t> idx(rank);
+      size_t src = 0;
+      size_t rem = begin;
+      for (size_t k = 0; k < rank; ++k) {
+        idx[k] = rem % pdims[k];
+        rem /= pdims[k];
+        src += idx[k] * pstrides[k];
+      }
+
+      for (size_t offset = begin; offset < end; ++offset) {
+        dst[offset] = values[src];
+
+        for (size_t k = 0; k < rank; ++k) {
+          if (++idx[k] < pdims[k]) {
+            src += pstrides[k];
+            break;
+          }
+          src -= (pdims[k] - 1) * pstrides[k];
+          idx[k] = 0;
+        }
+      }
+    };
+
+    const size_t sz = GetSize();
+    if (!allowMultithreading || sz < OmpLimit) {
+      copyRange(0, sz);
+      return;
+    }
+
+    const auto processor_count = GetNumberOfThreads();
+    const long long int nrBlocks = processor_count;
+    const size_t blockSize = (sz + nrBlocks - 1) / nrBlocks;
+
+#pragma omp parallel for num_threads(processor_count)
+    for (long long int block = 0; block < nrBlocks; ++block) {
+      const size_t begin = block * blockSize;
+      if (begin < sz) copyRange(begin, std::min(begin + blockSize, sz));
+    }
+  }
+
+  void ContractElementwise(
+      const Tensor<T, Storage> &other,
+      const std::vector<std::pair<size_t, size_t>> &indices,
+      const std::unordered_set<size_t> &indicesSet1,
+      const std::unordered_set<size_t> &indicesSet2,
+      const std::vector<size_t> &contractDims, Tensor<T, Storage> &result,
+      bool allowMultithreading) const {
+    const Tensor<T, Storage> dummy(contractDims,
+                                   true);  // used for incrementing the index
+    const size_t sz = result.GetSize();
+
+    if (!allowMultithreading || sz < OmpLimit) {
+      std::vector<size_t> dummyIndices(
+          contractDims.size(), 0);  // the dummy index to be incremented - use
+                                    // the values to complete the real indices
+      std::vector<size_t> indices1(dims.size());
+      std::vector<size_t> indices2(other.dims.size());
+
+      for (size_t offset = 0; offset < sz; ++offset) {
+        const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
+
+        size_t pos = 0;
+        for (size_t i = 0; i < dims.size(); ++i)
+          if (indicesSet1.find(i) == indicesSet1.end()) {
+            indices1[i] = indicesres[pos];
+            ++pos;
+          }
+
+        for (size_t i = 0; i < other.dims.size(); ++i)
+          if (indicesSet2.find(i) == indicesSet2.end()) {
+            indices2[i] = indicesres[pos];
+            ++pos;
+          }
+
+        // contracting more than one index requires creating a dummy tensor to
+        // iterate over all the indices that are contracted
+        do {
+          for (size_t i = 0; i < dummyIndices.size(); ++i)
+            indices1[indices[i].first] = indices2[indices[i].second] =
+                dummyIndices[i];
+
+          // trying to fix a linux compile bug
+          const T &val1 = values[GetOffset(indices1)];
+          const T &val2 = other[indices2];
+          auto mulRes = val1 * val2;
+          result[offset] = result[offset] + std::move(mulRes);
+        } while (dummy.IncrementIndex(dummyIndices));
+      }
+    } else {
+      const auto processor_count = GetNumberOfThreads();
+
+#pragma omp parallel for num_threads(processor_count) \
+  schedule(static, OmpLimit / divSchedule)
+      for (long long int offset = 0; offset < static_cast<long long int>(sz);
+           ++offset) {
+        const std::vector<size_t> indicesres = result.IndexFromOffset(offset);
+        std::vector<size_t> indices1(dims.size());
+        std::vector<size_t> indices2(other.dims.size());
+
+        size_t pos = 0;
+        for (size_t i = 0; i < dims.size(); ++i)
+          if (indicesSet1.find(i) == indicesSet1.end()) {
+            indices1[i] = indicesres[pos];
+            ++pos;
+          }
+
+        for (size_t i = 0; i < other.dims.size(); ++i)
+          if (indicesSet2.find(i) == indicesSet2.end()) {
+            indices2[i] = indicesres[pos];
+            ++pos;
+          }
+
+        // contracting more than one index requires creating a dummy tensor to
+        // iterate over all the indices that are contracted
+        std::vector<size_t> dummyIndices(
+            contractDims.size(),
+            0);  // the dummy index to be incremented - use the values to
+                 // complete the real indices
+
+        do {
+          for (size_t i = 0; i < dummyIndices.size(); ++i)
+            indices1[indices[i].first] = indices2[indices[i].second] =
+                dummyIndices[i];
+
+          // trying to fix a linux compile bug
+          const T &val1 = values[GetOffset(indices1)];
+          const T &val2 = other[indices2];
+
+          auto mulRes = val1 * val2;
+          result[offset] = result[offset] + std::move(mulRes);
+        } while (dummy.IncrementIndex(dummyIndices));
+      }
+    }
+  }
+
   // C/C++ layout (row-major order)
 
   inline size_t GetCPPOffset(const std::vector<size_t> &indices) const {
@@ -99,6 +99,10 @@ class MaestroLibrary : public Utils::Library {
           fAmplitude = (double* (*)(void*, unsigned long long int))GetFunction(
               "Amplitude");
           CheckFunction((void*)fAmplitude, __LINE__);
+          fAmplitudes = (double* (*)(void*, const unsigned long long int*,
+                                     unsigned long int))
+              GetFunction("Amplitudes");
+          CheckFunction((void*)fAmplitudes, __LINE__);
           fAllProbabilities =
               (double* (*)(void*))GetFunction("AllProbabilities");
           CheckFunction((void*)fAllProbabilities, __LINE__);
@@ -451,6 +455,16 @@ class MaestroLibrary : public Utils::Library {
     return nullptr;
   }
 
+  double* Amplitudes(void* sim, const unsigned long long int* outcomes,
+                     unsigned long int nrOutcomes) {
+    if (maestro && sim && fAmplitudes)
+      return fAmplitudes(sim, outcomes, nrOutcomes);
+    else
+      throw std::runtime_error(
+          "MaestroLibrary: Unable to get the amplitudes of the outcomes.");
+    return nullptr;
+  }
+
   double* AllProbabilities(void* sim) {
     if (maestro && sim && fAllProbabilities)
       return fAllProbabilities(sim);
@@ -858,6 +872,8 @@ class MaestroLibrary : public Utils::Library {
   void (*fFreeDoubleVector)(double*);
   void (*fFreeULLIVector)(unsigned long long int*);
   double* (*fAmplitude)(void*, unsigned long long int);
+  double* (*fAmplitudes)(void*, const unsigned long long int*,
+                         unsigned long int);
   double* (*fAllProbabilities)(void*);
   double* (*fProbabilities)(void*, const unsigned long long int*,
                             unsigned long int);
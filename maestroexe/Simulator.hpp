@@ -155,6 +155,13 @@ class Simulator : protected MaestroLibrary {
     return nullptr;
   }
 
+  double *Amplitudes(const unsigned long long int *outcomes,
+                     unsigned long int nrOutcomes) {
+    if (simulatorPtr)
+      return MaestroLibrary::Amplitudes(simulatorPtr, outcomes, nrOutcomes);
+    return nullptr;
+  }
+
   double *AllProbabilities() {
     if (simulatorPtr) return MaestroLibrary::AllProbabilities(simulatorPtr);
     return nullptr;
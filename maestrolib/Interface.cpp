@@ -203,6 +203,24 @@ __declspec(dllexport)
     network->Configure("mps_sample_measure_algorithm", mpsSample.c_str());
   }
 
+  const std::string jacobiSvd = Json::JsonParserMaestro<>::GetConfigString(
+      "matrix_product_state_jacobi_svd", configJson);
+  if (!jacobiSvd.empty()) {
+    configured = true;
+    if (network->GetSimulator()) network->GetSimulator()->Clear();
+    network->Configure("matrix_product_state_jacobi_svd", jacobiSvd.c_str());
+  }
+
+  const std::string targetFidelity =
+      Json::JsonParserMaestro<>::GetConfigString(
+          "matrix_product_state_target_fidelity", configJson);
+  if (!targetFidelity.empty()) {
+    configured = true;
+    if (network->GetSimulator()) network->GetSimulator()->Clear();
+    network->Configure("matrix_product_state_target_fidelity",
+                       targetFidelity.c_str());
+  }
+
   if (configured || !network->GetSimulator()) network->CreateSimulator();
 
   // TODO: get from config the allowed simulators types and so on, if set
@@ -361,6 +379,24 @@ __declspec(dllexport)
     network->Configure("mps_sample_measure_algorithm", mpsSample.c_str());
   }
 
+  const std::string jacobiSvd = Json::JsonParserMaestro<>::GetConfigString(
+      "matrix_product_state_jacobi_svd", configJson);
+  if (!jacobiSvd.empty()) {
+    configured = true;
+    if (network->GetSimulator()) network->GetSimulator()->Clear();
+    network->Configure("matrix_product_state_jacobi_svd", jacobiSvd.c_str());
+  }
+
+  const std::string targetFidelity =
+      Json::JsonParserMaestro<>::GetConfigString(
+          "matrix_product_state_target_fidelity", configJson);
+  if (!targetFidelity.empty()) {
+    configured = true;
+    if (network->GetSimulator()) network->GetSimulator()->Clear();
+    network->Configure("matrix_product_state_target_fidelity",
+                       targetFidelity.c_str());
+  }
+
   if (configured || !network->GetSimulator()) network->CreateSimulator();
 
   // Split observableStr by ';'
@@ -972,6 +1008,26 @@ __declspec(dllexport)
   return result;
 }
 
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+    double *Amplitudes(void *sim, const unsigned long long int *outcomes,
+                       unsigned long int nrOutcomes) {
+  if (!sim || !outcomes || nrOutcomes == 0) return nullptr;
+  auto simulator = static_cast<Simulators::ISimulator *>(sim);
+  const std::vector<Types::qubit_t> outcomesVector(outcomes,
+                                                   outcomes + nrOutcomes);
+  const auto amplitudes = simulator->Amplitudes(outcomesVector);
+
+  // real and imaginary parts interleaved, like an array of complex numbers
+  double *result = new double[2 * amplitudes.size()];
+  for (size_t i = 0; i < amplitudes.size(); ++i) {
+    result[2 * i] = amplitudes[i].real();
+    result[2 * i + 1] = amplitudes[i].imag();
+  }
+  return result;
+}
+
 #ifdef _WIN32
 __declspec(dllexport)
 #endif
@@ -124,6 +124,11 @@ __declspec(dllexport)
     double *Amplitude(void *sim, unsigned long long int outcome);
 #ifdef _WIN32
 __declspec(dllexport)
+#endif
+    double *Amplitudes(void *sim, const unsigned long long int *outcomes,
+                       unsigned long int nrOutcomes);
+#ifdef _WIN32
+__declspec(dllexport)
 #endif
     double *AllProbabilities(void *sim);
 #ifdef _WIN32
@@ -1,4 +1,5 @@
 #include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
 #include <nanobind/stl/complex.h>
 #include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
@@ -46,6 +47,8 @@ struct SimulatorConfig {
       Simulators::SimulationType::kStatevector;
   std::optional<size_t> max_bond_dimension = std::nullopt;
   std::optional<double> singular_value_threshold = std::nullopt;
+  // target total fidelity for MPS, the truncation is derived from it
+  std::optional<double> mps_target_fidelity = std::nullopt;
   bool use_double_precision = false;
   bool disable_optimized_swapping = false;
   int lookahead_depth = -1;
@@ -61,10 +64,16 @@ struct SimulatorConfig {
   std::optional<size_t> pp_pauli_weight_threshold = std::nullopt;
   std::optional<int> pp_steps_between_trims = std::nullopt;
   std::optional<int> pp_steps_between_deduplications = std::nullopt;
+  std::optional<size_t> pp_max_path_frequency = std::nullopt;
+  std::optional<double> pp_truncation_error_budget = std::nullopt;
 
   // path integral parameters
   std::optional<double> path_integral_threshold = std::nullopt;
 
+  // tensor network memory limit in bytes, the contractions that do not fit
+  // are sliced
+  std::optional<size_t> tn_memory_limit = std::nullopt;
+
   SimulatorConfig() = default;
 
   SimulatorConfig(Simulators::SimulatorType st, Simulators::SimulationType set,
@@ -136,6 +145,13 @@ std::shared_ptr<Network::INetwork<double>> ConfigureNetwork(
     network->Configure("matrix_product_state_truncation_threshold",
                        val.c_str());
   }
+  if (config.mps_target_fidelity) {
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<double>::max_digits10)
+        << *config.mps_target_fidelity;
+    network->Configure("matrix_product_state_target_fidelity",
+                       oss.str().c_str());
+  }
   if (config.use_double_precision) {
     network->Configure("use_double_precision", "1");
   }
@@ -164,8 +180,10 @@ std::shared_ptr<Network::INetwork<double>> ConfigureNetwork(
   // RemoveAllOptimizationSimulatorsAndAdd above.
   // PauliPropagator truncation settings are Configured before CreateSimulator;
   // the state replays its config map once the propagator exists, so they are
-  // applied then. Note that both thresholds are only consulted during a
-  // truncation pass, so a trim or deduplication cadence must also be set.
+  // applied then. Note that the thresholds (path frequency included) are only
+  // consulted during a truncation pass, so a trim or deduplication cadence
+  // must also be set. The dropped coefficients are summed up in the
+  // truncation error bounds returned with the expectation values.
   if (config.pp_coefficient_threshold) {
     std::ostringstream oss;
     oss << std::setprecision(std::numeric_limits<double>::max_digits10)
@@ -187,6 +205,17 @@ std::shared_ptr<Network::INetwork<double>> ConfigureNetwork(
         "pauli_propagator_num_gates_between_deduplications",
         std::to_string(*config.pp_steps_between_deduplications).c_str());
   }
+  if (config.pp_max_path_frequency) {
+    network->Configure("pauli_propagator_max_path_frequency",
+                       std::to_string(*config.pp_max_path_frequency).c_str());
+  }
+  if (config.pp_truncation_error_budget) {
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<double>::max_digits10)
+        << *config.pp_truncation_error_budget;
+    network->Configure("pauli_propagator_truncation_error_budget",
+                       oss.str().c_str());
+  }
   if (config.path_integral_threshold) {
     std::ostringstream oss;
     oss << std::setprecision(std::numeric_limits<double>::max_digits10)
@@ -194,6 +223,10 @@ std::shared_ptr<Network::INetwork<double>> ConfigureNetwork(
     auto val = oss.str();
     network->Configure("path_integral_threshold", val.c_str());
   }
+  if (config.tn_memory_limit) {
+    network->Configure("tensor_network_memory_limit",
+                       std::to_string(*config.tn_memory_limit).c_str());
+  }
 
   network->CreateSimulator();
 
@@ -205,6 +238,26 @@ std::shared_ptr<Network::INetwork<double>> ConfigureNetwork(
   return network;
 }
 
+// With a target fidelity the network derives a fixed singular values cutoff
+// from it and bounds the fidelity from the cutoff and the bond dimension
+// reached. The bound is None (unavailable) if the max bond dimension cap was
+// hit, the key is missing if no target fidelity was set for a mps execution.
+void AddFidelityLowerBound(
+    nb::dict& py_result,
+    const std::shared_ptr<Network::INetwork<double>>& network,
+    const SimulatorConfig& config) {
+  if (!config.mps_target_fidelity ||
+      network->GetLastSimulationType() !=
+          Simulators::SimulationType::kMatrixProductState)
+    return;
+
+  const auto bound = network->GetMPSFidelityLowerBound();
+  if (bound)
+    py_result["fidelity_lower_bound"] = *bound;
+  else
+    py_result["fidelity_lower_bound"] = nb::none();
+}
+
 // Helper to parse observables from String (";" sep) or List[str]
 std::vector<std::string> ParseObservables(const nb::object& observables) {
   std::vector<std::string> paulis;
@@ -255,6 +308,84 @@ static void apply_readout_error_to_counts(
   counts = std::move(new_counts);
 }
 
+// The Pauli frames execution runs on the qcsim stabilizer simulator, which is
+// the one the network picks for Clifford circuits when a qcsim simulator is
+// configured, so it's used only with those. Without measurements there is
+// nothing to sample, the usual path handles that.
+static bool can_execute_on_frames(
+    const std::shared_ptr<Circuits::Circuit<double>>& circuit,
+    const noise::NoiseModel& nm, const SimulatorConfig& config, int shots) {
+  if (shots <= 0 ||
+      (config.simulator_type != Simulators::SimulatorType::kQCSim &&
+       config.simulator_type != Simulators::SimulatorType::kCompositeQCSim) ||
+      !noise::is_pauli_frame_noise(nm) ||
+      !Simulators::PauliFrameSampler<double>::CanSample(circuit))
+    return false;
+
+  for (const auto& op : circuit->GetOperations())
+    if (op->GetType() == Circuits::OperationType::kMeasurement) return true;
+
+  return false;
+}
+
+// Noisy execution of a stabilizer circuit with Pauli noise. The circuit runs
+// once on the stabilizer simulator for the reference sample, then the noise is
+// sampled per shot while the Pauli frames are propagated, so all the shots
+// take a single pass instead of one simulation per noise realization.
+static nb::dict noisy_execute_frames(
+    std::shared_ptr<Circuits::Circuit<double>> circuit,
+    const noise::NoiseModel& nm, int shots, std::mt19937& rng) {
+  const size_t num_qubits =
+      std::max(1, static_cast<int>(circuit->GetMaxQubitIndex()) + 1);
+  // the results have as many bits as the network execution gives
+  const size_t num_cbits =
+      std::max(num_qubits, circuit->GetMaxCbitIndex() + 1);
+  const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+
+  Network::INetwork<double>::ExecuteResults raw_results;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  {
+    nb::gil_scoped_release release;
+
+    auto sim = Simulators::SimulatorsFactory::CreateSimulator(
+        Simulators::SimulatorType::kQCSim,
+        Simulators::SimulationType::kStabilizer);
+    if (!sim) throw std::runtime_error("Failed to create the simulator.");
+    sim->AllocateQubits(num_qubits);
+    sim->Initialize();
+
+    Simulators::PauliFrameSampler<double> sampler(
+        circuit, num_qubits, num_cbits, noise::make_frame_noise(nm));
+    sampler.ComputeReference(sim);
+    raw_results = sampler.Sample(static_cast<size_t>(shots), num_cbits, seed);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  std::unordered_map<std::string, size_t> combined;
+  for (const auto& [bool_vec, count] : raw_results) {
+    std::string bitstring(bool_vec.size(), '0');
+    for (size_t i = 0; i < bool_vec.size(); ++i)
+      if (bool_vec[i]) bitstring[i] = '1';
+    combined[bitstring] += count;
+  }
+
+  // Apply readout error (classical post-measurement channel)
+  apply_readout_error_to_counts(combined, nm, rng);
+
+  nb::dict py_counts;
+  for (const auto& [k, v] : combined) py_counts[k.c_str()] = v;
+
+  nb::dict out;
+  out["counts"] = py_counts;
+  out["time_taken"] = std::chrono::duration<double>(end - start).count();
+  out["simulator"] = (int)Simulators::SimulatorType::kQCSim;
+  out["method"] = (int)Simulators::SimulationType::kStabilizer;
+  // every shot samples its own noise
+  out["noise_realizations"] = shots;
+  return out;
+}
+
 // Core Execution Logic
 nb::dict execute_core(std::shared_ptr<Circuits::Circuit<double>> circuit,
                       const SimulatorConfig& config, int shots) {
@@ -299,6 +430,7 @@ nb::dict execute_core(std::shared_ptr<Circuits::Circuit<double>> circuit,
 
   size_t max_bond_dim = network->GetCurrentMaxBondDimension();
   if (max_bond_dim > 0) py_result["max_bond_dim_reached"] = max_bond_dim;
+  AddFidelityLowerBound(py_result, network, config);
 
   return py_result;
 }
@@ -342,6 +474,15 @@ nb::dict estimate_core(std::shared_ptr<Circuits::Circuit<double>> circuit,
 
   size_t max_bond_dim = network->GetCurrentMaxBondDimension();
   if (max_bond_dim > 0) py_result["max_bond_dim_reached"] = max_bond_dim;
+  AddFidelityLowerBound(py_result, network, config);
+
+  // bounds of the errors the Pauli propagator truncation introduced
+  const auto truncation_errors = network->GetTruncationErrors();
+  if (!truncation_errors.empty()) {
+    nb::list errors;
+    for (double err : truncation_errors) errors.append(err);
+    py_result["truncation_errors"] = errors;
+  }
 
   return py_result;
 }
@@ -369,6 +510,41 @@ std::vector<std::complex<double>> statevector_core(
   return amplitudes;
 }
 
+// Core Batched Amplitudes Logic
+// The amplitudes are returned as a contiguous numpy array, owned by it.
+nb::ndarray<nb::numpy, std::complex<double>, nb::ndim<1>> amplitudes_core(
+    std::shared_ptr<Circuits::Circuit<double>> circuit,
+    const std::vector<Types::qubit_t>& outcomes,
+    const SimulatorConfig& config) {
+  if (!circuit) throw nb::value_error("Circuit is null.");
+
+  int num_qubits =
+      std::max(1, static_cast<int>(circuit->GetMaxQubitIndex()) + 1);
+  for (const auto outcome : outcomes)
+    if (num_qubits < 64 && (outcome >> num_qubits) != 0)
+      throw nb::value_error("An outcome is out of range for the circuit.");
+
+  ScopedSimulator sim(num_qubits);
+  if (sim.handle == 0)
+    throw std::runtime_error("Failed to create simulator handle.");
+
+  auto network = ConfigureNetwork(sim.handle, config);
+  if (!network) throw std::runtime_error("Failed to configure network.");
+
+  auto amplitudes = new std::vector<std::complex<double>>();
+  nb::capsule owner(amplitudes, [](void* p) noexcept {
+    delete static_cast<std::vector<std::complex<double>>*>(p);
+  });
+
+  {
+    nb::gil_scoped_release release;
+    *amplitudes = network->ExecuteOnHostAmplitudes(circuit, 0, outcomes);
+  }
+
+  return nb::ndarray<nb::numpy, std::complex<double>, nb::ndim<1>>(
+      amplitudes->data(), {amplitudes->size()}, owner);
+}
+
 // Helper: Create the adjoint (inverse) of a single quantum gate operation.
 // Non-gate operations (measurements, resets, etc.) return nullptr and are
 // skipped when building the mirror circuit.
@@ -713,13 +889,15 @@ nb::dict incremental_evolve_core(
     }
     current_step = target_step;
 
-    // Compute expectation values (non-destructive for MPS)
-    // GIL is held here — needed for Python object creation
-    nb::list step_exp;
-    for (const auto& pauli : paulis) {
-      double ev = simulator->ExpectationValue(pauli);
-      step_exp.append(ev);
+    // Compute expectation values (non-destructive for MPS) — release GIL for
+    // the computation, it's held again for Python object creation
+    std::vector<double> evs;
+    {
+      nb::gil_scoped_release release;
+      evs = simulator->ExpectationValues(paulis);
     }
+    nb::list step_exp;
+    for (const double ev : evs) step_exp.append(ev);
     all_expectations.append(step_exp);
     steps_measured.append(target_step);
     bond_dim_evolution.append(current_max_bond_dim);
@@ -796,6 +974,7 @@ NB_MODULE(maestro, m) {
       .def_rw("max_bond_dimension", &SimulatorConfig::max_bond_dimension)
       .def_rw("singular_value_threshold",
               &SimulatorConfig::singular_value_threshold)
+      .def_rw("mps_target_fidelity", &SimulatorConfig::mps_target_fidelity)
       .def_rw("use_double_precision", &SimulatorConfig::use_double_precision)
       .def_rw("precision", &SimulatorConfig::precision)
       .def_rw("disable_optimized_swapping",
@@ -811,8 +990,12 @@ NB_MODULE(maestro, m) {
               &SimulatorConfig::pp_steps_between_trims)
       .def_rw("pp_steps_between_deduplications",
               &SimulatorConfig::pp_steps_between_deduplications)
+      .def_rw("pp_max_path_frequency", &SimulatorConfig::pp_max_path_frequency)
+      .def_rw("pp_truncation_error_budget",
+              &SimulatorConfig::pp_truncation_error_budget)
       .def_rw("path_integral_threshold",
               &SimulatorConfig::path_integral_threshold)
+      .def_rw("tn_memory_limit", &SimulatorConfig::tn_memory_limit)
       .def("__repr__", [](const SimulatorConfig& c) {
         std::ostringstream oss;
         oss << "SimulatorConfig("
@@ -1058,6 +1241,16 @@ NB_MODULE(maestro, m) {
           "config"_a = SimulatorConfig{},
           "Get the full statevector (complex amplitudes) after executing the "
           "circuit.")
+      .def(
+          "get_amplitudes",
+          [](std::shared_ptr<Circuits::Circuit<double>> self,
+             const std::vector<Types::qubit_t> &outcomes,
+             const SimulatorConfig &config) {
+            return amplitudes_core(self, outcomes, config);
+          },
+          "outcomes"_a, "config"_a = SimulatorConfig{},
+          "Get the amplitudes of the specified basis states (indexed as in "
+          "the statevector) after executing the circuit, as a numpy array.")
       .def(
           "mirror_fidelity",
           [](std::shared_ptr<Circuits::Circuit<double>> self,
@@ -1244,6 +1437,12 @@ NB_MODULE(maestro, m) {
              std::optional<unsigned int> seed) {
             if (!self) throw nb::value_error("Circuit is null.");
             std::mt19937 rng(seed.value_or(std::random_device{}()));
+
+            // Clifford circuits with Pauli noise: sample all the shots in one
+            // pass on Pauli frames
+            if (can_execute_on_frames(self, noise_model, config, shots))
+              return noisy_execute_frames(self, noise_model, shots, rng);
+
             const int batches =
                 std::min(shots, std::max(1, noise_realizations));
             const int base_batch = shots / batches;
@@ -1798,6 +1997,20 @@ NB_MODULE(maestro, m) {
       "Get the full statevector (complex amplitudes) after executing a "
       "circuit.");
 
+  m.def(
+      "get_amplitudes",
+      [](std::shared_ptr<Circuits::Circuit<double>> circuit,
+         const std::vector<Types::qubit_t>& outcomes,
+         const SimulatorConfig& config) {
+        return amplitudes_core(circuit, outcomes, config);
+      },
+      "circuit"_a, "outcomes"_a, "config"_a = SimulatorConfig{},
+      "Get the amplitudes of the specified basis states (indexed as in the "
+      "statevector) after executing a circuit, as a numpy array. The "
+      "amplitudes are computed together, the tensor network simulator "
+      "shares the contractions between them, so it's much faster than "
+      "getting them one by one (useful for cross entropy benchmarking).");
+
   m.def(
       "mirror_fidelity",
       [](std::shared_ptr<Circuits::Circuit<double>> circuit,
@@ -2271,6 +2484,12 @@ NB_MODULE(maestro, m) {
         if (!circuit) throw nb::value_error("Circuit is null.");
 
         std::mt19937 rng(seed.value_or(std::random_device{}()));
+
+        // Clifford circuits with Pauli noise: sample all the shots in one pass
+        // on Pauli frames
+        if (can_execute_on_frames(circuit, noise_model, config, shots))
+          return noisy_execute_frames(circuit, noise_model, shots, rng);
+
         const int batches = std::min(shots, std::max(1, noise_realizations));
         const int base_batch = shots / batches;
         int leftover = shots % batches;
@@ -2309,7 +2528,9 @@ NB_MODULE(maestro, m) {
       "shots"_a = 1024, "noise_realizations"_a = 64, "seed"_a = nb::none(),
       "Execute a circuit with Monte Carlo Pauli noise. "
       "Each of 'noise_realizations' batches uses a different random noise "
-      "pattern, with shots distributed evenly across batches.");
+      "pattern, with shots distributed evenly across batches. With a qcsim "
+      "simulator, measured Clifford circuits without T1 decay are sampled on "
+      "Pauli frames instead, with independent noise for every shot.");
 
   // =========================================================================
   // Coherent Noise: Execute
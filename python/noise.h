@@ -36,6 +36,7 @@
 #include <unordered_map>
 
 #include "Circuit/Circuit.h"
+#include "Simulators/PauliFrameSampler.h"
 
 namespace noise {
 
@@ -596,6 +597,50 @@ inline std::shared_ptr<Circuits::Circuit<double>> inject_noise(
   return out;
 }
 
+/**
+ * True if the noise injected by inject_noise can be sampled on Pauli frames.
+ * All its channels are Pauli channels, except the T1 decay (a reset applied
+ * with some probability is not a Pauli error).
+ */
+inline bool is_pauli_frame_noise(const NoiseModel &nm) { return !nm.has_t1(); }
+
+/**
+ * Build the noise function for the Pauli frame sampler.
+ * Adds after each gate the same channels inject_noise samples: the "all
+ * gates" and the gate-type-specific Pauli channels on every affected qubit
+ * and the two-qubit depolarizing channel. The errors are then sampled
+ * independently for each shot while the frames are propagated.
+ *
+ * @param nm  NoiseModel without T1 decay (see is_pauli_frame_noise).
+ * @return The noise function, it holds a copy of the model.
+ */
+inline Simulators::PauliFrameSampler<double>::NoiseFunction make_frame_noise(
+    const NoiseModel &nm) {
+  using Sampler = Simulators::PauliFrameSampler<double>;
+
+  return [nm](const std::shared_ptr<Circuits::IQuantumGate<double>> &gate,
+              Sampler::NoiseChannels &channels) {
+    auto affected = gate->AffectedQubits();
+    bool is_2q = affected.size() >= 2;
+
+    for (auto q : affected) {
+      const auto *qn = nm.get(static_cast<int>(q));
+      if (qn) channels.pauli.push_back({q, qn->px, qn->py, qn->pz});
+
+      const auto *qng = is_2q ? nm.get_2q_gate_noise(static_cast<int>(q))
+                              : nm.get_1q_gate_noise(static_cast<int>(q));
+      if (qng) channels.pauli.push_back({q, qng->px, qng->py, qng->pz});
+    }
+
+    if (is_2q) {
+      double p2q = nm.get_2q_depolarizing(static_cast<int>(affected[0]),
+                                          static_cast<int>(affected[1]));
+      if (p2q > 0)
+        channels.depolarizing2.push_back({affected[0], affected[1], p2q});
+    }
+  };
+}
+
 /**
  * Inject coherent rotation noise into a circuit copy.
  *
@@ -24,6 +24,9 @@ namespace bdata = boost::unit_test::data;
 #include <math.h>
 
 #include "../Simulators/Factory.h"
+#include "../Simulators/PauliFrameSampler.h"
+#include "../Simulators/StabilizerTableau.h"
+#include "Clifford.h"
 #include "../Circuit/Factory.h"
 
 struct CliffordSimTestFixture {
@@ -168,4 +171,300 @@ BOOST_DATA_TEST_CASE_F(CliffordSimTestFixture, RandomCircuitsTest,
   state.Reset();
 }
 
+BOOST_DATA_TEST_CASE_F(CliffordSimTestFixture, PauliFrameSamplingTest,
+                       bdata::xrange(1, 20), nrGates) {
+  const size_t nrShots = 20000;
+
+  GenerateCircuit(nrGates);
+
+  circ->Execute(qcsimClifford, state);
+  const auto qcsimProbs = qcsimClifford->AllProbabilities();
+  resetRandomCirc->Execute(qcsimClifford, state);
+
+  std::vector<std::pair<Types::qubit_t, size_t>> measurements;
+  for (size_t q = 0; q < nrQubitsForRandomCirc; ++q)
+    measurements.emplace_back(q, q);
+  circ->AddOperation(
+      std::make_shared<Circuits::MeasurementOperation<>>(measurements));
+
+  BOOST_TEST(Simulators::PauliFrameSampler<>::CanSample(circ));
+
+  Simulators::PauliFrameSampler<> sampler(circ, nrQubitsForRandomCirc,
+                                          nrQubitsForRandomCirc);
+  sampler.ComputeReference(qcsimClifford);
+  const auto results =
+      sampler.Sample(nrShots, nrQubitsForRandomCirc, nrGates);
+
+  size_t totalShots = 0;
+  for (const auto &[bits, cnt] : results) {
+    size_t basisState = 0;
+    for (size_t q = 0; q < bits.size(); ++q)
+      if (bits[q]) basisState |= 1ULL << q;
+
+    BOOST_TEST(qcsimProbs[basisState] > 1e-5);
+    BOOST_CHECK_SMALL(static_cast<double>(cnt) / nrShots -
+                          qcsimProbs[basisState],
+                      0.02);
+
+    totalShots += cnt;
+  }
+  BOOST_TEST(totalShots == nrShots);
+
+  resetRandomCirc->Execute(qcsimClifford, state);
+
+  circ->Clear();
+  state.Reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(PauliFrameMidCircuitMeasurementsTest,
+                        CliffordSimTestFixture) {
+  // the first measurement is random, the second one repeats it through the
+  // cnot, the reset qubit is measured as zero
+  circ->AddOperation(std::make_shared<Circuits::HadamardGate<>>(0));
+  circ->AddOperation(std::make_shared<Circuits::MeasurementOperation<>>(
+      std::vector<std::pair<Types::qubit_t, size_t>>{{0, 0}}));
+  circ->AddOperation(std::make_shared<Circuits::CXGate<>>(0, 1));
+  circ->AddOperation(
+      std::make_shared<Circuits::Reset<>>(Types::qubits_vector{0}));
+  circ->AddOperation(std::make_shared<Circuits::MeasurementOperation<>>(
+      std::vector<std::pair<Types::qubit_t, size_t>>{{0, 2}, {1, 1}}));
+
+  BOOST_TEST(Simulators::PauliFrameSampler<>::CanSample(circ));
+
+  Simulators::PauliFrameSampler<> sampler(circ, nrQubitsForRandomCirc,
+                                          nrQubitsForRandomCirc);
+  sampler.ComputeReference(qcsimClifford);
+  const auto results = sampler.Sample(10000, 3, 42);
+
+  BOOST_TEST(results.size() == 2);
+  for (const auto &[bits, cnt] : results) {
+    BOOST_TEST(bits[0] == bits[1]);
+    BOOST_TEST(!bits[2]);
+    BOOST_CHECK_SMALL(static_cast<double>(cnt) / 10000. - 0.5, 0.02);
+  }
+
+  circ->AddOperation(std::make_shared<Circuits::TGate<>>(1));
+  BOOST_TEST(!Simulators::PauliFrameSampler<>::CanSample(circ));
+
+  resetRandomCirc->Execute(qcsimClifford, state);
+  circ->Clear();
+}
+
+BOOST_FIXTURE_TEST_CASE(PauliFrameNoiseTest, CliffordSimTestFixture) {
+  // H H is the identity, the errors after the first H are conjugated by the
+  // second one, so the measured bit flips with probability py + pz after the
+  // first gate and px + py after the second one; the two qubit depolarizing
+  // channel after the cnot flips each of the two bits with probability 8/15 p
+  // and both of them with probability 4/15 p
+  constexpr double px = 0.05;
+  constexpr double py = 0.1;
+  constexpr double pz = 0.15;
+  constexpr double p2 = 0.3;
+  constexpr size_t shots = 100000;
+
+  circ->AddOperation(std::make_shared<Circuits::HadamardGate<>>(0));
+  circ->AddOperation(std::make_shared<Circuits::HadamardGate<>>(0));
+  circ->AddOperation(std::make_shared<Circuits::CXGate<>>(1, 2));
+  circ->AddOperation(std::make_shared<Circuits::MeasurementOperation<>>(
+      std::vector<std::pair<Types::qubit_t, size_t>>{{0, 0}, {1, 1}, {2, 2}}));
+
+  using Sampler = Simulators::PauliFrameSampler<>;
+  const auto noise = [&](const std::shared_ptr<Circuits::IQuantumGate<>> &gate,
+                         Sampler::NoiseChannels &channels) {
+    if (gate->GetNumQubits() == 1)
+      channels.pauli.push_back({gate->GetQubit(0), px, py, pz});
+    else
+      channels.depolarizing2.push_back(
+          {gate->GetQubit(0), gate->GetQubit(1), p2});
+  };
+
+  Sampler sampler(circ, nrQubitsForRandomCirc, nrQubitsForRandomCirc, noise);
+  sampler.ComputeReference(qcsimClifford);
+  const auto results = sampler.Sample(shots, 3, 7);
+
+  double flip0 = 0;
+  double flip1 = 0;
+  double flip12 = 0;
+  for (const auto &[bits, cnt] : results) {
+    if (bits[0]) flip0 += cnt;
+    if (bits[1]) flip1 += cnt;
+    if (bits[1] && bits[2]) flip12 += cnt;
+  }
+
+  const double a = py + pz;
+  const double b = px + py;
+  BOOST_CHECK_SMALL(flip0 / shots - (a * (1. - b) + b * (1. - a)), 0.01);
+  BOOST_CHECK_SMALL(flip1 / shots - 8. / 15. * p2, 0.01);
+  BOOST_CHECK_SMALL(flip12 / shots - 4. / 15. * p2, 0.01);
+
+  // without noise the circuit is deterministic
+  Sampler noiseless(circ, nrQubitsForRandomCirc, nrQubitsForRandomCirc);
+  resetRandomCirc->Execute(qcsimClifford, state);
+  noiseless.ComputeReference(qcsimClifford);
+  BOOST_TEST(noiseless.Sample(1000, 3, 7).size() == 1);
+
+  resetRandomCirc->Execute(qcsimClifford, state);
+  circ->Clear();
+}
+
+BOOST_DATA_TEST_CASE(StabilizerTableauVsQCSimTest,
+                     bdata::make({10, 100, 500}), nrQubits) {
+  const size_t nrGates = 20 * nrQubits;
+
+  Simulators::StabilizerTableau tableau(nrQubits);
+  QC::Clifford::StabilizerSimulator qcsimTableau(nrQubits);
+
+  std::mt19937 g(static_cast<unsigned int>(nrQubits));
+  std::uniform_int_distribution<unsigned int> qubitDist(0, nrQubits - 1);
+  std::uniform_int_distribution<int> gateDist(0, 7);
+
+  std::vector<std::tuple<int, unsigned int, unsigned int>> gates(nrGates);
+  for (auto &[gate, q1, q2] : gates) {
+    gate = gateDist(g);
+    q1 = qubitDist(g);
+    do {
+      q2 = qubitDist(g);
+    } while (q2 == q1);
+  }
+
+  const auto applyGates = [&gates](auto &sim) {
+    for (const auto &[gate, q1, q2] : gates) {
+      switch (gate) {
+        case 0:
+          sim.ApplyH(q1);
+          break;
+        case 1:
+          sim.ApplyS(q1);
+          break;
+        case 2:
+          sim.ApplySdg(q1);
+          break;
+        case 3:
+          sim.ApplySx(q1);
+          break;
+        case 4:
+          sim.ApplyCX(q1, q2);
+          break;
+        case 5:
+          sim.ApplyCY(q1, q2);
+          break;
+        case 6:
+          sim.ApplyCZ(q1, q2);
+          break;
+        default:
+          sim.ApplySwap(q1, q2);
+          break;
+      }
+    }
+  };
+
+  auto start = std::chrono::system_clock::now();
+  applyGates(tableau);
+  auto end = std::chrono::system_clock::now();
+  const double tableauTime =
+      std::chrono::duration<double>(end - start).count() * 1000.;
+
+  start = std::chrono::system_clock::now();
+  applyGates(qcsimTableau);
+  end = std::chrono::system_clock::now();
+  const double qcsimTime =
+      std::chrono::duration<double>(end - start).count() * 1000.;
+
+  BOOST_TEST_MESSAGE("Gates on " << nrQubits << " qubits, bit-packed tableau: "
+                                 << tableauTime << " ms, qcsim: " << qcsimTime
+                                 << " ms");
+
+  // the expectation values are deterministic, they must be the same
+  std::uniform_int_distribution<int> pauliDist(0, 3);
+  for (int i = 0; i < 50; ++i) {
+    std::string pauliString(nrQubits, 'I');
+    for (int j = 0; j < 3; ++j) pauliString[qubitDist(g)] = "IXYZ"[pauliDist(g)];
+
+    BOOST_CHECK_PREDICATE(checkClose,
+                          (tableau.ExpectationValue(pauliString))(
+                              qcsimTableau.ExpectationValue(pauliString))(
+                              1e-10));
+  }
+
+  start = std::chrono::system_clock::now();
+  for (unsigned int q = 0; q < nrQubits; ++q) tableau.MeasureQubit(q);
+  end = std::chrono::system_clock::now();
+  const double tableauMeasTime =
+      std::chrono::duration<double>(end - start).count() * 1000.;
+
+  start = std::chrono::system_clock::now();
+  for (unsigned int q = 0; q < nrQubits; ++q) qcsimTableau.MeasureQubit(q);
+  end = std::chrono::system_clock::now();
+  const double qcsimMeasTime =
+      std::chrono::duration<double>(end - start).count() * 1000.;
+
+  BOOST_TEST_MESSAGE("Measuring " << nrQubits
+                                  << " qubits, bit-packed tableau: "
+                                  << tableauMeasTime << " ms, qcsim: "
+                                  << qcsimMeasTime << " ms");
+
+  // after measuring all qubits, the state is a basis state
+  std::string zString(nrQubits, 'I');
+  for (unsigned int q = 0; q < nrQubits; ++q) {
+    zString[q] = 'Z';
+    BOOST_TEST(std::abs(tableau.ExpectationValue(zString)) == 1.);
+    zString[q] = 'I';
+  }
+
+  // the batched expectation values are the same as the separate ones, on an
+  // entangled state, with both zero and nonzero values
+  for (unsigned int q = 0; q + 1 < nrQubits; ++q)
+    tableau.ApplyCX(q + 1, q);
+  tableau.ApplyH(0);
+
+  std::vector<std::string> pauliStrings;
+  for (unsigned int q = 0; q + 1 < nrQubits; ++q) {
+    std::string pauliString(nrQubits, 'I');
+    pauliString[q] = 'Z';
+    pauliString[q + 1] = q % 2 ? 'z' : 'Z';
+    pauliStrings.emplace_back(std::move(pauliString));
+  }
+  for (int i = 0; i < 50; ++i) {
+    std::string pauliString(nrQubits, 'I');
+    for (int j = 0; j < 3; ++j) pauliString[qubitDist(g)] = "IXYZ"[pauliDist(g)];
+    pauliStrings.emplace_back(std::move(pauliString));
+  }
+
+  start = std::chrono::system_clock::now();
+  const auto values = tableau.ExpectationValues(pauliStrings);
+  end = std::chrono::system_clock::now();
+
+  BOOST_TEST_MESSAGE("Expectation values of " << pauliStrings.size()
+                                              << " Pauli strings on "
+                                              << nrQubits << " qubits: "
+                                              << std::chrono::duration<double>(
+                                                     end - start)
+                                                         .count() *
+                                                     1000.
+                                              << " ms");
+
+  BOOST_TEST(values.size() == pauliStrings.size());
+  for (size_t i = 0; i < pauliStrings.size(); ++i)
+    BOOST_TEST(values[i] == tableau.ExpectationValue(pauliStrings[i]));
+}
+
+BOOST_AUTO_TEST_CASE(StabilizerTableauCloneTest) {
+  const size_t nrQubits = 64;
+  Simulators::StabilizerTableau tableau(nrQubits);
+  for (unsigned int q = 0; q < nrQubits; ++q) tableau.ApplyH(q);
+
+  // the clone has the same state, but draws its own outcomes
+  auto clone = tableau.Clone();
+  std::string zString(nrQubits, 'I');
+  zString[0] = 'Z';
+  BOOST_TEST(clone->ExpectationValue(zString) == 0.);
+
+  std::vector<bool> outcomes(nrQubits), cloneOutcomes(nrQubits);
+  for (unsigned int q = 0; q < nrQubits; ++q) {
+    outcomes[q] = tableau.MeasureQubit(q);
+    cloneOutcomes[q] = clone->MeasureQubit(q);
+  }
+  BOOST_TEST(outcomes != cloneOutcomes);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,8 @@ namespace bdata = boost::unit_test::data;
 
 #include "../Simulators/Factory.h"
 #include "../Circuit/Factory.h"
+#include "../Estimators/ExecutionCost.h"
+#include "../Simulators/ExtendedStabilizer.h"
 
 struct Operation {
   int gate = 0;  // gate id, first codes for clifford gates, then for
@@ -39,27 +41,7 @@ struct Operation {
   double gamma = 0;
 };
 
-struct ExtStabTestFixture {
-  ExtStabTestFixture() {
-    simExtStabilizer = Simulators::SimulatorsFactory::CreateSimulator(
-        Simulators::SimulatorType::kQiskitAer,
-        Simulators::SimulationType::kExtendedStabilizer);
-
-    // default value is 0.05, too bad for the tests
-    simExtStabilizer->Configure("extended_stabilizer_approximation_error",
-                                "0.01");
-    // simExtStabilizer->Configure("extended_stabilizer_sampling_method",
-    // "norm_estimation");
-    simExtStabilizer->AllocateQubits(nrQubitsForRandomCirc);
-    simExtStabilizer->Initialize();
-
-    simStatevector = Simulators::SimulatorsFactory::CreateSimulator(
-        Simulators::SimulatorType::kQCSim,
-        Simulators::SimulationType::kStatevector);
-    simStatevector->AllocateQubits(nrQubitsForRandomCirc);
-    simStatevector->Initialize();
-  }
-
+struct ExtStabCircuitsGenerator {
   std::string GeneratePauliString(int nrQubits) {
     std::string pauli;
     pauli.resize(nrQubits);
@@ -262,6 +244,44 @@ struct ExtStabTestFixture {
   std::shared_ptr<Simulators::ISimulator> simExtStabilizer;
 };
 
+struct ExtStabTestFixture : public ExtStabCircuitsGenerator {
+  ExtStabTestFixture() {
+    simExtStabilizer = Simulators::SimulatorsFactory::CreateSimulator(
+        Simulators::SimulatorType::kQiskitAer,
+        Simulators::SimulationType::kExtendedStabilizer);
+
+    // default value is 0.05, too bad for the tests
+    simExtStabilizer->Configure("extended_stabilizer_approximation_error",
+                                "0.01");
+    // simExtStabilizer->Configure("extended_stabilizer_sampling_method",
+    // "norm_estimation");
+    simExtStabilizer->AllocateQubits(nrQubitsForRandomCirc);
+    simExtStabilizer->Initialize();
+
+    simStatevector = Simulators::SimulatorsFactory::CreateSimulator(
+        Simulators::SimulatorType::kQCSim,
+        Simulators::SimulationType::kStatevector);
+    simStatevector->AllocateQubits(nrQubitsForRandomCirc);
+    simStatevector->Initialize();
+  }
+};
+
+struct QCSimExtStabTestFixture : public ExtStabCircuitsGenerator {
+  QCSimExtStabTestFixture() {
+    simExtStabilizer = Simulators::SimulatorsFactory::CreateSimulator(
+        Simulators::SimulatorType::kQCSim,
+        Simulators::SimulationType::kExtendedStabilizer);
+    simExtStabilizer->AllocateQubits(nrQubitsForRandomCirc);
+    simExtStabilizer->Initialize();
+
+    simStatevector = Simulators::SimulatorsFactory::CreateSimulator(
+        Simulators::SimulatorType::kQCSim,
+        Simulators::SimulationType::kStatevector);
+    simStatevector->AllocateQubits(nrQubitsForRandomCirc);
+    simStatevector->Initialize();
+  }
+};
+
 BOOST_AUTO_TEST_SUITE(ext_stabilizer_tests)
 
 BOOST_FIXTURE_TEST_CASE(ExtStabilizerSimInitializationTest,
@@ -453,4 +473,104 @@ sim"
 }
 */
 
+// the in-tree extended stabilizer is exact (up to the truncation of the
+// negligible terms), so it can be checked on non-Clifford circuits as well
+BOOST_DATA_TEST_CASE_F(QCSimExtStabTestFixture,
+                       QCSimRandomNonCliffordCircuitsTest,
+                       bdata::xrange(1, 20), nrGates) {
+  auto circuit = GenerateCircuit(nrQubitsForRandomCirc, nrGates, 29);
+
+  for (const auto& op : circuit) {
+    ExecuteGate(op, simStatevector);
+    ExecuteGate(op, simExtStabilizer);
+  }
+
+  const int nrChecks = 100;
+  for (int i = 0; i < nrChecks; ++i) {
+    const std::string pauliStr = GeneratePauliString(nrQubitsForRandomCirc);
+    const double expValStateVec = simStatevector->ExpectationValue(pauliStr);
+
+    const double expValExtStabilizer =
+        simExtStabilizer->ExpectationValue(pauliStr);
+    BOOST_TEST(std::abs(expValStateVec - expValExtStabilizer) < 1e-6,
+               "Expectation value mismatch for pauli string "
+                   << pauliStr << ": statevector " << expValStateVec
+                   << ", ext stabilizer " << expValExtStabilizer);
+  }
+
+  const auto svProbs = simStatevector->AllProbabilities();
+  const auto esProbs = simExtStabilizer->AllProbabilities();
+  BOOST_TEST(svProbs.size() == esProbs.size());
+  for (size_t i = 0; i < std::min(svProbs.size(), esProbs.size()); ++i)
+    BOOST_TEST(std::abs(svProbs[i] - esProbs[i]) < 1e-6,
+               "Probability mismatch for outcome "
+                   << i << ": statevector " << svProbs[i]
+                   << ", ext stabilizer " << esProbs[i]);
+
+  simExtStabilizer->Reset();
+}
+
+BOOST_AUTO_TEST_CASE(ExtStabilizerDoublingsTest) {
+  auto circ = std::make_shared<Circuits::Circuit<>>();
+  circ->AddOperation(std::make_shared<Circuits::CXGate<>>(0, 1));
+  circ->AddOperation(std::make_shared<Circuits::TGate<>>(0));
+  circ->AddOperation(std::make_shared<Circuits::UGate<>>(1, 0.3, 0.2, 0.1));
+  circ->AddOperation(
+      std::make_shared<Circuits::CUGate<>>(0, 1, 0.3, 0.2, 0.1, 0.));
+  circ->AddOperation(std::make_shared<Circuits::CCXGate<>>(0, 1, 2));
+
+  // 1 for T, 3 for U, 6 for CU, 7 for CCX
+  BOOST_TEST(Estimators::ExecutionCost::ExtendedStabilizerDoublings(circ) ==
+             17);
+
+  // the cost model doubles the terms as many times
+  double nrTerms = 0;
+  Estimators::ExecutionCost::ExtendedStabilizerCost(3, circ, nrTerms);
+  BOOST_TEST(nrTerms == std::pow(2., 17));
+}
+
+BOOST_AUTO_TEST_CASE(ExtStabilizerMeasureTest) {
+  // H T H on qubit 0 gives 1 with probability sin^2(pi/8), the CX copies the
+  // outcome on qubit 1
+  Simulators::ExtendedStabilizer sim(2);
+  sim.ApplyH(0);
+  sim.ApplyPhase(0, M_PI / 4);
+  sim.ApplyH(0);
+  sim.ApplyCX(1, 0);
+  BOOST_TEST(sim.GetNumberOfTerms() == 2);
+  sim.SaveState();
+
+  const int nrShots = 10000;
+  const double prob1 = std::pow(std::sin(M_PI / 8), 2);
+  int nrOnes = 0;
+  for (int shot = 0; shot < nrShots; ++shot) {
+    const bool outcome = sim.MeasureQubit(0);
+    if (outcome) ++nrOnes;
+
+    // the state is collapsed
+    BOOST_TEST(sim.MeasureQubit(1) == outcome);
+    BOOST_TEST(std::abs(sim.ExpectationValue("ZI") - (outcome ? -1. : 1.)) <
+               1e-10);
+
+    sim.RestoreState();
+  }
+
+  const double sigma = std::sqrt(prob1 * (1. - prob1) / nrShots);
+  BOOST_TEST(std::abs(static_cast<double>(nrOnes) / nrShots - prob1) <
+             5. * sigma);
+
+  // a clone draws its own outcomes
+  const size_t nrQubits = 64;
+  Simulators::ExtendedStabilizer wide(nrQubits);
+  for (unsigned int q = 0; q < nrQubits; ++q) wide.ApplyH(q);
+  auto clone = wide.Clone();
+
+  std::vector<bool> outcomes(nrQubits), cloneOutcomes(nrQubits);
+  for (unsigned int q = 0; q < nrQubits; ++q) {
+    outcomes[q] = wide.MeasureQubit(q);
+    cloneOutcomes[q] = clone->MeasureQubit(q);
+  }
+  BOOST_TEST(outcomes != cloneOutcomes);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -24,6 +24,8 @@ namespace bdata = boost::unit_test::data;
 #include <math.h>
 
 #include "../Simulators/Factory.h"
+#include "../Simulators/MPSEnvironments.h"
+#include "../Simulators/MPSLayerUpdate.h"
 #include "../Circuit/Factory.h"
 
 struct MPSSimTestFixture {
@@ -344,6 +346,44 @@ BOOST_DATA_TEST_CASE_F(MPSSimTestFixture, RandomCircuitsTest,
   state.Reset();
 }
 
+BOOST_FIXTURE_TEST_CASE(JacobiSvdTest, MPSSimTestFixture) {
+  const int nrGates = 9;
+
+  // the cpu mps has only the full svd, it ignores the option
+  BOOST_CHECK_NO_THROW(
+      qcsimMPS->Configure("matrix_product_state_jacobi_svd", "true"));
+  BOOST_CHECK_NO_THROW(
+      qcsimMPS->Configure("matrix_product_state_jacobi_svd", "auto"));
+  BOOST_CHECK_NO_THROW(
+      qcsimMPS->Configure("matrix_product_state_jacobi_svd", "false"));
+
+#ifdef __linux__
+  if (!gpusimMPS) return;
+
+  auto gpuJacobiMPS = Simulators::SimulatorsFactory::CreateSimulator(
+      Simulators::SimulatorType::kGpuSim,
+      Simulators::SimulationType::kMatrixProductState);
+  gpuJacobiMPS->AllocateQubits(nrQubitsForRandomCirc);
+  gpuJacobiMPS->Configure("matrix_product_state_jacobi_svd", "true");
+  gpuJacobiMPS->Initialize();
+
+  GenerateCircuit(nrGates);
+  circ->Execute(gpusimMPS, state);
+  circ->Execute(gpuJacobiMPS, state);
+
+  // same decomposition, obtained with a different algorithm
+  const auto probs = gpusimMPS->AllProbabilities();
+  const auto jacobiProbs = gpuJacobiMPS->AllProbabilities();
+  BOOST_TEST(jacobiProbs.size() == probs.size());
+  for (size_t i = 0; i < probs.size(); ++i)
+    BOOST_CHECK_SMALL(probs[i] - jacobiProbs[i], 1e-5);
+
+  resetRandomCirc->Execute(gpusimMPS, state);
+  circ->Clear();
+  state.Reset();
+#endif
+}
+
 // this is quite slow, I'll leave it here with the number of tests/gates reduced
 // (originally it started from 100)
 
@@ -620,4 +660,296 @@ BOOST_DATA_TEST_CASE_F(MPSSimTestFixture, SampleCountsManyTest,
   state.Reset();
 }
 
+BOOST_DATA_TEST_CASE_F(MPSSimTestFixture, ExpectationValuesTest,
+                       bdata::xrange(1, 20), nrGates) {
+  GenerateCircuit(nrGates);
+
+  circ->Execute(qcsimSV, state);
+  circ->Execute(qcsimMPS, state);
+
+  std::random_device rd;
+  std::mt19937 g(rd());
+  std::uniform_int_distribution<int> opDist(0, 3);
+  const char ops[] = {'I', 'X', 'Y', 'Z'};
+
+  // random terms, with duplicates, identities and single qubit Z terms mixed
+  // in, to exercise all the paths of the batched evaluation
+  std::vector<std::string> paulis;
+  for (int t = 0; t < 30; ++t) {
+    std::string pauli(nrQubitsForRandomCirc, 'I');
+    for (auto &op : pauli) op = ops[opDist(g)];
+    paulis.push_back(pauli);
+  }
+  paulis.push_back(paulis.front());
+  paulis.push_back(std::string(nrQubitsForRandomCirc, 'I'));
+  paulis.push_back("IIZ");
+  paulis.push_back("xz");
+  // past the last qubit, Z keeps the value and X zeroes it
+  paulis.push_back(paulis[1] + "IZ");
+  paulis.push_back(paulis[2] + "X");
+
+  const auto svVals = qcsimSV->ExpectationValues(paulis);
+  const auto mpsVals = qcsimMPS->ExpectationValues(paulis);
+
+  BOOST_TEST(svVals.size() == paulis.size());
+  BOOST_TEST(mpsVals.size() == paulis.size());
+
+  for (size_t i = 0; i < paulis.size(); ++i) {
+    const double svVal = qcsimSV->ExpectationValue(paulis[i]);
+    const double mpsVal = qcsimMPS->ExpectationValue(paulis[i]);
+
+    BOOST_CHECK_SMALL(svVals[i] - svVal, 1e-10);
+    BOOST_CHECK_SMALL(mpsVals[i] - mpsVal, 1e-10);
+    BOOST_CHECK_SMALL(mpsVals[i] - svVal, 1e-4);
+  }
+
+  resetRandomCirc->Execute(qcsimMPS, state);
+  resetRandomCirc->Execute(qcsimSV, state);
+
+  circ->Clear();
+  state.Reset();
+}
+
+BOOST_AUTO_TEST_CASE(MPSEnvironmentsTest) {
+  const int nrQubits = 6;
+  const size_t dim = 1ULL << nrQubits;
+
+  std::mt19937 g(42);
+  std::normal_distribution<double> nd;
+  Eigen::VectorXcd psi(dim);
+  for (size_t i = 0; i < dim; ++i) psi[i] = std::complex<double>(nd(g), nd(g));
+  psi.normalize();
+
+  // Vidal's form, qubit i on the position i in the chain
+  std::vector<Eigen::Tensor<std::complex<double>, 3>> gammas;
+  std::vector<Eigen::VectorXd> lambdas;
+  Eigen::MatrixXcd rest = psi.transpose();
+  Eigen::VectorXd prevLambda = Eigen::VectorXd::Ones(1);
+  for (int q = 0; q < nrQubits; ++q) {
+    const Eigen::Index left = rest.rows();
+    Eigen::MatrixXcd m(left * 2, rest.cols() / 2);
+    for (Eigen::Index l = 0; l < left; ++l)
+      for (Eigen::Index c = 0; c < rest.cols(); ++c)
+        m(l * 2 + (c & 1), c >> 1) = rest(l, c);
+
+    const bool last = q == nrQubits - 1;
+    Eigen::JacobiSVD<Eigen::MatrixXcd> svd(
+        m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::Index right = last ? 1 : svd.singularValues().size();
+
+    Eigen::Tensor<std::complex<double>, 3> gamma(left, 2, right);
+    for (Eigen::Index l = 0; l < left; ++l)
+      for (int s = 0; s < 2; ++s)
+        for (Eigen::Index r = 0; r < right; ++r)
+          gamma(l, s, r) =
+              (last ? m(l * 2 + s, 0) : svd.matrixU()(l * 2 + s, r)) /
+              prevLambda[l];
+    gammas.push_back(gamma);
+
+    if (!last) {
+      prevLambda = svd.singularValues();
+      lambdas.push_back(prevLambda);
+      rest = prevLambda.asDiagonal() * svd.matrixV().adjoint();
+    }
+  }
+
+  Simulators::MPSEnvironments environments;
+  BOOST_TEST(environments.Load(gammas, lambdas));
+  BOOST_TEST(environments.GetNumberOfSites() == nrQubits);
+
+  std::uniform_int_distribution<int> opDist(0, 3);
+  std::uniform_int_distribution<int> lenDist(0, nrQubits);
+  const char ops[] = {'I', 'X', 'Y', 'Z'};
+  std::vector<std::string> paulis;
+  for (int t = 0; t < 200; ++t) {
+    std::string pauli(lenDist(g), 'I');
+    for (auto &op : pauli) op = ops[opDist(g)];
+    paulis.push_back(pauli);
+  }
+
+  for (size_t nrThreads : {1, 4}) {
+    const auto vals = environments.ExpectationValues(paulis, nrThreads);
+    BOOST_TEST(vals.size() == paulis.size());
+
+    for (size_t t = 0; t < paulis.size(); ++t) {
+      Eigen::VectorXcd phi = psi;
+      for (size_t q = 0; q < paulis[t].size(); ++q) {
+        const size_t mask = 1ULL << q;
+        for (size_t i = 0; i < dim; ++i) {
+          if (i & mask) continue;
+          const std::complex<double> a0 = phi[i];
+          const std::complex<double> a1 = phi[i | mask];
+          if (paulis[t][q] == 'X') {
+            phi[i] = a1;
+            phi[i | mask] = a0;
+          } else if (paulis[t][q] == 'Y') {
+            phi[i] = std::complex<double>(0, -1) * a1;
+            phi[i | mask] = std::complex<double>(0, 1) * a0;
+          } else if (paulis[t][q] == 'Z')
+            phi[i | mask] = -a1;
+        }
+      }
+
+      BOOST_CHECK_SMALL(vals[t] - psi.dot(phi).real(), 1e-10);
+    }
+  }
+
+  // dimensions not matching a chain of qubits are rejected
+  lambdas.pop_back();
+  BOOST_TEST(!environments.Load(gammas, lambdas));
+}
+
+BOOST_AUTO_TEST_CASE(MPSLayerUpdateTest) {
+  const int nrQubits = 8;
+  const size_t dim = 1ULL << nrQubits;
+
+  std::mt19937 g(42);
+  std::normal_distribution<double> nd;
+  std::bernoulli_distribution swapDist;
+
+  // Vidal's form of |0...0>, qubit i on the position i in the chain
+  std::vector<Eigen::Tensor<std::complex<double>, 3>> gammas(
+      nrQubits, Eigen::Tensor<std::complex<double>, 3>(1, 2, 1));
+  for (auto &gamma : gammas) {
+    gamma.setZero();
+    gamma(0, 0, 0) = 1.;
+  }
+  std::vector<Eigen::VectorXd> lambdas(nrQubits - 1, Eigen::VectorXd::Ones(1));
+
+  Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(dim);
+  psi[0] = 1.;
+
+  for (int layer = 0; layer < 10; ++layer) {
+    std::vector<Simulators::MPSLayerUpdate::BondGate> gates;
+    for (int pos = layer % 2; pos + 1 < nrQubits; pos += 2) {
+      Eigen::Matrix4cd m;
+      for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+          m(i, j) = std::complex<double>(nd(g), nd(g));
+      const Eigen::Matrix4cd gate =
+          Eigen::HouseholderQR<Eigen::Matrix4cd>(m).householderQ();
+
+      Simulators::MPSLayerUpdate::BondGate bondGate;
+      bondGate.matrix = gate;
+      bondGate.position = pos;
+      bondGate.swapped = swapDist(g);
+      gates.push_back(bondGate);
+
+      // the least significant qubit of the gate matrix
+      const size_t lowMask = 1ULL << (bondGate.swapped ? pos + 1 : pos);
+      const size_t highMask = 1ULL << (bondGate.swapped ? pos : pos + 1);
+      for (size_t i = 0; i < dim; ++i) {
+        if (i & (lowMask | highMask)) continue;
+        const size_t indices[] = {i, i | lowMask, i | highMask,
+                                  i | lowMask | highMask};
+        Eigen::Vector4cd v;
+        for (int k = 0; k < 4; ++k) v[k] = psi[indices[k]];
+        v = gate * v;
+        for (int k = 0; k < 4; ++k) psi[indices[k]] = v[k];
+      }
+    }
+
+    Simulators::MPSLayerUpdate::Apply(gammas, lambdas, gates, 0, 0.,
+                                      layer % 2 ? 4 : 1);
+  }
+
+  // the lambdas stay the normalized Schmidt values of the bonds
+  for (const auto &lambda : lambdas)
+    BOOST_CHECK_SMALL(lambda.squaredNorm() - 1., 1e-10);
+
+  for (size_t i = 0; i < dim; ++i) {
+    Eigen::RowVectorXcd v = Eigen::RowVectorXcd::Ones(1);
+    for (int pos = 0; pos < nrQubits; ++pos) {
+      const auto &gamma = gammas[pos];
+      const int s = (i >> pos) & 1;
+      Eigen::MatrixXcd site(gamma.dimension(0), gamma.dimension(2));
+      for (Eigen::Index l = 0; l < site.rows(); ++l)
+        for (Eigen::Index r = 0; r < site.cols(); ++r)
+          site(l, r) =
+              gamma(l, s, r) * (pos < nrQubits - 1 ? lambdas[pos][r] : 1.);
+      v = v * site;
+    }
+    BOOST_CHECK_SMALL(std::abs(v(0) - psi[i]), 1e-10);
+  }
+
+  // the bond dimension is capped
+  Simulators::MPSLayerUpdate::Apply(
+      gammas, lambdas,
+      {Simulators::MPSLayerUpdate::BondGate{Eigen::Matrix4cd::Identity(), 3,
+                                            false}},
+      2, 0., 1);
+  BOOST_TEST(lambdas[3].size() == 2);
+  BOOST_CHECK_SMALL(lambdas[3].squaredNorm() - 1., 1e-10);
+
+  // the gates of a layer cannot share a site
+  BOOST_CHECK_THROW(
+      Simulators::MPSLayerUpdate::Apply(
+          gammas, lambdas,
+          {Simulators::MPSLayerUpdate::BondGate{Eigen::Matrix4cd::Identity(),
+                                                1, false},
+           Simulators::MPSLayerUpdate::BondGate{Eigen::Matrix4cd::Identity(),
+                                                2, false}},
+          0, 0., 2),
+      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(LayeredCircuitTest) {
+  // large enough for the bonds in the middle of the chain to pass the bond
+  // dimension from which the layers are applied in parallel
+  const size_t nrQubits = 12;
+
+  auto mps = Simulators::SimulatorsFactory::CreateSimulator(
+      Simulators::SimulatorType::kQCSim,
+      Simulators::SimulationType::kMatrixProductState);
+  mps->AllocateQubits(nrQubits);
+  mps->Initialize();
+
+  auto sv = Simulators::SimulatorsFactory::CreateSimulator(
+      Simulators::SimulatorType::kQCSim,
+      Simulators::SimulationType::kStatevector);
+  sv->AllocateQubits(nrQubits);
+  sv->Initialize();
+
+  std::mt19937 g(7);
+  std::uniform_real_distribution<double> angleDist(-M_PI, M_PI);
+  const Circuits::QuantumGateType twoQubitsGates[] = {
+      Circuits::QuantumGateType::kCXGateType,
+      Circuits::QuantumGateType::kCRyGateType,
+      Circuits::QuantumGateType::kCUGateType,
+      Circuits::QuantumGateType::kSwapGateType};
+
+  auto circ = std::make_shared<Circuits::Circuit<>>();
+  for (size_t layer = 0; layer < 12; ++layer) {
+    for (size_t q = 0; q < nrQubits; ++q)
+      circ->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+          Circuits::QuantumGateType::kUGateType, q, 0, 0, angleDist(g),
+          angleDist(g), angleDist(g)));
+
+    // the layers alternate the bonds, both ways of the gates, and a gate on
+    // qubits that are not neighbours once in a while
+    for (size_t q = layer % 2; q + 1 < nrQubits; q += 2) {
+      const auto type = twoQubitsGates[(q / 2 + layer) % 4];
+      const bool reversed = (q / 2 + layer) % 3 == 0;
+      circ->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+          type, reversed ? q + 1 : q, reversed ? q : q + 1, 0, angleDist(g),
+          angleDist(g), angleDist(g), angleDist(g)));
+    }
+    if (layer % 4 == 3)
+      circ->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+          Circuits::QuantumGateType::kCXGateType, 0, nrQubits - 1));
+  }
+
+  Circuits::OperationState state;
+  size_t maxBondDim = 0;
+  circ->ExecuteBD(mps, state, &maxBondDim);
+  circ->Execute(sv, state);
+
+  BOOST_TEST(maxBondDim >= 32);
+  BOOST_TEST(maxBondDim == mps->GetCurrentMaxBondDimension());
+
+  for (Types::qubit_t outcome = 0; outcome < (1ULL << nrQubits); ++outcome)
+    BOOST_CHECK_SMALL(std::abs(mps->Amplitude(outcome) - sv->Amplitude(outcome)),
+                      1e-8);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
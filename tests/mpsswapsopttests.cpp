@@ -28,6 +28,8 @@ namespace bdata = boost::unit_test::data;
 #include "../Circuit/Circuit.h"
 #include "../Circuit/Factory.h"
 #include "../Simulators/MPSDummySimulator.h"
+#include "../Simulators/MPSFidelityBudget.h"
+#include "../Simulators/MPSLayoutCache.h"
 #include "../Simulators/Factory.h"
 #include "../Network/SimpleDisconnectedNetwork.h"
 
@@ -1037,4 +1039,293 @@ BOOST_DATA_TEST_CASE(NetworkOptimizedSwapsVsUnoptimizedOnHost,
   BOOST_CHECK_LT(totalVariation, 0.5);
 }
 
+BOOST_AUTO_TEST_CASE(FidelityBudgetTruncationThreshold) {
+  // adjacent gates need one bond update each, a gate between qubits 0 and 3
+  // needs two swaps to bring them together, then the gate itself
+  Simulators::MPSDummySimulator dummySim(4);
+
+  dummySim.ApplyGate(Circuits::CircuitFactory<>::CreateGate(
+      Circuits::QuantumGateType::kCXGateType, 0, 1));
+  dummySim.ApplyGate(Circuits::CircuitFactory<>::CreateGate(
+      Circuits::QuantumGateType::kHadamardGateType, 2));
+  BOOST_CHECK_EQUAL(dummySim.getNrBondUpdates(), 1);
+
+  dummySim.ApplyGate(Circuits::CircuitFactory<>::CreateGate(
+      Circuits::QuantumGateType::kCXGateType, 0, 3));
+  BOOST_CHECK_EQUAL(dummySim.getNrBondUpdates(), 4);
+
+  const size_t nrUpdates = dummySim.getNrBondUpdates();
+  const double targetFidelity = 0.99;
+
+  // 4 qubits: no bond has more than 4 singular values, with a cap of 1 on
+  // the bond dimension an update has at most 2
+  BOOST_CHECK_EQUAL(
+      Simulators::MPSFidelityBudget::GetMaxNrSingularValues(4, 0), 4);
+  BOOST_CHECK_EQUAL(
+      Simulators::MPSFidelityBudget::GetMaxNrSingularValues(4, 1), 2);
+  BOOST_CHECK_EQUAL(
+      Simulators::MPSFidelityBudget::GetMaxNrSingularValues(40, 16), 32);
+
+  // the singular values cutoff, with the largest number of dropped singular
+  // values in each update, gives exactly the target
+  const double cutoff =
+      Simulators::MPSFidelityBudget::ComputeSingularValueCutoff(
+          targetFidelity, nrUpdates, 4);
+  BOOST_CHECK_GT(cutoff, 0.);
+  BOOST_CHECK_CLOSE(std::pow(1. - 3. * cutoff * cutoff,
+                             static_cast<double>(nrUpdates)),
+                    targetFidelity, 1e-8);
+  BOOST_CHECK_CLOSE(Simulators::MPSFidelityBudget::ComputeFidelityLowerBound(
+                        cutoff, nrUpdates, 4),
+                    targetFidelity, 1e-8);
+  BOOST_CHECK_GT(Simulators::MPSFidelityBudget::ComputeFidelityLowerBound(
+                     cutoff, nrUpdates, 2),
+                 targetFidelity);
+
+  BOOST_CHECK_EQUAL(
+      Simulators::MPSFidelityBudget::ComputeSingularValueCutoff(1., nrUpdates,
+                                                                4),
+      0.);
+  BOOST_CHECK_EQUAL(Simulators::MPSFidelityBudget::ComputeSingularValueCutoff(
+                        targetFidelity, 0, 4),
+                    0.);
+
+  std::vector<std::shared_ptr<Circuits::IOperation<>>> ops{
+      Circuits::CircuitFactory<>::CreateGate(
+          Circuits::QuantumGateType::kCXGateType, 0, 1),
+      Circuits::CircuitFactory<>::CreateGate(
+          Circuits::QuantumGateType::kCXGateType, 0, 3)};
+
+  const auto budget = Simulators::MPSFidelityBudget::Compute(
+      targetFidelity, ops, 4, 0, 0.);
+  BOOST_CHECK(budget.IsEnabled());
+  BOOST_CHECK_EQUAL(budget.GetNrBondUpdates(), nrUpdates);
+  BOOST_CHECK_CLOSE(budget.GetCutoff(), cutoff, 1e-8);
+
+  // the bound improves if the bond dimension stayed low, there is none if the
+  // cap was hit
+  BOOST_REQUIRE(budget.GetFidelityLowerBound(2));
+  BOOST_REQUIRE(budget.GetFidelityLowerBound(1));
+  BOOST_CHECK_GE(*budget.GetFidelityLowerBound(2), targetFidelity - 1e-12);
+  BOOST_CHECK_GT(*budget.GetFidelityLowerBound(1),
+                 *budget.GetFidelityLowerBound(2));
+  const auto cappedBudget = Simulators::MPSFidelityBudget::Compute(
+      targetFidelity, ops, 4, 2, 0.);
+  BOOST_CHECK(!cappedBudget.GetFidelityLowerBound(2));
+  BOOST_REQUIRE(cappedBudget.GetFidelityLowerBound(1));
+  BOOST_CHECK_GT(*cappedBudget.GetFidelityLowerBound(1), targetFidelity);
+
+  // a smaller cutoff set by the user is kept, a larger one is not
+  const auto userBudget = Simulators::MPSFidelityBudget::Compute(
+      targetFidelity, ops, 4, 0, cutoff / 2);
+  BOOST_CHECK_EQUAL(userBudget.GetCutoff(), cutoff / 2);
+  const auto largeUserBudget = Simulators::MPSFidelityBudget::Compute(
+      targetFidelity, ops, 4, 0, cutoff * 2);
+  BOOST_CHECK_CLOSE(largeUserBudget.GetCutoff(), cutoff, 1e-8);
+
+  BOOST_CHECK(!Simulators::MPSFidelityBudget::Compute(1., ops, 4, 0, 0.)
+                   .IsEnabled());
+
+  dummySim.Clear();
+  BOOST_CHECK_EQUAL(dummySim.getNrBondUpdates(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(CachedPortfolioQubitsMap) {
+  // a chain of interactions between shuffled qubits, the identity layout is
+  // bad, but there is a layout without any swap
+  constexpr int nrQubits = 16;
+
+  std::vector<size_t> chain(nrQubits);
+  std::iota(chain.begin(), chain.end(), 0);
+  std::shuffle(chain.begin(), chain.end(), std::mt19937(7));
+
+  auto circ = std::make_shared<Circuits::Circuit<>>();
+  for (int rep = 0; rep < 4; ++rep)
+    for (int i = 0; i < nrQubits - 1; ++i)
+      circ->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+          Circuits::QuantumGateType::kCXGateType, chain[i], chain[i + 1]));
+
+  const auto layers = circ->ToMultipleQubitsLayers();
+
+  Simulators::MPSDummySimulator dummySim(nrQubits);
+  dummySim.SetMaxBondDimension(64);
+
+  auto &cache = Simulators::MPSLayoutCache::GetInstance();
+  cache.Clear();
+
+  const auto optimalMap = cache.GetOptimalQubitsMap(dummySim, layers);
+  BOOST_CHECK_EQUAL(cache.GetSize(), 1);
+
+  auto sortedMap = optimalMap;
+  std::sort(sortedMap.begin(), sortedMap.end());
+  for (int q = 0; q < nrQubits; ++q) BOOST_CHECK_EQUAL(sortedMap[q], q);
+
+  std::vector<long long int> identityMap(nrQubits);
+  std::iota(identityMap.begin(), identityMap.end(), 0);
+  BOOST_CHECK_LE(dummySim.EvaluateQubitsMapCost(layers, optimalMap),
+                 dummySim.EvaluateQubitsMapCost(layers, identityMap));
+
+  // the same circuit hits the cache
+  const auto cachedMap = cache.GetOptimalQubitsMap(dummySim, layers);
+  BOOST_CHECK(cachedMap == optimalMap);
+  BOOST_CHECK_EQUAL(cache.GetSize(), 1);
+
+  // a different cost model does not
+  Simulators::MPSDummySimulator otherDummySim(nrQubits);
+  otherDummySim.SetMaxBondDimension(16);
+  cache.GetOptimalQubitsMap(otherDummySim, layers);
+  BOOST_CHECK_EQUAL(cache.GetSize(), 2);
+
+  // the search is limited by the work done, not by time, so it's
+  // reproducible
+  BOOST_CHECK(dummySim.ComputeOptimalQubitsMap(layers) ==
+              dummySim.ComputeOptimalQubitsMap(layers));
+
+  // a circuit with another structure is a different entry
+  auto otherCirc = std::make_shared<Circuits::Circuit<>>();
+  for (int i = 0; i < nrQubits - 1; ++i)
+    otherCirc->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+        Circuits::QuantumGateType::kCXGateType, i, i + 1));
+  const auto otherLayers = otherCirc->ToMultipleQubitsLayers();
+  BOOST_CHECK(Simulators::MPSLayoutCache::GetLayersStructure(otherLayers) !=
+              Simulators::MPSLayoutCache::GetLayersStructure(layers));
+  cache.GetOptimalQubitsMap(dummySim, otherLayers);
+  BOOST_CHECK_EQUAL(cache.GetSize(), 3);
+
+  // an exhausted work budget still returns a valid map, not worse than the
+  // seeds
+  const auto quickMap = dummySim.ComputeOptimalQubitsMap(layers, 0, 0, 0);
+  BOOST_CHECK_LE(dummySim.EvaluateQubitsMapCost(layers, quickMap),
+                 dummySim.EvaluateQubitsMapCost(layers, identityMap));
+
+  cache.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(LayoutCacheEvictsLeastRecentlyUsed) {
+  constexpr int nrQubits = 4;
+
+  auto circ = std::make_shared<Circuits::Circuit<>>();
+  for (int i = 0; i < nrQubits - 1; ++i)
+    circ->AddOperation(Circuits::CircuitFactory<>::CreateGate(
+        Circuits::QuantumGateType::kCXGateType, i, i + 1));
+  const auto layers = circ->ToMultipleQubitsLayers();
+
+  auto &cache = Simulators::MPSLayoutCache::GetInstance();
+  cache.Clear();
+
+  // the cost models differ by the max bond dimension, so each one is an entry
+  std::vector<std::unique_ptr<Simulators::MPSDummySimulator>> dummySims;
+  for (size_t i = 0; i <= Simulators::MPSLayoutCache::kMaxEntries; ++i) {
+    dummySims.emplace_back(
+        std::make_unique<Simulators::MPSDummySimulator>(nrQubits));
+    dummySims.back()->SetMaxBondDimension(static_cast<int>(i) + 2);
+  }
+
+  for (size_t i = 0; i < Simulators::MPSLayoutCache::kMaxEntries; ++i)
+    cache.GetOptimalQubitsMap(*dummySims[i], layers);
+  BOOST_CHECK_EQUAL(cache.GetSize(), Simulators::MPSLayoutCache::kMaxEntries);
+
+  // using the oldest entry keeps it, the next oldest one is evicted instead
+  cache.GetOptimalQubitsMap(*dummySims[0], layers);
+  cache.GetOptimalQubitsMap(*dummySims.back(), layers);
+  BOOST_CHECK_EQUAL(cache.GetSize(), Simulators::MPSLayoutCache::kMaxEntries);
+  BOOST_CHECK(cache.IsCached(*dummySims[0], layers));
+  BOOST_CHECK(!cache.IsCached(*dummySims[1], layers));
+  BOOST_CHECK(cache.IsCached(*dummySims[2], layers));
+  BOOST_CHECK(cache.IsCached(*dummySims.back(), layers));
+
+  cache.Clear();
+  BOOST_CHECK_EQUAL(cache.GetSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalLookaheadMatchesExhaustiveSearch) {
+  constexpr int nrQubits = 12;
+
+  std::mt19937 g(11);
+  std::uniform_int_distribution<int> qubitDist(0, nrQubits - 1);
+
+  std::vector<std::shared_ptr<Circuits::IOperation<>>> ops;
+  for (int i = 0; i < 120; ++i) {
+    const int q1 = qubitDist(g);
+    int q2 = qubitDist(g);
+    while (q2 == q1) q2 = qubitDist(g);
+    ops.push_back(Circuits::CircuitFactory<>::CreateGate(
+        Circuits::QuantumGateType::kCXGateType, q1, q2));
+  }
+
+  Simulators::MPSDummySimulator dummySim(nrQubits);
+  dummySim.SetMaxBondDimension(32);
+
+  for (size_t i = 0; i + 1 < ops.size(); ++i) {
+    const auto qbits = ops[i]->AffectedQubits();
+    const auto map = dummySim.getQubitsMap();
+    const auto bondDims = dummySim.getCurrentBondDimensions();
+    const double cost = dummySim.getTotalSwappingCost();
+
+    long long int realq1 = map[qbits[0]];
+    long long int realq2 = map[qbits[1]];
+    if (realq1 > realq2) std::swap(realq1, realq2);
+
+    // one level of lookahead, the next gate at the heuristic position
+    double bestCost = std::numeric_limits<double>::infinity();
+    const auto meetPos =
+        dummySim.FindBestMeetingPosition(ops, i, 1, 0, 0., bestCost);
+
+    // the search must leave the simulator as it was
+    BOOST_CHECK(dummySim.getQubitsMap() == map);
+    BOOST_CHECK(dummySim.getCurrentBondDimensions() == bondDims);
+    BOOST_CHECK_EQUAL(dummySim.getTotalSwappingCost(), cost);
+
+    double exhaustiveCost = std::numeric_limits<double>::infinity();
+    const long long int lastPos = realq2 - realq1 > 1 ? realq2 - 1 : realq1;
+    for (long long int m = realq1; m <= lastPos; ++m) {
+      auto sim = dummySim.Clone();
+      sim->setTotalSwappingCost(0);
+      sim->SwapQubitsToPosition(qbits[0], qbits[1], m);
+      sim->ApplyGate(ops[i]);
+      sim->ApplyGate(ops[i + 1]);
+      exhaustiveCost = std::min(exhaustiveCost, sim->getTotalSwappingCost());
+    }
+
+    BOOST_CHECK_CLOSE(bestCost, exhaustiveCost, 1e-9);
+
+    dummySim.SwapQubitsToPosition(qbits[0], qbits[1], meetPos);
+    dummySim.ApplyGate(ops[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LookaheadDepthAutoTune) {
+  Simulators::MPSDummySimulator dummySim(8);
+
+  // disabled, the configured depth is used as is
+  BOOST_CHECK_EQUAL(dummySim.GetTunedLookaheadDepth(6), 6);
+
+  dummySim.SetLookaheadAutoTune(true);
+  BOOST_CHECK_EQUAL(dummySim.GetTunedLookaheadDepth(6), 6);
+
+  auto decide = [&dummySim](std::chrono::steady_clock::time_point& now,
+                            std::chrono::microseconds simulation,
+                            std::chrono::microseconds routing) {
+    now += simulation;
+    const auto start = now;
+    now += routing;
+    dummySim.RecordLookaheadDecision(start, now);
+  };
+
+  std::chrono::steady_clock::time_point now{std::chrono::seconds(1)};
+
+  // the routing takes most of the time, the depth goes down
+  for (int i = 0; i < 100; ++i)
+    decide(now, std::chrono::microseconds(100), std::chrono::microseconds(900));
+  const int loweredDepth = dummySim.GetTunedLookaheadDepth(6);
+  BOOST_CHECK_LT(loweredDepth, 6);
+
+  // the routing is cheap again, the depth goes back up, but not above the
+  // configured one
+  for (int i = 0; i < 1000; ++i)
+    decide(now, std::chrono::microseconds(1000), std::chrono::microseconds(1));
+  BOOST_CHECK_EQUAL(dummySim.GetTunedLookaheadDepth(6), 6);
+  BOOST_CHECK_EQUAL(dummySim.GetTunedLookaheadDepth(4), 4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
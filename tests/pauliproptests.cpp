@@ -26,6 +26,7 @@ namespace bdata = boost::unit_test::data;
 #include "../Simulators/Factory.h"
 #include "../Circuit/Factory.h"
 #include "../Simulators/QcsimPauliPropagator.h"
+#include "../Simulators/PauliSum.h"
 
 struct Operation {
   int gate = 0;  // gate id, first codes for clifford gates, then for
@@ -1079,4 +1080,228 @@ BOOST_DATA_TEST_CASE_F(PauliSimTestFixture, RandomNonCliffordCircuitsTest,
 #endif
 }
 
+BOOST_DATA_TEST_CASE_F(PauliSimTestFixture, RandomCircuitsExpectationValuesTest,
+                       bdata::xrange(1, 20), nrGates) {
+  auto circuit = GenerateCircuit(nrQubitsForRandomCirc, nrGates, 29);
+
+  for (const auto& op : circuit) {
+    ExecuteGate(op, statevectorSim);
+    ExecuteGate(op, qcsimPauliSim);
+    ExecuteGate(op, qcsimPauliStdSim);
+  }
+
+  // all the strings propagated together, some of them repeated
+  const int nrStrings = 100;
+  std::vector<std::string> pauliStrings;
+  for (int i = 0; i < nrStrings; ++i)
+    pauliStrings.push_back(GeneratePauliString(nrQubitsForRandomCirc));
+  pauliStrings.push_back(pauliStrings.front());
+  pauliStrings.push_back(std::string(nrQubitsForRandomCirc, 'I'));
+
+  const auto expValsPauliSim = qcsimPauliSim.ExpectationValues(pauliStrings);
+  const auto expValsPauliStdSim =
+      qcsimPauliStdSim->ExpectationValues(pauliStrings);
+  BOOST_TEST(expValsPauliSim.size() == pauliStrings.size());
+  BOOST_TEST(expValsPauliStdSim.size() == pauliStrings.size());
+
+  for (size_t i = 0; i < pauliStrings.size(); ++i) {
+    const double expValStateVec =
+        statevectorSim->ExpectationValue(pauliStrings[i]);
+    BOOST_TEST(std::abs(expValStateVec - expValsPauliSim[i]) < 1e-7,
+               "Expectation value mismatch for pauli string "
+                   << pauliStrings[i] << ": statevector " << expValStateVec
+                   << ", pauli sim " << expValsPauliSim[i]);
+    BOOST_TEST(std::abs(expValStateVec - expValsPauliStdSim[i]) < 1e-7,
+               "Expectation value mismatch for pauli string "
+                   << pauliStrings[i] << ": statevector " << expValStateVec
+                   << ", pauli std sim " << expValsPauliStdSim[i]);
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(PauliSimTestFixture, RandomCircuitsTruncationErrorsTest,
+                       bdata::xrange(1, 20), nrGates) {
+  auto circuit = GenerateCircuit(nrQubitsForRandomCirc, nrGates, 29);
+
+  // the coefficient threshold with a budget on one, the weight and the path
+  // frequency thresholds on the other
+  const double budget = 0.05;
+  qcsimPauliSim.SetCoefficientThreshold(0.02);
+  qcsimPauliSim.SetTruncationErrorBudget(budget);
+  qcsimPauliSim.SetStepsBetweenTrims(1);
+  qcsimPauliStdSim->Configure("pauli_propagator_pauli_weight_threshold", "3");
+  qcsimPauliStdSim->Configure("pauli_propagator_max_path_frequency", "2");
+  qcsimPauliStdSim->Configure("pauli_propagator_steps_between_trims", "2");
+
+  for (const auto& op : circuit) {
+    ExecuteGate(op, statevectorSim);
+    ExecuteGate(op, qcsimPauliSim);
+    ExecuteGate(op, qcsimPauliStdSim);
+  }
+
+  const int nrStrings = 50;
+  std::vector<std::string> pauliStrings;
+  for (int i = 0; i < nrStrings; ++i)
+    pauliStrings.push_back(GeneratePauliString(nrQubitsForRandomCirc));
+
+  const auto expValsPauliSim = qcsimPauliSim.ExpectationValues(pauliStrings);
+  const auto errorsPauliSim = qcsimPauliSim.GetTruncationErrors();
+  const auto expValsPauliStdSim =
+      qcsimPauliStdSim->ExpectationValues(pauliStrings);
+  const auto errorsPauliStdSim = qcsimPauliStdSim->GetTruncationErrors();
+  BOOST_TEST(errorsPauliSim.size() == pauliStrings.size());
+  BOOST_TEST(errorsPauliStdSim.size() == pauliStrings.size());
+
+  // the error bounds hold, up to the rounding errors
+  for (size_t i = 0; i < pauliStrings.size(); ++i) {
+    const double expValStateVec =
+        statevectorSim->ExpectationValue(pauliStrings[i]);
+    BOOST_TEST(errorsPauliSim[i] <= budget + 1e-12);
+    BOOST_TEST(std::abs(expValStateVec - expValsPauliSim[i]) <=
+                   errorsPauliSim[i] + 1e-10,
+               "Truncation error above the bound for pauli string "
+                   << pauliStrings[i] << ": error "
+                   << std::abs(expValStateVec - expValsPauliSim[i])
+                   << ", bound " << errorsPauliSim[i]);
+    BOOST_TEST(std::abs(expValStateVec - expValsPauliStdSim[i]) <=
+                   errorsPauliStdSim[i] + 1e-10,
+               "Truncation error above the bound for pauli string "
+                   << pauliStrings[i] << ": error "
+                   << std::abs(expValStateVec - expValsPauliStdSim[i])
+                   << ", bound " << errorsPauliStdSim[i]);
+  }
+
+  // a single string is truncated the same, with its bound
+  const double expValPauliStdSim =
+      qcsimPauliStdSim->ExpectationValue(pauliStrings[0]);
+  const auto errorPauliStdSim = qcsimPauliStdSim->GetTruncationErrors();
+  BOOST_CHECK_PREDICATE(checkClose,
+                        (expValPauliStdSim)(expValsPauliStdSim[0])(1e-12));
+  BOOST_TEST(errorPauliStdSim.size() == 1);
+  if (errorPauliStdSim.size() == 1)
+    BOOST_CHECK_PREDICATE(checkClose,
+                          (errorPauliStdSim[0])(errorsPauliStdSim[0])(1e-12));
+}
+
+BOOST_DATA_TEST_CASE_F(PauliSimTestFixture, RandomCircuitsSampleCountsTest,
+                       bdata::xrange(1, 20), nrGates) {
+  auto circuit = GenerateCircuit(nrQubitsForRandomCirc, nrGates, 29);
+
+  for (const auto& op : circuit) {
+    ExecuteGate(op, statevectorSim);
+    ExecuteGate(op, qcsimPauliSim);
+    ExecuteGate(op, qcsimPauliStdSim);
+  }
+
+  const auto probs = statevectorSim->AllProbabilities();
+
+  // sampled in a shuffled order, all shots at once
+  const size_t nrSamples = 20000;
+  std::vector<int> pq(nrQubitsForRandomCirc);
+  std::iota(pq.begin(), pq.end(), 0);
+  std::random_device rd;
+  std::mt19937 g(rd());
+  std::shuffle(pq.begin(), pq.end(), g);
+
+  const auto counts = qcsimPauliSim.SampleCounts(pq, nrSamples);
+  std::vector<double> psProbs(probs.size(), 0.);
+  size_t totalCount = 0;
+  for (const auto& [res, count] : counts) {
+    BOOST_TEST(res.size() == pq.size());
+    Types::qubit_t outcome = 0;
+    for (size_t q = 0; q < pq.size(); ++q)
+      if (res[q]) outcome |= (1ULL << pq[q]);
+    psProbs[outcome] += static_cast<double>(count) / nrSamples;
+    totalCount += count;
+  }
+  BOOST_TEST(totalCount == nrSamples);
+
+  Types::qubits_vector qubitsToMeasure(nrQubitsForRandomCirc);
+  std::iota(qubitsToMeasure.begin(), qubitsToMeasure.end(), 0);
+  auto stdRes = qcsimPauliStdSim->SampleCounts(qubitsToMeasure, nrSamples);
+
+  for (Types::qubit_t outcome = 0; outcome < probs.size(); ++outcome) {
+    const double stdProb =
+        stdRes.find(outcome) != stdRes.end()
+            ? static_cast<double>(stdRes[outcome]) / nrSamples
+            : 0.;
+    BOOST_TEST(std::abs(probs[outcome] - psProbs[outcome]) < 0.03,
+               "Sampling probability mismatch for outcome "
+                   << outcome << ": statevector " << probs[outcome]
+                   << ", pauli sim " << psProbs[outcome]);
+    BOOST_TEST(std::abs(probs[outcome] - stdProb) < 0.03,
+               "Sampling probability mismatch for outcome "
+                   << outcome << ": statevector " << probs[outcome]
+                   << ", pauli std sim " << stdProb);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PauliSumTest) {
+  // more than one word of bits, the two qubit gates cross the words
+  const size_t nrQubits = 70;
+  Simulators::PauliSum sum(nrQubits);
+
+  std::string pauliString(nrQubits, 'I');
+  pauliString[3] = 'X';
+  sum.AddTerm(pauliString, 1.);
+  pauliString[3] = 'I';
+  pauliString[67] = 'Z';
+  sum.AddTerm(pauliString, 0.5, 1);
+
+  // X3 -> X3 X67, Z67 -> Z3 Z67
+  sum.ApplyCX(3, 67);
+  BOOST_TEST(sum.size() == 2);
+  BOOST_TEST(sum.GetOperator(0, 3) == 'X');
+  BOOST_TEST(sum.GetOperator(0, 67) == 'X');
+  BOOST_TEST(sum.GetOperator(1, 3) == 'Z');
+  BOOST_TEST(sum.GetOperator(1, 67) == 'Z');
+  BOOST_TEST(sum.GetWeight(0) == 2);
+  BOOST_TEST(!sum.IsDiagonal(0));
+  BOOST_TEST(sum.IsDiagonal(1));
+
+  // the rotation branches the first term only, the opposite rotation brings
+  // it back after merging, the other branch cancels out
+  const double angle = 0.3;
+  BOOST_TEST(sum.ApplyRotation(67, 'Z', angle));
+  BOOST_TEST(sum.size() == 3);
+  BOOST_TEST(sum.ApplyRotation(67, 'Z', -angle));
+  BOOST_TEST(sum.size() == 5);
+
+  sum.Merge();
+  BOOST_TEST(sum.size() == 2);
+  BOOST_TEST(std::abs(sum.GetCoefficient(0) - 1.) < 1e-12);
+  BOOST_TEST(sum.GetOperator(0, 67) == 'X');
+  BOOST_TEST(std::abs(sum.GetCoefficient(1) - 0.5) < 1e-12);
+  BOOST_TEST(sum.GetTag(1) == 1);
+
+  // the same string with a different tag is not merged
+  pauliString[3] = 'Z';
+  sum.AddTerm(pauliString, 0.25, 0);
+  sum.Merge();
+  BOOST_TEST(sum.size() == 3);
+
+  sum.RemoveIf([&sum](size_t t) { return sum.GetTag(t) == 1; });
+  BOOST_TEST(sum.size() == 2);
+  BOOST_TEST(std::abs(sum.GetCoefficient(1) - 0.25) < 1e-12);
+
+  // the same with the operations in parallel from the first term
+  Simulators::PauliSum parallelSum(nrQubits);
+  parallelSum.SetParallelThreshold(1);
+  BOOST_TEST(parallelSum.GetParallelThreshold() == 1);
+  pauliString.assign(nrQubits, 'I');
+  pauliString[3] = 'X';
+  parallelSum.AddTerm(pauliString, 1.);
+  pauliString[3] = 'I';
+  pauliString[67] = 'Z';
+  parallelSum.AddTerm(pauliString, 0.5, 1);
+  parallelSum.ApplyCX(3, 67);
+  BOOST_TEST(parallelSum.ApplyRotation(67, 'Z', angle));
+  BOOST_TEST(parallelSum.ApplyRotation(67, 'Z', -angle));
+  parallelSum.Merge();
+  BOOST_TEST(parallelSum.size() == 2);
+  double total = 0.;
+  for (size_t t = 0; t < parallelSum.size(); ++t)
+    total += parallelSum.GetCoefficient(t);
+  BOOST_TEST(std::abs(total - 1.5) < 1e-12);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
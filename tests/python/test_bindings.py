@@ -970,6 +970,20 @@ class TestPauliPropagatorSimulation:
         assert exp_vals[1] == pytest.approx(0.7071, abs=1e-3)
 
 
+def _estimate_pauli_propagator_xx(**knobs):
+    """<XX> for GENERAL_NO_MEASURE_QASM on the Pauli Propagator backend."""
+    config = maestro.SimulatorConfig(
+        simulator_type=maestro.SimulatorType.QCSim,
+        simulation_type=maestro.SimulationType.PauliPropagator,
+    )
+    # Maestro binds these as properties, not constructor arguments.
+    for name, value in knobs.items():
+        setattr(config, name, value)
+    return maestro.simple_estimate(
+        GENERAL_NO_MEASURE_QASM, "XX", config=config
+    )
+
+
 class TestPauliPropagatorTruncation:
     """Truncation knobs on the Pauli Propagator backend.
 
@@ -981,16 +995,7 @@ class TestPauliPropagatorTruncation:
 
     @staticmethod
     def _estimate_xx(**knobs):
-        config = maestro.SimulatorConfig(
-            simulator_type=maestro.SimulatorType.QCSim,
-            simulation_type=maestro.SimulationType.PauliPropagator,
-        )
-        # Maestro binds these as properties, not constructor arguments.
-        for name, value in knobs.items():
-            setattr(config, name, value)
-        result = maestro.simple_estimate(
-            GENERAL_NO_MEASURE_QASM, "XX", config=config
-        )
+        result = _estimate_pauli_propagator_xx(**knobs)
         return result['expectation_values'][0]
 
     def test_no_truncation_baseline(self):
@@ -1044,6 +1049,59 @@ class TestPauliPropagatorTruncation:
         ) == pytest.approx(self.UNTRUNCATED, abs=1e-9)
 
 
+class TestPauliPropagatorTruncationErrors:
+    """Truncation error bounds and the strategies they make safe.
+
+    Propagated backwards, XX for GENERAL_NO_MEASURE_QASM becomes X on qubit
+    0, which the T gate branches in X and Y with coefficients 1/sqrt(2).
+    """
+
+    UNTRUNCATED = TestPauliPropagatorTruncation.UNTRUNCATED
+
+    @staticmethod
+    def _estimate_xx(**knobs):
+        result = _estimate_pauli_propagator_xx(**knobs)
+        return result['expectation_values'][0], result['truncation_errors'][0]
+
+    def test_no_truncation_has_zero_error(self):
+        value, error = self._estimate_xx()
+        assert value == pytest.approx(self.UNTRUNCATED, abs=1e-9)
+        assert error == 0.0
+
+    def test_coefficient_threshold_error_bounds_the_result(self):
+        """Both branches are dropped, the bound is their coefficients sum."""
+        value, error = self._estimate_xx(
+            pp_coefficient_threshold=0.99, pp_steps_between_trims=1
+        )
+        assert value == pytest.approx(0.0, abs=1e-9)
+        assert error == pytest.approx(2 * self.UNTRUNCATED, abs=1e-9)
+        assert abs(value - self.UNTRUNCATED) <= error + 1e-9
+
+    def test_path_frequency_drops_the_sine_branch(self):
+        """The Y branch has no expectation value, only the bound grows."""
+        value, error = self._estimate_xx(
+            pp_max_path_frequency=0, pp_steps_between_trims=1
+        )
+        assert value == pytest.approx(self.UNTRUNCATED, abs=1e-9)
+        assert error == pytest.approx(self.UNTRUNCATED, abs=1e-9)
+
+    def test_path_frequency_without_cadence_is_inert(self):
+        value, error = self._estimate_xx(pp_max_path_frequency=0)
+        assert value == pytest.approx(self.UNTRUNCATED, abs=1e-9)
+        assert error == 0.0
+
+    def test_error_budget_caps_the_dropped_terms(self):
+        """Only one of the branches fits in the budget."""
+        value, error = self._estimate_xx(
+            pp_coefficient_threshold=0.99,
+            pp_steps_between_trims=1,
+            pp_truncation_error_budget=0.75,
+        )
+        assert error == pytest.approx(self.UNTRUNCATED, abs=1e-9)
+        assert error <= 0.75
+        assert abs(value - self.UNTRUNCATED) <= error + 1e-9
+
+
 class TestExtendedStabilizerSimulation:
     """Test the Extended Stabilizer simulation backend"""
 
@@ -1735,6 +1793,71 @@ class TestGetStatevector:
             assert abs(amp) ** 2 == pytest.approx(prob, abs=1e-10)
 
 
+class TestGetAmplitudes:
+    """Test the get_amplitudes function for batched amplitude computation."""
+
+    def _circuit(self):
+        from maestro.circuits import QuantumCircuit
+        qc = QuantumCircuit()
+        for q in range(4):
+            qc.h(q)
+        qc.cx(0, 1)
+        qc.rz(1, 0.3)
+        qc.cx(1, 2)
+        qc.ry(2, 0.7)
+        qc.cx(2, 3)
+        qc.t(3)
+        return qc
+
+    def test_get_amplitudes_matches_statevector(self):
+        """The batched amplitudes are the statevector entries."""
+        qc = self._circuit()
+        outcomes = [0, 3, 5, 9, 15, 3]
+
+        sv = maestro.get_statevector(qc)
+        amps = maestro.get_amplitudes(qc, outcomes)
+        assert len(amps) == len(outcomes)
+        for outcome, amp in zip(outcomes, amps):
+            assert amp == pytest.approx(sv[outcome], abs=1e-10)
+
+    def test_get_amplitudes_tensor_network(self):
+        """The tensor network simulator gives the same amplitudes."""
+        qc = self._circuit()
+        outcomes = list(range(16))
+
+        sv = maestro.get_statevector(qc)
+        amps = qc.get_amplitudes(
+            outcomes,
+            config=maestro.SimulatorConfig(
+                simulator_type=maestro.SimulatorType.QCSim,
+                simulation_type=maestro.SimulationType.TensorNetwork
+            ),
+        )
+        for outcome, amp in zip(outcomes, amps):
+            assert amp == pytest.approx(sv[outcome], abs=1e-8)
+
+    def test_get_amplitudes_tensor_network_memory_limit(self):
+        """The sliced contractions give the same amplitudes.
+
+        The limit allows tensors up to rank 2 (4 complex values), the tensors
+        of the cx gates have rank 4, so every contraction has to be sliced,
+        including the ones with open qubits.
+        """
+        qc = self._circuit()
+        outcomes = list(range(16))
+
+        config = maestro.SimulatorConfig(
+            simulator_type=maestro.SimulatorType.QCSim,
+            simulation_type=maestro.SimulationType.TensorNetwork
+        )
+        config.tn_memory_limit = 64
+
+        sv = maestro.get_statevector(qc)
+        amps = qc.get_amplitudes(outcomes, config=config)
+        for outcome, amp in zip(outcomes, amps):
+            assert amp == pytest.approx(sv[outcome], abs=1e-8)
+
+
 class TestMirrorFidelity:
     """Test the mirror_fidelity function and circuit method.
 
@@ -2560,6 +2683,19 @@ class TestNoisyExecute:
         # X gate on |0⟩ → |1⟩, always
         assert counts.get('1', 0) == 100
 
+    def test_zero_noise_keeps_classical_bits(self):
+        """Measurements into higher classical bits give the same keys as
+        the noiseless execution."""
+        from maestro.circuits import QuantumCircuit
+        qc = QuantumCircuit()
+        qc.x(0)
+        qc.measure([(0, 3)])
+
+        nm = maestro.NoiseModel()  # no noise
+        result = maestro.noisy_execute(qc, nm, shots=100, seed=42)
+        expected = qc.execute(shots=100)
+        assert result['counts'] == expected['counts']
+
     def test_noise_introduces_errors(self):
         """With noise, we should see some bit errors."""
         from maestro.circuits import QuantumCircuit
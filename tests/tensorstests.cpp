@@ -20,6 +20,7 @@ namespace bdata = boost::unit_test::data;
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <sstream>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -40,6 +41,7 @@ namespace bdata = boost::unit_test::data;
 #include "../TensorNetworks/ForestContractor.h"
 #include "../TensorNetworks/DumbContractor.h"
 #include "../TensorNetworks/LookaheadContractor.h"
+#include "../TensorNetworks/PartitionContractor.h"
 
 struct TensorsTestFixture {
   TensorsTestFixture() : g(std::random_device{}()), boolDist(0.5) {
@@ -621,6 +623,150 @@ BOOST_FIXTURE_TEST_CASE(TensorsInitializationTest, TensorsTestFixture) {
   BOOST_TEST(qcsimMPS);
 }
 
+BOOST_DATA_TEST_CASE(TensorsContractionTest, bdata::xrange(0, 4),
+                     nrContracted) {
+  std::mt19937 g(std::random_device{}());
+  std::uniform_real_distribution<double> dist(-1., 1.);
+
+  // the contracted indices are scattered, to force permutations
+  const std::vector<size_t> dims1{2, 3, 2, 2, 3, 2};
+  const std::vector<size_t> dims2{3, 2, 2, 2, 3, 2};
+  const std::vector<std::pair<size_t, size_t>> allIndices{
+      {4, 0}, {1, 4}, {2, 3}};
+  const std::vector<std::pair<size_t, size_t>> indices(
+      allIndices.begin(), allIndices.begin() + nrContracted);
+
+  Utils::Tensor<> tensor1(dims1);
+  Utils::Tensor<> tensor2(dims2);
+  for (size_t i = 0; i < tensor1.GetSize(); ++i)
+    tensor1[i] = std::complex<double>(dist(g), dist(g));
+  for (size_t i = 0; i < tensor2.GetSize(); ++i)
+    tensor2[i] = std::complex<double>(dist(g), dist(g));
+
+  const auto result = tensor1.Contract(tensor2, indices);
+  BOOST_TEST(result.GetRank() ==
+             dims1.size() + dims2.size() - 2 * indices.size());
+
+  // compare with the contraction done element by element
+  Utils::Tensor<> expected(result.GetDims());
+  std::vector<size_t> indices1(dims1.size(), 0);
+  do {
+    std::vector<size_t> indices2(dims2.size(), 0);
+    do {
+      const bool matching =
+          std::all_of(indices.begin(), indices.end(), [&](const auto& p) {
+            return indices1[p.first] == indices2[p.second];
+          });
+      if (!matching) continue;
+
+      std::vector<size_t> resIndices;
+      for (size_t i = 0; i < dims1.size(); ++i)
+        if (std::none_of(indices.begin(), indices.end(),
+                         [i](const auto& p) { return p.first == i; }))
+          resIndices.push_back(indices1[i]);
+      for (size_t i = 0; i < dims2.size(); ++i)
+        if (std::none_of(indices.begin(), indices.end(),
+                         [i](const auto& p) { return p.second == i; }))
+          resIndices.push_back(indices2[i]);
+
+      expected[resIndices] += tensor1[indices1] * tensor2[indices2];
+    } while (tensor2.IncrementIndex(indices2));
+  } while (tensor1.IncrementIndex(indices1));
+
+  for (size_t i = 0; i < result.GetSize(); ++i)
+    BOOST_CHECK_PREDICATE(checkClose, (result[i])(expected[i])(1e-10));
+
+  // a single index pair goes through the same kernel
+  if (nrContracted == 1) {
+    const auto result1 =
+        tensor1.Contract(tensor2, indices[0].first, indices[0].second);
+    for (size_t i = 0; i < result.GetSize(); ++i)
+      BOOST_CHECK_PREDICATE(checkClose, (result1[i])(expected[i])(1e-10));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TensorsPooledStorageTest) {
+  std::mt19937 g(std::random_device{}());
+  std::uniform_real_distribution<double> dist(-1., 1.);
+
+  const std::vector<size_t> dims1{2, 3, 2, 2};
+  const std::vector<size_t> dims2{3, 2, 2, 2};
+  const std::vector<std::pair<size_t, size_t>> indices{{1, 0}, {3, 2}};
+
+  Utils::Tensor<> tensor1(dims1);
+  Utils::Tensor<> tensor2(dims2);
+  for (size_t i = 0; i < tensor1.GetSize(); ++i)
+    tensor1[i] = std::complex<double>(dist(g), dist(g));
+  for (size_t i = 0; i < tensor2.GetSize(); ++i)
+    tensor2[i] = std::complex<double>(dist(g), dist(g));
+
+  // the values are aligned for SIMD and a new tensor starts zeroed
+  BOOST_TEST(reinterpret_cast<uintptr_t>(&tensor1.GetValues()[0]) %
+                 Utils::TensorMemoryPool::Alignment ==
+             0);
+  const Utils::Tensor<> zero(dims1);
+  for (size_t i = 0; i < zero.GetSize(); ++i)
+    BOOST_TEST(zero[i] == std::complex<double>(0., 0.));
+
+  // the same results as with the std::valarray storage
+  using ValarrayTensor =
+      Utils::Tensor<std::complex<double>, std::valarray<std::complex<double>>>;
+  ValarrayTensor vtensor1(dims1);
+  ValarrayTensor vtensor2(dims2);
+  for (size_t i = 0; i < tensor1.GetSize(); ++i) vtensor1[i] = tensor1[i];
+  for (size_t i = 0; i < tensor2.GetSize(); ++i) vtensor2[i] = tensor2[i];
+
+  const auto expected = vtensor1.Contract(vtensor2, indices);
+  const auto result = tensor1.Contract(tensor2, indices);
+  BOOST_TEST(result.GetDims() == expected.GetDims());
+  for (size_t i = 0; i < result.GetSize(); ++i)
+    BOOST_CHECK_PREDICATE(checkClose, (result[i])(expected[i])(1e-10));
+
+  // contracting into a destination reuses its storage
+  Utils::Tensor<> destination;
+  tensor1.Contract(tensor2, indices, destination);
+  const auto *buffer = &destination.GetValues()[0];
+
+  Utils::TensorMemoryPool::ResetStatistics();
+  for (int rep = 0; rep < 10; ++rep) {
+    tensor1[rep] *= 2.;
+    vtensor1[rep] *= 2.;
+
+    tensor1.Contract(tensor2, indices, destination);
+    BOOST_TEST(&destination.GetValues()[0] == buffer);
+  }
+
+  const auto expected2 = vtensor1.Contract(vtensor2, indices);
+  BOOST_TEST(destination.GetDims() == expected2.GetDims());
+  for (size_t i = 0; i < destination.GetSize(); ++i)
+    BOOST_CHECK_PREDICATE(checkClose,
+                          (destination[i])(expected2[i])(1e-10));
+
+  // the permutation buffers are the only allocations and they come from the
+  // free lists
+  const auto stats = Utils::TensorMemoryPool::GetStatistics();
+  BOOST_TEST(stats.allocations == stats.deallocations);
+  BOOST_TEST(stats.poolHits == stats.allocations);
+
+  // the free lists are bounded and released by trimming (the other threads
+  // may keep some blocks as well)
+  const size_t maxCachedBytes = Utils::TensorMemoryPool::GetMaxCachedBytes();
+  Utils::TensorMemoryPool::Trim();
+  const size_t othersCachedBytes =
+      Utils::TensorMemoryPool::GetStatistics().bytesCached;
+  Utils::TensorMemoryPool::SetMaxCachedBytes(othersCachedBytes + 4096);
+  {
+    std::vector<Utils::Tensor<>> tensors(10, Utils::Tensor<>(dims1));
+  }
+  BOOST_TEST(Utils::TensorMemoryPool::GetStatistics().bytesCached <=
+             othersCachedBytes + 4096);
+
+  Utils::TensorMemoryPool::Trim();
+  BOOST_TEST(Utils::TensorMemoryPool::GetStatistics().bytesCached ==
+             othersCachedBytes);
+  Utils::TensorMemoryPool::SetMaxCachedBytes(maxCachedBytes);
+}
+
 BOOST_FIXTURE_TEST_CASE(TensorsOneQubitEmptyCircuitTest, TensorsTestFixture) {
   const double prob = tensorNetworkOneQubit->Probability(0);
 
@@ -1011,6 +1157,535 @@ BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSimpleRandomCircsMeasTest,
   }
 }
 
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsCachedPathsMeasTest,
+                       bdata::xrange(10, 15), nrGates) {
+  // the same network, contracted without caching the paths
+  auto uncachedContractor =
+      std::make_shared<TensorNetworks::ForestContractor>();
+  uncachedContractor->SetMaxCachedPaths(0);
+  TensorNetworks::TensorNetwork uncachedNetwork(nrQubits);
+  uncachedNetwork.SetContractor(uncachedContractor);
+
+  GenerateCircuits(nrGates);
+
+  for (int g = 0; g < nrGates; ++g) {
+    const QC::Gates::QuantumGateWithOp<
+        TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+    tensorNetwork->AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                           randomQcSimCirc[g]->getQubit2());
+    uncachedNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                            randomQcSimCirc[g]->getQubit2());
+  }
+
+  // the paths are reused from the second shot on, with the collapsed qubits
+  // changing the tensors
+  for (int shot = 0; shot < 10; ++shot) {
+    tensorNetwork->SaveState();
+    uncachedNetwork.SaveState();
+
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const double prob1 = tensorNetwork->Probability(q, false);
+      const double prob2 = uncachedNetwork.Probability(q, false);
+      BOOST_CHECK_PREDICATE(checkClose, (prob1)(prob2)(0.000001));
+
+      const bool one = boolDist(g) ? prob2 > 0.5 : prob2 > 0.05;
+      const double prob = one ? prob2 : 1. - prob2;
+      tensorNetwork->AddProjectorOp(q, !one, prob);
+      uncachedNetwork.AddProjectorOp(q, !one, prob);
+    }
+
+    tensorNetwork->RestoreState();
+    uncachedNetwork.RestoreState();
+  }
+
+  tensorNetwork->Clear();
+  randomCirc->Clear();
+  randomQcSimCirc.clear();
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsCachedPathsBytesTest,
+                       bdata::xrange(10, 15), nrGates) {
+  // a cache too small for all the paths, it's cleared when it's full
+  const size_t maxCachedBytes = 4096;
+  auto smallCacheContractor =
+      std::make_shared<TensorNetworks::ForestContractor>();
+  smallCacheContractor->SetMaxCachedBytes(maxCachedBytes);
+  TensorNetworks::TensorNetwork smallCacheNetwork(nrQubits);
+  smallCacheNetwork.SetContractor(smallCacheContractor);
+
+  auto uncachedContractor =
+      std::make_shared<TensorNetworks::ForestContractor>();
+  uncachedContractor->SetMaxCachedPaths(0);
+  TensorNetworks::TensorNetwork uncachedNetwork(nrQubits);
+  uncachedNetwork.SetContractor(uncachedContractor);
+
+  GenerateCircuits(nrGates);
+
+  for (int g = 0; g < nrGates; ++g) {
+    const QC::Gates::QuantumGateWithOp<
+        TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+    smallCacheNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                              randomQcSimCirc[g]->getQubit2());
+    uncachedNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                            randomQcSimCirc[g]->getQubit2());
+  }
+
+  for (int shot = 0; shot < 3; ++shot)
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const double prob1 = smallCacheNetwork.Probability(q, false);
+      const double prob2 = uncachedNetwork.Probability(q, false);
+      BOOST_CHECK_PREDICATE(checkClose, (prob1)(prob2)(0.000001));
+      BOOST_TEST(smallCacheContractor->GetCachedBytes() <= maxCachedBytes);
+    }
+
+  randomCirc->Clear();
+  randomQcSimCirc.clear();
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSaveLoadTest,
+                       bdata::xrange(10, 15), nrGates) {
+  GenerateCircuits(nrGates);
+
+  for (int g = 0; g < nrGates; ++g) {
+    const QC::Gates::QuantumGateWithOp<
+        TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+    tensorNetwork->AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                           randomQcSimCirc[g]->getQubit2());
+  }
+
+  // a saved state and a collapsed qubit, with the contraction paths cached
+  tensorNetwork->SaveState();
+  const double prob0 = tensorNetwork->Probability(0, false);
+  const bool one = prob0 > 0.5;
+  tensorNetwork->AddProjectorOp(0, !one, one ? prob0 : 1. - prob0);
+
+  std::vector<double> probs(nrQubits);
+  for (size_t q = 0; q < nrQubits; ++q)
+    probs[q] = tensorNetwork->Probability(q, false);
+
+  std::stringstream stream;
+  tensorNetwork->Save(stream);
+
+  TensorNetworks::TensorNetwork loadedNetwork(1);
+  loadedNetwork.SetContractor(
+      std::make_shared<TensorNetworks::ForestContractor>());
+  loadedNetwork.Load(stream);
+  BOOST_TEST(loadedNetwork.GetNumQubits() == nrQubits);
+
+  for (size_t q = 0; q < nrQubits; ++q) {
+    const double prob = loadedNetwork.Probability(q, false);
+    BOOST_CHECK_PREDICATE(checkClose, (prob)(probs[q])(0.000001));
+  }
+
+  tensorNetwork->RestoreState();
+  loadedNetwork.RestoreState();
+  for (size_t q = 0; q < nrQubits; ++q) {
+    const double prob1 = tensorNetwork->Probability(q, false);
+    const double prob2 = loadedNetwork.Probability(q, false);
+    BOOST_CHECK_PREDICATE(checkClose, (prob1)(prob2)(0.000001));
+  }
+
+  // truncated data is rejected, leaving the network unchanged
+  std::stringstream withoutCache;
+  tensorNetwork->Save(withoutCache, false);
+  const std::string data = withoutCache.str();
+  std::stringstream truncated(data.substr(0, data.size() / 2));
+  TensorNetworks::TensorNetwork otherNetwork(2);
+  BOOST_CHECK_THROW(otherNetwork.Load(truncated), std::runtime_error);
+  BOOST_TEST(otherNetwork.GetNumQubits() == 2);
+
+  // so is a saved state past the saved tensors: the empty saved state of a
+  // network (sizes of the tensors, the four last tensors vectors, the qubits
+  // map and the groups) is replaced, the settings after it are kept
+  TensorNetworks::TensorNetwork unsaved(2);
+  std::stringstream unsavedStream;
+  unsaved.Save(unsavedStream, false);
+  const std::string unsavedData = unsavedStream.str();
+  const size_t savedStateSize = 8 * sizeof(uint64_t);
+  const size_t settingsSize = 2 + sizeof(uint64_t) + 1;
+  std::stringstream unsavedCopy(unsavedData);
+  BOOST_CHECK_NO_THROW(otherNetwork.Load(unsavedCopy));
+
+  std::stringstream savedState;
+  Utils::BinaryWriter savedWriter(savedState);
+  savedWriter.WriteSize(0);
+  savedWriter.WriteSize(0);
+  for (int v = 0; v < 4; ++v)
+    savedWriter.WriteVector(std::vector<Eigen::Index>{5, 5});
+  savedWriter.WriteVector(std::vector<size_t>{});
+  savedWriter.WriteSize(0);
+  std::stringstream invalidSavedState(
+      unsavedData.substr(0, unsavedData.size() - savedStateSize -
+                                settingsSize) +
+      savedState.str() + unsavedData.substr(unsavedData.size() - settingsSize));
+  BOOST_CHECK_THROW(otherNetwork.Load(invalidSavedState), std::runtime_error);
+
+  // so are corrupted sizes, instead of being allocated
+  std::stringstream corrupted;
+  Utils::BinaryWriter writer(corrupted);
+  writer.WriteSize(1ULL << 60);
+  writer.WriteSize(1ULL << 40);
+  writer.Write(false);
+  {
+    Utils::BinaryReader reader(corrupted);
+    BOOST_CHECK_THROW(reader.ReadVector<double>(), std::runtime_error);
+  }
+  corrupted.clear();
+  corrupted.seekg(0);
+  {
+    Utils::BinaryReader reader(corrupted);
+    BOOST_CHECK_THROW(reader.ReadString(), std::runtime_error);
+  }
+  std::stringstream corruptedTensor;
+  Utils::BinaryWriter tensorWriter(corruptedTensor);
+  tensorWriter.WriteVector(std::vector<size_t>{1ULL << 20, 1ULL << 20});
+  tensorWriter.Write(false);
+  {
+    Utils::BinaryReader reader(corruptedTensor);
+    Utils::Tensor<> tensor;
+    BOOST_CHECK_THROW(tensor.Load(reader), std::runtime_error);
+  }
+
+  tensorNetwork->Clear();
+  randomCirc->Clear();
+  randomQcSimCirc.clear();
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSampleCountsTest,
+                       bdata::xrange(10, 15), nrGates) {
+  const size_t nrStates = 1ULL << nrQubits;
+  const size_t nrSamples = 20000;
+  Circuits::OperationState stateDummy(nrQubits);
+
+  std::vector<Types::qubit_t> qubits(nrQubits);
+  for (size_t q = 0; q < nrQubits; ++q) qubits[q] = q;
+
+  for (int t = 0; t < 3; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      tensorNetwork->AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                             randomQcSimCirc[g]->getQubit2());
+    }
+
+    const double probBefore = tensorNetwork->Probability(0);
+
+    const auto counts = tensorNetwork->SampleCounts(qubits, nrSamples);
+
+    // the network is left as it was
+    BOOST_CHECK_PREDICATE(checkClose, (tensorNetwork->Probability(0))(
+                                          probBefore)(0.000001));
+
+    std::vector<double> frequencies(nrStates, 0.);
+    size_t total = 0;
+    for (const auto& [outcome, count] : counts) {
+      BOOST_TEST(outcome.size() == nrQubits);
+      size_t state = 0;
+      for (size_t q = 0; q < nrQubits; ++q)
+        if (outcome[q]) state |= 1ULL << q;
+
+      frequencies[state] +=
+          static_cast<double>(count) / static_cast<double>(nrSamples);
+      total += count;
+    }
+    BOOST_TEST(total == nrSamples);
+
+    for (size_t state = 0; state < nrStates; ++state)
+      BOOST_CHECK_PREDICATE(checkClose,
+                            (frequencies[state])(qc->Probability(state))(0.03));
+
+    // repeated qubits get the same outcome
+    const auto repeated = tensorNetwork->SampleCounts({1, 0, 1}, 100);
+    for (const auto& [outcome, count] : repeated)
+      BOOST_TEST(outcome[0] == outcome[2]);
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    tensorNetwork->Clear();
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsLightConeExpectationValuesTest,
+                       bdata::xrange(10, 20), nrGates) {
+  Circuits::OperationState stateDummy(nrQubits);
+  std::uniform_int_distribution<int> opDist(0, 3);
+
+  for (int t = 0; t < 5; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      tensorNetwork->AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                             randomQcSimCirc[g]->getQubit2());
+    }
+
+    // mostly local strings, to have gates out of their light cone
+    std::vector<std::string> pauliStrings;
+    for (int i = 0; i < 10; ++i) {
+      std::string pauliString(nrQubits, 'I');
+      pauliString[i % nrQubits] = "IXYZ"[opDist(g)];
+      if (i % 3 == 0) pauliString[(i + 1) % nrQubits] = "IXYZ"[opDist(g)];
+      pauliStrings.emplace_back(std::move(pauliString));
+    }
+
+    const auto values = tensorNetwork->ExpectationValues(pauliStrings);
+
+    for (size_t i = 0; i < pauliStrings.size(); ++i) {
+      const double expected = qc->ExpectationValue(pauliStrings[i]);
+      BOOST_CHECK_PREDICATE(checkClose, (values[i])(expected)(0.000001));
+      BOOST_CHECK_PREDICATE(
+          checkClose,
+          (tensorNetwork->ExpectationValue(pauliStrings[i]))(expected)(0.000001));
+    }
+
+    // the network is not changed by the simplification
+    tensorNetwork->SetLightConeCancellation(false);
+    for (size_t q = 0; q < nrQubits; ++q) {
+      std::string pauliString(nrQubits, 'I');
+      pauliString[q] = 'Z';
+      const double expected = 2. * tensorNetwork->Probability(q) - 1.;
+      BOOST_CHECK_PREDICATE(
+          checkClose,
+          (tensorNetwork->ExpectationValue(pauliString))(expected)(0.000001));
+    }
+    tensorNetwork->SetLightConeCancellation(true);
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    tensorNetwork->Clear();
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsBatchedAmplitudesTest,
+                       bdata::xrange(10, 20), nrGates) {
+  const size_t nrStates = 1ULL << nrQubits;
+  Circuits::OperationState stateDummy(nrQubits);
+  std::uniform_int_distribution<Types::qubit_t> outcomeDist(0, nrStates - 1);
+
+  for (int t = 0; t < 5; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      tensorNetwork->AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                             randomQcSimCirc[g]->getQubit2());
+    }
+
+    // all the states, with slabs as large as possible
+    std::vector<Types::qubit_t> outcomes(nrStates);
+    for (size_t state = 0; state < nrStates; ++state) outcomes[state] = state;
+
+    auto amplitudes = tensorNetwork->Amplitudes(outcomes);
+    for (size_t state = 0; state < nrStates; ++state)
+      BOOST_CHECK_PREDICATE(
+          checkClose, (amplitudes[state])(qc->Amplitude(state))(0.000001));
+
+    // a few states, with repetitions, also with all the qubits closed
+    outcomes.resize(6);
+    for (auto& outcome : outcomes) outcome = outcomeDist(g);
+    outcomes.push_back(outcomes[0]);
+
+    for (const size_t maxOpen : {0, 10}) {
+      tensorNetwork->SetMaxOpenQubits(maxOpen);
+      amplitudes = tensorNetwork->Amplitudes(outcomes);
+      for (size_t i = 0; i < outcomes.size(); ++i)
+        BOOST_CHECK_PREDICATE(
+            checkClose,
+            (amplitudes[i])(qc->Amplitude(outcomes[i]))(0.000001));
+    }
+
+    // the network is not changed
+    for (size_t q = 0; q < nrQubits; ++q) {
+      double prob = 0.;
+      const size_t qubitMask = 1ULL << q;
+      for (size_t state = 0; state < nrStates; ++state)
+        if ((state & qubitMask) == 0) prob += qc->Probability(state);
+
+      BOOST_CHECK_PREDICATE(checkClose,
+                            (tensorNetwork->Probability(q))(prob)(0.000001));
+    }
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    tensorNetwork->Clear();
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsPartitionContractorTest,
+                       bdata::xrange(10, 20), nrGates) {
+  const size_t nrStates = 1ULL << nrQubits;
+  Circuits::OperationState stateDummy(nrQubits);
+
+  auto partitionContractor =
+      std::make_shared<TensorNetworks::PartitionContractor>();
+  partitionContractor->SetNumberOfTrials(4);
+  partitionContractor->SetTimeBudget(0.1);
+  TensorNetworks::TensorNetwork partitionNetwork(nrQubits);
+  partitionNetwork.SetContractor(partitionContractor);
+
+  for (int t = 0; t < 5; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      partitionNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                               randomQcSimCirc[g]->getQubit2());
+    }
+
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const double prob1 = partitionNetwork.Probability(q);
+
+      // sum up all probabilities where the qubit is zero
+      double prob2 = 0.;
+      const size_t qubitMask = 1ULL << q;
+      for (size_t state = 0; state < nrStates; ++state)
+        if ((state & qubitMask) == 0) prob2 += qc->Probability(state);
+
+      BOOST_CHECK_PREDICATE(checkClose, (prob1)(prob2)(0.000001));
+    }
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    partitionNetwork.Clear();
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSlicedContractionTest,
+                       bdata::xrange(10, 15), nrGates) {
+  const size_t nrStates = 1ULL << nrQubits;
+  Circuits::OperationState stateDummy(nrQubits);
+
+  // the intermediate tensors can have at most rank 4, like the tensors of the
+  // two qubit gates
+  auto partitionContractor =
+      std::make_shared<TensorNetworks::PartitionContractor>();
+  partitionContractor->SetNumberOfTrials(4);
+  partitionContractor->SetTimeBudget(0.1);
+  partitionContractor->SetMemoryLimit(16 * sizeof(std::complex<double>));
+  TensorNetworks::TensorNetwork partitionNetwork(nrQubits);
+  partitionNetwork.SetContractor(partitionContractor);
+
+  for (int t = 0; t < 3; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      partitionNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                               randomQcSimCirc[g]->getQubit2());
+    }
+
+    for (size_t q = 0; q < nrQubits; ++q) {
+      const double prob1 = partitionNetwork.Probability(q);
+      BOOST_CHECK(partitionContractor->GetMaxTensorRank() <= 4);
+
+      double prob2 = 0.;
+      const size_t qubitMask = 1ULL << q;
+      for (size_t state = 0; state < nrStates; ++state)
+        if ((state & qubitMask) == 0) prob2 += qc->Probability(state);
+
+      BOOST_CHECK_PREDICATE(checkClose, (prob1)(prob2)(0.000001));
+    }
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    partitionNetwork.Clear();
+  }
+}
+
+BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSlicedAmplitudesTest,
+                       bdata::xrange(10, 15), nrGates) {
+  const size_t nrStates = 1ULL << nrQubits;
+  Circuits::OperationState stateDummy(nrQubits);
+
+  // the intermediate tensors can have at most rank 2, less than the tensors of
+  // the two qubit gates, so the contractions are sliced, also the ones with
+  // open qubits
+  auto partitionContractor =
+      std::make_shared<TensorNetworks::PartitionContractor>();
+  partitionContractor->SetNumberOfTrials(4);
+  partitionContractor->SetTimeBudget(0.1);
+  partitionContractor->SetMemoryLimit(4 * sizeof(std::complex<double>));
+  TensorNetworks::TensorNetwork partitionNetwork(nrQubits);
+  partitionNetwork.SetContractor(partitionContractor);
+
+  for (int t = 0; t < 3; ++t) {
+    GenerateCircuits(nrGates);
+
+    randomCirc->Execute(qc, stateDummy);
+
+    for (int g = 0; g < nrGates; ++g) {
+      const QC::Gates::QuantumGateWithOp<
+          TensorNetworks::TensorNode::MatrixClass>& gate = *randomQcSimCirc[g];
+      partitionNetwork.AddGate(gate, randomQcSimCirc[g]->getQubit1(),
+                               randomQcSimCirc[g]->getQubit2());
+    }
+
+    std::vector<Types::qubit_t> outcomes(nrStates);
+    for (size_t state = 0; state < nrStates; ++state) outcomes[state] = state;
+
+    bool twoQubitsGates = false;
+    for (const auto& gate : randomQcSimCirc)
+      if (gate->getQubitsNumber() > 1) twoQubitsGates = true;
+
+    const auto amplitudes = partitionNetwork.Amplitudes(outcomes);
+    if (twoQubitsGates)
+      BOOST_CHECK(partitionContractor->GetLastSlicedIndices() > 0);
+    for (size_t state = 0; state < nrStates; ++state)
+      BOOST_CHECK_PREDICATE(
+          checkClose, (amplitudes[state])(qc->Amplitude(state))(0.000001));
+
+    qc->Clear();
+    qc->AllocateQubits(nrQubits);
+    qc->Initialize();
+
+    randomCirc->Clear();
+    randomQcSimCirc.clear();
+
+    partitionNetwork.Clear();
+  }
+}
+
 BOOST_DATA_TEST_CASE_F(TensorsTestFixture, TensorsSimpleRandomForestCircsTest,
                        bdata::xrange(20, 30), nrGates) {
   const size_t nrStates = 1ULL << nrQubitsForest;